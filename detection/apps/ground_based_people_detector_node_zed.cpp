@@ -204,7 +204,8 @@ cloud_cb (const Image::ConstPtr& rgb_image, const Image::ConstPtr& depth_image)
 	  	}
     
 		
-		*cloud = *point_cloud;
+		// A new cloud is built at every frame, so it is handed to the main loop without copying it:
+		cloud = point_cloud;
 		new_cloud_available_flag = true;
 		
 		if(pub_cloud.getNumSubscribers() > 0)
@@ -0,0 +1,1260 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Matteo Munaro [matteo.munaro@dei.unipd.it]
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * ground_based_people_detector_node.cpp
+ * Created on: Jul 07, 2013
+ * Author: Matteo Munaro
+ *
+ * ROS nodelet which performs people detection assuming that people stand/walk on a ground plane.
+ * As a first step, the ground is manually initialized, then people detection is performed with the GroundBasedPeopleDetectionApp class,
+ * which implements the people detection algorithm described here:
+ * M. Munaro, F. Basso and E. Menegatti,
+ * Tracking people within groups with RGB-D data,
+ * In Proceedings of the International Conference on Intelligent Robots and Systems (IROS) 2012, Vilamoura (Portugal), 2012.
+ */
+
+// ROS includes:
+#include <ros/ros.h>
+#include <ros/package.h>
+
+// PCL includes:
+#include <pcl/conversions.h>
+#include <pcl_ros/point_cloud.h>
+#include <pcl/point_types.h>
+#include <pcl/visualization/pcl_visualizer.h>
+#include <pcl/sample_consensus/sac_model_plane.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <tf/transform_listener.h>
+
+// Open PTrack includes:
+#include <open_ptrack/detection/ground_segmentation.h>
+#include <open_ptrack/detection/ground_based_people_detection_app.h>
+#include <open_ptrack/detection/detector_host.h>
+#include <open_ptrack/detection/exclusion_mask.h>
+#include <open_ptrack/opt_utils/conversions.h>
+#include <open_ptrack/opt_utils/latency_reporter.h>
+#include <open_ptrack/opt_utils/mailbox.h>
+
+//Publish Messages
+#include <opt_msgs/RoiRect.h>
+#include <opt_msgs/Rois.h>
+#include <std_msgs/String.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/image_encodings.h>
+#include <opt_msgs/Detection.h>
+#include <opt_msgs/DetectionArray.h>
+
+// Dynamic reconfigure:
+#include <dynamic_reconfigure/server.h>
+#include <detection/GroundBasedPeopleDetectorConfig.h>
+
+// Time synchronization of depth and RGB images:
+#include <message_filters/subscriber.h>
+#include <message_filters/synchronizer.h>
+#include <message_filters/sync_policies/approximate_time.h>
+
+// Nodelet:
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace opt_msgs;
+using namespace sensor_msgs;
+
+namespace open_ptrack
+{
+namespace detection
+{
+
+typedef pcl::PointXYZRGB PointT;
+typedef pcl::PointCloud<PointT> PointCloudT;
+typedef ::detection::GroundBasedPeopleDetectorConfig Config;
+typedef dynamic_reconfigure::Server<Config> ReconfigureServer;
+typedef GroundBasedPeopleDetectionApp<PointT>::Frame DetectionFrame;
+
+/** \brief Frame in the detection pipeline */
+struct PipelineFrame
+{
+  DetectionFrame detection;
+  std::chrono::steady_clock::time_point start;    // time the cloud was taken
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+typedef boost::shared_ptr<PipelineFrame> PipelineFramePtr;
+
+/** \brief RGB-D images pointing into the ROS messages, which are kept alive with them */
+struct RGBDImageMessages : public RGBDImage
+{
+  sensor_msgs::Image::ConstPtr depth_msg;
+  sensor_msgs::Image::ConstPtr color_msg;
+};
+
+typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Image, sensor_msgs::Image,
+    sensor_msgs::CameraInfo> ImagesSyncPolicy;
+typedef message_filters::Synchronizer<ImagesSyncPolicy> ImagesSynchronizer;
+
+/** \brief Bounded queue of frames between two stages of the detection pipeline (one thread on each side) */
+struct StageQueue
+{
+  explicit StageQueue(size_t capacity) :
+    capacity(capacity)
+  {
+
+  }
+
+  std::deque<PipelineFramePtr> frames;
+  size_t capacity;
+  std::mutex mutex;                     // guards frames, held across push/pop and wait
+  std::condition_variable changed;      // notified at every push and pop
+};
+
+/**
+ * \brief GroundBasedPeopleDetectorNodelet detects people in the point clouds of a camera
+ *
+ * Loaded in the nodelet manager of the camera driver, it receives the point clouds as shared pointers, without
+ * serialization. Detection runs in a thread of the nodelet, which waits for a valid frame and estimates the ground as
+ * the node did. The ground_based_people_detector node loads it in its own process.
+ *
+ * With background_subtraction, the background is a voxel grid saved in /tmp/background_<frame>.bin, or acquired from
+ * the first background_seconds of frames (and again when requested on update_background_topic, or when max_distance is
+ * reconfigured) without stopping the detection thread. With background_absorb_seconds > 0, objects which stay still
+ * for that time become background, and they stop being background background_release_seconds after they are removed.
+ * Voxels which are occupied in less than half of the frames (people walking by) never become background.
+ *
+ * Exclusion zones (escalators, mirrors, screens...) are given as an image mask (exclusion_mask_file, non-zero pixels
+ * are excluded) and as boxes (exclusion_boxes, 6 values per box: minimum and maximum corner in exclusion_frame). They
+ * are compiled once into a few depth ranges per pixel, and their points are dropped by the first pass of pre-processing.
+ *
+ * With pipelined_detection, the detection stages run in three threads on different frames: the detection thread
+ * does pre-processing, ground removal and background subtraction, the clustering thread does euclidean clustering
+ * and sub-clustering, the classification thread computes the HOG+SVM confidence and publishes the detections.
+ * Stages are connected by bounded queues of pipeline_queue_size frames: a stage waits when the next queue is full,
+ * and the clouds received meanwhile are dropped (only the latest one is kept, as without pipelining).
+ *
+ * With use_depth_image, the nodelet subscribes to the depth image (16UC1, registered to the RGB image), the RGB
+ * image and the camera info instead of the point cloud: only the sampled pixels are back-projected, and the whole
+ * cloud is built only for ground estimation, denoising and when checking the first frames.
+ *
+ * With use_detector_host, the detectors loaded in the same manager share the pool of DetectorHost: once a detector is
+ * initialized, its frames are detected by a task of the pool scheduled when they arrive (one task per camera at a time),
+ * instead of by its thread polling at the given rate. Frames older than latency_budget seconds when their detection
+ * starts are skipped, so that a camera which falls behind catches up instead of delaying the others.
+ */
+class GroundBasedPeopleDetectorNodelet : public nodelet::Nodelet
+{
+public:
+
+  /** \brief Constructor. */
+  GroundBasedPeopleDetectorNodelet();
+
+  /** \brief Destructor (stops the detection thread). */
+  virtual ~GroundBasedPeopleDetectorNodelet();
+
+  /** \brief Start the detection thread. */
+  virtual void
+  onInit();
+
+private:
+
+  void
+  cloud_cb (const PointCloudT::ConstPtr& callback_cloud);
+
+  void
+  images_cb (const sensor_msgs::Image::ConstPtr& depth_msg, const sensor_msgs::Image::ConstPtr& color_msg,
+      const sensor_msgs::CameraInfo::ConstPtr& info_msg);
+
+  void
+  cameraInfoCallback (const sensor_msgs::CameraInfo::ConstPtr & msg);
+
+  void
+  updateBackgroundCallback (const std_msgs::String::ConstPtr & msg);
+
+  bool
+  takeCloud ();
+
+  PointCloudT::ConstPtr
+  inputCloud ();
+
+  const pcl::PCLHeader&
+  inputHeader ();
+
+  std::string
+  backgroundFile () const;
+
+  open_ptrack::detection::ExclusionMask
+  computeExclusionMask (const std::string& mask_file, const std::vector<double>& boxes, const std::string& boxes_frame);
+
+  void
+  configCb(Config &config, uint32_t level);
+
+  static bool
+  fileExists(const char *fileName);
+
+  void
+  detectionLoop ();
+
+  void
+  detectFrame ();
+
+  void
+  reportSkippedFrames ();
+
+  void
+  scheduleDetection ();
+
+  void
+  hostDetection ();
+
+  void
+  shutdownSubscribers ();
+
+  void
+  removeBackgroundFile ();
+
+  void
+  publishDetections (const std_msgs::Header& header, std::vector<pcl::people::PersonCluster<PointT> >& clusters,
+      float mean_luminance, const Eigen::Affine3f& anti_transform);
+
+  bool
+  pushFrame (StageQueue& queue, const PipelineFramePtr& frame);
+
+  bool
+  popFrame (StageQueue& queue, PipelineFramePtr& frame);
+
+  void
+  clusteringLoop ();
+
+  void
+  classificationLoop ();
+
+  PointCloudT::ConstPtr cloud;            // cloud processed by the detection thread (shared with the driver, never modified)
+  RGBDImage::ConstPtr images;             // images processed by the detection thread, with use_depth_image
+  bool use_depth_image;
+  bool intrinsics_already_set;
+  Eigen::Matrix3f intrinsics_matrix;
+  std::atomic<bool> update_background;
+
+  // Min confidence for people detection:
+  double min_confidence;
+  // People detection object
+  open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT> people_detector;
+  // Flag stating if classifiers based on RGB image should be used or not
+  bool use_rgb;
+  // Threshold on image luminance. If luminance is over this threshold, classifiers on RGB image are also used
+  int minimum_luminance;
+  // If true, sensor tilt angle wrt ground plane is compensated to improve people detection
+  bool sensor_tilt_compensation;
+  // Voxel size for downsampling the cloud
+  double voxel_size;
+  // Maximum distance of people from the sensor
+  double max_distance;
+  // If true, do not update the ground plane at every frame
+  bool lock_ground;
+  // Frames to use for updating the background
+  int max_background_frames;
+  // Main loop rate:
+  double rate_value;
+  // Voxel resolution of the grid used to represent the background
+  double background_resolution;
+  // If true, background subtraction is performed
+  bool background_subtraction;
+  // Threshold on the ratio of valid points needed for ground estimation
+  double valid_points_threshold;
+  // Ground plane coefficients (updated at every frame if not lock_ground):
+  Eigen::VectorXf ground_coeffs;
+  // Frame id of the camera:
+  std::string frame_id;
+  // Maximum age of a frame when its detection starts (0 = no limit):
+  double latency_budget;
+  // Frames skipped because of the latency budget, and last report of the skipped frames:
+  unsigned long budget_skipped;
+  ros::WallTime last_drop_report;
+  // Subscribers:
+  ros::Subscriber sub;
+  boost::shared_ptr<message_filters::Subscriber<sensor_msgs::Image> > depth_image_sub, rgb_image_sub;
+  boost::shared_ptr<message_filters::Subscriber<sensor_msgs::CameraInfo> > depth_camera_info_sub;
+  boost::shared_ptr<ImagesSynchronizer> images_sync;
+  ros::Subscriber camera_info_sub;
+  ros::Subscriber update_background_sub;
+  // Publisher of the detections:
+  ros::Publisher detection_pub;
+  // Latency profiling (kept with the nodelet, since in host mode detection goes on after the detection thread):
+  boost::shared_ptr<open_ptrack::opt_utils::LatencyProfiler> latency_profiler;
+  boost::shared_ptr<open_ptrack::opt_utils::LatencyReporter> latency_reporter;
+  // Latency of a whole frame (NULL if latency profiling is disabled):
+  open_ptrack::opt_utils::LatencyHistogram* frame_latency;
+
+  // Latest cloud received, not taken yet by the detection thread:
+  open_ptrack::opt_utils::Mailbox<PointCloudT::ConstPtr> cloud_mailbox;
+  open_ptrack::opt_utils::Mailbox<RGBDImage::ConstPtr> images_mailbox;
+  // People detector and parameters (dynamic reconfigure takes it exclusively, pipeline stages shared):
+  boost::shared_mutex detector_mutex;
+  std::thread detection_thread;
+  // Detection pipeline:
+  bool pipelined_detection;
+  boost::shared_ptr<StageQueue> clustering_queue;         // from the detection thread to the clustering thread
+  boost::shared_ptr<StageQueue> classification_queue;     // from the clustering thread to the classification thread
+  std::thread clustering_thread;
+  std::thread classification_thread;
+  std::atomic<bool> running;
+  // Detection on the pool of the detector host:
+  bool use_detector_host;
+  open_ptrack::opt_utils::WorkStealingPool* host_pool;
+  unsigned int host_worker;                     // home worker of this camera
+  std::atomic<bool> host_ready;                 // true when the initialization is over
+  std::atomic<bool> detection_scheduled;        // true while a detection task of this camera is queued or running
+  std::atomic<int> host_tasks;                  // detection tasks not finished yet
+  boost::recursive_mutex config_mutex_;
+  boost::shared_ptr<ReconfigureServer> reconfigure_server_;
+};
+
+void
+GroundBasedPeopleDetectorNodelet::cloud_cb (const PointCloudT::ConstPtr& callback_cloud)
+{
+  // Only the pointer is handed to the detection thread, the callback never waits for it:
+  cloud_mailbox.put(callback_cloud);
+  scheduleDetection();
+}
+
+void
+GroundBasedPeopleDetectorNodelet::images_cb (const sensor_msgs::Image::ConstPtr& depth_msg,
+    const sensor_msgs::Image::ConstPtr& color_msg, const sensor_msgs::CameraInfo::ConstPtr& info_msg)
+{
+  namespace enc = sensor_msgs::image_encodings;
+
+  int color_channels;
+  if ((color_msg->encoding == enc::RGB8) or (color_msg->encoding == enc::BGR8))
+    color_channels = 3;
+  else if ((color_msg->encoding == enc::RGBA8) or (color_msg->encoding == enc::BGRA8))
+    color_channels = 4;
+  else
+  {
+    ROS_WARN_THROTTLE(10, "[%s] RGB image encoding %s not supported.", getName().c_str(), color_msg->encoding.c_str());
+    return;
+  }
+  if (((depth_msg->encoding != enc::TYPE_16UC1) and (depth_msg->encoding != enc::MONO16)) or depth_msg->is_bigendian)
+  {
+    ROS_WARN_THROTTLE(10, "[%s] Depth image encoding %s not supported (16UC1 in millimeters is expected).",
+        getName().c_str(), depth_msg->encoding.c_str());
+    return;
+  }
+  if ((depth_msg->width != color_msg->width) or (depth_msg->height != color_msg->height))
+  {
+    ROS_WARN_THROTTLE(10, "[%s] Depth image (%dx%d) is not registered to the RGB image (%dx%d).", getName().c_str(),
+        depth_msg->width, depth_msg->height, color_msg->width, color_msg->height);
+    return;
+  }
+
+  // The images are not copied, they are handed to the detection thread with their messages:
+  boost::shared_ptr<RGBDImageMessages> images(new RGBDImageMessages);
+  images->depth_msg = depth_msg;
+  images->color_msg = color_msg;
+  pcl_conversions::toPCL(depth_msg->header, images->header);
+  images->width = depth_msg->width;
+  images->height = depth_msg->height;
+  images->depth = reinterpret_cast<const uint16_t*>(&depth_msg->data[0]);
+  images->depth_step = depth_msg->step;
+  images->depth_scale = 0.001f;
+  images->color = &color_msg->data[0];
+  images->color_step = color_msg->step;
+  images->color_channels = color_channels;
+  images->bgr = (color_msg->encoding == enc::BGR8) or (color_msg->encoding == enc::BGRA8);
+  images->fx = info_msg->K[0];
+  images->fy = info_msg->K[4];
+  images->cx = info_msg->K[2];
+  images->cy = info_msg->K[5];
+  images_mailbox.put(images);
+  scheduleDetection();
+}
+
+/**
+ * \brief Take the latest cloud (or images, with use_depth_image) received, if it has not been taken yet (detection thread only)
+ *
+ * \return true if cloud (or images) is new.
+ */
+bool
+GroundBasedPeopleDetectorNodelet::takeCloud ()
+{
+  if (use_depth_image)
+    return images_mailbox.take(images);
+  return cloud_mailbox.take(cloud);
+}
+
+/**
+ * \brief Cloud of the current frame (back-projected from the images with use_depth_image, which is expensive)
+ */
+PointCloudT::ConstPtr
+GroundBasedPeopleDetectorNodelet::inputCloud ()
+{
+  if (not use_depth_image)
+    return cloud;
+
+  PointCloudT::Ptr image_cloud(new PointCloudT);
+  OrganizedCloudPreprocessor<PointT>::backProject(*images, *image_cloud);
+  return image_cloud;
+}
+
+/** \brief Header of the current frame */
+const pcl::PCLHeader&
+GroundBasedPeopleDetectorNodelet::inputHeader ()
+{
+  return use_depth_image ? images->header : cloud->header;
+}
+
+void
+GroundBasedPeopleDetectorNodelet::cameraInfoCallback (const sensor_msgs::CameraInfo::ConstPtr & msg)
+{
+  if (!intrinsics_already_set)
+  {
+    intrinsics_matrix << msg->K.elems[0], msg->K.elems[1], msg->K.elems[2],
+        msg->K.elems[3], msg->K.elems[4], msg->K.elems[5],
+        msg->K.elems[6], msg->K.elems[7], msg->K.elems[8];
+    intrinsics_already_set = true;
+  }
+}
+
+void
+GroundBasedPeopleDetectorNodelet::updateBackgroundCallback (const std_msgs::String::ConstPtr & msg)
+{
+  if (msg->data == "update")
+  {
+    update_background = true;
+  }
+}
+
+void
+GroundBasedPeopleDetectorNodelet::configCb(Config &config, uint32_t level)
+{
+  boost::unique_lock<boost::shared_mutex> lock(detector_mutex);
+  valid_points_threshold = config.valid_points_threshold;
+
+  min_confidence = config.ground_based_people_detection_min_confidence;
+
+  people_detector.setHeightLimits (config.minimum_person_height, config.maximum_person_height);
+
+  if (config.max_distance != max_distance)
+  {
+    // The background grid is defined again to cover the new distance, so the background has to be acquired again:
+    max_distance = config.max_distance;
+    people_detector.setMaxDistance (config.max_distance);
+    if (background_subtraction)
+      update_background = true;
+  }
+
+  people_detector.setSamplingFactor (config.sampling_factor);
+
+  use_rgb = config.use_rgb;
+  people_detector.setUseRGB (config.use_rgb);
+
+  minimum_luminance = config.minimum_luminance;
+
+  sensor_tilt_compensation = config.sensor_tilt_compensation;
+  people_detector.setSensorTiltCompensation (config.sensor_tilt_compensation);
+
+  people_detector.setMinimumDistanceBetweenHeads (config.heads_minimum_distance);
+
+  voxel_size = config.voxel_size;
+  people_detector.setVoxelSize (config.voxel_size);
+
+  people_detector.setDenoisingParameters (config.apply_denoising, config.mean_k_denoising, config.std_dev_denoising);
+
+  lock_ground = config.lock_ground;
+
+  max_background_frames = int(config.background_seconds * rate_value);
+
+  if (config.background_resolution != background_resolution)
+  {
+    // The background has to be acquired again with the new voxel size:
+    background_resolution = config.background_resolution;
+    people_detector.setBackgroundSubtraction(background_subtraction, background_resolution);
+    if (background_subtraction)
+      update_background = true;
+  }
+
+  if (config.background_subtraction != background_subtraction)
+  {
+    if (config.background_subtraction)
+    {
+      update_background = true;
+    }
+    else
+    {
+      background_subtraction = false;
+      people_detector.setBackgroundSubtraction(false, background_resolution);
+    }
+  }
+}
+
+bool
+GroundBasedPeopleDetectorNodelet::fileExists(const char *fileName)
+{
+    ifstream infile(fileName);
+    return infile.good();
+}
+
+GroundBasedPeopleDetectorNodelet::GroundBasedPeopleDetectorNodelet() :
+  intrinsics_already_set(false),
+  use_depth_image(false),
+  update_background(false),
+  latency_budget(0.0),
+  budget_skipped(0),
+  frame_latency(NULL),
+  pipelined_detection(false),
+  running(false),
+  use_detector_host(false),
+  host_pool(NULL),
+  host_worker(0),
+  host_ready(false),
+  detection_scheduled(false),
+  host_tasks(0)
+{
+
+}
+
+GroundBasedPeopleDetectorNodelet::~GroundBasedPeopleDetectorNodelet()
+{
+  running = false;
+  if (detection_thread.joinable())
+    detection_thread.join();
+  if (clustering_thread.joinable())
+    clustering_thread.join();
+  if (classification_thread.joinable())
+    classification_thread.join();
+  shutdownSubscribers();
+
+  if (host_ready)
+  {
+    // No callback can queue a detection task from now on, wait for the queued one, if any:
+    while (host_tasks > 0)
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    removeBackgroundFile();
+  }
+}
+
+void
+GroundBasedPeopleDetectorNodelet::onInit()
+{
+  // Ground estimation and background acquisition wait for frames, so detection runs in its own thread:
+  running = true;
+  detection_thread = std::thread(&GroundBasedPeopleDetectorNodelet::detectionLoop, this);
+}
+
+/** \brief Main loop of the detection thread (this was the main function of the node). */
+void
+GroundBasedPeopleDetectorNodelet::detectionLoop ()
+{
+  ros::NodeHandle& nh = getPrivateNodeHandle();
+
+  // Read some parameters from launch file:
+  int ground_estimation_mode;
+  nh.param("ground_estimation_mode", ground_estimation_mode, 0);
+  std::string svm_filename;
+
+  nh.param("classifier_file", svm_filename, std::string("./"));
+  nh.param("use_rgb", use_rgb, true);
+  nh.param("minimum_luminance", minimum_luminance, 20);
+  nh.param("ground_based_people_detection_min_confidence", min_confidence, -1.5);
+  nh.param("max_distance", max_distance, 50.0);
+  double min_height;
+  nh.param("minimum_person_height", min_height, 1.3);
+  double max_height;
+  nh.param("maximum_person_height", max_height, 2.3);
+  // Point cloud sampling factor:
+  int sampling_factor;
+  nh.param("sampling_factor", sampling_factor, 1);
+  std::string pointcloud_topic;
+  nh.param("pointcloud_topic", pointcloud_topic, std::string("/camera/depth_registered/points"));
+  std::string output_topic;
+  nh.param("output_topic", output_topic, std::string("/ground_based_people_detector/detections"));
+  std::string camera_info_topic;
+  nh.param("camera_info_topic", camera_info_topic, std::string("/camera/rgb/camera_info"));
+  // If true, depth and RGB images are used instead of the point cloud:
+  nh.param("use_depth_image", use_depth_image, false);
+  std::string depth_image_topic;
+  nh.param("depth_image_topic", depth_image_topic, std::string("/camera/depth_registered/image_raw"));
+  std::string rgb_image_topic;
+  nh.param("rgb_image_topic", rgb_image_topic, std::string("/camera/rgb/image_rect_color"));
+  std::string depth_camera_info_topic;
+  nh.param("depth_camera_info_topic", depth_camera_info_topic, std::string("/camera/depth_registered/camera_info"));
+  nh.param("rate", rate_value, 30.0);
+  // If true, exploit extrinsic calibration for estimatin the ground plane equation:
+  bool ground_from_extrinsic_calibration;
+  nh.param("ground_from_extrinsic_calibration", ground_from_extrinsic_calibration, false);
+  nh.param("lock_ground", lock_ground, false);
+  nh.param("sensor_tilt_compensation", sensor_tilt_compensation, false);
+  nh.param("valid_points_threshold", valid_points_threshold, 0.2);
+  nh.param("background_subtraction", background_subtraction, false);
+  nh.param("background_resolution", background_resolution, 0.3);
+  double background_seconds;      // Number of seconds used to acquire the background
+  nh.param("background_seconds", background_seconds, 3.0);
+  double background_absorb_seconds;   // Seconds after which a static object becomes background (0: no adaptation)
+  nh.param("background_absorb_seconds", background_absorb_seconds, 0.0);
+  double background_release_seconds;  // Seconds after which a removed object stops being background
+  nh.param("background_release_seconds", background_release_seconds, 60.0);
+  std::string update_background_topic;  // Topic where the background update message is published/read
+  nh.param("update_background_topic", update_background_topic, std::string("/background_update"));
+  double heads_minimum_distance;  // Minimum distance between two persons' head
+  nh.param("heads_minimum_distance", heads_minimum_distance, 0.3);
+  nh.param("voxel_size", voxel_size, 0.06);
+  bool read_ground_from_file;     // Flag stating if the ground should be read from file, if present
+  nh.param("read_ground_from_file", read_ground_from_file, false);
+  bool remote_ground_selection;   // Flag enabling manual ground selection via ssh:
+  nh.param("remote_ground_selection", remote_ground_selection, false);
+  // Denoising flag. If true, a statistical filter is applied to the point cloud to remove noise
+  bool apply_denoising;
+  nh.param("apply_denoising", apply_denoising, false);
+  // MeanK for denoising (the higher it is, the stronger is the filtering)
+  int mean_k_denoising;
+  nh.param("mean_k_denoising", mean_k_denoising, 5);
+  // Standard deviation for denoising (the lower it is, the stronger is the filtering)
+  double std_dev_denoising;
+  nh.param("std_dev_denoising", std_dev_denoising, 0.3);
+  // Latency profiling of the detection stages (statistics are published on /diagnostics):
+  bool latency_profiling;
+  nh.param("latency_profiling", latency_profiling, false);
+  double latency_report_period;
+  nh.param("latency_report_period", latency_report_period, 5.0);
+  std::string latency_log;
+  nh.param("latency_log", latency_log, std::string(""));
+  // Pipelining of the detection stages (higher throughput, at the cost of the latency of the queues):
+  nh.param("pipelined_detection", pipelined_detection, false);
+  int pipeline_queue_size;
+  nh.param("pipeline_queue_size", pipeline_queue_size, 1);
+  // If true, the HOG features of a frame are computed once and shared by its clusters:
+  bool batch_classification;
+  nh.param("batch_classification", batch_classification, false);
+  // If true, frames are detected on the thread pool shared by the detectors of the process (see DetectorHost):
+  nh.param("use_detector_host", use_detector_host, false);
+  int detector_host_threads;      // Threads of the pool (0 = one per core), set by the first detector of the process
+  nh.param("detector_host_threads", detector_host_threads, 0);
+  // Frames older than this when their detection starts are skipped (0 = never):
+  nh.param("latency_budget", latency_budget, 0.0);
+  std::string exclusion_mask_file;  // Image whose non-zero pixels are excluded from detection (empty = none)
+  nh.param("exclusion_mask_file", exclusion_mask_file, std::string(""));
+  std::vector<double> exclusion_boxes;  // Boxes excluded from detection (min x, y, z and max x, y, z of every box)
+  nh.getParam("exclusion_boxes", exclusion_boxes);
+  std::string exclusion_frame;      // Frame of the exclusion boxes (/world by default, empty = camera frame)
+  nh.param("exclusion_frame", exclusion_frame, std::string("/world"));
+  if (use_detector_host)
+  {
+    host_pool = &DetectorHost::instance().getPool(std::max(detector_host_threads, 0));
+    host_worker = DetectorHost::instance().addCamera();
+  }
+
+  //	Eigen::Matrix3f intrinsics_matrix;
+  intrinsics_matrix << 525, 0.0, 319.5, 0.0, 525, 239.5, 0.0, 0.0, 1.0; // Kinect RGB camera intrinsics
+
+  // Subscribers:
+  if (use_depth_image)
+  {
+    depth_image_sub.reset(new message_filters::Subscriber<sensor_msgs::Image>(nh, depth_image_topic, 1));
+    rgb_image_sub.reset(new message_filters::Subscriber<sensor_msgs::Image>(nh, rgb_image_topic, 1));
+    depth_camera_info_sub.reset(new message_filters::Subscriber<sensor_msgs::CameraInfo>(nh, depth_camera_info_topic, 1));
+    images_sync.reset(new ImagesSynchronizer(ImagesSyncPolicy(10), *depth_image_sub, *rgb_image_sub, *depth_camera_info_sub));
+    images_sync->registerCallback(boost::bind(&GroundBasedPeopleDetectorNodelet::images_cb, this, _1, _2, _3));
+  }
+  else
+    sub = nh.subscribe(pointcloud_topic, 1, &GroundBasedPeopleDetectorNodelet::cloud_cb, this);
+  camera_info_sub = nh.subscribe(camera_info_topic, 1, &GroundBasedPeopleDetectorNodelet::cameraInfoCallback, this);
+  update_background_sub = nh.subscribe(update_background_topic, 1,
+      &GroundBasedPeopleDetectorNodelet::updateBackgroundCallback, this);
+
+  // Publishers:
+  detection_pub= nh.advertise<opt_msgs::DetectionArray>(output_topic, 3);
+
+  Rois output_rois_;
+
+  ros::Rate rate(rate_value);
+  while(running && ros::ok() && !takeCloud())
+  {
+    rate.sleep();
+  }
+  if (not running)
+    return;
+
+  // Create classifier for people detection (the SVM file is read once per process):
+  open_ptrack::detection::PersonClassifier<pcl::RGB> person_classifier;
+  DetectorHost::instance().getClassifier(svm_filename, person_classifier);   // load trained SVM
+
+  // People detection app initialization:
+  people_detector.setVoxelSize(voxel_size);                        // set the voxel size
+  people_detector.setMaxDistance(max_distance);                    // set maximum distance of people from the sensor
+  people_detector.setIntrinsics(intrinsics_matrix);                // set RGB camera intrinsic parameters
+  people_detector.setClassifier(person_classifier);                // set person classifier
+  people_detector.setHeightLimits(min_height, max_height);         // set person classifier
+  people_detector.setSamplingFactor(sampling_factor);              // set sampling factor
+  people_detector.setUseRGB(use_rgb);                              // set if RGB should be used or not
+  people_detector.setBatchClassification(batch_classification);    // set if clusters are classified at once
+  people_detector.setSensorTiltCompensation(sensor_tilt_compensation);      // enable point cloud rotation correction
+  people_detector.setMinimumDistanceBetweenHeads (heads_minimum_distance);  // set minimum distance between persons' head
+  people_detector.setDenoisingParameters (apply_denoising, mean_k_denoising, std_dev_denoising); // set parameters for denoising the point cloud
+
+  // Latency profiling:
+  latency_profiler.reset(new open_ptrack::opt_utils::LatencyProfiler(latency_profiling));
+  frame_latency = latency_profiler->getHistogram("detector/frame");
+  if (latency_profiling)
+  {
+    people_detector.setLatencyProfiler(latency_profiler.get());
+    latency_reporter.reset(new open_ptrack::opt_utils::LatencyReporter(nh, *latency_profiler, getName(),
+        latency_report_period, latency_log));
+  }
+
+  // Set up dynamic reconfiguration
+  ReconfigureServer::CallbackType f = boost::bind(&GroundBasedPeopleDetectorNodelet::configCb, this, _1, _2);
+  reconfigure_server_.reset(new ReconfigureServer(config_mutex_, nh));
+  reconfigure_server_->setCallback(f);
+
+  // Loop until a valid point cloud is found
+  open_ptrack::detection::GroundplaneEstimation<PointT> ground_estimator(ground_estimation_mode, remote_ground_selection);
+  bool first_valid_frame = false;
+  int no_valid_frame_counter = 0;
+  while (!first_valid_frame && running)
+  {
+    if (!ground_estimator.tooManyNaN(inputCloud(), 1 - valid_points_threshold))
+    { // A point cloud is valid if the ratio #NaN / #valid points is lower than a threshold
+      first_valid_frame = true;
+      std::cout << "Valid frame found!" << std::endl;
+    }
+    else
+    {
+      if (++no_valid_frame_counter > 60)
+      {
+        std::cout << "No valid frame. Move the camera to a better position..." << std::endl;
+        no_valid_frame_counter = 0;
+      }
+    }
+
+    rate.sleep();
+    takeCloud();
+  }
+  std::cout << std::endl;
+  if (not running)
+    return;
+
+  // Initialization for background subtraction:
+  frame_id = inputHeader().frame_id;
+  max_background_frames = int(background_seconds * rate_value);
+  {
+    boost::unique_lock<boost::shared_mutex> lock(detector_mutex);
+    people_detector.setBackgroundSubtraction(background_subtraction, background_resolution);
+    people_detector.setBackgroundAdaptation(int(background_absorb_seconds * rate_value), int(background_release_seconds * rate_value));
+    people_detector.setBackgroundFile(backgroundFile());
+    if (background_subtraction)
+    {
+      std::cout << "Background subtraction enabled." << std::endl;
+
+      // Try to load the background from file, otherwise acquire it from the first frames after ground estimation:
+      if (people_detector.loadBackground(backgroundFile()))
+        std::cout << "Background read from file." << std::endl << std::endl;
+      else
+        people_detector.learnBackground(max_background_frames);
+    }
+  }
+
+  // Exclusion zones, compiled for the images of this camera:
+  if ((not exclusion_mask_file.empty()) or (not exclusion_boxes.empty()))
+  {
+    open_ptrack::detection::ExclusionMask exclusion_mask = computeExclusionMask(exclusion_mask_file, exclusion_boxes, exclusion_frame);
+    boost::unique_lock<boost::shared_mutex> lock(detector_mutex);
+    people_detector.setExclusionMask(exclusion_mask);
+  }
+
+  // Ground estimation:
+  std::cout << "Ground plane initialization starting..." << std::endl;
+  PointCloudT::Ptr ground_cloud(new PointCloudT(*inputCloud()));    // the ground estimator may modify its cloud
+  ground_estimator.setInputCloud(ground_cloud);
+  ground_coeffs = ground_estimator.computeMulticamera(ground_from_extrinsic_calibration, read_ground_from_file,
+      pointcloud_topic, sampling_factor, voxel_size);
+
+  if (pipelined_detection)
+  {
+    // The next stages run in their own threads:
+    clustering_queue.reset(new StageQueue(std::max(pipeline_queue_size, 1)));
+    classification_queue.reset(new StageQueue(std::max(pipeline_queue_size, 1)));
+    clustering_thread = std::thread(&GroundBasedPeopleDetectorNodelet::clusteringLoop, this);
+    classification_thread = std::thread(&GroundBasedPeopleDetectorNodelet::classificationLoop, this);
+  }
+
+  // Main loop:
+  last_drop_report = ros::WallTime::now();
+  if (use_detector_host)
+  {
+    // From now on, frames are detected by the pool of the host as they arrive:
+    host_ready = true;
+    scheduleDetection();
+    return;
+  }
+  while(running && ros::ok())
+  {
+    reportSkippedFrames();
+    if (takeCloud())
+      detectFrame();
+
+    rate.sleep();
+  }
+
+  if (pipelined_detection)
+  {
+    running = false;
+    clustering_thread.join();
+    classification_thread.join();
+  }
+
+  removeBackgroundFile();
+}
+
+/** \brief Detect people in the frame just taken (cloud or images) and publish them */
+void
+GroundBasedPeopleDetectorNodelet::detectFrame ()
+{
+  // Frames which are already too old are not worth the time of the other cameras:
+  if (latency_budget > 0.0)
+  {
+    double age = (ros::Time::now() - pcl_conversions::fromPCL(inputHeader()).stamp).toSec();
+    if (age > latency_budget)
+    {
+      budget_skipped++;
+      return;
+    }
+  }
+
+  // If requested, update background:
+  if (update_background)
+  {
+    boost::unique_lock<boost::shared_mutex> lock(detector_mutex);
+    if (not background_subtraction)
+    {
+      std::cout << "Background subtraction enabled." << std::endl;
+      background_subtraction = true;
+    }
+    std::cout << "Background acquisition..." << std::endl;
+    people_detector.learnBackground(max_background_frames);
+
+    update_background = false;
+  }
+
+  if (pipelined_detection)
+  {
+    // First stage, then the frame goes to the clustering thread:
+    PipelineFramePtr frame(new PipelineFrame);
+    frame->start = std::chrono::steady_clock::now();
+    frame->detection.cloud = cloud;
+    frame->detection.images = images;
+    bool valid_frame;
+    {
+      boost::shared_lock<boost::shared_mutex> lock(detector_mutex);
+      people_detector.setGround(ground_coeffs);                  // set floor coefficients
+      valid_frame = people_detector.computeForeground(frame->detection);
+
+      // If not lock_ground, update ground coefficients:
+      if (not lock_ground)
+        ground_coeffs = people_detector.getGround();
+    }
+    if (valid_frame)
+      pushFrame(*clustering_queue, frame);
+  }
+  else
+  {
+    boost::unique_lock<boost::shared_mutex> lock(detector_mutex);
+
+    // Convert PCL cloud header to ROS header:
+    std_msgs::Header cloud_header = pcl_conversions::fromPCL(inputHeader());
+
+    // Perform people detection on the new cloud:
+    open_ptrack::opt_utils::ScopedLatencyTimer frame_timer(frame_latency);
+    std::vector<pcl::people::PersonCluster<PointT> > clusters;   // vector containing persons clusters
+    if (use_depth_image)
+      people_detector.setInputImages(images);
+    else
+      people_detector.setInputCloud(cloud);
+    people_detector.setGround(ground_coeffs);                    // set floor coefficients
+    people_detector.compute(clusters);                           // perform people detection
+
+    // If not lock_ground, update ground coefficients:
+    if (not lock_ground)
+      ground_coeffs = people_detector.getGround();                 // get updated floor coefficients
+
+    // Transforms used to correct sensor tilt (identity if not compensated):
+    Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+    Eigen::Affine3f anti_transform = Eigen::Affine3f::Identity();
+    if (sensor_tilt_compensation)
+      people_detector.getTiltCompensationTransforms(transform, anti_transform);
+
+    publishDetections(cloud_header, clusters, people_detector.getMeanLuminance(), anti_transform);
+  }
+}
+
+/** \brief Report every 10 seconds the frames which have not been detected */
+void
+GroundBasedPeopleDetectorNodelet::reportSkippedFrames ()
+{
+  ros::WallTime now = ros::WallTime::now();
+  if ((now - last_drop_report).toSec() < 10.0)
+    return;
+
+  // Frames which arrived while detection was busy (only the latest one is processed):
+  unsigned long dropped = use_depth_image ? images_mailbox.takeDropped() : cloud_mailbox.takeDropped();
+  if (dropped > 0)
+    ROS_INFO_STREAM("[" << getName() << "] skipped " << dropped << " frames in the last "
+        << (now - last_drop_report).toSec() << " s");
+  if (budget_skipped > 0)
+    ROS_INFO_STREAM("[" << getName() << "] skipped " << budget_skipped << " frames older than the latency budget ("
+        << latency_budget << " s) in the last " << (now - last_drop_report).toSec() << " s");
+  budget_skipped = 0;
+  last_drop_report = now;
+}
+
+/** \brief Queue a detection task of this camera to the pool of the host, if it is not queued yet (host mode only) */
+void
+GroundBasedPeopleDetectorNodelet::scheduleDetection ()
+{
+  // Counted before checking running, so that the destructor cannot miss a task queued while it stops the nodelet:
+  host_tasks++;
+  if (host_ready and running and not detection_scheduled.exchange(true))
+  {
+    host_pool->enqueue(boost::bind(&GroundBasedPeopleDetectorNodelet::hostDetection, this), host_worker);
+    return;
+  }
+  host_tasks--;
+}
+
+/** \brief Shut down the subscribers, waiting for their callbacks in progress (after the detection thread has stopped) */
+void
+GroundBasedPeopleDetectorNodelet::shutdownSubscribers ()
+{
+  sub.shutdown();
+  if (depth_image_sub)
+  {
+    depth_image_sub->unsubscribe();
+    rgb_image_sub->unsubscribe();
+    depth_camera_info_sub->unsubscribe();
+  }
+  camera_info_sub.shutdown();
+  update_background_sub.shutdown();
+}
+
+/** \brief Detection task run by the pool of the host: detects the frames of this camera until there are no new ones */
+void
+GroundBasedPeopleDetectorNodelet::hostDetection ()
+{
+  while (true)
+  {
+    reportSkippedFrames();
+    while (running and takeCloud())
+      detectFrame();
+
+    // A frame put after the last take may have found the task still scheduled, then it is taken here:
+    detection_scheduled = false;
+    bool empty = use_depth_image ? images_mailbox.empty() : cloud_mailbox.empty();
+    if (not running or empty or detection_scheduled.exchange(true))
+      break;
+  }
+  host_tasks--;     // last access to the nodelet, which can be destroyed from now on
+}
+
+/** \brief File where the background of this camera is saved */
+std::string
+GroundBasedPeopleDetectorNodelet::backgroundFile () const
+{
+  return "/tmp/background_" + frame_id.substr(1, frame_id.length()-1) + ".bin";
+}
+
+/**
+ * \brief Compile the exclusion zones of this camera for the size of its images
+ *
+ * \param[in] mask_file Image whose non-zero pixels are excluded (empty = none).
+ * \param[in] boxes Minimum and maximum corners of the excluded boxes (6 values per box).
+ * \param[in] boxes_frame Frame of the boxes (empty = camera frame).
+ *
+ * \return The exclusion mask.
+ */
+open_ptrack::detection::ExclusionMask
+GroundBasedPeopleDetectorNodelet::computeExclusionMask (const std::string& mask_file, const std::vector<double>& boxes,
+    const std::string& boxes_frame)
+{
+  // Size and intrinsics of the frames the mask is applied to:
+  int width, height;
+  float fx, fy, cx, cy;
+  if (use_depth_image)
+  {
+    width = images->width;
+    height = images->height;
+    fx = images->fx;
+    fy = images->fy;
+    cx = images->cx;
+    cy = images->cy;
+  }
+  else
+  {
+    width = inputCloud()->width;
+    height = inputCloud()->height;
+    fx = intrinsics_matrix(0, 0);
+    fy = intrinsics_matrix(1, 1);
+    cx = intrinsics_matrix(0, 2);
+    cy = intrinsics_matrix(1, 2);
+  }
+
+  open_ptrack::detection::ExclusionMask exclusion_mask;
+  exclusion_mask.init(width, height);
+
+  if (not mask_file.empty())
+  {
+    cv::Mat mask = cv::imread(mask_file, CV_LOAD_IMAGE_GRAYSCALE);
+    if (mask.empty())
+    {
+      ROS_ERROR("Cannot read the exclusion mask %s.", mask_file.c_str());
+    }
+    else
+    {
+      if ((mask.cols != width) or (mask.rows != height))
+        cv::resize(mask, mask, cv::Size(width, height), 0, 0, cv::INTER_NEAREST);
+      exclusion_mask.addImageMask(mask.data, mask.step);
+    }
+  }
+
+  if (boxes.size() % 6 != 0)
+  {
+    ROS_ERROR("exclusion_boxes must have 6 values per box (minimum and maximum corner), boxes ignored.");
+  }
+  else if (not boxes.empty())
+  {
+    // Transform from the camera frame to the frame of the boxes:
+    Eigen::Affine3f camera_to_boxes = Eigen::Affine3f::Identity();
+    if ((not boxes_frame.empty()) and (boxes_frame != frame_id))
+    {
+      tf::TransformListener tf_listener;
+      tf::StampedTransform transform;
+      try
+      {
+        tf_listener.waitForTransform(boxes_frame, frame_id, ros::Time(0), ros::Duration(3.0), ros::Duration(0.01));
+        tf_listener.lookupTransform(boxes_frame, frame_id, ros::Time(0), transform);
+      }
+      catch (tf::TransformException ex)
+      {
+        ROS_ERROR("Exclusion boxes ignored: %s", ex.what());
+        return exclusion_mask;
+      }
+      const tf::Vector3 origin = transform.getOrigin();
+      const tf::Quaternion rotation = transform.getRotation();
+      camera_to_boxes = Eigen::Translation3f(origin.x(), origin.y(), origin.z()) *
+          Eigen::Quaternionf(rotation.w(), rotation.x(), rotation.y(), rotation.z());
+    }
+
+    for (unsigned int i = 0; i < boxes.size(); i += 6)
+    {
+      exclusion_mask.addBox(camera_to_boxes, Eigen::Vector3f(boxes[i], boxes[i+1], boxes[i+2]),
+          Eigen::Vector3f(boxes[i+3], boxes[i+4], boxes[i+5]), fx, fy, cx, cy);
+    }
+  }
+
+  return exclusion_mask;
+}
+
+/** \brief Delete the background file of this camera from disk */
+void
+GroundBasedPeopleDetectorNodelet::removeBackgroundFile ()
+{
+  std::string filename = backgroundFile();
+  if (fileExists (filename.c_str()))
+  {
+    remove( filename.c_str() );
+  }
+}
+
+/**
+ * \brief Publish the people detected in a frame
+ *
+ * \param[in] header Header of the input cloud.
+ * \param[in] clusters People clusters, with their confidence.
+ * \param[in] mean_luminance Mean luminance of the frame.
+ * \param[in] anti_transform Inverse of the sensor tilt compensation transform.
+ */
+void
+GroundBasedPeopleDetectorNodelet::publishDetections (const std_msgs::Header& header,
+    std::vector<pcl::people::PersonCluster<PointT> >& clusters, float mean_luminance, const Eigen::Affine3f& anti_transform)
+{
+  open_ptrack::opt_utils::Conversions converter;
+
+  /// Write detection message:
+  opt_msgs::DetectionArray::Ptr detection_array_msg(new opt_msgs::DetectionArray);
+  // Set camera-specific fields:
+  detection_array_msg->header = header;
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 3; j++)
+      detection_array_msg->intrinsic_matrix.push_back(intrinsics_matrix(i, j));
+  detection_array_msg->confidence_type = std::string("hog+svm");
+  detection_array_msg->image_type = std::string("rgb");
+
+  // Add all valid detections:
+  for(std::vector<pcl::people::PersonCluster<PointT> >::iterator it = clusters.begin(); it != clusters.end(); ++it)
+  {
+    if((!use_rgb) | (mean_luminance < minimum_luminance) |      // if RGB is not used or luminance is too low
+        ((mean_luminance >= minimum_luminance) & (it->getPersonConfidence() > min_confidence)))            // if RGB is used, keep only people with confidence above a threshold
+    {
+      // Create detection message:
+      opt_msgs::Detection detection_msg;
+      converter.Vector3fToVector3(anti_transform * it->getMin(), detection_msg.box_3D.p1);
+      converter.Vector3fToVector3(anti_transform * it->getMax(), detection_msg.box_3D.p2);
+
+      float head_centroid_compensation = 0.05;
+
+      // theoretical person centroid:
+      Eigen::Vector3f centroid3d = anti_transform * it->getTCenter();
+      Eigen::Vector3f centroid2d = converter.world2cam(centroid3d, intrinsics_matrix);
+      // theoretical person top point:
+      Eigen::Vector3f top3d = anti_transform * it->getTTop();
+      Eigen::Vector3f top2d = converter.world2cam(top3d, intrinsics_matrix);
+      // theoretical person bottom point:
+      Eigen::Vector3f bottom3d = anti_transform * it->getTBottom();
+      Eigen::Vector3f bottom2d = converter.world2cam(bottom3d, intrinsics_matrix);
+      float enlarge_factor = 1.1;
+      float pixel_xc = centroid2d(0);
+      float pixel_yc = centroid2d(1);
+      float pixel_height = (bottom2d(1) - top2d(1)) * enlarge_factor;
+      float pixel_width = pixel_height / 2;
+      detection_msg.box_2D.x = int(centroid2d(0) - pixel_width/2.0);
+      detection_msg.box_2D.y = int(centroid2d(1) - pixel_height/2.0);
+      detection_msg.box_2D.width = int(pixel_width);
+      detection_msg.box_2D.height = int(pixel_height);
+      detection_msg.height = it->getHeight();
+      detection_msg.confidence = it->getPersonConfidence();
+      detection_msg.distance = it->getDistance();
+      converter.Vector3fToVector3((1+head_centroid_compensation/centroid3d.norm())*centroid3d, detection_msg.centroid);
+      converter.Vector3fToVector3((1+head_centroid_compensation/top3d.norm())*top3d, detection_msg.top);
+      converter.Vector3fToVector3((1+head_centroid_compensation/bottom3d.norm())*bottom3d, detection_msg.bottom);
+
+      // Add message:
+      detection_array_msg->detections.push_back(detection_msg);
+    }
+  }
+  detection_pub.publish(detection_array_msg);		 // publish message
+}
+
+/**
+ * \brief Queue a frame for the next pipeline stage, waiting while the queue is full
+ *
+ * \return false if the nodelet is stopping (the frame is dropped).
+ */
+bool
+GroundBasedPeopleDetectorNodelet::pushFrame (StageQueue& queue, const PipelineFramePtr& frame)
+{
+  std::unique_lock<std::mutex> lock(queue.mutex);
+  while (queue.frames.size() >= queue.capacity)
+  {
+    if (not running)
+      return false;
+    queue.changed.wait_for(lock, std::chrono::milliseconds(100));
+  }
+  queue.frames.push_back(frame);
+  queue.changed.notify_all();
+  return true;
+}
+
+/**
+ * \brief Take a frame from the previous pipeline stage, waiting while the queue is empty
+ *
+ * \return false if the nodelet is stopping.
+ */
+bool
+GroundBasedPeopleDetectorNodelet::popFrame (StageQueue& queue, PipelineFramePtr& frame)
+{
+  std::unique_lock<std::mutex> lock(queue.mutex);
+  while (queue.frames.empty())
+  {
+    if (not running)
+      return false;
+    queue.changed.wait_for(lock, std::chrono::milliseconds(100));
+  }
+  frame = queue.frames.front();
+  queue.frames.pop_front();
+  queue.changed.notify_all();
+  return true;
+}
+
+/** \brief Main loop of the clustering thread (second pipeline stage) */
+void
+GroundBasedPeopleDetectorNodelet::clusteringLoop ()
+{
+  PipelineFramePtr frame;
+  while (popFrame(*clustering_queue, frame))
+  {
+    {
+      boost::shared_lock<boost::shared_mutex> lock(detector_mutex);
+      people_detector.computeClusters(frame->detection);
+    }
+    pushFrame(*classification_queue, frame);
+    frame.reset();
+  }
+}
+
+/** \brief Main loop of the classification thread (third pipeline stage, publishes the detections) */
+void
+GroundBasedPeopleDetectorNodelet::classificationLoop ()
+{
+  PipelineFramePtr frame;
+  while (popFrame(*classification_queue, frame))
+  {
+    boost::shared_lock<boost::shared_mutex> lock(detector_mutex);
+    DetectionFrame& detection = frame->detection;
+    people_detector.computeConfidences(detection);
+    const pcl::PCLHeader& header = detection.cloud ? detection.cloud->header : detection.images->header;
+    publishDetections(pcl_conversions::fromPCL(header), detection.clusters, detection.mean_luminance,
+        detection.anti_transform);
+    if (frame_latency != NULL)
+      frame_latency->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - frame->start).count());
+    frame.reset();
+  }
+}
+
+} // namespace detection
+} // namespace open_ptrack
+
+PLUGINLIB_EXPORT_CLASS(open_ptrack::detection::GroundBasedPeopleDetectorNodelet, nodelet::Nodelet)
+
+
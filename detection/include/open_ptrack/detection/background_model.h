@@ -0,0 +1,310 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * background_model.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_BACKGROUND_MODEL_H_
+#define OPEN_PTRACK_DETECTION_BACKGROUND_MODEL_H_
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief BackgroundModel represents the background of a camera as a dense grid of voxels, one bit per voxel.
+     *
+     * The grid covers a box of the camera frame (the field of view up to the maximum distance), so that the voxel of
+     * a point and its background bit are found in constant time, without branches. Points out of the box are never
+     * background.
+     *
+     * With adaptation enabled, every voxel also keeps an evidence of being occupied, which grows in the frames in which
+     * the voxel is occupied and decreases by the same step in the frames in which it is empty. A voxel becomes
+     * background when its evidence is full, i.e. after absorb_frames frames of a static object, and it stops being
+     * background when its evidence is exhausted, i.e. release_frames frames after the object has been removed,
+     * without acquiring the background again. Since steps are symmetric, the evidence of a voxel occupied in less than
+     * half of the frames (people walking by) does not accumulate.
+     */
+    class BackgroundModel
+    {
+      public:
+
+        /** \brief Maximum number of voxels of the grid (8 MB of bits, 256 MB of evidence with adaptation). */
+        static const size_t MAX_VOXELS = size_t(1) << 26;
+
+        /** \brief Constructor. */
+        BackgroundModel ();
+
+        /**
+         * \brief Define the grid and clear the background.
+         *
+         * If the box would need more than MAX_VOXELS voxels, the voxel size is increased until it does not (see
+         * getResolution).
+         *
+         * \param[in] resolution Voxel size (m).
+         * \param[in] min_x, min_y, min_z Minimum corner of the box covered by the grid.
+         * \param[in] max_x, max_y, max_z Maximum corner of the box covered by the grid.
+         */
+        void
+        init (float resolution, float min_x, float min_y, float min_z, float max_x, float max_y, float max_z);
+
+        /**
+         * \brief Set the adaptation of the background to static scene changes.
+         *
+         * \param[in] absorb_frames Frames a voxel has to be occupied to become background (0 disables adaptation, at most
+         * 65535).
+         * \param[in] release_frames Frames after which a background voxel which is no longer occupied stops being
+         * background (at least 1, at most 65535).
+         */
+        void
+        setAdaptation (unsigned int absorb_frames, unsigned int release_frames);
+
+        /**
+         * \brief Remove all the voxels from the background.
+         */
+        void
+        clear ();
+
+        /**
+         * \brief Add the voxels of the points of a cloud to the background.
+         *
+         * \param[in] cloud Background points.
+         */
+        template <typename PointT> void
+        learn (const pcl::PointCloud<PointT>& cloud);
+
+        /**
+         * \brief Update the background with the points of a frame (it does nothing if adaptation is disabled).
+         *
+         * \param[in] cloud Points of the frame (background and foreground).
+         */
+        template <typename PointT> void
+        update (const pcl::PointCloud<PointT>& cloud);
+
+        /**
+         * \brief Remove the background points from a cloud, keeping the order of the other points.
+         *
+         * \param[in,out] cloud Point cloud (it becomes unorganized).
+         */
+        template <typename PointT> void
+        removeBackground (pcl::PointCloud<PointT>& cloud) const;
+
+        /**
+         * \brief Return the index of the voxel containing a point.
+         *
+         * Points out of the grid (or with NaN coordinates) are in the last voxel, which is never background.
+         *
+         * \param[in] x, y, z Point coordinates.
+         *
+         * \return The voxel index.
+         */
+        inline size_t
+        voxel (float x, float y, float z) const
+        {
+          const float i = (x - min_x_) * inverse_resolution_;
+          const float j = (y - min_y_) * inverse_resolution_;
+          const float k = (z - min_z_) * inverse_resolution_;
+          const bool inside = (i >= 0.0f) & (j >= 0.0f) & (k >= 0.0f) &
+              (i < size_x_) & (j < size_y_) & (k < size_z_);
+          const size_t index = (static_cast<size_t>(inside ? k : 0.0f) * dim_y_ + static_cast<size_t>(inside ? j : 0.0f)) *
+              dim_x_ + static_cast<size_t>(inside ? i : 0.0f);
+          return inside ? index : outside_voxel_;
+        }
+
+        /**
+         * \brief Return true if a voxel is background.
+         *
+         * \param[in] voxel Voxel index.
+         */
+        inline bool
+        isBackground (size_t voxel) const
+        {
+          return (bits_[voxel >> 6] >> (voxel & 63)) & 1;
+        }
+
+        /**
+         * \brief Return true if the voxel containing a point is background.
+         *
+         * \param[in] x, y, z Point coordinates.
+         */
+        inline bool
+        isBackground (float x, float y, float z) const
+        {
+          return isBackground(voxel(x, y, z));
+        }
+
+        /**
+         * \brief Return the voxel size (larger than the one passed to init if the grid was limited to MAX_VOXELS).
+         */
+        float
+        getResolution () const;
+
+        /**
+         * \brief Return true if another model has the same grid (voxel size, corner and size).
+         *
+         * \param[in] other Another model.
+         */
+        bool
+        hasSameGrid (const BackgroundModel& other) const;
+
+        /**
+         * \brief Return the number of background voxels.
+         */
+        size_t
+        size () const;
+
+        /**
+         * \brief Save the grid and the background bits to a binary file (in the byte order of this machine).
+         *
+         * \param[in] filename File name.
+         *
+         * \return true if the file has been written.
+         */
+        bool
+        save (const std::string& filename) const;
+
+        /**
+         * \brief Load the grid and the background bits written by save.
+         *
+         * \param[in] filename File name.
+         *
+         * \return true if the file has been read, false if it does not exist or it is not valid, including grids of
+         * more than MAX_VOXELS voxels (the model is not changed).
+         */
+        bool
+        load (const std::string& filename);
+
+      protected:
+
+        /**
+         * \brief Set the background bit of a voxel.
+         *
+         * \param[in] voxel Voxel index.
+         */
+        inline void
+        setBackground (size_t voxel)
+        {
+          bits_[voxel >> 6] |= uint64_t(1) << (voxel & 63);
+        }
+
+        /**
+         * \brief Increase the evidence of a voxel occupied in the current frame, and add it to the background when the
+         * evidence is full.
+         *
+         * \param[in] voxel Voxel index (not the outside voxel).
+         */
+        void
+        addEvidence (size_t voxel);
+
+        /**
+         * \brief Give full evidence to the background voxels and no evidence to the others.
+         */
+        void
+        resetEvidence ();
+
+        /**
+         * \brief Decrease the evidence of the voxels with evidence which are not occupied in the current frame, and
+         * remove the voxels without evidence from the background.
+         */
+        void
+        decay ();
+
+        /**
+         * \brief Evidence step of a voxel (background voxels move by the release step, the others by the absorb step).
+         *
+         * \param[in] voxel Voxel index.
+         */
+        inline uint32_t
+        evidenceStep (size_t voxel) const
+        {
+          return isBackground(voxel) ? release_step_ : absorb_step_;
+        }
+
+        /**
+         * \brief Allocate the bits (and the evidence) of the grid, all empty.
+         */
+        void
+        allocate ();
+
+        /** \brief voxel size and its inverse */
+        float resolution_;
+        float inverse_resolution_;
+
+        /** \brief minimum corner of the grid */
+        float min_x_, min_y_, min_z_;
+
+        /** \brief grid size (voxels) */
+        size_t dim_x_, dim_y_, dim_z_;
+        float size_x_, size_y_, size_z_;
+
+        /** \brief index of the voxel of the points out of the grid (one past the last voxel of the grid) */
+        size_t outside_voxel_;
+
+        /** \brief background bits, 64 voxels per word */
+        std::vector<uint64_t> bits_;
+
+        /** \brief frames to absorb and to release a voxel (absorb_frames_ is 0 without adaptation) */
+        unsigned int absorb_frames_;
+        unsigned int release_frames_;
+
+        /** \brief evidence of every voxel (with adaptation), from 0 to full_evidence_ */
+        std::vector<uint32_t> evidence_;
+
+        /**
+         * \brief full evidence (absorb_frames_ * release_frames_) and evidence steps of the voxels which are not
+         * background (full_evidence_ / absorb_frames_) and of the background voxels (full_evidence_ / release_frames_),
+         * so that both take an exact number of frames
+         */
+        uint32_t full_evidence_;
+        uint32_t absorb_step_;
+        uint32_t release_step_;
+
+        /** \brief bits of the voxels with evidence (the only ones visited by decay) */
+        std::vector<uint64_t> evidence_bits_;
+
+        /** \brief bits of the voxels occupied in the current frame, and their indices */
+        std::vector<uint64_t> frame_bits_;
+        std::vector<size_t> frame_voxels_;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+#include <open_ptrack/detection/impl/background_model.hpp>
+#endif /* OPEN_PTRACK_DETECTION_BACKGROUND_MODEL_H_ */
@@ -103,7 +103,7 @@ namespace open_ptrack
          * \return a pointer to the DetectionSource which generated the detection.
          */
         open_ptrack::detection::DetectionSource*
-        getSource();
+        getSource() const;
 
         /**
          * \brief Returns the detection centroid in world reference frame.
@@ -0,0 +1,123 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * detector_host.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_DETECTOR_HOST_H_
+#define OPEN_PTRACK_DETECTION_DETECTOR_HOST_H_
+
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_types.h>
+
+#include <open_ptrack/detection/person_classifier.h>
+#include <open_ptrack/opt_utils/work_stealing_pool.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief DetectorHost holds the resources shared by the people detectors of a process (one per camera).
+     *
+     * Detectors loaded in the same nodelet manager share a work-stealing pool, on which each of them schedules the
+     * detection of its frames when they arrive, instead of polling in its own thread. Every detector has a home worker,
+     * assigned round robin. Classifiers are read from file once per process.
+     */
+    class DetectorHost
+    {
+      public:
+
+        /**
+         * \brief Get the host of this process.
+         *
+         * \return the host (created at the first call).
+         */
+        static DetectorHost&
+        instance ();
+
+        /**
+         * \brief Get the pool of detection threads.
+         *
+         * \param[in] threads Number of threads of the pool (0 = one per core), used only by the first call.
+         *
+         * \return the pool.
+         */
+        opt_utils::WorkStealingPool&
+        getPool (unsigned int threads);
+
+        /**
+         * \brief Register a camera.
+         *
+         * \return the index of the home worker of the camera in the pool.
+         */
+        unsigned int
+        addCamera ();
+
+        /**
+         * \brief Get the person classifier stored in a file.
+         *
+         * \param[in] svm_filename File with the SVM (read only if no detector has loaded it yet).
+         * \param[out] person_classifier The classifier.
+         *
+         * \return false if the file is not a valid SVM.
+         */
+        bool
+        getClassifier (const std::string& svm_filename, PersonClassifier<pcl::RGB>& person_classifier);
+
+      private:
+
+        /** \brief Constructor. */
+        DetectorHost ();
+
+        DetectorHost (const DetectorHost&);
+        DetectorHost& operator= (const DetectorHost&);
+
+        /** \brief pool of detection threads (NULL until the first getPool) */
+        boost::shared_ptr<opt_utils::WorkStealingPool> pool_;
+
+        /** \brief number of cameras registered */
+        unsigned int cameras_;
+
+        /** \brief classifiers already loaded, by file */
+        std::map<std::string, PersonClassifier<pcl::RGB> > classifiers_;
+
+        std::mutex mutex_;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_DETECTION_DETECTOR_HOST_H_ */
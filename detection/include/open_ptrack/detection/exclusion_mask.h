@@ -0,0 +1,177 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * exclusion_mask.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_EXCLUSION_MASK_H_
+#define OPEN_PTRACK_DETECTION_EXCLUSION_MASK_H_
+
+#include <vector>
+#include <stdint.h>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief ExclusionMask marks the parts of the field of view of a camera where people are not searched.
+     *
+     * Zones are given as 2D image masks (excluded at any depth) or as 3D boxes, and compiled once into a few ranges of
+     * depths for every pixel: a point is excluded if its z coordinate is in a range of its pixel. For a box, the range
+     * is where the ray of the pixel crosses the box. Ranges which overlap are merged, so the ray of a pixel can cross
+     * up to MAX_RANGES separate boxes without excluding the depths between them. Beyond that, the two closest ranges
+     * are merged (and the gap between them is excluded too).
+     */
+    class ExclusionMask
+    {
+      public:
+
+        /** \brief Excluded depths of a pixel (near > far if the range is not used) */
+        struct DepthRange
+        {
+          float near;
+          float far;
+        };
+
+        /** \brief Maximum number of separate ranges of a pixel */
+        static const int MAX_RANGES = 2;
+
+        /** \brief Excluded ranges of a pixel, sorted by depth (the unused ones are at the end) */
+        struct PixelRanges
+        {
+          DepthRange ranges[MAX_RANGES];
+        };
+
+        /** \brief Constructor (empty mask, of size 0). */
+        ExclusionMask ();
+
+        /**
+         * \brief Set the image size and remove all the zones.
+         *
+         * \param[in] width Image width.
+         * \param[in] height Image height.
+         */
+        void
+        init (int width, int height);
+
+        /**
+         * \brief Exclude the pixels of an image mask, at any depth.
+         *
+         * \param[in] mask Mask of the size of the image (8 bits, non-zero pixels are excluded).
+         * \param[in] step Bytes per row of the mask.
+         */
+        void
+        addImageMask (const uint8_t* mask, int step);
+
+        /**
+         * \brief Exclude the points inside a box.
+         *
+         * \param[in] camera_to_box Transform from the camera frame to the frame of the box.
+         * \param[in] min_corner Minimum corner of the box, in its frame.
+         * \param[in] max_corner Maximum corner of the box, in its frame.
+         * \param[in] fx, fy, cx, cy Intrinsics of the camera (pixels).
+         */
+        void
+        addBox (const Eigen::Affine3f& camera_to_box, const Eigen::Vector3f& min_corner, const Eigen::Vector3f& max_corner,
+            float fx, float fy, float cx, float cy);
+
+        /**
+         * \brief Return true if no pixel is excluded.
+         */
+        bool
+        empty () const;
+
+        /**
+         * \brief Return true if the mask has the given size and some pixel is excluded.
+         *
+         * \param[in] width Image width.
+         * \param[in] height Image height.
+         */
+        bool
+        appliesTo (int width, int height) const;
+
+        /**
+         * \brief Return the excluded depths of a row of pixels.
+         *
+         * \param[in] row Row index.
+         */
+        inline const PixelRanges*
+        row (int row) const
+        {
+          return &ranges_[row * width_];
+        }
+
+        /**
+         * \brief Return true if a point is excluded.
+         *
+         * \param[in] pixel Excluded ranges of the pixel of the point.
+         * \param[in] z Point depth.
+         */
+        static inline bool
+        isExcluded (const PixelRanges& pixel, float z)
+        {
+          bool excluded = false;
+          for (int i = 0; i < MAX_RANGES; i++)
+            excluded |= (z >= pixel.ranges[i].near) & (z <= pixel.ranges[i].far);
+          return excluded;
+        }
+
+      protected:
+
+        /**
+         * \brief Add a range of excluded depths to a pixel.
+         *
+         * \param[in,out] pixel Excluded ranges of the pixel.
+         * \param[in] near, far Excluded depths.
+         */
+        void
+        addRange (PixelRanges& pixel, float near, float far);
+
+        /** \brief image size */
+        int width_;
+        int height_;
+
+        /** \brief excluded ranges of every pixel, row by row */
+        std::vector<PixelRanges> ranges_;
+
+        /** \brief number of pixels with excluded depths */
+        int excluded_pixels_;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+
+#endif /* OPEN_PTRACK_DETECTION_EXCLUSION_MASK_H_ */
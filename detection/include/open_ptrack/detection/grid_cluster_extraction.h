@@ -0,0 +1,166 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * grid_cluster_extraction.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_GRID_CLUSTER_EXTRACTION_H_
+#define OPEN_PTRACK_DETECTION_GRID_CLUSTER_EXTRACTION_H_
+
+#include <vector>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/PointIndices.h>
+
+#include <open_ptrack/detection/voxel_hash.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief GridClusterExtraction extracts the Euclidean clusters of a point cloud with a grid instead of a KdTree.
+     *
+     * Points are hashed into grid cells as large as the cluster tolerance, so that the points closer than the
+     * tolerance to a point are in its cell or in the 26 neighboring cells. Pairs of close points are joined with
+     * union-find, in time linear in the number of points for clouds with a bounded density, like voxelized clouds.
+     * The clusters are the same as the ones of pcl::EuclideanClusterExtraction, sorted in the same way
+     * (by decreasing size, with sorted indices).
+     */
+    template <typename PointT>
+    class GridClusterExtraction
+    {
+      public:
+
+        typedef pcl::PointCloud<PointT> PointCloud;
+        typedef boost::shared_ptr<const PointCloud> PointCloudConstPtr;
+
+        /** \brief Constructor. */
+        GridClusterExtraction ();
+
+        /**
+         * \brief Set the input cloud.
+         *
+         * \param[in] cloud A pointer to the input cloud.
+         */
+        void
+        setInputCloud (const PointCloudConstPtr& cloud);
+
+        /**
+         * \brief Set the maximum distance between two points of a cluster.
+         *
+         * \param[in] tolerance Cluster tolerance (m).
+         */
+        void
+        setClusterTolerance (float tolerance);
+
+        /**
+         * \brief Set the minimum number of points of a cluster.
+         *
+         * \param[in] min_cluster_size Minimum cluster size.
+         */
+        void
+        setMinClusterSize (int min_cluster_size);
+
+        /**
+         * \brief Set the maximum number of points of a cluster.
+         *
+         * \param[in] max_cluster_size Maximum cluster size.
+         */
+        void
+        setMaxClusterSize (int max_cluster_size);
+
+        /**
+         * \brief Extract the clusters of the input cloud.
+         *
+         * \param[out] clusters Indices of the points of every cluster.
+         */
+        void
+        extract (std::vector<pcl::PointIndices>& clusters);
+
+      protected:
+
+        /**
+         * \brief Return the representative of the set of a point (with path halving).
+         *
+         * \param[in] i Point index.
+         */
+        int
+        findRoot (int i);
+
+        /**
+         * \brief Join the sets of two points.
+         *
+         * \param[in] i First point index.
+         * \param[in] j Second point index.
+         */
+        void
+        join (int i, int j);
+
+        /** \brief input cloud */
+        PointCloudConstPtr cloud_;
+
+        /** \brief cluster tolerance (also the size of the grid cells) */
+        float tolerance_;
+
+        /** \brief minimum cluster size */
+        int min_cluster_size_;
+
+        /** \brief maximum cluster size */
+        int max_cluster_size_;
+
+        /** \brief indices of the grid cells */
+        VoxelHash cell_hash_;
+
+        /** \brief cell of every point */
+        std::vector<int> point_cells_;
+
+        /** \brief points sorted by cell: the points of cell c are cell_points_[cell_starts_[c]..cell_starts_[c+1]) */
+        std::vector<int> cell_starts_;
+        std::vector<int> cell_points_;
+
+        /** \brief union-find parent of every point */
+        std::vector<int> parents_;
+
+        /** \brief cluster of every set representative (-1 if none yet) */
+        std::vector<int> root_clusters_;
+
+        /** \brief size of every cluster, and its index in the output (-1 if its size is out of limits) */
+        std::vector<int> cluster_sizes_;
+        std::vector<int> cluster_outputs_;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+#include <open_ptrack/detection/impl/grid_cluster_extraction.hpp>
+#endif /* OPEN_PTRACK_DETECTION_GRID_CLUSTER_EXTRACTION_H_ */
@@ -40,6 +40,9 @@
 #ifndef OPEN_PTRACK_DETECTION_GROUND_BASED_PEOPLE_DETECTION_APP_H_
 #define OPEN_PTRACK_DETECTION_GROUND_BASED_PEOPLE_DETECTION_APP_H_
 
+#include <mutex>
+#include <string>
+
 #include <pcl/point_types.h>
 #include <pcl/sample_consensus/sac_model_plane.h>
 #include <pcl/sample_consensus/ransac.h>
@@ -50,11 +53,15 @@
 #include <pcl/people/person_cluster.h>
 #include <pcl/people/head_based_subcluster.h>
 #include <pcl/common/transforms.h>
-#include <pcl/octree/octree.h>
 #include <pcl/visualization/pcl_visualizer.h>
 #include <pcl/filters/statistical_outlier_removal.h>
 
 #include <open_ptrack/detection/person_classifier.h>
+#include <open_ptrack/detection/organized_cloud_preprocessor.h>
+#include <open_ptrack/detection/rgbd_image.h>
+#include <open_ptrack/detection/grid_cluster_extraction.h>
+#include <open_ptrack/detection/background_model.h>
+#include <open_ptrack/opt_utils/latency_profiler.h>
 
 namespace open_ptrack
 {
@@ -79,6 +86,49 @@ namespace open_ptrack
         typedef boost::shared_ptr<PointCloud> PointCloudPtr;
         typedef boost::shared_ptr<const PointCloud> PointCloudConstPtr;
 
+        /**
+         * \brief Data of a frame, passed from a detection stage to the next one.
+         *
+         * The stages (computeForeground, computeClusters and computeConfidences) keep their per-frame results here,
+         * so that different frames can be in different stages at the same time.
+         */
+        struct Frame
+        {
+          /** \brief input cloud (set by the caller, not modified) */
+          PointCloudConstPtr cloud;
+
+          /** \brief input RGB-D images, used instead of the cloud if it is NULL (set by the caller, not modified) */
+          RGBDImage::ConstPtr images;
+
+          /** \brief RGB image of the input cloud (allocated by computeForeground if NULL) */
+          pcl::PointCloud<pcl::RGB>::Ptr rgb_image;
+
+          /** \brief if true, debug info is written for this frame */
+          bool debug;
+
+          /** \brief mean luminance of the RGB image */
+          float mean_luminance;
+
+          /** \brief ground coefficients, after the update with this frame */
+          Eigen::VectorXf ground_coeffs;
+
+          /** \brief minimum and maximum number of points of a cluster */
+          int min_points;
+          int max_points;
+
+          /** \brief points which are not ground (nor background) */
+          PointCloudPtr no_ground_cloud;
+
+          /** \brief transforms used to compensate the sensor tilt */
+          Eigen::Affine3f transform;
+          Eigen::Affine3f anti_transform;
+
+          /** \brief people clusters (with their confidence, after computeConfidences) */
+          std::vector<pcl::people::PersonCluster<PointT> > clusters;
+
+          EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+        };
+
         /** \brief Constructor. */
         GroundBasedPeopleDetectionApp ();
 
@@ -88,10 +138,18 @@ namespace open_ptrack
         /**
          * \brief Set the pointer to the input cloud.
          *
-         * \param[in] cloud A pointer to the input cloud.
+         * \param[in] cloud A pointer to the input cloud (not copied nor modified).
+         */
+        void
+        setInputCloud (const PointCloudConstPtr& cloud);
+
+        /**
+         * \brief Set the pointer to the input RGB-D images, used instead of an input cloud.
+         *
+         * \param[in] images A pointer to the depth and RGB images (not copied nor modified).
          */
         void
-        setInputCloud (PointCloudPtr& cloud);
+        setInputImages (const RGBDImage::ConstPtr& images);
 
         /**
          * \brief Set the ground coefficients.
@@ -130,6 +188,8 @@ namespace open_ptrack
         /**
          * \brief Set points maximum distance from the sensor.
          *
+         * The background grid is cleared if the maximum distance changes, since it has to cover the new distance.
+         *
          * \param[in] max_distance Set points maximum distance from the sensor (default = 50m.).
          */
         void
@@ -201,6 +261,15 @@ namespace open_ptrack
         void
         setUseRGB (bool use_rgb);
 
+        /**
+         * \brief Set if the clusters of a frame should be classified at once (see PersonClassifier::evaluateBatch).
+         *
+         * \param[in] batch_classification True: HOG features are shared by the clusters of a frame, false: every
+         * cluster is classified on its own patch (default).
+         */
+        void
+        setBatchClassification (bool batch_classification);
+
         /**
          * \brief Set if sensor tilt angle wrt ground plane should be compensated to improve people detection
          *
@@ -213,11 +282,75 @@ namespace open_ptrack
          * \brief Set background subtraction parameters
          *
          * \param[in] background_subtraction True: background subtraction is performed, false: background subtraction is not performed.
-         * \param[in] background_octree_resolution Resolution of the octree.
+         * \param[in] background_resolution Voxel size of the background model.
          * \param[in] background_cloud Point cloud containing the background.
          */
         void
-        setBackground ( bool background_subtraction, float background_octree_resolution, PointCloudPtr& background_cloud);
+        setBackground ( bool background_subtraction, float background_resolution, PointCloudPtr& background_cloud);
+
+        /**
+         * \brief Enable or disable background subtraction, keeping the current background.
+         *
+         * The background is cleared if the voxel size changes.
+         *
+         * \param[in] background_subtraction True: background subtraction is performed, false: background subtraction is not performed.
+         * \param[in] background_resolution Voxel size of the background model.
+         */
+        void
+        setBackgroundSubtraction (bool background_subtraction, float background_resolution);
+
+        /**
+         * \brief Set the adaptation of the background to objects which are moved in the scene.
+         *
+         * \param[in] absorb_frames Frames after which a static object becomes background (0: no adaptation).
+         * \param[in] release_frames Frames after which a removed object stops being background.
+         */
+        void
+        setBackgroundAdaptation (unsigned int absorb_frames, unsigned int release_frames);
+
+        /**
+         * \brief Acquire the background again, from the next frames (no people are detected in these frames).
+         *
+         * It enables background subtraction. The background is saved to the background file when acquired.
+         *
+         * \param[in] frames Number of frames to acquire.
+         */
+        void
+        learnBackground (unsigned int frames);
+
+        /**
+         * \brief Set the file where the background is saved after every acquisition.
+         *
+         * \param[in] background_file File name (empty: the background is not saved).
+         */
+        void
+        setBackgroundFile (const std::string& background_file);
+
+        /**
+         * \brief Load a background saved after an acquisition.
+         *
+         * \param[in] background_file File name.
+         *
+         * \return true if the background has been loaded with the current grid (voxel size and maximum distance).
+         */
+        bool
+        loadBackground (const std::string& background_file);
+
+        /**
+         * \brief Set the zones of the image where people are not searched (their points are dropped by pre-processing).
+         *
+         * \param[in] exclusion_mask Exclusion mask, with the size of the input images.
+         */
+        void
+        setExclusionMask (const ExclusionMask& exclusion_mask);
+
+        /**
+         * \brief Set the profiler measuring the latency of every detection stage
+         *
+         * \param[in] profiler Latency profiler (it must outlive the detector), or NULL for no profiling.
+         */
+        void
+        setLatencyProfiler (open_ptrack::opt_utils::LatencyProfiler* profiler);
 
         /**
          * \brief Get minimum and maximum allowed height for a person cluster.
@@ -277,7 +410,7 @@ namespace open_ptrack
          * \param[out] output_cloud A pointer to a RGB point cloud.
          */
         void
-        extractRGBFromPointCloud (PointCloudPtr input_cloud, pcl::PointCloud<pcl::RGB>::Ptr& output_cloud);
+        extractRGBFromPointCloud (const PointCloudConstPtr& input_cloud, pcl::PointCloud<pcl::RGB>::Ptr& output_cloud);
 
         /**
          * \brief Swap rows/cols dimensions of a RGB point cloud (90 degrees counterclockwise rotation).
@@ -317,7 +450,43 @@ namespace open_ptrack
          * \return The cloud after pre-processing.
          */
         PointCloudPtr
-        preprocessCloud (PointCloudPtr& input_cloud);
+        preprocessCloud (const PointCloudConstPtr& input_cloud);
+
+        /**
+         * \brief Perform pre-processing operations on the input cloud (downsampling, filtering) and extract its RGB image.
+         *
+         * Without denoising, the cloud is read once (see OrganizedCloudPreprocessor).
+         *
+         * \param[in] input_cloud Input cloud.
+         * \param[out] rgb_image RGB cloud corresponding to input_cloud (not filled if NULL).
+         *
+         * \return The cloud after pre-processing.
+         */
+        PointCloudPtr
+        preprocessCloud (const PointCloudConstPtr& input_cloud, pcl::PointCloud<pcl::RGB>::Ptr rgb_image);
+
+        /**
+         * \brief Perform pre-processing operations on input RGB-D images (downsampling, filtering).
+         *
+         * \param[in] images Input depth and RGB images.
+         *
+         * \return The cloud after pre-processing.
+         */
+        PointCloudPtr
+        preprocessImages (const RGBDImage::ConstPtr& images);
+
+        /**
+         * \brief Perform pre-processing operations on input RGB-D images (downsampling, filtering) and extract the RGB image.
+         *
+         * Without denoising, only the sampled pixels are back-projected (see OrganizedCloudPreprocessor).
+         *
+         * \param[in] images Input depth and RGB images.
+         * \param[out] rgb_image RGB cloud corresponding to the images (not filled if NULL).
+         *
+         * \return The cloud after pre-processing.
+         */
+        PointCloudPtr
+        preprocessImages (const RGBDImage::ConstPtr& images, pcl::PointCloud<pcl::RGB>::Ptr rgb_image);
 
         /**
          * \brief Perform people detection on the input data and return people clusters information.
@@ -329,7 +498,57 @@ namespace open_ptrack
         bool
         compute (std::vector<pcl::people::PersonCluster<PointT> >& clusters);
 
+        /**
+         * \brief Perform people detection on a frame (the three detection stages, in order).
+         *
+         * The results are also kept for getNoGroundCloud, getMeanLuminance and getTiltCompensationTransforms.
+         *
+         * \param[in,out] frame Frame with the input cloud, and then with the results.
+         *
+         * \return true if the compute operation is successful, false otherwise.
+         */
+        bool
+        compute (Frame& frame);
+
+        /**
+         * \brief First detection stage: pre-processing, ground removal and update, background subtraction.
+         *
+         * The input is frame.cloud or, if it is NULL, frame.images.
+         *
+         * The stages of different frames can run concurrently in different threads, if each stage is run by one
+         * thread at a time and frames go through it in order. Parameters must not be changed while a stage runs.
+         *
+         * \param[in,out] frame Frame with the input cloud.
+         *
+         * \return false if mandatory parameters have not been set (the frame must not go through the next stages).
+         */
+        bool
+        computeForeground (Frame& frame);
+
+        /**
+         * \brief Second detection stage: euclidean clustering, sensor tilt compensation and head based sub-clustering.
+         *
+         * \param[in,out] frame Frame processed by computeForeground.
+         */
+        void
+        computeClusters (Frame& frame);
+
+        /**
+         * \brief Third detection stage: person confidence of the clusters (HOG+SVM on the RGB image).
+         *
+         * \param[in,out] frame Frame processed by computeClusters.
+         */
+        void
+        computeConfidences (Frame& frame);
+
       protected:
+        /**
+         * \brief Define the background grid for the maximum distance and the background voxel size, clearing the
+         * background (background_mutex_ has to be locked).
+         */
+        void
+        initBackgroundGrid ();
+
         /** \brief sampling factor used to downsample the point cloud */
         int sampling_factor_;
 
@@ -346,7 +565,10 @@ namespace open_ptrack
         float sqrt_ground_coeffs_;
 
         /** \brief pointer to the input cloud */
-        PointCloudPtr cloud_;
+        PointCloudConstPtr cloud_;
+
+        /** \brief pointer to the input RGB-D images (used if cloud_ is NULL) */
+        RGBDImage::ConstPtr images_;
 
         /** \brief pointer to the cloud after voxel grid filtering and ground removal */
         PointCloudPtr no_ground_cloud_;
@@ -391,6 +613,9 @@ namespace open_ptrack
         /** \brief flag stating if RGB information should be used or not for people detection */
         bool use_rgb_;
 
+        /** \brief if true, the clusters of a frame are classified at once */
+        bool batch_classification_;
+
         /** \brief Mean luminance of the RGB data */
         float mean_luminance_;
 
@@ -403,8 +628,20 @@ namespace open_ptrack
         /** \brief Flag stating if background subtraction should be applied or not */
         bool background_subtraction_;
 
-        /** \brief Octree representing the background */
-        pcl::octree::OctreePointCloud<PointT> *background_octree_;
+        /** \brief Voxel grid representing the background */
+        open_ptrack::detection::BackgroundModel background_model_;
+
+        /** \brief voxel size requested for the background (0 until background subtraction is set) */
+        float background_resolution_;
+
+        /** \brief frames still to be added to the background before detecting people again */
+        unsigned int background_learning_frames_;
+
+        /** \brief file where the background is saved after an acquisition */
+        std::string background_file_;
+
+        /** \brief Protects the background model, which is updated by the first detection stage */
+        std::mutex background_mutex_;
 
         /** \brief Frame counter */
         unsigned int frame_counter_;
@@ -418,6 +655,20 @@ namespace open_ptrack
         /** \brief Standard deviation for denoising (the lower it is, the stronger is the filtering): */
         float std_dev_denoising_;
 
+        /** \brief Single-pass sampling, voxel grid filtering and RGB extraction (used without denoising) */
+        open_ptrack::detection::OrganizedCloudPreprocessor<PointT> preprocessor_;
+
+        /** \brief Euclidean clustering on a hashed grid (its buffers are reused between frames) */
+        open_ptrack::detection::GridClusterExtraction<PointT> cluster_extraction_;
+
+        /** \brief Latency histograms of the detection stages (NULL if latency profiling is disabled) */
+        open_ptrack::opt_utils::LatencyHistogram* preprocess_latency_;
+        open_ptrack::opt_utils::LatencyHistogram* ground_latency_;
+        open_ptrack::opt_utils::LatencyHistogram* background_latency_;
+        open_ptrack::opt_utils::LatencyHistogram* clustering_latency_;
+        open_ptrack::opt_utils::LatencyHistogram* subclustering_latency_;
+        open_ptrack::opt_utils::LatencyHistogram* classification_latency_;
+
 //        pcl::visualization::PCLVisualizer::Ptr denoising_viewer_;
 
     };
@@ -0,0 +1,108 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * background_model.hpp
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_BACKGROUND_MODEL_HPP_
+#define OPEN_PTRACK_DETECTION_BACKGROUND_MODEL_HPP_
+
+#include <open_ptrack/detection/background_model.h>
+
+template <typename PointT> void
+open_ptrack::detection::BackgroundModel::learn (const pcl::PointCloud<PointT>& cloud)
+{
+  for (size_t i = 0; i < cloud.points.size(); i++)
+  {
+    const size_t v = voxel(cloud.points[i].x, cloud.points[i].y, cloud.points[i].z);
+    if (v != outside_voxel_)
+    {
+      setBackground(v);
+      if (absorb_frames_ > 0)
+      {
+        evidence_[v] = full_evidence_;
+        evidence_bits_[v >> 6] |= uint64_t(1) << (v & 63);
+      }
+    }
+  }
+}
+
+template <typename PointT> void
+open_ptrack::detection::BackgroundModel::update (const pcl::PointCloud<PointT>& cloud)
+{
+  if (absorb_frames_ == 0)
+    return;
+
+  // Count every occupied voxel once per frame:
+  for (size_t i = 0; i < cloud.points.size(); i++)
+  {
+    const size_t v = voxel(cloud.points[i].x, cloud.points[i].y, cloud.points[i].z);
+    const uint64_t bit = uint64_t(1) << (v & 63);
+    if (not (frame_bits_[v >> 6] & bit))
+    {
+      frame_bits_[v >> 6] |= bit;
+      frame_voxels_.push_back(v);
+    }
+  }
+  for (size_t i = 0; i < frame_voxels_.size(); i++)
+  {
+    if (frame_voxels_[i] != outside_voxel_)
+      addEvidence(frame_voxels_[i]);
+  }
+
+  // Empty voxels lose evidence, then the bits of the frame are cleared for the next one:
+  decay();
+  for (size_t i = 0; i < frame_voxels_.size(); i++)
+    frame_bits_[frame_voxels_[i] >> 6] = 0;
+  frame_voxels_.clear();
+}
+
+template <typename PointT> void
+open_ptrack::detection::BackgroundModel::removeBackground (pcl::PointCloud<PointT>& cloud) const
+{
+  // Compact the cloud in place: every point is written, but only foreground points advance the output.
+  size_t n = 0;
+  for (size_t i = 0; i < cloud.points.size(); i++)
+  {
+    const PointT& point = cloud.points[i];
+    const bool background = isBackground(voxel(point.x, point.y, point.z));
+    cloud.points[n] = point;
+    n += !background;
+  }
+  cloud.points.resize(n);
+  cloud.width = n;
+  cloud.height = 1;
+}
+
+#endif /* OPEN_PTRACK_DETECTION_BACKGROUND_MODEL_HPP_ */
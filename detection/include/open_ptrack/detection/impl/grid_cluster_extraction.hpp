@@ -0,0 +1,250 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * grid_cluster_extraction.hpp
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_GRID_CLUSTER_EXTRACTION_HPP_
+#define OPEN_PTRACK_DETECTION_GRID_CLUSTER_EXTRACTION_HPP_
+
+#include <open_ptrack/detection/grid_cluster_extraction.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief Order clusters by decreasing size (as pcl::EuclideanClusterExtraction). */
+    inline bool
+    largerCluster (const pcl::PointIndices& a, const pcl::PointIndices& b)
+    {
+      return a.indices.size() > b.indices.size();
+    }
+  } /* namespace detection */
+} /* namespace open_ptrack */
+
+template <typename PointT>
+open_ptrack::detection::GridClusterExtraction<PointT>::GridClusterExtraction () :
+  tolerance_(0.12),
+  min_cluster_size_(1),
+  max_cluster_size_(std::numeric_limits<int>::max())
+{
+
+}
+
+template <typename PointT> void
+open_ptrack::detection::GridClusterExtraction<PointT>::setInputCloud (const PointCloudConstPtr& cloud)
+{
+  cloud_ = cloud;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GridClusterExtraction<PointT>::setClusterTolerance (float tolerance)
+{
+  tolerance_ = tolerance;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GridClusterExtraction<PointT>::setMinClusterSize (int min_cluster_size)
+{
+  min_cluster_size_ = min_cluster_size;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GridClusterExtraction<PointT>::setMaxClusterSize (int max_cluster_size)
+{
+  max_cluster_size_ = max_cluster_size;
+}
+
+template <typename PointT> int
+open_ptrack::detection::GridClusterExtraction<PointT>::findRoot (int i)
+{
+  while (parents_[i] != i)
+  {
+    parents_[i] = parents_[parents_[i]];
+    i = parents_[i];
+  }
+  return i;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GridClusterExtraction<PointT>::join (int i, int j)
+{
+  const int root_i = findRoot(i);
+  const int root_j = findRoot(j);
+  // The smallest index is the representative:
+  if (root_i < root_j)
+    parents_[root_j] = root_i;
+  else if (root_j < root_i)
+    parents_[root_i] = root_j;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GridClusterExtraction<PointT>::extract (std::vector<pcl::PointIndices>& clusters)
+{
+  clusters.clear();
+  if ((not cloud_) or cloud_->points.empty())
+    return;
+
+  const PointCloud& cloud = *cloud_;
+  const int n_points = cloud.points.size();
+  const float inverse_cell_size = 1.0f / tolerance_;
+  const float sqr_tolerance = tolerance_ * tolerance_;
+
+  // Grid cells as large as the tolerance:
+  cell_hash_.clear();
+  point_cells_.resize(n_points);
+  for (int i = 0; i < n_points; i++)
+  {
+    const PointT& point = cloud.points[i];
+    if (std::isfinite(point.x) and std::isfinite(point.y) and std::isfinite(point.z))
+      point_cells_[i] = cell_hash_.insert(VoxelHash::key(point.x * inverse_cell_size, point.y * inverse_cell_size,
+          point.z * inverse_cell_size));
+    else
+      point_cells_[i] = -1;
+  }
+
+  // Points sorted by cell (counting sort, points of a cell by increasing index):
+  const int n_cells = cell_hash_.size();
+  cell_starts_.assign(n_cells + 1, 0);
+  for (int i = 0; i < n_points; i++)
+  {
+    if (point_cells_[i] >= 0)
+      cell_starts_[point_cells_[i] + 1]++;
+  }
+  for (int c = 0; c < n_cells; c++)
+    cell_starts_[c + 1] += cell_starts_[c];
+  cell_points_.resize(cell_starts_[n_cells]);
+  for (int i = 0; i < n_points; i++)
+  {
+    if (point_cells_[i] >= 0)
+      cell_points_[cell_starts_[point_cells_[i]]++] = i;
+  }
+  for (int c = n_cells; c > 0; c--)     // cell_starts_[c] was moved to the start of cell c + 1
+    cell_starts_[c] = cell_starts_[c - 1];
+  cell_starts_[0] = 0;
+
+  // Join the points closer than the tolerance, looking in the cell of a point and in half of its neighbors
+  // (the other half look in this cell):
+  static const int NEIGHBORS[13][3] = {
+      {1, 0, 0},
+      {-1, 1, 0}, {0, 1, 0}, {1, 1, 0},
+      {-1, -1, 1}, {0, -1, 1}, {1, -1, 1},
+      {-1, 0, 1}, {0, 0, 1}, {1, 0, 1},
+      {-1, 1, 1}, {0, 1, 1}, {1, 1, 1}};
+  parents_.resize(n_points);
+  for (int i = 0; i < n_points; i++)
+    parents_[i] = i;
+  const std::vector<uint64_t>& cell_keys = cell_hash_.keys();
+  for (int c = 0; c < n_cells; c++)
+  {
+    const int begin = cell_starts_[c];
+    const int end = cell_starts_[c + 1];
+    for (int a = begin; a < end; a++)
+    {
+      const PointT& point_a = cloud.points[cell_points_[a]];
+      for (int b = a + 1; b < end; b++)
+      {
+        const PointT& point_b = cloud.points[cell_points_[b]];
+        const float dx = point_a.x - point_b.x, dy = point_a.y - point_b.y, dz = point_a.z - point_b.z;
+        if (dx * dx + dy * dy + dz * dz < sqr_tolerance)
+          join(cell_points_[a], cell_points_[b]);
+      }
+    }
+
+    for (int k = 0; k < 13; k++)
+    {
+      const int neighbor = cell_hash_.find(VoxelHash::neighborKey(cell_keys[c], NEIGHBORS[k][0], NEIGHBORS[k][1],
+          NEIGHBORS[k][2]));
+      if (neighbor < 0)
+        continue;
+
+      const int neighbor_begin = cell_starts_[neighbor];
+      const int neighbor_end = cell_starts_[neighbor + 1];
+      for (int a = begin; a < end; a++)
+      {
+        const PointT& point_a = cloud.points[cell_points_[a]];
+        for (int b = neighbor_begin; b < neighbor_end; b++)
+        {
+          const PointT& point_b = cloud.points[cell_points_[b]];
+          const float dx = point_a.x - point_b.x, dy = point_a.y - point_b.y, dz = point_a.z - point_b.z;
+          if (dx * dx + dy * dy + dz * dz < sqr_tolerance)
+            join(cell_points_[a], cell_points_[b]);
+        }
+      }
+    }
+  }
+
+  // Clusters, numbered by their first point (as the seeds of pcl::EuclideanClusterExtraction):
+  root_clusters_.assign(n_points, -1);
+  cluster_sizes_.clear();
+  for (int i = 0; i < n_points; i++)
+  {
+    int& cluster = root_clusters_[findRoot(i)];
+    if (cluster < 0)
+    {
+      cluster = cluster_sizes_.size();
+      cluster_sizes_.push_back(0);
+    }
+    cluster_sizes_[cluster]++;
+  }
+
+  // Clusters with a valid size, with their points by increasing index:
+  cluster_outputs_.resize(cluster_sizes_.size());
+  for (unsigned int c = 0; c < cluster_sizes_.size(); c++)
+  {
+    if ((cluster_sizes_[c] >= min_cluster_size_) and (cluster_sizes_[c] <= max_cluster_size_))
+    {
+      cluster_outputs_[c] = clusters.size();
+      clusters.push_back(pcl::PointIndices());
+      clusters.back().header = cloud.header;
+      clusters.back().indices.reserve(cluster_sizes_[c]);
+    }
+    else
+      cluster_outputs_[c] = -1;
+  }
+  for (int i = 0; i < n_points; i++)
+  {
+    const int output = cluster_outputs_[root_clusters_[findRoot(i)]];
+    if (output >= 0)
+      clusters[output].indices.push_back(i);
+  }
+
+  std::stable_sort(clusters.begin(), clusters.end(), largerCluster);
+}
+
+#endif /* OPEN_PTRACK_DETECTION_GRID_CLUSTER_EXTRACTION_HPP_ */
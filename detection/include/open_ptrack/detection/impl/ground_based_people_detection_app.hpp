@@ -62,20 +62,37 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::GroundBasedPeople
   dimension_limits_set_ = false;
   heads_minimum_distance_ = 0.3;
   use_rgb_ = true;
+  batch_classification_ = false;
   mean_luminance_ = 0.0;
   sensor_tilt_compensation_ = false;
   background_subtraction_ = false;
+  background_resolution_ = 0.0;
+  background_learning_frames_ = 0;
+  apply_denoising_ = false;
+  mean_k_denoising_ = 5;
+  std_dev_denoising_ = 0.3;
 
   // set flag values for mandatory parameters:
   sqrt_ground_coeffs_ = std::numeric_limits<float>::quiet_NaN();
   person_classifier_set_flag_ = false;
   frame_counter_ = 0;
+
+  // latency profiling is disabled by default:
+  setLatencyProfiler(NULL);
 }
 
 template <typename PointT> void
-open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setInputCloud (PointCloudPtr& cloud)
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setInputCloud (const PointCloudConstPtr& cloud)
 {
   cloud_ = cloud;
+  images_.reset();
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setInputImages (const RGBDImage::ConstPtr& images)
+{
+  images_ = images;
+  cloud_.reset();
 }
 
 template <typename PointT> void
@@ -89,12 +106,14 @@ template <typename PointT> void
 open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setSamplingFactor (int sampling_factor)
 {
   sampling_factor_ = sampling_factor;
+  preprocessor_.setSamplingFactor (sampling_factor);
 }
 
 template <typename PointT> void
 open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setVoxelSize (float voxel_size)
 {
   voxel_size_ = voxel_size;
+  preprocessor_.setVoxelSize (voxel_size);
 }
 
 template <typename PointT> void
@@ -108,7 +127,13 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setDenoisingParam
 template <typename PointT> void
 open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setMaxDistance (float max_distance)
 {
+  preprocessor_.setMaxDistance (max_distance);
+
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  bool changed = (max_distance != max_distance_);
   max_distance_ = max_distance;
+  if (changed and (background_resolution_ > 0.0))
+    initBackgroundGrid();
 }
 
 template <typename PointT> void
@@ -170,14 +195,94 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setUseRGB (bool u
 }
 
 template <typename PointT> void
-open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setBackground (bool background_subtraction, float background_octree_resolution, PointCloudPtr& background_cloud)
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setBatchClassification (bool batch_classification)
 {
+  batch_classification_ = batch_classification;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setBackground (bool background_subtraction, float background_resolution, PointCloudPtr& background_cloud)
+{
+  std::lock_guard<std::mutex> lock(background_mutex_);
   background_subtraction_ = background_subtraction;
+  background_learning_frames_ = 0;
+
+  background_resolution_ = background_resolution;
+  initBackgroundGrid();
+  background_model_.learn(*background_cloud);
+}
 
-  background_octree_ = new pcl::octree::OctreePointCloud<PointT>(background_octree_resolution);
-  background_octree_->defineBoundingBox(-max_distance_/2, -max_distance_/2, 0.0, max_distance_/2, max_distance_/2, max_distance_);
-  background_octree_->setInputCloud (background_cloud);
-  background_octree_->addPointsFromInputCloud ();
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setBackgroundSubtraction (bool background_subtraction, float background_resolution)
+{
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  background_subtraction_ = background_subtraction;
+  if (background_resolution != background_resolution_)
+  {
+    background_resolution_ = background_resolution;
+    initBackgroundGrid();
+  }
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setBackgroundAdaptation (unsigned int absorb_frames, unsigned int release_frames)
+{
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  background_model_.setAdaptation(absorb_frames, release_frames);
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::learnBackground (unsigned int frames)
+{
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  background_subtraction_ = true;
+  background_model_.clear();
+  background_learning_frames_ = frames;
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setBackgroundFile (const std::string& background_file)
+{
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  background_file_ = background_file;
+}
+
+template <typename PointT> bool
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::loadBackground (const std::string& background_file)
+{
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  open_ptrack::detection::BackgroundModel background_model = background_model_;
+  if (not background_model.load(background_file) or not background_model.hasSameGrid(background_model_))
+    return (false);
+
+  background_model_ = background_model;
+  background_learning_frames_ = 0;
+  return (true);
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::initBackgroundGrid ()
+{
+  // The grid covers fields of view up to 90 degrees (horizontal and vertical) up to the maximum distance:
+  background_model_.init(background_resolution_, -max_distance_, -max_distance_, 0.0, max_distance_, max_distance_, max_distance_);
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setExclusionMask (const ExclusionMask& exclusion_mask)
+{
+  preprocessor_.setExclusionMask (exclusion_mask);
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::setLatencyProfiler (open_ptrack::opt_utils::LatencyProfiler* profiler)
+{
+  bool enabled = (profiler != NULL);
+  preprocess_latency_ = enabled ? profiler->getHistogram("detector/preprocess") : NULL;
+  ground_latency_ = enabled ? profiler->getHistogram("detector/ground") : NULL;
+  background_latency_ = enabled ? profiler->getHistogram("detector/background") : NULL;
+  clustering_latency_ = enabled ? profiler->getHistogram("detector/clustering") : NULL;
+  subclustering_latency_ = enabled ? profiler->getHistogram("detector/subclustering") : NULL;
+  classification_latency_ = enabled ? profiler->getHistogram("detector/hog") : NULL;
 }
 
 template <typename PointT> void
@@ -230,7 +335,7 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::getTiltCompensati
 }
 
 template <typename PointT> void
-open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::extractRGBFromPointCloud (PointCloudPtr input_cloud, pcl::PointCloud<pcl::RGB>::Ptr& output_cloud)
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::extractRGBFromPointCloud (const PointCloudConstPtr& input_cloud, pcl::PointCloud<pcl::RGB>::Ptr& output_cloud)
 {
   // Extract RGB information from a point cloud and output the corresponding RGB point cloud  
   output_cloud->points.resize(input_cloud->height*input_cloud->width);
@@ -238,9 +343,9 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::extractRGBFromPoi
   output_cloud->height = input_cloud->height;
 
   pcl::RGB rgb_point;
-  for (int j = 0; j < input_cloud->width; j++)
+  for (int i = 0; i < input_cloud->height; i++)
   {
-    for (int i = 0; i < input_cloud->height; i++)
+    for (int j = 0; j < input_cloud->width; j++)
     { 
       rgb_point.r = (*input_cloud)(j,i).r;
       rgb_point.g = (*input_cloud)(j,i).g;
@@ -319,39 +424,58 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::rotateGround(Eige
 }
 
 template <typename PointT> typename open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::PointCloudPtr
-open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessCloud (PointCloudPtr& input_cloud)
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessCloud (const PointCloudConstPtr& input_cloud)
+{
+  return preprocessCloud (input_cloud, pcl::PointCloud<pcl::RGB>::Ptr());
+}
+
+template <typename PointT> typename open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::PointCloudPtr
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessCloud (const PointCloudConstPtr& input_cloud, pcl::PointCloud<pcl::RGB>::Ptr rgb_image)
 {
-  // Downsample of sampling_factor in every dimension:
+  if (not apply_denoising_)
+  {
+    // Sampling, voxel grid filtering and RGB extraction in a single pass:
+    PointCloudPtr cloud_filtered(new PointCloud);
+    preprocessor_.compute (*input_cloud, *cloud_filtered, rgb_image.get());
+    return cloud_filtered;
+  }
+
+  if (rgb_image)
+    extractRGBFromPointCloud(input_cloud, rgb_image);
+
+  // Downsample of sampling_factor in every dimension (points in the exclusion zones become NaN):
+  const ExclusionMask& exclusion_mask = preprocessor_.getExclusionMask();
+  const bool exclusion = exclusion_mask.appliesTo(input_cloud->width, input_cloud->height);
   PointCloudPtr cloud_downsampled(new PointCloud);
   PointCloudPtr cloud_denoised(new PointCloud);
-  if (sampling_factor_ != 1)
+  if ((sampling_factor_ != 1) or exclusion)
   {
     cloud_downsampled->width = (input_cloud->width)/sampling_factor_;
     cloud_downsampled->height = (input_cloud->height)/sampling_factor_;
     cloud_downsampled->points.resize(cloud_downsampled->height*cloud_downsampled->width);
-    cloud_downsampled->is_dense = input_cloud->is_dense;
+    cloud_downsampled->is_dense = input_cloud->is_dense and not exclusion;
     cloud_downsampled->header = input_cloud->header;
-    for (int j = 0; j < cloud_downsampled->width; j++)
+    for (int i = 0; i < cloud_downsampled->height; i++)
     {
-      for (int i = 0; i < cloud_downsampled->height; i++)
+      for (int j = 0; j < cloud_downsampled->width; j++)
       {
-        (*cloud_downsampled)(j,i) = (*input_cloud)(sampling_factor_*j,sampling_factor_*i);
+        PointT& point = (*cloud_downsampled)(j,i);
+        point = (*input_cloud)(sampling_factor_*j,sampling_factor_*i);
+        if (exclusion and ExclusionMask::isExcluded(exclusion_mask.row(sampling_factor_*i)[sampling_factor_*j], point.z))
+          point.x = point.y = point.z = std::numeric_limits<float>::quiet_NaN();
       }
     }
   }
 
-  if (apply_denoising_)
-  {
-    // Denoising with statistical filtering:
-    pcl::StatisticalOutlierRemoval<PointT> sor;
-    if (sampling_factor_ != 1)
-      sor.setInputCloud (cloud_downsampled);
-    else
-      sor.setInputCloud (input_cloud);
-    sor.setMeanK (mean_k_denoising_);
-    sor.setStddevMulThresh (std_dev_denoising_);
-    sor.filter (*cloud_denoised);
-  }
+  // Denoising with statistical filtering:
+  pcl::StatisticalOutlierRemoval<PointT> sor;
+  if ((sampling_factor_ != 1) or exclusion)
+    sor.setInputCloud (cloud_downsampled);
+  else
+    sor.setInputCloud (input_cloud);
+  sor.setMeanK (mean_k_denoising_);
+  sor.setStddevMulThresh (std_dev_denoising_);
+  sor.filter (*cloud_denoised);
 
   //  // Denoising viewer
   //  int v1(0);
@@ -369,15 +493,7 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessCloud (
   // Voxel grid filtering:
   PointCloudPtr cloud_filtered(new PointCloud);
   pcl::VoxelGrid<PointT> voxel_grid_filter_object;
-  if (apply_denoising_)
-    voxel_grid_filter_object.setInputCloud(cloud_denoised);
-  else
-  {
-    if (sampling_factor_ != 1)
-      voxel_grid_filter_object.setInputCloud(cloud_downsampled);
-    else
-      voxel_grid_filter_object.setInputCloud(input_cloud);
-  }
+  voxel_grid_filter_object.setInputCloud(cloud_denoised);
   voxel_grid_filter_object.setLeafSize (voxel_size_, voxel_size_, voxel_size_);
   voxel_grid_filter_object.setFilterFieldName("z");
   voxel_grid_filter_object.setFilterLimits(0.0, max_distance_);
@@ -386,27 +502,82 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessCloud (
   return cloud_filtered;
 }
 
+template <typename PointT> typename open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::PointCloudPtr
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessImages (const RGBDImage::ConstPtr& images)
+{
+  return preprocessImages (images, pcl::PointCloud<pcl::RGB>::Ptr());
+}
+
+template <typename PointT> typename open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::PointCloudPtr
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::preprocessImages (const RGBDImage::ConstPtr& images, pcl::PointCloud<pcl::RGB>::Ptr rgb_image)
+{
+  if (not apply_denoising_)
+  {
+    // Sampled pixels are back-projected straight into the voxel grid:
+    PointCloudPtr cloud_filtered(new PointCloud);
+    preprocessor_.compute (*images, *cloud_filtered, rgb_image.get());
+    return cloud_filtered;
+  }
+
+  // Denoising needs the neighbors of every point, then the whole cloud is built:
+  PointCloudPtr cloud(new PointCloud);
+  OrganizedCloudPreprocessor<PointT>::backProject (*images, *cloud);
+  return preprocessCloud (cloud, rgb_image);
+}
+
 template <typename PointT> bool
 open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::compute (std::vector<pcl::people::PersonCluster<PointT> >& clusters)
+{
+  Frame frame;
+  frame.cloud = cloud_;
+  frame.images = images_;
+  frame.rgb_image = rgb_image_;
+  if (not compute(frame))
+    return (false);
+
+  clusters.swap(frame.clusters);
+  return (true);
+}
+
+template <typename PointT> bool
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::compute (Frame& frame)
+{
+  if (not computeForeground(frame))
+    return (false);
+  computeClusters(frame);
+  computeConfidences(frame);
+
+  // Results of the last frame:
+  rgb_image_ = frame.rgb_image;
+  no_ground_cloud_ = frame.no_ground_cloud;
+  mean_luminance_ = frame.mean_luminance;
+  transform_ = frame.transform;
+  anti_transform_ = frame.anti_transform;
+
+  return (true);
+}
+
+template <typename PointT> bool
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::computeForeground (Frame& frame)
 {
   frame_counter_++;
 
   // Define if debug info should be written or not for this frame:
-  bool debug_flag = false;
+  frame.debug = false;
   if ((frame_counter_ % 60) == 0)
   {
-    debug_flag = true;
+    frame.debug = true;
   }
 
   // Check if all mandatory variables have been set:
-  if (debug_flag)
+  if (frame.debug)
   {
     if (sqrt_ground_coeffs_ != sqrt_ground_coeffs_)
     {
       PCL_ERROR ("[open_ptrack::detection::GroundBasedPeopleDetectionApp::compute] Floor parameters have not been set or they are not valid!\n");
       return (false);
     }
-    if (cloud_ == NULL)
+    if ((frame.cloud == NULL) and (frame.images == NULL))
     {
       PCL_ERROR ("[open_ptrack::detection::GroundBasedPeopleDetectionApp::compute] Input cloud has not been set!\n");
       return (false);
@@ -430,161 +601,205 @@ open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::compute (std::vec
     if (voxel_size_ > 0.06)
       min_points_ = int(float(min_points_) * std::pow(0.06/voxel_size_, 2));
   }
+  frame.min_points = min_points_;
+  frame.max_points = max_points_;
+
+  // Point cloud pre-processing (downsampling and filtering) and RGB image:
+  open_ptrack::opt_utils::ScopedLatencyTimer preprocess_timer(preprocess_latency_);
+  if (not frame.rgb_image)
+    frame.rgb_image = pcl::PointCloud<pcl::RGB>::Ptr(new pcl::PointCloud<pcl::RGB>);
+  PointCloudPtr cloud_filtered;
+  if (frame.cloud)
+    cloud_filtered = preprocessCloud (frame.cloud, frame.rgb_image);
+  else
+    cloud_filtered = preprocessImages (frame.images, frame.rgb_image);
 
-  // Fill rgb image:
-  rgb_image_->points.clear();                            // clear RGB pointcloud
-  extractRGBFromPointCloud(cloud_, rgb_image_);          // fill RGB pointcloud
-
-  // Point cloud pre-processing (downsampling and filtering):
-  PointCloudPtr cloud_filtered(new PointCloud);
-  cloud_filtered = preprocessCloud (cloud_);
-
+  frame.mean_luminance = mean_luminance_;
   if (use_rgb_)
   {
     // Compute mean luminance:
     int n_points = cloud_filtered->points.size();
-    double sumR, sumG, sumB = 0.0;
-    for (int j = 0; j < cloud_filtered->width; j++)
+    double sumR = 0.0, sumG = 0.0, sumB = 0.0;
+    for (int i = 0; i < n_points; i++)
     {
-      for (int i = 0; i < cloud_filtered->height; i++)
-      {
-        sumR += (*cloud_filtered)(j,i).r;
-        sumG += (*cloud_filtered)(j,i).g;
-        sumB += (*cloud_filtered)(j,i).b;
-      }
+      sumR += cloud_filtered->points[i].r;
+      sumG += cloud_filtered->points[i].g;
+      sumB += cloud_filtered->points[i].b;
     }
-    mean_luminance_ = 0.3 * sumR/n_points + 0.59 * sumG/n_points + 0.11 * sumB/n_points;
-    //    mean_luminance_ = 0.2126 * sumR/n_points + 0.7152 * sumG/n_points + 0.0722 * sumB/n_points;
+    frame.mean_luminance = 0.3 * sumR/n_points + 0.59 * sumG/n_points + 0.11 * sumB/n_points;
+    //    frame.mean_luminance = 0.2126 * sumR/n_points + 0.7152 * sumG/n_points + 0.0722 * sumB/n_points;
   }
+  preprocess_timer.stop();
 
   // Ground removal and update:
+  open_ptrack::opt_utils::ScopedLatencyTimer ground_timer(ground_latency_);
   pcl::IndicesPtr inliers(new std::vector<int>);
   boost::shared_ptr<pcl::SampleConsensusModelPlane<PointT> > ground_model(new pcl::SampleConsensusModelPlane<PointT>(cloud_filtered));
   ground_model->selectWithinDistance(ground_coeffs_, voxel_size_, *inliers);
-  no_ground_cloud_ = PointCloudPtr (new PointCloud);
+  frame.no_ground_cloud = PointCloudPtr (new PointCloud);
   pcl::ExtractIndices<PointT> extract;
   extract.setInputCloud(cloud_filtered);
   extract.setIndices(inliers);
   extract.setNegative(true);
-  extract.filter(*no_ground_cloud_);
+  extract.filter(*frame.no_ground_cloud);
   if (inliers->size () >= (300 * 0.06 / voxel_size_ / std::pow (static_cast<double> (sampling_factor_), 2)))
     ground_model->optimizeModelCoefficients (*inliers, ground_coeffs_, ground_coeffs_);
   else
   {
-    if (debug_flag)
+    if (frame.debug)
     {
       PCL_INFO ("No groundplane update!\n");
     }
   }
+  frame.ground_coeffs = ground_coeffs_;
+  ground_timer.stop();
 
   // Background Subtraction (optional):
   if (background_subtraction_)
   {
-    PointCloudPtr foreground_cloud(new PointCloud);
-    for (unsigned int i = 0; i < no_ground_cloud_->points.size(); i++)
+    open_ptrack::opt_utils::ScopedLatencyTimer background_timer(background_latency_);
+    std::lock_guard<std::mutex> lock(background_mutex_);
+    if (background_learning_frames_ > 0)
     {
-      if (not (background_octree_->isVoxelOccupiedAtPoint(no_ground_cloud_->points[i].x, no_ground_cloud_->points[i].y, no_ground_cloud_->points[i].z)))
+      // Background acquisition, the whole frame is background:
+      background_model_.learn(*frame.no_ground_cloud);
+      frame.no_ground_cloud->points.clear();
+      frame.no_ground_cloud->width = 0;
+      frame.no_ground_cloud->height = 1;
+      if (--background_learning_frames_ == 0)
       {
-        foreground_cloud->points.push_back(no_ground_cloud_->points[i]);
+        PCL_INFO ("Background acquired (%lu voxels).\n", static_cast<unsigned long>(background_model_.size()));
+        if (not background_file_.empty() and not background_model_.save(background_file_))
+          PCL_WARN ("[open_ptrack::detection::GroundBasedPeopleDetectionApp::compute] Cannot save the background to %s!\n", background_file_.c_str());
       }
     }
-    no_ground_cloud_ = foreground_cloud;
+    else
+    {
+      background_model_.update(*frame.no_ground_cloud);
+      background_model_.removeBackground(*frame.no_ground_cloud);
+    }
   }
 
-  if (no_ground_cloud_->points.size() > 0)
+  return (true);
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::computeClusters (Frame& frame)
+{
+  frame.clusters.clear();
+  frame.transform = Eigen::Affine3f::Identity();
+  frame.anti_transform = Eigen::Affine3f::Identity();
+  if (frame.no_ground_cloud->points.size() == 0)
+    return;
+
+  // Euclidean Clustering:
+  open_ptrack::opt_utils::ScopedLatencyTimer clustering_timer(clustering_latency_);
+  std::vector<pcl::PointIndices> cluster_indices;
+  cluster_extraction_.setClusterTolerance(2 * 0.06);
+  cluster_extraction_.setMinClusterSize(frame.min_points);
+  cluster_extraction_.setMaxClusterSize(frame.max_points);
+  cluster_extraction_.setInputCloud(frame.no_ground_cloud);
+  cluster_extraction_.extract(cluster_indices);
+  clustering_timer.stop();
+
+  // Sensor tilt compensation to improve people detection:
+  open_ptrack::opt_utils::ScopedLatencyTimer subclustering_timer(subclustering_latency_);
+  PointCloudPtr no_ground_cloud_rotated(new PointCloud);
+  Eigen::VectorXf ground_coeffs_new;
+  if(sensor_tilt_compensation_)
+  {
+    // We want to rotate the point cloud so that the ground plane is parallel to the xOz plane of the sensor:
+    Eigen::Vector3f input_plane, output_plane;
+    input_plane << frame.ground_coeffs(0), frame.ground_coeffs(1), frame.ground_coeffs(2);
+    output_plane << 0.0, -1.0, 0.0;
+
+    Eigen::Vector3f axis = input_plane.cross(output_plane);
+    float angle = acos( input_plane.dot(output_plane)/ ( input_plane.norm()/output_plane.norm() ) );
+    frame.transform = Eigen::AngleAxisf(angle, axis);
+
+    // Setting also anti_transform for later
+    frame.anti_transform = frame.transform.inverse();
+    no_ground_cloud_rotated = rotateCloud(frame.no_ground_cloud, frame.transform);
+    ground_coeffs_new.resize(4);
+    ground_coeffs_new = rotateGround(frame.ground_coeffs, frame.transform);
+  }
+  else
+  {
+    no_ground_cloud_rotated = frame.no_ground_cloud;
+    ground_coeffs_new = frame.ground_coeffs;
+  }
+
+  // To avoid PCL warning:
+  if (cluster_indices.size() == 0)
+    cluster_indices.push_back(pcl::PointIndices());
+
+  // Head based sub-clustering //
+  pcl::people::HeadBasedSubclustering<PointT> subclustering;
+  subclustering.setInputCloud(no_ground_cloud_rotated);
+  subclustering.setGround(ground_coeffs_new);
+  subclustering.setInitialClusters(cluster_indices);
+  subclustering.setHeightLimits(min_height_, max_height_);
+  subclustering.setMinimumDistanceBetweenHeads(heads_minimum_distance_);
+  subclustering.setSensorPortraitOrientation(vertical_);
+  subclustering.subcluster(frame.clusters);
+  subclustering_timer.stop();
+}
+
+template <typename PointT> void
+open_ptrack::detection::GroundBasedPeopleDetectionApp<PointT>::computeConfidences (Frame& frame)
+{
+  if (frame.no_ground_cloud->points.size() == 0)
+    return;
+
+//  for (unsigned int i = 0; i < frame.rgb_image->points.size(); i++)
+//  {
+//    if ((frame.rgb_image->points[i].r < 0) | (frame.rgb_image->points[i].r > 255) | isnan(frame.rgb_image->points[i].r))
+//    {
+//      std::cout << "ERROR in RGB data!" << std::endl;
+//    }
+//  }
+
+  if (use_rgb_) // if RGB information can be used
   {
-    // Euclidean Clustering:
-    std::vector<pcl::PointIndices> cluster_indices;
-    typename pcl::search::KdTree<PointT>::Ptr tree (new pcl::search::KdTree<PointT>);
-    tree->setInputCloud(no_ground_cloud_);
-    pcl::EuclideanClusterExtraction<PointT> ec;
-    ec.setClusterTolerance(2 * 0.06);
-    ec.setMinClusterSize(min_points_);
-    ec.setMaxClusterSize(max_points_);
-    ec.setSearchMethod(tree);
-    ec.setInputCloud(no_ground_cloud_);
-    ec.extract(cluster_indices);
-
-    // Sensor tilt compensation to improve people detection:
-    PointCloudPtr no_ground_cloud_rotated(new PointCloud);
-    Eigen::VectorXf ground_coeffs_new;
-    if(sensor_tilt_compensation_)
+    // Person confidence evaluation with HOG+SVM:
+    open_ptrack::opt_utils::ScopedLatencyTimer classification_timer(classification_latency_);
+    if (vertical_)  // Rotate the image if the camera is vertical
     {
-      // We want to rotate the point cloud so that the ground plane is parallel to the xOz plane of the sensor:
-      Eigen::Vector3f input_plane, output_plane;
-      input_plane << ground_coeffs_(0), ground_coeffs_(1), ground_coeffs_(2);
-      output_plane << 0.0, -1.0, 0.0;
-
-      Eigen::Vector3f axis = input_plane.cross(output_plane);
-      float angle = acos( input_plane.dot(output_plane)/ ( input_plane.norm()/output_plane.norm() ) );
-      transform_ = Eigen::AngleAxisf(angle, axis);
-
-      // Setting also anti_transform for later
-      anti_transform_ = transform_.inverse();
-      no_ground_cloud_rotated = rotateCloud(no_ground_cloud_, transform_);
-      ground_coeffs_new.resize(4);
-      ground_coeffs_new = rotateGround(ground_coeffs_, transform_);
+      swapDimensions(frame.rgb_image);
     }
-    else
+    std::vector<typename open_ptrack::detection::PersonClassifier<pcl::RGB>::Window> windows;
+    for(typename std::vector<pcl::people::PersonCluster<PointT> >::iterator it = frame.clusters.begin(); it != frame.clusters.end(); ++it)
     {
-      transform_ = transform_.Identity();
-      anti_transform_ = transform_.inverse();
-      no_ground_cloud_rotated = no_ground_cloud_;
-      ground_coeffs_new = ground_coeffs_;
+      //Evaluate confidence for the current PersonCluster:
+      Eigen::Vector3f centroid = intrinsics_matrix_ * (frame.anti_transform * it->getTCenter());
+      centroid /= centroid(2);
+      Eigen::Vector3f top = intrinsics_matrix_ * (frame.anti_transform * it->getTTop());
+      top /= top(2);
+      Eigen::Vector3f bottom = intrinsics_matrix_ * (frame.anti_transform * it->getTBottom());
+      bottom /= bottom(2);
+
+      if (batch_classification_)
+        windows.push_back(person_classifier_.getWindow(frame.rgb_image, bottom, top, centroid, vertical_));
+      else
+        it->setPersonConfidence(person_classifier_.evaluate(frame.rgb_image, bottom, top, centroid, vertical_));
     }
 
-    // To avoid PCL warning:
-    if (cluster_indices.size() == 0)
-      cluster_indices.push_back(pcl::PointIndices());
-
-    // Head based sub-clustering //
-    pcl::people::HeadBasedSubclustering<PointT> subclustering;
-    subclustering.setInputCloud(no_ground_cloud_rotated);
-    subclustering.setGround(ground_coeffs_new);
-    subclustering.setInitialClusters(cluster_indices);
-    subclustering.setHeightLimits(min_height_, max_height_);
-    subclustering.setMinimumDistanceBetweenHeads(heads_minimum_distance_);
-    subclustering.setSensorPortraitOrientation(vertical_);
-    subclustering.subcluster(clusters);
-
-//    for (unsigned int i = 0; i < rgb_image_->points.size(); i++)
-//    {
-//      if ((rgb_image_->points[i].r < 0) | (rgb_image_->points[i].r > 255) | isnan(rgb_image_->points[i].r))
-//      {
-//        std::cout << "ERROR in RGB data!" << std::endl;
-//      }
-//    }
-
-    if (use_rgb_) // if RGB information can be used
+    if (batch_classification_)
     {
-      // Person confidence evaluation with HOG+SVM:
-      if (vertical_)  // Rotate the image if the camera is vertical
-      {
-        swapDimensions(rgb_image_);
-      }
-      for(typename std::vector<pcl::people::PersonCluster<PointT> >::iterator it = clusters.begin(); it != clusters.end(); ++it)
-      {
-        //Evaluate confidence for the current PersonCluster:
-        Eigen::Vector3f centroid = intrinsics_matrix_ * (anti_transform_ * it->getTCenter());
-        centroid /= centroid(2);
-        Eigen::Vector3f top = intrinsics_matrix_ * (anti_transform_ * it->getTTop());
-        top /= top(2);
-        Eigen::Vector3f bottom = intrinsics_matrix_ * (anti_transform_ * it->getTBottom());
-        bottom /= bottom(2);
-
-        it->setPersonConfidence(person_classifier_.evaluate(rgb_image_, bottom, top, centroid, vertical_));
-      }
+      // The clusters share the HOG features of the frame:
+      std::vector<double> confidences;
+      person_classifier_.evaluateBatch(frame.rgb_image, windows, confidences);
+      for (unsigned int i = 0; i < frame.clusters.size(); i++)
+        frame.clusters[i].setPersonConfidence(confidences[i]);
     }
-    else
+  }
+  else
+  {
+    for(typename std::vector<pcl::people::PersonCluster<PointT> >::iterator it = frame.clusters.begin(); it != frame.clusters.end(); ++it)
     {
-      for(typename std::vector<pcl::people::PersonCluster<PointT> >::iterator it = clusters.begin(); it != clusters.end(); ++it)
-      {
-        it->setPersonConfidence(-100.0);
-      }
+      it->setPersonConfidence(-100.0);
     }
   }
-
-  return (true);
 }
 
 template <typename PointT>
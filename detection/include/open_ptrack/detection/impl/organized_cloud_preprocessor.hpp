@@ -0,0 +1,370 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * organized_cloud_preprocessor.hpp
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_ORGANIZED_CLOUD_PREPROCESSOR_HPP_
+#define OPEN_PTRACK_DETECTION_ORGANIZED_CLOUD_PREPROCESSOR_HPP_
+
+#include <open_ptrack/detection/organized_cloud_preprocessor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+template <typename PointT>
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::OrganizedCloudPreprocessor () :
+  sampling_factor_(1),
+  voxel_size_(0.06),
+  max_distance_(50.0)
+{
+
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::setSamplingFactor (int sampling_factor)
+{
+  sampling_factor_ = std::max(sampling_factor, 1);
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::setVoxelSize (float voxel_size)
+{
+  voxel_size_ = voxel_size;
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::setMaxDistance (float max_distance)
+{
+  max_distance_ = max_distance;
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::setExclusionMask (const ExclusionMask& exclusion_mask)
+{
+  exclusion_mask_ = exclusion_mask;
+}
+
+template <typename PointT> const open_ptrack::detection::ExclusionMask&
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::getExclusionMask () const
+{
+  return exclusion_mask_;
+}
+
+template <typename PointT> int
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::findVoxel (uint64_t key)
+{
+  const int index = voxel_hash_.insert(key);
+  if (index == static_cast<int>(voxels_.size()))
+  {
+    // New voxel:
+    VoxelAccumulator voxel = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
+    voxels_.push_back(voxel);
+  }
+  return index;
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::addToVoxel (int index, const VoxelAccumulator& sums)
+{
+  VoxelAccumulator& voxel = voxels_[index];
+  voxel.x += sums.x;
+  voxel.y += sums.y;
+  voxel.z += sums.z;
+  voxel.r += sums.r;
+  voxel.g += sums.g;
+  voxel.b += sums.b;
+  voxel.count += sums.count;
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::startVoxels (VoxelRun& run)
+{
+  voxel_hash_.clear();
+  voxels_.clear();
+
+  VoxelAccumulator empty = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
+  run.key = VoxelHash::EMPTY_KEY;
+  run.voxel = -1;
+  run.sums = empty;
+}
+
+template <typename PointT> inline void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::addPoint (VoxelRun& run, uint64_t key, float x, float y,
+    float z, float r, float g, float b)
+{
+  if (key != run.key)
+  {
+    flushRun(run);
+    run.key = key;
+    run.voxel = findVoxel(key);
+  }
+  run.sums.x += x;
+  run.sums.y += y;
+  run.sums.z += z;
+  run.sums.r += r;
+  run.sums.g += g;
+  run.sums.b += b;
+  run.sums.count++;
+}
+
+template <typename PointT> inline void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::flushRun (VoxelRun& run)
+{
+  if (run.sums.count > 0)
+  {
+    addToVoxel(run.voxel, run.sums);
+    VoxelAccumulator empty = {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
+    run.sums = empty;
+  }
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::writeVoxels (PointCloud& output_cloud)
+{
+  // Voxel centroids, in the order of pcl::VoxelGrid:
+  const std::vector<uint64_t>& keys = voxel_hash_.keys();
+  order_.resize(voxels_.size());
+  for (unsigned int i = 0; i < voxels_.size(); i++)
+    order_[i] = std::make_pair(keys[i], static_cast<int>(i));
+  std::sort(order_.begin(), order_.end());
+
+  output_cloud.points.resize(order_.size());
+  output_cloud.width = order_.size();
+  output_cloud.height = 1;
+  output_cloud.is_dense = true;
+  for (unsigned int i = 0; i < order_.size(); i++)
+  {
+    const VoxelAccumulator& voxel = voxels_[order_[i].second];
+    const float n = voxel.count;
+    PointT& point = output_cloud.points[i];
+    point = PointT();
+    point.x = voxel.x / n;
+    point.y = voxel.y / n;
+    point.z = voxel.z / n;
+    point.r = static_cast<uint8_t>(voxel.r / n);
+    point.g = static_cast<uint8_t>(voxel.g / n);
+    point.b = static_cast<uint8_t>(voxel.b / n);
+  }
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::compute (const PointCloud& input_cloud, PointCloud& output_cloud,
+    pcl::PointCloud<pcl::RGB>* rgb_image)
+{
+  const int width = input_cloud.width;
+  const int height = input_cloud.height;
+  const int step = sampling_factor_;
+  const float max_distance = max_distance_;
+  // Rows and columns kept by sampling (as many as in the downsampled cloud of GroundBasedPeopleDetectionApp):
+  const int sampled_width = (width / step) * step;
+  const int sampled_height = (height / step) * step;
+  const float inverse_voxel_size = 1.0f / voxel_size_;
+  const bool exclusion = exclusion_mask_.appliesTo(width, height);
+
+  if (rgb_image != NULL)
+  {
+    rgb_image->points.resize(input_cloud.points.size());
+    rgb_image->width = width;
+    rgb_image->height = height;
+  }
+
+  // Neighboring pixels are often in the same voxel: consecutive points of a voxel are summed in a run before being
+  // added to its accumulator, which is looked up in the hash table once per run.
+  VoxelRun run;
+  startVoxels(run);
+  for (int row = 0; row < height; row++)
+  {
+    const PointT* input_row = &input_cloud.points[row * width];
+
+    // RGB image (every pixel):
+    if (rgb_image != NULL)
+    {
+      pcl::RGB* rgb_row = &rgb_image->points[row * width];
+      for (int col = 0; col < width; col++)
+      {
+        rgb_row[col].r = input_row[col].r;
+        rgb_row[col].g = input_row[col].g;
+        rgb_row[col].b = input_row[col].b;
+      }
+    }
+
+    if ((row % step != 0) or (row >= sampled_height))
+      continue;
+
+    // Voxel grid (sampled pixels with z in [0, max_distance], out of the exclusion zones):
+    const ExclusionMask::PixelRanges* excluded_row = exclusion ? exclusion_mask_.row(row) : NULL;
+    for (int col = 0; col < sampled_width; col += step)
+    {
+      const PointT& point = input_row[col];
+      if (not (point.z >= 0.0f and point.z <= max_distance) or not std::isfinite(point.x) or not std::isfinite(point.y))
+        continue;
+      if (excluded_row != NULL and ExclusionMask::isExcluded(excluded_row[col], point.z))
+        continue;
+
+      const uint64_t key = VoxelHash::key(point.x * inverse_voxel_size, point.y * inverse_voxel_size,
+          point.z * inverse_voxel_size);
+      addPoint(run, key, point.x, point.y, point.z, point.r, point.g, point.b);
+    }
+  }
+  flushRun(run);
+
+  output_cloud.header = input_cloud.header;
+  output_cloud.sensor_origin_ = input_cloud.sensor_origin_;
+  output_cloud.sensor_orientation_ = input_cloud.sensor_orientation_;
+  writeVoxels(output_cloud);
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::compute (const RGBDImage& image, PointCloud& output_cloud,
+    pcl::PointCloud<pcl::RGB>* rgb_image)
+{
+  const int width = image.width;
+  const int height = image.height;
+  const int step = sampling_factor_;
+  const int sampled_width = (width / step) * step;
+  const int sampled_height = (height / step) * step;
+  const float inverse_voxel_size = 1.0f / voxel_size_;
+  const float inverse_fx = 1.0f / image.fx;
+  const float inverse_fy = 1.0f / image.fy;
+  // Largest depth value kept (0 means no measurement):
+  const float max_depth = max_distance_ / image.depth_scale;
+  const int channels = image.color_channels;
+  const int red = image.bgr ? 2 : 0;
+  const int blue = image.bgr ? 0 : 2;
+  const bool exclusion = exclusion_mask_.appliesTo(width, height);
+
+  if (rgb_image != NULL)
+  {
+    rgb_image->points.resize(width * height);
+    rgb_image->width = width;
+    rgb_image->height = height;
+  }
+
+  VoxelRun run;
+  startVoxels(run);
+  for (int row = 0; row < height; row++)
+  {
+    const uint8_t* color_row = image.color + row * image.color_step;
+
+    // RGB image (every pixel):
+    if (rgb_image != NULL)
+    {
+      pcl::RGB* rgb_row = &rgb_image->points[row * width];
+      const uint8_t* pixel = color_row;
+      for (int col = 0; col < width; col++, pixel += channels)
+      {
+        rgb_row[col].r = pixel[red];
+        rgb_row[col].g = pixel[1];
+        rgb_row[col].b = pixel[blue];
+      }
+    }
+
+    if ((row % step != 0) or (row >= sampled_height))
+      continue;
+
+    // Voxel grid (only the sampled pixels are back-projected):
+    const uint16_t* depth_row = reinterpret_cast<const uint16_t*>(
+        reinterpret_cast<const uint8_t*>(image.depth) + row * image.depth_step);
+    const float y_factor = (row - image.cy) * inverse_fy;
+    const ExclusionMask::PixelRanges* excluded_row = exclusion ? exclusion_mask_.row(row) : NULL;
+    for (int col = 0; col < sampled_width; col += step)
+    {
+      const uint16_t depth = depth_row[col];
+      if ((depth == 0) or (depth > max_depth))
+        continue;
+
+      const float z = depth * image.depth_scale;
+      if (excluded_row != NULL and ExclusionMask::isExcluded(excluded_row[col], z))
+        continue;
+      const float x = (col - image.cx) * inverse_fx * z;
+      const float y = y_factor * z;
+      const uint64_t key = VoxelHash::key(x * inverse_voxel_size, y * inverse_voxel_size, z * inverse_voxel_size);
+      const uint8_t* pixel = color_row + col * channels;
+      addPoint(run, key, x, y, z, pixel[red], pixel[1], pixel[blue]);
+    }
+  }
+  flushRun(run);
+
+  output_cloud.header = image.header;
+  output_cloud.sensor_origin_ = Eigen::Vector4f::Zero();
+  output_cloud.sensor_orientation_ = Eigen::Quaternionf::Identity();
+  writeVoxels(output_cloud);
+}
+
+template <typename PointT> void
+open_ptrack::detection::OrganizedCloudPreprocessor<PointT>::backProject (const RGBDImage& image, PointCloud& cloud)
+{
+  const float bad_point = std::numeric_limits<float>::quiet_NaN();
+  const float inverse_fx = 1.0f / image.fx;
+  const float inverse_fy = 1.0f / image.fy;
+  const int channels = image.color_channels;
+  const int red = image.bgr ? 2 : 0;
+  const int blue = image.bgr ? 0 : 2;
+
+  cloud.header = image.header;
+  cloud.sensor_origin_ = Eigen::Vector4f::Zero();
+  cloud.sensor_orientation_ = Eigen::Quaternionf::Identity();
+  cloud.width = image.width;
+  cloud.height = image.height;
+  cloud.is_dense = false;
+  cloud.points.resize(image.width * image.height);
+  for (int row = 0; row < image.height; row++)
+  {
+    const uint16_t* depth_row = reinterpret_cast<const uint16_t*>(
+        reinterpret_cast<const uint8_t*>(image.depth) + row * image.depth_step);
+    const uint8_t* pixel = image.color + row * image.color_step;
+    PointT* cloud_row = &cloud.points[row * image.width];
+    for (int col = 0; col < image.width; col++, pixel += channels)
+    {
+      PointT& point = cloud_row[col];
+      if (depth_row[col] == 0)
+      {
+        point.x = point.y = point.z = bad_point;
+      }
+      else
+      {
+        point.z = depth_row[col] * image.depth_scale;
+        point.x = (col - image.cx) * inverse_fx * point.z;
+        point.y = (row - image.cy) * inverse_fy * point.z;
+      }
+      point.r = pixel[red];
+      point.g = pixel[1];
+      point.b = pixel[blue];
+    }
+  }
+}
+
+#endif /* OPEN_PTRACK_DETECTION_ORGANIZED_CLOUD_PREPROCESSOR_HPP_ */
@@ -43,7 +43,9 @@
 #define OPEN_PTRACK_DETECTION_PERSON_CLASSIFIER_HPP_
 
 template <typename PointT>
-open_ptrack::detection::PersonClassifier<PointT>::PersonClassifier () {}
+open_ptrack::detection::PersonClassifier<PointT>::PersonClassifier () :
+  scales_per_octave_(8)
+{}
 
 template <typename PointT>
 open_ptrack::detection::PersonClassifier<PointT>::~PersonClassifier () {}
@@ -226,15 +228,13 @@ open_ptrack::detection::PersonClassifier<PointT>::evaluate (float height_person,
   return (-1000);
   }
 
-  int height = floor((height_person * window_height_) / (0.75 * window_height_) + 0.5);  // floor(i+0.5) = round(i)
-  int width = floor((height_person * window_width_) / (0.75 * window_height_) + 0.5);
-  int xmin = floor(xc - width / 2 + 0.5);
-  int ymin = floor(yc - height / 2 + 0.5);
+  int xmin, ymin, width, height;
+  getBox(height_person, xc, yc, xmin, ymin, width, height);
   double confidence;
 
 //std::cout << "Before copyMakeBorder: " << xmin << " " << ymin << " " << width << " " << height << std::endl;
 
-  if ((height > 0) & ((xmin+width-1) > 0))
+  if ((height > 0) & ((xmin+width-1) > 0) & (xmin < int(image->width)) & ((ymin+height-1) > 0) & (ymin < int(image->height)))
   {
     // If near the border, fill with black:
     PointCloudPtr box(new PointCloud);
@@ -288,6 +288,17 @@ open_ptrack::detection::PersonClassifier<PointT>::evaluate (PointCloudPtr& image
               Eigen::Vector3f& top,
               Eigen::Vector3f& centroid,
               bool vertical)
+{
+  Window window = getWindow(image, bottom, top, centroid, vertical);
+  return (evaluate(window.height, window.xc, window.yc, image));
+}
+
+template <typename PointT> typename open_ptrack::detection::PersonClassifier<PointT>::Window
+open_ptrack::detection::PersonClassifier<PointT>::getWindow (PointCloudPtr& image,
+              Eigen::Vector3f& bottom,
+              Eigen::Vector3f& top,
+              Eigen::Vector3f& centroid,
+              bool vertical)
 {
   float pixel_height;
   float pixel_width;
@@ -305,13 +316,175 @@ open_ptrack::detection::PersonClassifier<PointT>::evaluate (PointCloudPtr& image
   float pixel_xc = centroid(0);
   float pixel_yc = centroid(1);
 
+  Window window;
   if (!vertical)
   {
-    return (evaluate(pixel_height, pixel_xc, pixel_yc, image));
+    window.height = pixel_height;
+    window.xc = pixel_xc;
+    window.yc = pixel_yc;
   }
   else
   {
-    return (evaluate(pixel_width, pixel_yc, image->height-pixel_xc+1, image));
+    window.height = pixel_width;
+    window.xc = pixel_yc;
+    window.yc = image->height-pixel_xc+1;
+  }
+  return (window);
+}
+
+template <typename PointT> void
+open_ptrack::detection::PersonClassifier<PointT>::getBox (float height_person, float xc, float yc, int& xmin, int& ymin,
+    int& width, int& height)
+{
+  height = floor((height_person * window_height_) / (0.75 * window_height_) + 0.5);  // floor(i+0.5) = round(i)
+  width = floor((height_person * window_width_) / (0.75 * window_height_) + 0.5);
+  xmin = floor(xc - width / 2 + 0.5);
+  ymin = floor(yc - height / 2 + 0.5);
+}
+
+template <typename PointT> void
+open_ptrack::detection::PersonClassifier<PointT>::setScalesPerOctave (int scales_per_octave)
+{
+  scales_per_octave_ = std::max(1, scales_per_octave);
+}
+
+template <typename PointT> void
+open_ptrack::detection::PersonClassifier<PointT>::evaluateBatch (PointCloudPtr& image,
+              const std::vector<Window>& windows,
+              std::vector<double>& confidences)
+{
+  confidences.assign(windows.size(), std::numeric_limits<double>::quiet_NaN());
+  if (SVM_weights_.size() == 0)
+  {
+    PCL_ERROR ("[open_ptrack::detection::PersonClassifier::evaluateBatch] SVM has not been set!\n");
+    confidences.assign(windows.size(), -1000);
+    return;
+  }
+
+  // Parameters of pcl::people::HOG:
+  const int bin_size = 8;
+  const int n_orients = 9;
+  const float clip = 0.2f;
+  const int window_cells_y = window_height_ / bin_size;
+  const int window_cells_x = window_width_ / bin_size;
+  const int descriptor_rows = window_cells_y - 2;     // border cells are not part of the descriptor
+
+  if ((sizeof(PointT) != 4) or (descriptor_rows * (window_cells_x - 2) * n_orients * 4 != int(SVM_weights_.size())))
+  {
+    for (unsigned int i = 0; i < windows.size(); i++)
+      confidences[i] = evaluate(windows[i].height, windows[i].xc, windows[i].yc, image);
+    return;
+  }
+
+  // Boxes of the patches, sorted by pyramid level (scale of the image for which a box is as large as the window):
+  std::vector<int> xmins(windows.size()), ymins(windows.size()), widths(windows.size()), heights(windows.size());
+  std::vector<std::pair<int, int> > levels;
+  for (unsigned int i = 0; i < windows.size(); i++)
+  {
+    getBox(windows[i].height, windows[i].xc, windows[i].yc, xmins[i], ymins[i], widths[i], heights[i]);
+    if ((heights[i] > 0) & ((xmins[i]+widths[i]-1) > 0) & (xmins[i] < int(image->width)) &
+        ((ymins[i]+heights[i]-1) > 0) & (ymins[i] < int(image->height)))
+    {
+      float octaves = std::log(float(window_height_) / heights[i]) / std::log(2.0f);
+      levels.push_back(std::make_pair(int(floor(octaves * scales_per_octave_ + 0.5)), int(i)));
+    }
+  }
+  std::sort(levels.begin(), levels.end());
+
+  // 8-bit, 4-channel view of the image (no copy):
+  cv::Mat image_view(image->height, image->width, CV_8UC4, (void*) &image->points[0]);
+
+  pcl::people::HOG hog;
+  std::vector<float> image_float, magnitude, orientation, histograms, cells;
+  std::vector<float> partial(descriptor_rows);
+  for (unsigned int begin = 0; begin < levels.size(); )
+  {
+    unsigned int end = begin;
+    while ((end < levels.size()) && (levels[end].first == levels[begin].first))
+      end++;
+    const float scale = std::pow(2.0f, float(levels[begin].first) / scales_per_octave_);
+
+    // Part of the resized image covering the patches of this level, with a margin of one cell:
+    float xmin = std::numeric_limits<float>::max(), ymin = xmin;
+    float xmax = -xmin, ymax = -xmin;
+    for (unsigned int k = begin; k < end; k++)
+    {
+      int i = levels[k].second;
+      xmin = std::min(xmin, float(xmins[i]));
+      ymin = std::min(ymin, float(ymins[i]));
+      xmax = std::max(xmax, float(xmins[i] + widths[i]));
+      ymax = std::max(ymax, float(ymins[i] + heights[i]));
+    }
+    const int origin_x = int(floor(xmin * scale)) - bin_size;
+    const int origin_y = int(floor(ymin * scale)) - bin_size;
+    const int cells_x = std::max(window_cells_x, int(ceil((xmax * scale - origin_x) / bin_size)) + 1);
+    const int cells_y = std::max(window_cells_y, int(ceil((ymax * scale - origin_y) / bin_size)) + 1);
+    const int map_width = cells_x * bin_size;
+    const int map_height = cells_y * bin_size;
+
+    // Resize it (black outside the image, as copyMakeBorder):
+    cv::Mat transform = (cv::Mat_<double>(2, 3) << scale, 0, 0.5 * scale - 0.5 - origin_x,
+        0, scale, 0.5 * scale - 0.5 - origin_y);
+    cv::Mat region;
+    cv::warpAffine(image_view, region, transform, cv::Size(map_width, map_height), cv::INTER_LINEAR,
+        cv::BORDER_CONSTANT, cv::Scalar::all(0));
+
+    // Convert it to array of float (as in evaluate):
+    int delta = map_height * map_width;
+    image_float.resize(delta * 3);
+    for (int row = 0; row < map_height; row++)
+    {
+      const unsigned char* pixel = region.ptr<unsigned char>(row);
+      for (int col = 0; col < map_width; col++, pixel += 4)
+      {
+        image_float[row + map_height * col] = float(pixel[2]) / 255;
+        image_float[row + map_height * col + delta] = float(pixel[1]) / 255;
+        image_float[row + map_height * col + delta * 2] = float(pixel[0]) / 255;
+      }
+    }
+
+    // HOG cells, once for all the patches of this level:
+    magnitude.resize(delta);
+    orientation.resize(delta);
+    hog.gradMag(&image_float[0], map_height, map_width, 3, &magnitude[0], &orientation[0]);
+    histograms.assign(cells_y * cells_x * n_orients, 0.0f);
+    hog.gradHist(&magnitude[0], &orientation[0], map_height, map_width, bin_size, n_orients, true, &histograms[0]);
+    cells.assign(cells_y * cells_x * n_orients * 4, 0.0f);
+    hog.normalization(&histograms[0], map_height, map_width, bin_size, n_orients, clip, &cells[0]);
+
+    // Score the windows, centered on the patches, by dot product with the SVM weights (descriptor order of
+    // pcl::people::HOG: normalized orientation, then column, then row):
+    const int channel_size = cells_y * cells_x;
+    for (unsigned int k = begin; k < end; k++)
+    {
+      int i = levels[k].second;
+      int cell_x = int(floor(((xmins[i] + widths[i] / 2.0f) * scale - origin_x) / bin_size - window_cells_x / 2.0f + 0.5f));
+      int cell_y = int(floor(((ymins[i] + heights[i] / 2.0f) * scale - origin_y) / bin_size - window_cells_y / 2.0f + 0.5f));
+      cell_x = std::max(0, std::min(cells_x - window_cells_x, cell_x));
+      cell_y = std::max(0, std::min(cells_y - window_cells_y, cell_y));
+
+      // Rows are contiguous, so they are accumulated separately (vectorized) and summed at the end:
+      std::fill(partial.begin(), partial.end(), 0.0f);
+      const float* weights = &SVM_weights_[0];
+      for (int l = 0; l < n_orients * 4; l++)
+      {
+        for (int j = 1; j < window_cells_x - 1; j++)
+        {
+          const float* column = &cells[(cell_y + 1) + (cell_x + j) * cells_y + l * channel_size];
+          for (int r = 0; r < descriptor_rows; r++)
+            partial[r] += weights[r] * column[r];
+          weights += descriptor_rows;
+        }
+      }
+
+      double confidence = 0.0;
+      for (int r = 0; r < descriptor_rows; r++)
+        confidence += partial[r];
+      // Confidence correction:
+      confidences[i] = confidence - SVM_offset_;
+    }
+
+    begin = end;
   }
 }
 #endif /* OPEN_PTRACK_DETECTION_PERSON_CLASSIFIER_HPP_ */
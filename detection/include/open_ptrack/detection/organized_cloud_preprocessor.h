@@ -0,0 +1,239 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * organized_cloud_preprocessor.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_ORGANIZED_CLOUD_PREPROCESSOR_H_
+#define OPEN_PTRACK_DETECTION_ORGANIZED_CLOUD_PREPROCESSOR_H_
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+
+#include <open_ptrack/detection/rgbd_image.h>
+#include <open_ptrack/detection/exclusion_mask.h>
+#include <open_ptrack/detection/voxel_hash.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief OrganizedCloudPreprocessor downsamples an organized RGB-D point cloud in a single pass.
+     *
+     * The cloud is read once, row by row: sampling, the limit on z and the voxel grid averaging are applied while
+     * the RGB image of the cloud is extracted. Voxels are accumulated through a VoxelHash which is reused between frames.
+     * The output is the one of sampling the cloud and then applying a pcl::VoxelGrid with z limits [0, max_distance]
+     * (same voxels, same order).
+     *
+     * The same can be done on an RGBDImage: only the sampled pixels are back-projected, and straight into the voxels,
+     * so the organized cloud is never built.
+     *
+     * Points excluded by the exclusion mask (if it has the size of the input) are dropped in the same pass.
+     */
+    template <typename PointT>
+    class OrganizedCloudPreprocessor
+    {
+      public:
+
+        typedef pcl::PointCloud<PointT> PointCloud;
+
+        /** \brief Constructor. */
+        OrganizedCloudPreprocessor ();
+
+        /**
+         * \brief Set sampling factor.
+         *
+         * \param[in] sampling_factor Downsampling factor applied to rows and columns before the voxel grid (default = 1).
+         */
+        void
+        setSamplingFactor (int sampling_factor);
+
+        /**
+         * \brief Set voxel size.
+         *
+         * \param[in] voxel_size Voxel dimension (default = 0.06m).
+         */
+        void
+        setVoxelSize (float voxel_size);
+
+        /**
+         * \brief Set the maximum distance of the points kept.
+         *
+         * \param[in] max_distance Maximum value of the z coordinate (default = 50m).
+         */
+        void
+        setMaxDistance (float max_distance);
+
+        /**
+         * \brief Set the zones of the image where points are dropped.
+         *
+         * \param[in] exclusion_mask Exclusion mask, with the size of the input (it is ignored with a different size).
+         */
+        void
+        setExclusionMask (const ExclusionMask& exclusion_mask);
+
+        /**
+         * \brief Get the zones of the image where points are dropped.
+         */
+        const ExclusionMask&
+        getExclusionMask () const;
+
+        /**
+         * \brief Downsample the input cloud and, if rgb_image is not NULL, extract its RGB image.
+         *
+         * \param[in] input_cloud Organized input cloud.
+         * \param[out] output_cloud Unorganized cloud with the centroid of every occupied voxel.
+         * \param[out] rgb_image RGB cloud with the size of input_cloud (optional).
+         */
+        void
+        compute (const PointCloud& input_cloud, PointCloud& output_cloud, pcl::PointCloud<pcl::RGB>* rgb_image = NULL);
+
+        /**
+         * \brief Downsample the cloud of an RGB-D image and, if rgb_image is not NULL, extract its RGB image.
+         *
+         * The output is the one of compute on the organized cloud of the image (see backProject).
+         *
+         * \param[in] image Depth and RGB images (of the same size) with the camera intrinsics.
+         * \param[out] output_cloud Unorganized cloud with the centroid of every occupied voxel.
+         * \param[out] rgb_image RGB cloud with the size of the image (optional).
+         */
+        void
+        compute (const RGBDImage& image, PointCloud& output_cloud, pcl::PointCloud<pcl::RGB>* rgb_image = NULL);
+
+        /**
+         * \brief Back-project every pixel of an RGB-D image (as the point clouds of the camera drivers).
+         *
+         * \param[in] image Depth and RGB images (of the same size) with the camera intrinsics.
+         * \param[out] cloud Organized cloud, with NaN coordinates where there is no depth.
+         */
+        static void
+        backProject (const RGBDImage& image, PointCloud& cloud);
+
+      protected:
+
+        /** \brief Sums of the coordinates and of the colors of the points in a voxel */
+        struct VoxelAccumulator
+        {
+          float x, y, z;
+          float r, g, b;
+          unsigned int count;
+        };
+
+        /** \brief Consecutive points of a voxel, summed before being added to its accumulator */
+        struct VoxelRun
+        {
+          uint64_t key;
+          int voxel;
+          VoxelAccumulator sums;
+        };
+
+        /**
+         * \brief Return the index in voxels_ of a voxel, adding it if the voxel is new.
+         *
+         * \param[in] key Voxel key.
+         *
+         * \return The index of the voxel accumulator.
+         */
+        int
+        findVoxel (uint64_t key);
+
+        /**
+         * \brief Add sums of points to the accumulator of a voxel.
+         *
+         * \param[in] index Index of the voxel in voxels_.
+         * \param[in] sums Sums of the points to add.
+         */
+        void
+        addToVoxel (int index, const VoxelAccumulator& sums);
+
+        /** \brief Start the voxels of a new frame, with an empty run. */
+        void
+        startVoxels (VoxelRun& run);
+
+        /**
+         * \brief Add a point to the current run, or to a new run if it is in a different voxel.
+         *
+         * \param[in,out] run Current run.
+         * \param[in] key Key of the voxel of the point.
+         * \param[in] x, y, z Coordinates of the point.
+         * \param[in] r, g, b Color of the point.
+         */
+        void
+        addPoint (VoxelRun& run, uint64_t key, float x, float y, float z, float r, float g, float b);
+
+        /**
+         * \brief Add the sums of a run to its voxel and empty it.
+         *
+         * \param[in,out] run Run to add.
+         */
+        void
+        flushRun (VoxelRun& run);
+
+        /**
+         * \brief Write the centroids of the voxels to the output cloud, in the order of pcl::VoxelGrid.
+         *
+         * \param[out] output_cloud Output cloud (its header is not modified).
+         */
+        void
+        writeVoxels (PointCloud& output_cloud);
+
+        /** \brief sampling factor used to downsample the point cloud */
+        int sampling_factor_;
+
+        /** \brief voxel size */
+        float voxel_size_;
+
+        /** \brief max distance from the sensor */
+        float max_distance_;
+
+        /** \brief zones of the image where points are dropped */
+        ExclusionMask exclusion_mask_;
+
+        /** \brief indices of the voxels of the current frame in voxels_ */
+        VoxelHash voxel_hash_;
+
+        /** \brief accumulators of the voxels of the current frame, in insertion order */
+        std::vector<VoxelAccumulator> voxels_;
+
+        /** \brief voxels sorted by key (output order) */
+        std::vector<std::pair<uint64_t, int> > order_;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+#include <open_ptrack/detection/impl/organized_cloud_preprocessor.hpp>
+#endif /* OPEN_PTRACK_DETECTION_ORGANIZED_CLOUD_PREPROCESSOR_H_ */
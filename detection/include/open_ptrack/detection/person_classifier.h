@@ -42,6 +42,11 @@
 
 #include <pcl/people/person_cluster.h>
 #include <pcl/people/hog.h>
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include <algorithm>
+#include <limits>
 
 namespace open_ptrack
 {
@@ -66,11 +71,39 @@ namespace open_ptrack
       /** \brief SVM weights vector. */
       std::vector<float> SVM_weights_;  
 
+      /** \brief Number of scales per octave of the image pyramid used by evaluateBatch. */
+      int scales_per_octave_;
+
+      /**
+       * \brief Compute the box of the image patch to classify (as in the training stage).
+       *
+       * \param[in] height_person The height of the image patch to classify, in pixels.
+       * \param[in] xc The x-coordinate of the center of the image patch to classify, in pixels.
+       * \param[in] yc The y-coordinate of the center of the image patch to classify, in pixels.
+       * \param[out] xmin x coordinate of the top-left point of the box.
+       * \param[out] ymin y coordinate of the top-left point of the box.
+       * \param[out] width Box width.
+       * \param[out] height Box height.
+       */
+      void
+      getBox (float height_person, float xc, float yc, int& xmin, int& ymin, int& width, int& height);
+
     public:
 
       typedef pcl::PointCloud<PointT> PointCloud;
       typedef boost::shared_ptr<PointCloud> PointCloudPtr;
 
+      /** \brief Image patch to classify (see evaluate). */
+      struct Window
+      {
+        /** \brief height of the patch, in pixels */
+        float height;
+
+        /** \brief center of the patch, in pixels */
+        float xc;
+        float yc;
+      };
+
       /** \brief Constructor. */
       PersonClassifier ();
 
@@ -141,7 +174,7 @@ namespace open_ptrack
        * \param[in] xc The x-coordinate of the center of the image patch to classify, in pixels.
        * \param[in] yc The y-coordinate of the center of the image patch to classify, in pixels.
        * \param[in] image The whole image (pointer to a point cloud containing RGB information) containing the object to classify.
-       * \return The classification score given by the SVM.
+       * \return The classification score given by the SVM (NaN if the patch is out of the image).
        */
       double
       evaluate (float height, float xc, float yc, PointCloudPtr& image);
@@ -158,6 +191,43 @@ namespace open_ptrack
       double
       evaluate (PointCloudPtr& image, Eigen::Vector3f& bottom, Eigen::Vector3f& top, Eigen::Vector3f& centroid,
          bool vertical);
+
+      /**
+       * \brief Compute the image patch to classify for a given PersonCluster.
+       * \param[in] image The input image (pointer to a point cloud containing RGB information).
+       * \param[in] bottom Theoretical bottom point of the cluster projected to the image.
+       * \param[in] top Theoretical top point of the cluster projected to the image.
+       * \param[in] centroid Theoretical centroid point of the cluster projected to the image.
+       * \param[in] vertical If true, the sensor is considered to be vertically placed (portrait mode).
+       * \return The image patch (as used by evaluate).
+       */
+      Window
+      getWindow (PointCloudPtr& image, Eigen::Vector3f& bottom, Eigen::Vector3f& top, Eigen::Vector3f& centroid,
+         bool vertical);
+
+      /**
+       * \brief Set the number of scales per octave of the image pyramid used by evaluateBatch.
+       *
+       * \param[in] scales_per_octave Number of scales per octave (default = 8).
+       */
+      void
+      setScalesPerOctave (int scales_per_octave);
+
+      /**
+       * \brief Classify all the patches of an image at once.
+       *
+       * Patches are grouped by scale (image pyramid with scales_per_octave scales per octave). For every scale, the
+       * part of the image covering its patches is resized once, its HOG cells are computed once, and every patch is
+       * scored by the SVM on the cells of its window. Patches are thus rounded to the nearest scale and HOG cell, so
+       * scores are close to the ones of evaluate, but not identical. Images which are not 4-byte RGB points (as
+       * pcl::RGB) are classified with evaluate.
+       *
+       * \param[in] image The whole image (pointer to a point cloud containing RGB information).
+       * \param[in] windows The image patches to classify.
+       * \param[out] confidences The classification scores given by the SVM (NaN for patches out of the image).
+       */
+      void
+      evaluateBatch (PointCloudPtr& image, const std::vector<Window>& windows, std::vector<double>& confidences);
     };
   } /* namespace open_ptrack */
 } /* namespace detection */
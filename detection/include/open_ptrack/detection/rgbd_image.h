@@ -0,0 +1,104 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * rgbd_image.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_RGBD_IMAGE_H_
+#define OPEN_PTRACK_DETECTION_RGBD_IMAGE_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+#include <boost/shared_ptr.hpp>
+#include <pcl/point_cloud.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief RGBDImage describes a depth image registered to an RGB image, without owning their pixels.
+     *
+     * It is the input of the detector when it does not receive point clouds: only the pixels which are needed are
+     * back-projected with the pinhole model of the camera. The buffers must be kept alive as long as the RGBDImage is used
+     * (e.g. by a derived class holding the ROS messages).
+     */
+    struct RGBDImage
+    {
+      typedef boost::shared_ptr<RGBDImage> Ptr;
+      typedef boost::shared_ptr<const RGBDImage> ConstPtr;
+
+      /** \brief Constructor (empty image). */
+      RGBDImage () :
+        width(0), height(0),
+        depth(NULL), depth_step(0), depth_scale(0.001f),
+        color(NULL), color_step(0), color_channels(3), bgr(false),
+        fx(0.0f), fy(0.0f), cx(0.0f), cy(0.0f)
+      {
+
+      }
+
+      /** \brief Destructor. */
+      virtual ~RGBDImage ()
+      {
+
+      }
+
+      /** \brief header of the clouds obtained from the images (time and frame of the depth image) */
+      pcl::PCLHeader header;
+
+      /** \brief size of both images */
+      int width;
+      int height;
+
+      /** \brief depth image (0 = no measurement), its row size in bytes and the meters of a depth unit */
+      const uint16_t* depth;
+      size_t depth_step;
+      float depth_scale;
+
+      /** \brief RGB image, its row size in bytes, its channels (3 or 4, the fourth is ignored) and if they are in BGR order */
+      const uint8_t* color;
+      size_t color_step;
+      int color_channels;
+      bool bgr;
+
+      /** \brief intrinsic parameters of the (registered) depth camera */
+      float fx;
+      float fy;
+      float cx;
+      float cy;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_DETECTION_RGBD_IMAGE_H_ */
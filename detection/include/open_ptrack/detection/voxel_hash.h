@@ -0,0 +1,167 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * voxel_hash.h
+ */
+
+#ifndef OPEN_PTRACK_DETECTION_VOXEL_HASH_H_
+#define OPEN_PTRACK_DETECTION_VOXEL_HASH_H_
+
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+    /** \brief VoxelHash maps the keys of the voxels (or grid cells) of a frame to consecutive indices.
+     *
+     * Indices are assigned in insertion order. The open addressing table is emptied in a time proportional to the
+     * number of keys inserted, so that it can be reused for every frame.
+     */
+    class VoxelHash
+    {
+      public:
+
+        /** \brief Key which is not used by any voxel (keys use 63 bits). */
+        static const uint64_t EMPTY_KEY = 0xFFFFFFFFFFFFFFFFULL;
+
+        /** \brief Constructor. */
+        VoxelHash ();
+
+        /**
+         * \brief Return the key of the voxel containing a point.
+         *
+         * Voxel coordinates are the floor of the point coordinates divided by the voxel size, as in pcl::VoxelGrid
+         * (|coordinate| < 2^20 voxels). Keys are sorted by (z, y, x), like the voxel indices of pcl::VoxelGrid.
+         *
+         * \param[in] x x coordinate divided by the voxel size.
+         * \param[in] y y coordinate divided by the voxel size.
+         * \param[in] z z coordinate divided by the voxel size.
+         *
+         * \return The voxel key.
+         */
+        static inline uint64_t
+        key (float x, float y, float z)
+        {
+          // Coordinates are offset by 2^20 to be positive: truncating them in double precision is an exact floor,
+          // without the library call.
+          const uint64_t i = static_cast<uint32_t>(static_cast<double>(x) + 1048576.0);
+          const uint64_t j = static_cast<uint32_t>(static_cast<double>(y) + 1048576.0);
+          const uint64_t k = static_cast<uint32_t>(static_cast<double>(z) + 1048576.0);
+          return ((k & 0x1FFFFF) << 42) | ((j & 0x1FFFFF) << 21) | (i & 0x1FFFFF);
+        }
+
+        /**
+         * \brief Return the key of a neighboring voxel.
+         *
+         * \param[in] key Voxel key.
+         * \param[in] dx Offset along x (voxels).
+         * \param[in] dy Offset along y (voxels).
+         * \param[in] dz Offset along z (voxels).
+         *
+         * \return The key of the voxel at (dx, dy, dz) from the voxel of key.
+         */
+        static inline uint64_t
+        neighborKey (uint64_t key, int dx, int dy, int dz)
+        {
+          return key + (static_cast<uint64_t>(static_cast<int64_t>(dz)) << 42) +
+              (static_cast<uint64_t>(static_cast<int64_t>(dy)) << 21) + static_cast<uint64_t>(static_cast<int64_t>(dx));
+        }
+
+        /**
+         * \brief Return the index of a key, adding the key if it is new.
+         *
+         * \param[in] key Voxel key.
+         *
+         * \return The index of the key.
+         */
+        int
+        insert (uint64_t key);
+
+        /**
+         * \brief Return the index of a key.
+         *
+         * \param[in] key Voxel key.
+         *
+         * \return The index of the key, -1 if it has not been inserted.
+         */
+        int
+        find (uint64_t key) const;
+
+        /**
+         * \brief Remove all keys.
+         */
+        void
+        clear ();
+
+        /**
+         * \brief Return the number of keys.
+         */
+        size_t
+        size () const;
+
+        /**
+         * \brief Return the keys, by index.
+         */
+        const std::vector<uint64_t>&
+        keys () const;
+
+      protected:
+
+        /**
+         * \brief Return the first slot of a key in the table.
+         *
+         * \param[in] key Voxel key.
+         */
+        size_t
+        firstSlot (uint64_t key) const;
+
+        /**
+         * \brief Double the size of the table.
+         */
+        void
+        grow ();
+
+        /** \brief open addressing table of key indices (-1 if the slot is empty) */
+        std::vector<int> table_;
+
+        /** \brief keys, by index */
+        std::vector<uint64_t> keys_;
+    };
+  } /* namespace detection */
+} /* namespace open_ptrack */
+
+#endif /* OPEN_PTRACK_DETECTION_VOXEL_HASH_H_ */
@@ -0,0 +1,269 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * background_model.cpp
+ */
+
+#include <open_ptrack/detection/background_model.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+
+    namespace
+    {
+      /** \brief First bytes of a background file (the last one is the format version). */
+      const char BACKGROUND_FILE_MAGIC[8] = {'O', 'P', 'T', 'B', 'G', 'M', 0, 1};
+    }
+
+    BackgroundModel::BackgroundModel () :
+      resolution_(0.0f),
+      inverse_resolution_(0.0f),
+      min_x_(0.0f), min_y_(0.0f), min_z_(0.0f),
+      dim_x_(0), dim_y_(0), dim_z_(0),
+      absorb_frames_(0),
+      release_frames_(0),
+      full_evidence_(0),
+      absorb_step_(0),
+      release_step_(0)
+    {
+      // Empty grid, until init is called:
+      allocate();
+    }
+
+    const size_t BackgroundModel::MAX_VOXELS;
+
+    void
+    BackgroundModel::init (float resolution, float min_x, float min_y, float min_z, float max_x, float max_y, float max_z)
+    {
+      const double size_x = std::max(double(max_x) - min_x, 0.0);
+      const double size_y = std::max(double(max_y) - min_y, 0.0);
+      const double size_z = std::max(double(max_z) - min_z, 0.0);
+
+      // Voxels of the requested size, or as small as the voxel count allows (the count is computed in double, since
+      // fine resolutions over large boxes overflow the integer types):
+      double voxel_size = std::max(double(resolution), std::cbrt(size_x * size_y * size_z / MAX_VOXELS));
+      double dims[3];
+      while (true)
+      {
+        dims[0] = std::max(1.0, std::ceil(size_x / voxel_size));
+        dims[1] = std::max(1.0, std::ceil(size_y / voxel_size));
+        dims[2] = std::max(1.0, std::ceil(size_z / voxel_size));
+        if (dims[0] * dims[1] * dims[2] <= MAX_VOXELS)
+          break;
+        voxel_size *= 1.01;
+      }
+
+      resolution_ = float(voxel_size);
+      inverse_resolution_ = 1.0f / resolution_;
+      min_x_ = min_x;
+      min_y_ = min_y;
+      min_z_ = min_z;
+      dim_x_ = size_t(dims[0]);
+      dim_y_ = size_t(dims[1]);
+      dim_z_ = size_t(dims[2]);
+      allocate();
+    }
+
+    void
+    BackgroundModel::allocate ()
+    {
+      size_x_ = dim_x_;
+      size_y_ = dim_y_;
+      size_z_ = dim_z_;
+      outside_voxel_ = dim_x_ * dim_y_ * dim_z_;
+      bits_.assign(outside_voxel_ / 64 + 1, 0);
+      frame_bits_.assign(bits_.size(), 0);
+      evidence_bits_.assign(bits_.size(), 0);
+      frame_voxels_.clear();
+      evidence_.assign(absorb_frames_ > 0 ? outside_voxel_ : 0, 0);
+    }
+
+    void
+    BackgroundModel::setAdaptation (unsigned int absorb_frames, unsigned int release_frames)
+    {
+      absorb_frames_ = std::min(absorb_frames, 65535u);
+      release_frames_ = std::max(1u, std::min(release_frames, 65535u));
+
+      // Both counts divide the full evidence, which fits 32 bits:
+      full_evidence_ = absorb_frames_ * release_frames_;
+      absorb_step_ = release_frames_;
+      release_step_ = absorb_frames_;
+
+      evidence_.resize(absorb_frames_ > 0 ? outside_voxel_ : 0);
+      resetEvidence();
+    }
+
+    void
+    BackgroundModel::clear ()
+    {
+      std::fill(bits_.begin(), bits_.end(), 0);
+      std::fill(evidence_.begin(), evidence_.end(), 0);
+      std::fill(evidence_bits_.begin(), evidence_bits_.end(), 0);
+    }
+
+    void
+    BackgroundModel::addEvidence (size_t voxel)
+    {
+      evidence_[voxel] = std::min(full_evidence_, evidence_[voxel] + evidenceStep(voxel));
+      evidence_bits_[voxel >> 6] |= uint64_t(1) << (voxel & 63);
+      if (evidence_[voxel] == full_evidence_)
+        setBackground(voxel);
+    }
+
+    void
+    BackgroundModel::resetEvidence ()
+    {
+      // Background voxels have full evidence:
+      for (size_t i = 0; i < evidence_.size(); i++)
+        evidence_[i] = isBackground(i) ? full_evidence_ : 0;
+      if (absorb_frames_ > 0)
+        evidence_bits_ = bits_;
+      else
+        std::fill(evidence_bits_.begin(), evidence_bits_.end(), 0);
+    }
+
+    void
+    BackgroundModel::decay ()
+    {
+      for (size_t w = 0; w < bits_.size(); w++)
+      {
+        // Only the words with voxels with evidence which are empty in this frame are visited:
+        const uint64_t empty = evidence_bits_[w] & ~frame_bits_[w];
+        if (empty == 0)
+          continue;
+        for (size_t b = 0; b < 64; b++)
+        {
+          if (not ((empty >> b) & 1))
+            continue;
+          const size_t i = w * 64 + b;
+          const uint32_t step = evidenceStep(i);
+          evidence_[i] = evidence_[i] > step ? evidence_[i] - step : 0;
+          if (evidence_[i] == 0)
+          {
+            evidence_bits_[w] &= ~(uint64_t(1) << b);
+            bits_[w] &= ~(uint64_t(1) << b);
+          }
+        }
+      }
+    }
+
+    float
+    BackgroundModel::getResolution () const
+    {
+      return resolution_;
+    }
+
+    bool
+    BackgroundModel::hasSameGrid (const BackgroundModel& other) const
+    {
+      return (resolution_ == other.resolution_) and (min_x_ == other.min_x_) and (min_y_ == other.min_y_) and
+          (min_z_ == other.min_z_) and (dim_x_ == other.dim_x_) and (dim_y_ == other.dim_y_) and (dim_z_ == other.dim_z_);
+    }
+
+    size_t
+    BackgroundModel::size () const
+    {
+      size_t count = 0;
+      for (size_t w = 0; w < bits_.size(); w++)
+      {
+        for (uint64_t word = bits_[w]; word != 0; word &= word - 1)
+          count++;
+      }
+      return count;
+    }
+
+    bool
+    BackgroundModel::save (const std::string& filename) const
+    {
+      std::ofstream file(filename.c_str(), std::ios::binary);
+      if (not file)
+        return false;
+
+      const float grid[4] = {resolution_, min_x_, min_y_, min_z_};
+      const uint32_t dims[3] = {uint32_t(dim_x_), uint32_t(dim_y_), uint32_t(dim_z_)};
+      file.write(BACKGROUND_FILE_MAGIC, sizeof(BACKGROUND_FILE_MAGIC));
+      file.write(reinterpret_cast<const char*>(grid), sizeof(grid));
+      file.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+      file.write(reinterpret_cast<const char*>(&bits_[0]), bits_.size() * sizeof(uint64_t));
+      return bool(file);
+    }
+
+    bool
+    BackgroundModel::load (const std::string& filename)
+    {
+      std::ifstream file(filename.c_str(), std::ios::binary);
+      if (not file)
+        return false;
+
+      char magic[sizeof(BACKGROUND_FILE_MAGIC)];
+      float grid[4];
+      uint32_t dims[3];
+      file.read(magic, sizeof(magic));
+      file.read(reinterpret_cast<char*>(grid), sizeof(grid));
+      file.read(reinterpret_cast<char*>(dims), sizeof(dims));
+      if (not file or std::memcmp(magic, BACKGROUND_FILE_MAGIC, sizeof(magic)) != 0 or not (grid[0] > 0.0f))
+        return false;
+      if (double(dims[0]) * dims[1] * dims[2] > MAX_VOXELS)
+        return false;
+
+      const size_t voxels = size_t(dims[0]) * dims[1] * dims[2];
+      std::vector<uint64_t> bits(voxels / 64 + 1);
+      file.read(reinterpret_cast<char*>(&bits[0]), bits.size() * sizeof(uint64_t));
+      if (not file)
+        return false;
+
+      resolution_ = grid[0];
+      inverse_resolution_ = 1.0f / grid[0];
+      min_x_ = grid[1];
+      min_y_ = grid[2];
+      min_z_ = grid[3];
+      dim_x_ = dims[0];
+      dim_y_ = dims[1];
+      dim_z_ = dims[2];
+      allocate();
+      bits_.swap(bits);
+      bits_[outside_voxel_ >> 6] &= ~(uint64_t(1) << (outside_voxel_ & 63));
+      resetEvidence();
+      return true;
+    }
+
+  } /* namespace detection */
+} /* namespace open_ptrack */
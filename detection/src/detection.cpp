@@ -71,7 +71,7 @@ namespace open_ptrack
     }
 
     open_ptrack::detection::DetectionSource*
-    Detection::getSource()
+    Detection::getSource() const
     {
       return source_;
     }
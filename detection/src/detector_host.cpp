@@ -0,0 +1,91 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * detector_host.cpp
+ */
+
+#include <open_ptrack/detection/detector_host.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+
+    DetectorHost::DetectorHost () :
+      cameras_(0)
+    {
+
+    }
+
+    DetectorHost&
+    DetectorHost::instance ()
+    {
+      static DetectorHost host;
+      return host;
+    }
+
+    opt_utils::WorkStealingPool&
+    DetectorHost::getPool (unsigned int threads)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (not pool_)
+        pool_.reset(new opt_utils::WorkStealingPool(threads));
+      return *pool_;
+    }
+
+    unsigned int
+    DetectorHost::addCamera ()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      return cameras_++;
+    }
+
+    bool
+    DetectorHost::getClassifier (const std::string& svm_filename, PersonClassifier<pcl::RGB>& person_classifier)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      std::map<std::string, PersonClassifier<pcl::RGB> >::iterator it = classifiers_.find(svm_filename);
+      if (it == classifiers_.end())
+      {
+        PersonClassifier<pcl::RGB> loaded;
+        if (not loaded.loadSVMFromFile(svm_filename))
+          return false;
+        it = classifiers_.insert(std::make_pair(svm_filename, loaded)).first;
+      }
+      person_classifier = it->second;
+      return true;
+    }
+
+  } /* namespace detection */
+} /* namespace open_ptrack */
@@ -0,0 +1,187 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * exclusion_mask.cpp
+ */
+
+#include <open_ptrack/detection/exclusion_mask.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+
+    namespace
+    {
+      /** \brief Range which is not used. */
+      const ExclusionMask::DepthRange NOT_EXCLUDED = {std::numeric_limits<float>::infinity(), -std::numeric_limits<float>::infinity()};
+
+      bool
+      nearer (const ExclusionMask::DepthRange& a, const ExclusionMask::DepthRange& b)
+      {
+        return a.near < b.near;
+      }
+    }
+
+    ExclusionMask::ExclusionMask () :
+      width_(0),
+      height_(0),
+      excluded_pixels_(0)
+    {
+
+    }
+
+    void
+    ExclusionMask::init (int width, int height)
+    {
+      width_ = width;
+      height_ = height;
+      PixelRanges not_excluded;
+      std::fill(not_excluded.ranges, not_excluded.ranges + MAX_RANGES, NOT_EXCLUDED);
+      ranges_.assign(width * height, not_excluded);
+      excluded_pixels_ = 0;
+    }
+
+    void
+    ExclusionMask::addImageMask (const uint8_t* mask, int step)
+    {
+      for (int row = 0; row < height_; row++)
+      {
+        const uint8_t* mask_row = mask + row * step;
+        PixelRanges* pixel_row = &ranges_[row * width_];
+        for (int col = 0; col < width_; col++)
+        {
+          if (mask_row[col] != 0)
+            addRange(pixel_row[col], -std::numeric_limits<float>::infinity(), std::numeric_limits<float>::infinity());
+        }
+      }
+    }
+
+    void
+    ExclusionMask::addBox (const Eigen::Affine3f& camera_to_box, const Eigen::Vector3f& min_corner,
+        const Eigen::Vector3f& max_corner, float fx, float fy, float cx, float cy)
+    {
+      // The ray of a pixel is origin + z * direction, with z the depth of its points:
+      const Eigen::Vector3f origin = camera_to_box.translation();
+      for (int row = 0; row < height_; row++)
+      {
+        PixelRanges* pixel_row = &ranges_[row * width_];
+        for (int col = 0; col < width_; col++)
+        {
+          const Eigen::Vector3f direction = camera_to_box.linear() * Eigen::Vector3f((col - cx) / fx, (row - cy) / fy, 1.0f);
+
+          // Intersection of the ray with the slabs of the box:
+          float near = 0.0f;
+          float far = std::numeric_limits<float>::infinity();
+          for (int axis = 0; axis < 3; axis++)
+          {
+            if (direction(axis) == 0.0f)
+            {
+              if ((origin(axis) < min_corner(axis)) or (origin(axis) > max_corner(axis)))
+                far = -1.0f;
+              continue;
+            }
+            const float t1 = (min_corner(axis) - origin(axis)) / direction(axis);
+            const float t2 = (max_corner(axis) - origin(axis)) / direction(axis);
+            near = std::max(near, std::min(t1, t2));
+            far = std::min(far, std::max(t1, t2));
+          }
+          if (near <= far)
+            addRange(pixel_row[col], near, far);
+        }
+      }
+    }
+
+    void
+    ExclusionMask::addRange (PixelRanges& pixel, float near, float far)
+    {
+      // The ranges of the pixel and the new one, sorted by depth:
+      DepthRange ranges[MAX_RANGES + 1];
+      int count = 0;
+      for (int i = 0; i < MAX_RANGES; i++)
+      {
+        if (pixel.ranges[i].near <= pixel.ranges[i].far)
+          ranges[count++] = pixel.ranges[i];
+      }
+      if (count == 0)
+        excluded_pixels_++;
+      ranges[count].near = near;
+      ranges[count].far = far;
+      count++;
+      std::sort(ranges, ranges + count, nearer);
+
+      // Overlapping ranges are merged, then the closest ones while they do not fit:
+      int merged = 0;
+      for (int i = 1; i < count; i++)
+      {
+        if (ranges[i].near <= ranges[merged].far)
+          ranges[merged].far = std::max(ranges[merged].far, ranges[i].far);
+        else
+          ranges[++merged] = ranges[i];
+      }
+      count = merged + 1;
+      while (count > MAX_RANGES)
+      {
+        int closest = 0;
+        for (int i = 1; i < count - 1; i++)
+        {
+          if (ranges[i + 1].near - ranges[i].far < ranges[closest + 1].near - ranges[closest].far)
+            closest = i;
+        }
+        ranges[closest].far = ranges[closest + 1].far;
+        std::copy(ranges + closest + 2, ranges + count, ranges + closest + 1);
+        count--;
+      }
+
+      std::copy(ranges, ranges + count, pixel.ranges);
+      std::fill(pixel.ranges + count, pixel.ranges + MAX_RANGES, NOT_EXCLUDED);
+    }
+
+    bool
+    ExclusionMask::empty () const
+    {
+      return excluded_pixels_ == 0;
+    }
+
+    bool
+    ExclusionMask::appliesTo (int width, int height) const
+    {
+      return (excluded_pixels_ > 0) and (width == width_) and (height == height_);
+    }
+
+  } /* namespace detection */
+} /* namespace open_ptrack */
@@ -0,0 +1,139 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * voxel_hash.cpp
+ */
+
+#include <open_ptrack/detection/voxel_hash.h>
+
+namespace open_ptrack
+{
+  namespace detection
+  {
+
+    const uint64_t VoxelHash::EMPTY_KEY;
+
+    VoxelHash::VoxelHash () :
+      table_(1 << 16, -1)
+    {
+
+    }
+
+    size_t
+    VoxelHash::firstSlot (uint64_t key) const
+    {
+      return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) & (table_.size() - 1);
+    }
+
+    int
+    VoxelHash::insert (uint64_t key)
+    {
+      const size_t mask = table_.size() - 1;
+      size_t slot = firstSlot(key);
+      while (table_[slot] >= 0)
+      {
+        if (keys_[table_[slot]] == key)
+          return table_[slot];
+        slot = (slot + 1) & mask;
+      }
+
+      // New key:
+      const int index = keys_.size();
+      table_[slot] = index;
+      keys_.push_back(key);
+
+      // Keep the load factor under 1/2:
+      if (2 * keys_.size() > table_.size())
+        grow();
+
+      return index;
+    }
+
+    int
+    VoxelHash::find (uint64_t key) const
+    {
+      const size_t mask = table_.size() - 1;
+      size_t slot = firstSlot(key);
+      while (table_[slot] >= 0)
+      {
+        if (keys_[table_[slot]] == key)
+          return table_[slot];
+        slot = (slot + 1) & mask;
+      }
+      return -1;
+    }
+
+    void
+    VoxelHash::clear ()
+    {
+      // Empty only the slots used (cheaper than clearing the whole table):
+      const size_t mask = table_.size() - 1;
+      for (unsigned int i = 0; i < keys_.size(); i++)
+      {
+        size_t slot = firstSlot(keys_[i]);
+        while (table_[slot] != static_cast<int>(i))
+          slot = (slot + 1) & mask;
+        table_[slot] = -1;
+      }
+      keys_.clear();
+    }
+
+    size_t
+    VoxelHash::size () const
+    {
+      return keys_.size();
+    }
+
+    const std::vector<uint64_t>&
+    VoxelHash::keys () const
+    {
+      return keys_;
+    }
+
+    void
+    VoxelHash::grow ()
+    {
+      table_.assign(2 * table_.size(), -1);
+      const size_t mask = table_.size() - 1;
+      for (unsigned int i = 0; i < keys_.size(); i++)
+      {
+        size_t slot = firstSlot(keys_[i]);
+        while (table_[slot] >= 0)
+          slot = (slot + 1) & mask;
+        table_[slot] = i;
+      }
+    }
+
+  } /* namespace detection */
+} /* namespace open_ptrack */
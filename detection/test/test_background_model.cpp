@@ -0,0 +1,205 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * test_background_model.cpp
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <gtest/gtest.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <open_ptrack/detection/background_model.h>
+
+typedef pcl::PointCloud<pcl::PointXYZ> PointCloud;
+
+namespace
+{
+  /** \brief A frame with a point in the voxel of (x, y, z), or no points. */
+  PointCloud
+  frame (bool occupied, float x = 0.55f, float y = 0.55f, float z = 0.55f)
+  {
+    PointCloud cloud;
+    if (occupied)
+      cloud.points.push_back(pcl::PointXYZ(x, y, z));
+    cloud.width = cloud.points.size();
+    cloud.height = 1;
+    return cloud;
+  }
+
+  /** \brief A model of a 1 m cube, with 0.1 m voxels. */
+  void
+  initModel (open_ptrack::detection::BackgroundModel& model, unsigned int absorb_frames, unsigned int release_frames)
+  {
+    model.init(0.1f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+    model.setAdaptation(absorb_frames, release_frames);
+  }
+} /* namespace */
+
+TEST(BackgroundModelTest, StaticObjectIsAbsorbed)
+{
+  open_ptrack::detection::BackgroundModel model;
+  initModel(model, 30, 90);
+  for (int i = 1; i < 30; i++)
+  {
+    model.update(frame(true));
+    ASSERT_FALSE(model.isBackground(0.55f, 0.55f, 0.55f)) << "frame " << i;
+  }
+  model.update(frame(true));
+  EXPECT_TRUE(model.isBackground(0.55f, 0.55f, 0.55f));
+  EXPECT_EQ(1u, model.size());
+}
+
+TEST(BackgroundModelTest, RemovedObjectIsReleased)
+{
+  // Release is honoured whether it is longer or shorter than absorb:
+  const unsigned int release_frames[] = {90, 10, 1};
+  for (int r = 0; r < 3; r++)
+  {
+    open_ptrack::detection::BackgroundModel model;
+    initModel(model, 30, release_frames[r]);
+    model.learn(frame(true));
+    ASSERT_TRUE(model.isBackground(0.55f, 0.55f, 0.55f));
+
+    for (unsigned int i = 1; i < release_frames[r]; i++)
+    {
+      model.update(frame(false));
+      ASSERT_TRUE(model.isBackground(0.55f, 0.55f, 0.55f)) << "release " << release_frames[r] << ", frame " << i;
+    }
+    model.update(frame(false));
+    EXPECT_FALSE(model.isBackground(0.55f, 0.55f, 0.55f)) << "release " << release_frames[r];
+    EXPECT_EQ(0u, model.size());
+  }
+}
+
+TEST(BackgroundModelTest, IntermittentTrafficIsNotAbsorbed)
+{
+  // People walking by occupy a voxel in a third of the frames, for many times the absorb frames:
+  const unsigned int release_frames[] = {90, 10};
+  for (int r = 0; r < 2; r++)
+  {
+    open_ptrack::detection::BackgroundModel model;
+    initModel(model, 30, release_frames[r]);
+    for (int i = 0; i < 3000; i++)
+    {
+      model.update(frame(i % 3 == 0));
+      ASSERT_FALSE(model.isBackground(0.55f, 0.55f, 0.55f)) << "release " << release_frames[r] << ", frame " << i;
+    }
+  }
+
+  // Occupied in most of the frames, the voxel is absorbed anyway:
+  open_ptrack::detection::BackgroundModel model;
+  initModel(model, 30, 90);
+  for (int i = 0; i < 3000; i++)
+    model.update(frame(i % 3 != 0));
+  EXPECT_TRUE(model.isBackground(0.55f, 0.55f, 0.55f));
+}
+
+TEST(BackgroundModelTest, BackgroundWithMissingPointsIsKept)
+{
+  // Background voxels with noisy depth are not occupied in every frame, but they are not released:
+  open_ptrack::detection::BackgroundModel model;
+  initModel(model, 30, 10);
+  model.learn(frame(true));
+  for (int i = 0; i < 3000; i++)
+  {
+    model.update(frame(i % 3 != 0));
+    ASSERT_TRUE(model.isBackground(0.55f, 0.55f, 0.55f)) << "frame " << i;
+  }
+}
+
+TEST(BackgroundModelTest, OtherVoxelsAreNotChanged)
+{
+  open_ptrack::detection::BackgroundModel model;
+  initModel(model, 5, 5);
+  model.learn(frame(true, 0.15f, 0.15f, 0.15f));
+  for (int i = 0; i < 5; i++)
+  {
+    PointCloud cloud = frame(true, 0.15f, 0.15f, 0.15f);
+    cloud.points.push_back(pcl::PointXYZ(0.95f, 0.95f, 0.95f));
+    cloud.points.push_back(pcl::PointXYZ(2.0f, 2.0f, 2.0f));      // out of the grid
+    model.update(cloud);
+  }
+  EXPECT_TRUE(model.isBackground(0.15f, 0.15f, 0.15f));
+  EXPECT_TRUE(model.isBackground(0.95f, 0.95f, 0.95f));
+  EXPECT_FALSE(model.isBackground(2.0f, 2.0f, 2.0f));
+  EXPECT_EQ(2u, model.size());
+}
+
+TEST(BackgroundModelTest, LargeGridIsLimited)
+{
+  // 1 cm voxels up to 50 m would be more than 1e11 voxels:
+  open_ptrack::detection::BackgroundModel model;
+  model.init(0.01f, -50.0f, -50.0f, 0.0f, 50.0f, 50.0f, 50.0f);
+  EXPECT_GT(model.getResolution(), 0.01f);
+  EXPECT_LT(model.voxel(49.99f, 49.99f, 49.99f), open_ptrack::detection::BackgroundModel::MAX_VOXELS);
+
+  // The whole box is still covered:
+  PointCloud cloud = frame(true, 49.99f, -49.99f, 49.99f);
+  model.learn(cloud);
+  EXPECT_TRUE(model.isBackground(49.99f, -49.99f, 49.99f));
+  EXPECT_EQ(1u, model.size());
+
+  // Small grids keep their voxel size:
+  initModel(model, 0, 1);
+  EXPECT_EQ(0.1f, model.getResolution());
+}
+
+TEST(BackgroundModelTest, FileWithTooManyVoxelsIsRejected)
+{
+  open_ptrack::detection::BackgroundModel model;
+  initModel(model, 0, 1);
+  model.learn(frame(true));
+  const std::string filename = "/tmp/test_background_model.bin";
+  ASSERT_TRUE(model.save(filename));
+
+  // A file with the same header, but a grid of 2^48 voxels:
+  {
+    std::fstream file(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+    const uint32_t dims[3] = {1u << 16, 1u << 16, 1u << 16};
+    file.seekp(8 + 4 * sizeof(float));
+    file.write(reinterpret_cast<const char*>(dims), sizeof(dims));
+  }
+  open_ptrack::detection::BackgroundModel loaded;
+  initModel(loaded, 0, 1);
+  EXPECT_FALSE(loaded.load(filename));
+  EXPECT_TRUE(loaded.hasSameGrid(model));
+  EXPECT_EQ(0u, loaded.size());
+
+  ASSERT_TRUE(model.save(filename));
+  EXPECT_TRUE(loaded.load(filename));
+  EXPECT_TRUE(loaded.isBackground(0.55f, 0.55f, 0.55f));
+  std::remove(filename.c_str());
+}
@@ -0,0 +1,123 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * test_exclusion_mask.cpp
+ */
+
+#include <limits>
+#include <gtest/gtest.h>
+#include <open_ptrack/detection/exclusion_mask.h>
+
+using open_ptrack::detection::ExclusionMask;
+
+namespace
+{
+  /** \brief A 3x3 mask whose center pixel looks along the z axis. */
+  ExclusionMask
+  createMask ()
+  {
+    ExclusionMask mask;
+    mask.init(3, 3);
+    return mask;
+  }
+
+  /** \brief Exclude the depths from near to far on the ray of the center pixel (a box 0.2 m wide around it). */
+  void
+  addBox (ExclusionMask& mask, float near, float far)
+  {
+    mask.addBox(Eigen::Affine3f::Identity(), Eigen::Vector3f(-0.1f, -0.1f, near), Eigen::Vector3f(0.1f, 0.1f, far),
+        1.0f, 1.0f, 1.0f, 1.0f);
+  }
+
+  bool
+  isExcluded (const ExclusionMask& mask, float z)
+  {
+    return ExclusionMask::isExcluded(mask.row(1)[1], z);
+  }
+} /* namespace */
+
+TEST(ExclusionMaskTest, BoxesOnTheSameRayAreNotMerged)
+{
+  ExclusionMask mask = createMask();
+  addBox(mask, 1.0f, 2.0f);
+  addBox(mask, 5.0f, 6.0f);
+  EXPECT_TRUE(mask.appliesTo(3, 3));
+  EXPECT_FALSE(isExcluded(mask, 0.5f));
+  EXPECT_TRUE(isExcluded(mask, 1.5f));
+  EXPECT_FALSE(isExcluded(mask, 3.5f));     // people between the two boxes are detected
+  EXPECT_TRUE(isExcluded(mask, 5.5f));
+  EXPECT_FALSE(isExcluded(mask, 7.0f));
+
+  // The other pixels look away from the boxes:
+  EXPECT_FALSE(ExclusionMask::isExcluded(mask.row(0)[0], 1.5f));
+}
+
+TEST(ExclusionMaskTest, OverlappingBoxesAreMerged)
+{
+  ExclusionMask mask = createMask();
+  addBox(mask, 5.0f, 6.0f);
+  addBox(mask, 1.0f, 2.0f);
+  addBox(mask, 1.5f, 3.0f);
+  EXPECT_TRUE(isExcluded(mask, 2.5f));
+  EXPECT_FALSE(isExcluded(mask, 4.0f));
+  EXPECT_TRUE(isExcluded(mask, 5.5f));
+}
+
+TEST(ExclusionMaskTest, ClosestRangesAreMergedWhenFull)
+{
+  ExclusionMask mask = createMask();
+  for (int i = 0; i < ExclusionMask::MAX_RANGES; i++)
+    addBox(mask, 1.0f + 10.0f * i, 2.0f + 10.0f * i);
+  addBox(mask, 3.0f, 4.0f);       // 1 m from the first range
+  for (int i = 0; i < ExclusionMask::MAX_RANGES; i++)
+  {
+    EXPECT_TRUE(isExcluded(mask, 1.5f + 10.0f * i));
+    EXPECT_FALSE(isExcluded(mask, 6.0f + 10.0f * i));
+  }
+  EXPECT_TRUE(isExcluded(mask, 2.5f));      // the gap between the merged ranges
+  EXPECT_TRUE(isExcluded(mask, 3.5f));
+}
+
+TEST(ExclusionMaskTest, ImageMaskExcludesAllDepths)
+{
+  ExclusionMask mask = createMask();
+  addBox(mask, 1.0f, 2.0f);
+  addBox(mask, 5.0f, 6.0f);
+  uint8_t image[9] = {0, 0, 0, 0, 255, 0, 0, 0, 0};
+  mask.addImageMask(image, 3);
+  EXPECT_TRUE(isExcluded(mask, 0.0f));
+  EXPECT_TRUE(isExcluded(mask, 3.5f));
+  EXPECT_TRUE(isExcluded(mask, 100.0f));
+  EXPECT_FALSE(ExclusionMask::isExcluded(mask.row(0)[0], 3.5f));
+}
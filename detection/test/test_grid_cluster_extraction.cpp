@@ -0,0 +1,158 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * test_grid_cluster_extraction.cpp
+ */
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <gtest/gtest.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/search/kdtree.h>
+#include <pcl/segmentation/extract_clusters.h>
+#include <open_ptrack/detection/grid_cluster_extraction.h>
+
+typedef pcl::PointXYZRGB PointT;
+typedef pcl::PointCloud<PointT> PointCloud;
+
+namespace
+{
+  const float VOXEL_SIZE = 0.06f;
+
+  /** \brief Add the voxel centroids of an ellipsoid to a cloud (jittered inside their voxels). */
+  void
+  addBlob(PointCloud& cloud, float cx, float cy, float cz, float rx, float ry, float rz, std::mt19937& random)
+  {
+    std::uniform_real_distribution<float> jitter(-0.3f * VOXEL_SIZE, 0.3f * VOXEL_SIZE);
+    for(float x = -rx; x <= rx; x += VOXEL_SIZE)
+    {
+      for(float y = -ry; y <= ry; y += VOXEL_SIZE)
+      {
+        for(float z = -rz; z <= rz; z += VOXEL_SIZE)
+        {
+          if ((x * x) / (rx * rx) + (y * y) / (ry * ry) + (z * z) / (rz * rz) > 1.0f)
+            continue;
+          PointT p;
+          p.x = cx + x + jitter(random);
+          p.y = cy + y + jitter(random);
+          p.z = cz + z + jitter(random);
+          cloud.points.push_back(p);
+        }
+      }
+    }
+  }
+
+  /** \brief A voxelized scene: people-sized blobs (two of them touching), small objects and scattered points. */
+  PointCloud::Ptr
+  createVoxelizedCloud()
+  {
+    std::mt19937 random(99);
+    PointCloud::Ptr cloud(new PointCloud);
+    addBlob(*cloud, 0.0f, 0.0f, 3.0f, 0.25f, 0.85f, 0.2f, random);
+    addBlob(*cloud, 1.0f, 0.1f, 3.5f, 0.22f, 0.8f, 0.18f, random);
+    addBlob(*cloud, 1.4f, 0.1f, 3.5f, 0.2f, 0.7f, 0.16f, random);     // touches the previous one
+    addBlob(*cloud, -1.5f, 0.2f, 4.0f, 0.3f, 0.9f, 0.25f, random);
+    addBlob(*cloud, 2.5f, 0.5f, 2.0f, 0.1f, 0.1f, 0.1f, random);      // too small
+    addBlob(*cloud, -3.0f, 0.0f, 6.0f, 1.2f, 1.0f, 0.4f, random);     // too large
+
+    std::uniform_real_distribution<float> position(-4.0f, 4.0f);
+    for(int i = 0; i < 200; i++)
+    {
+      PointT p;
+      p.x = position(random);
+      p.y = position(random);
+      p.z = 5.0f + position(random);
+      cloud->points.push_back(p);
+    }
+
+    // Shuffled, as the voxel order of a real scene does not follow the clusters:
+    std::shuffle(cloud->points.begin(), cloud->points.end(), random);
+    cloud->width = cloud->points.size();
+    cloud->height = 1;
+    cloud->is_dense = true;
+    return cloud;
+  }
+} /* namespace */
+
+TEST(GridClusterExtractionTest, SameClustersOfEuclideanClusterExtraction)
+{
+  PointCloud::Ptr cloud = createVoxelizedCloud();
+  const float tolerances[] = {2 * VOXEL_SIZE, 3 * VOXEL_SIZE};
+  for(int t = 0; t < 2; t++)
+  {
+    std::vector<pcl::PointIndices> clusters, reference_clusters;
+
+    pcl::search::KdTree<PointT>::Ptr tree(new pcl::search::KdTree<PointT>);
+    tree->setInputCloud(cloud);
+    pcl::EuclideanClusterExtraction<PointT> euclidean_cluster_extraction;
+    euclidean_cluster_extraction.setClusterTolerance(tolerances[t]);
+    euclidean_cluster_extraction.setMinClusterSize(30);
+    euclidean_cluster_extraction.setMaxClusterSize(5000);
+    euclidean_cluster_extraction.setSearchMethod(tree);
+    euclidean_cluster_extraction.setInputCloud(cloud);
+    euclidean_cluster_extraction.extract(reference_clusters);
+
+    open_ptrack::detection::GridClusterExtraction<PointT> grid_cluster_extraction;
+    grid_cluster_extraction.setClusterTolerance(tolerances[t]);
+    grid_cluster_extraction.setMinClusterSize(30);
+    grid_cluster_extraction.setMaxClusterSize(5000);
+    grid_cluster_extraction.setInputCloud(cloud);
+    grid_cluster_extraction.extract(clusters);
+
+    // Clusters are sorted by size, which has to tell them apart for the order to be the same:
+    ASSERT_GE(reference_clusters.size(), 3u);
+    std::set<size_t> sizes;
+    for(size_t c = 0; c < reference_clusters.size(); c++)
+      sizes.insert(reference_clusters[c].indices.size());
+    ASSERT_EQ(reference_clusters.size(), sizes.size()) << "clusters of the same size";
+
+    // pcl::EuclideanClusterExtraction sorts the indices of every cluster:
+    ASSERT_EQ(reference_clusters.size(), clusters.size()) << "tolerance " << tolerances[t];
+    for(size_t c = 0; c < clusters.size(); c++)
+      EXPECT_EQ(reference_clusters[c].indices, clusters[c].indices) << "cluster " << c << ", tolerance " << tolerances[t];
+  }
+}
+
+TEST(GridClusterExtractionTest, EmptyCloud)
+{
+  PointCloud::Ptr cloud(new PointCloud);
+  open_ptrack::detection::GridClusterExtraction<PointT> grid_cluster_extraction;
+  grid_cluster_extraction.setClusterTolerance(2 * VOXEL_SIZE);
+  grid_cluster_extraction.setInputCloud(cloud);
+  std::vector<pcl::PointIndices> clusters;
+  grid_cluster_extraction.extract(clusters);
+  EXPECT_TRUE(clusters.empty());
+}
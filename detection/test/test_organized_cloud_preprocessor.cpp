@@ -0,0 +1,276 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * test_organized_cloud_preprocessor.cpp
+ */
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <pcl/filters/voxel_grid.h>
+#include <open_ptrack/detection/organized_cloud_preprocessor.h>
+
+typedef pcl::PointXYZRGB PointT;
+typedef pcl::PointCloud<PointT> PointCloud;
+
+namespace
+{
+  /** \brief Organized cloud of a floor, a wall and a person-sized box, with holes and points beyond max distance. */
+  PointCloud::Ptr
+  createOrganizedCloud(int width, int height)
+  {
+    std::mt19937 random(1234);
+    std::normal_distribution<float> noise(0.0f, 0.01f);
+    PointCloud::Ptr cloud(new PointCloud(width, height));
+    const float fx = 0.8f * width, cx = 0.5f * width, cy = 0.5f * height;
+    for(int v = 0; v < height; v++)
+    {
+      for(int u = 0; u < width; u++)
+      {
+        PointT& p = (*cloud)(u, v);
+        p.r = static_cast<uint8_t>(u * 255 / width);
+        p.g = static_cast<uint8_t>(v * 255 / height);
+        p.b = static_cast<uint8_t>((u + v) % 256);
+        if ((u * 31 + v * 17) % 23 == 0)
+        {
+          p.x = p.y = p.z = std::numeric_limits<float>::quiet_NaN();
+          continue;
+        }
+
+        // Depth along the ray of the pixel: wall at 6 m (beyond max distance), floor below, box in the middle:
+        float ray_x = (u - cx) / fx, ray_y = (v - cy) / fx;
+        float z = 6.0f;
+        if (ray_y > 0.0f)
+          z = std::min(z, 1.2f / ray_y);
+        if ((std::abs(ray_x - 0.1f) < 0.15f) and (ray_y > -0.3f))
+          z = std::min(z, 2.5f + 0.3f * ray_x);
+        z += noise(random);
+        p.x = ray_x * z;
+        p.y = ray_y * z;
+        p.z = z;
+      }
+    }
+    cloud->is_dense = false;
+    return cloud;
+  }
+
+  /**
+   * \brief Depth (16 bits, in millimeters) and RGB images of the scene of createOrganizedCloud, with pixels without
+   * measurement (0), saturated pixels and pixels at exactly the given maximum distance.
+   */
+  struct SceneImages
+  {
+    SceneImages(int width, int height, int channels, float max_distance) :
+      depth(width * height),
+      color(width * height * channels)
+    {
+      PointCloud::Ptr cloud = createOrganizedCloud(width, height);
+      for(int i = 0; i < width * height; i++)
+      {
+        const PointT& p = cloud->points[i];
+        if (not std::isfinite(p.z))
+          depth[i] = 0;
+        else if (i % 29 == 0)
+          depth[i] = 65535;
+        else if (i % 31 == 0)
+          depth[i] = uint16_t(max_distance * 1000.0f + 0.5f);
+        else
+          depth[i] = uint16_t(p.z * 1000.0f + 0.5f);
+        color[i * channels] = p.r;
+        color[i * channels + 1] = p.g;
+        color[i * channels + 2] = p.b;
+      }
+
+      image.width = width;
+      image.height = height;
+      image.depth = &depth[0];
+      image.depth_step = width * sizeof(uint16_t);
+      image.depth_scale = 0.001f;
+      image.color = &color[0];
+      image.color_step = width * channels;
+      image.color_channels = channels;
+      image.bgr = (channels == 4);
+      image.fx = image.fy = 0.8f * width;
+      image.cx = 0.5f * width;
+      image.cy = 0.5f * height;
+    }
+
+    std::vector<uint16_t> depth;
+    std::vector<uint8_t> color;
+    open_ptrack::detection::RGBDImage image;
+  };
+
+  /** \brief The reference pipeline of GroundBasedPeopleDetectionApp: sampling, then pcl::VoxelGrid. */
+  void
+  filterWithVoxelGrid(const PointCloud::Ptr& input_cloud, int sampling_factor, float voxel_size, float max_distance,
+      PointCloud& output_cloud)
+  {
+    PointCloud::Ptr cloud_downsampled(new PointCloud);
+    cloud_downsampled->width = input_cloud->width / sampling_factor;
+    cloud_downsampled->height = input_cloud->height / sampling_factor;
+    cloud_downsampled->points.resize(cloud_downsampled->width * cloud_downsampled->height);
+    cloud_downsampled->is_dense = false;
+    for(unsigned int i = 0; i < cloud_downsampled->height; i++)
+      for(unsigned int j = 0; j < cloud_downsampled->width; j++)
+        (*cloud_downsampled)(j, i) = (*input_cloud)(sampling_factor * j, sampling_factor * i);
+
+    pcl::VoxelGrid<PointT> voxel_grid_filter_object;
+    voxel_grid_filter_object.setInputCloud(cloud_downsampled);
+    voxel_grid_filter_object.setLeafSize(voxel_size, voxel_size, voxel_size);
+    voxel_grid_filter_object.setFilterFieldName("z");
+    voxel_grid_filter_object.setFilterLimits(0.0, max_distance);
+    voxel_grid_filter_object.filter(output_cloud);
+  }
+} /* namespace */
+
+TEST(OrganizedCloudPreprocessorTest, SameVoxelsOfVoxelGrid)
+{
+  // An odd size, so that sampling drops the last rows and columns:
+  PointCloud::Ptr input_cloud = createOrganizedCloud(161, 121);
+  const float max_distance = 5.0f;
+  open_ptrack::detection::OrganizedCloudPreprocessor<PointT> preprocessor;
+  preprocessor.setMaxDistance(max_distance);
+
+  const int sampling_factors[] = {1, 2, 4};
+  const float voxel_sizes[] = {0.06f, 0.1f};
+  for(int s = 0; s < 3; s++)
+  {
+    for(int v = 0; v < 2; v++)
+    {
+      preprocessor.setSamplingFactor(sampling_factors[s]);
+      preprocessor.setVoxelSize(voxel_sizes[v]);
+      PointCloud output_cloud, reference_cloud;
+      preprocessor.compute(*input_cloud, output_cloud);
+      filterWithVoxelGrid(input_cloud, sampling_factors[s], voxel_sizes[v], max_distance, reference_cloud);
+
+      // Same voxels in the same order (centroids are summed in a different order, hence the tolerance):
+      ASSERT_EQ(reference_cloud.points.size(), output_cloud.points.size())
+          << "sampling " << sampling_factors[s] << ", voxel size " << voxel_sizes[v];
+      ASSERT_GT(output_cloud.points.size(), 100u);
+      for(size_t i = 0; i < output_cloud.points.size(); i++)
+      {
+        const PointT& p = output_cloud.points[i];
+        const PointT& q = reference_cloud.points[i];
+        ASSERT_NEAR(q.x, p.x, 1e-4) << "point " << i;
+        ASSERT_NEAR(q.y, p.y, 1e-4) << "point " << i;
+        ASSERT_NEAR(q.z, p.z, 1e-4) << "point " << i;
+        EXPECT_NEAR(q.r, p.r, 1) << "point " << i;
+        EXPECT_NEAR(q.g, p.g, 1) << "point " << i;
+        EXPECT_NEAR(q.b, p.b, 1) << "point " << i;
+      }
+    }
+  }
+}
+
+TEST(OrganizedCloudPreprocessorTest, SameVoxelsAcrossFrames)
+{
+  // The voxel hash is reused between frames: a frame must not see the voxels of the previous one.
+  open_ptrack::detection::OrganizedCloudPreprocessor<PointT> preprocessor;
+  preprocessor.setSamplingFactor(2);
+  PointCloud::Ptr large_cloud = createOrganizedCloud(161, 121);
+  PointCloud::Ptr small_cloud = createOrganizedCloud(80, 60);
+  PointCloud first, second, reference;
+  preprocessor.compute(*small_cloud, first);
+  preprocessor.compute(*large_cloud, second);
+  preprocessor.compute(*small_cloud, second);
+  filterWithVoxelGrid(small_cloud, 2, 0.06f, 50.0f, reference);
+
+  ASSERT_EQ(reference.points.size(), first.points.size());
+  ASSERT_EQ(first.points.size(), second.points.size());
+  for(size_t i = 0; i < first.points.size(); i++)
+  {
+    EXPECT_EQ(first.points[i].x, second.points[i].x);
+    EXPECT_EQ(first.points[i].y, second.points[i].y);
+    EXPECT_EQ(first.points[i].z, second.points[i].z);
+  }
+}
+
+TEST(OrganizedCloudPreprocessorTest, SameVoxelsOfTheBackProjectedImage)
+{
+  const int sampling_factors[] = {1, 3};
+  const float max_distances[] = {5.0f, 4.3f, 2.5f};
+  const int channels[] = {3, 4};
+  for(int s = 0; s < 2; s++)
+  {
+    for(int m = 0; m < 3; m++)
+    {
+      for(int c = 0; c < 2; c++)
+      {
+        SceneImages images(161, 121, channels[c], max_distances[m]);
+        open_ptrack::detection::OrganizedCloudPreprocessor<PointT> preprocessor;
+        preprocessor.setSamplingFactor(sampling_factors[s]);
+        preprocessor.setMaxDistance(max_distances[m]);
+
+        // Pixels without measurement are NaN points of the cloud:
+        PointCloud cloud;
+        preprocessor.backProject(images.image, cloud);
+        ASSERT_EQ(images.depth.size(), cloud.points.size());
+        for(size_t i = 0; i < images.depth.size(); i++)
+          ASSERT_EQ(images.depth[i] == 0, std::isnan(cloud.points[i].z)) << "pixel " << i;
+
+        PointCloud image_output, cloud_output;
+        pcl::PointCloud<pcl::RGB> image_rgb, cloud_rgb;
+        preprocessor.compute(images.image, image_output, &image_rgb);
+        preprocessor.compute(cloud, cloud_output, &cloud_rgb);
+
+        // Same voxels, points and colors, since pixels are back-projected in the same way:
+        ASSERT_EQ(cloud_output.points.size(), image_output.points.size())
+            << "sampling " << sampling_factors[s] << ", max distance " << max_distances[m] << ", channels " << channels[c];
+        ASSERT_GT(image_output.points.size(), 100u);
+        for(size_t i = 0; i < image_output.points.size(); i++)
+        {
+          const PointT& p = image_output.points[i];
+          const PointT& q = cloud_output.points[i];
+          ASSERT_EQ(q.x, p.x) << "point " << i;
+          ASSERT_EQ(q.y, p.y) << "point " << i;
+          ASSERT_EQ(q.z, p.z) << "point " << i;
+          ASSERT_EQ(q.r, p.r) << "point " << i;
+          ASSERT_EQ(q.g, p.g) << "point " << i;
+          ASSERT_EQ(q.b, p.b) << "point " << i;
+        }
+        ASSERT_EQ(cloud_rgb.points.size(), image_rgb.points.size());
+        for(size_t i = 0; i < image_rgb.points.size(); i++)
+        {
+          ASSERT_EQ(cloud_rgb.points[i].r, image_rgb.points[i].r) << "pixel " << i;
+          ASSERT_EQ(cloud_rgb.points[i].g, image_rgb.points[i].g) << "pixel " << i;
+          ASSERT_EQ(cloud_rgb.points[i].b, image_rgb.points[i].b) << "pixel " << i;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,191 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * test_person_classifier.cpp
+ */
+
+#include <cmath>
+#include <vector>
+#include <gtest/gtest.h>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include <open_ptrack/detection/person_classifier.h>
+
+typedef open_ptrack::detection::PersonClassifier<pcl::RGB> PersonClassifier;
+
+namespace
+{
+  /**
+   * \brief Largest difference between the scores of evaluateBatch and evaluate, and largest mean difference: the batch
+   * rounds patches to the nearest of 8 scales per octave (up to 4% of their size) and to the nearest HOG cell (up to 4
+   * pixels of the window), and computes the cells of the window borders from the pixels around the window.
+   */
+  const double TOLERANCE = 1.0;
+  const double MEAN_TOLERANCE = 0.4;
+
+  /** \brief Draw a filled ellipse (or a box, if box is true) on an image. */
+  void
+  draw(pcl::PointCloud<pcl::RGB>& image, float xc, float yc, float rx, float ry, uint8_t r, uint8_t g, uint8_t b,
+      bool box = false)
+  {
+    for(int y = std::max(0, int(yc - ry)); y < std::min(int(image.height), int(yc + ry) + 1); y++)
+    {
+      for(int x = std::max(0, int(xc - rx)); x < std::min(int(image.width), int(xc + rx) + 1); x++)
+      {
+        float dx = (x - xc) / rx, dy = (y - yc) / ry;
+        if (box or (dx * dx + dy * dy <= 1.0f))
+        {
+          image(x, y).r = r;
+          image(x, y).g = g;
+          image(x, y).b = b;
+        }
+      }
+    }
+  }
+
+  /** \brief A textured background with people (head, torso and legs) of a given height, standing on a row. */
+  pcl::PointCloud<pcl::RGB>::Ptr
+  createImage(const std::vector<float>& xc, const std::vector<float>& yc, const std::vector<float>& heights)
+  {
+    pcl::PointCloud<pcl::RGB>::Ptr image(new pcl::PointCloud<pcl::RGB>(640, 480));
+    for(int y = 0; y < 480; y++)
+    {
+      for(int x = 0; x < 640; x++)
+      {
+        pcl::RGB& p = (*image)(x, y);
+        p.r = uint8_t(150 + 60 * std::sin(x * 0.05) * std::cos(y * 0.03));
+        p.g = uint8_t(140 + 50 * std::sin(x * 0.02 + y * 0.04));
+        p.b = uint8_t(((x / 40 + y / 40) % 2) ? 200 : 120);
+        p.a = 255;
+      }
+    }
+    for(size_t i = 0; i < xc.size(); i++)
+    {
+      const float h = heights[i], top = yc[i] - h / 2;
+      draw(*image, xc[i], top + 0.07f * h, 0.06f * h, 0.07f * h, 60, 40, 30);                     // head
+      draw(*image, xc[i], top + 0.35f * h, 0.13f * h, 0.21f * h, 30, 30, 90);                     // torso
+      draw(*image, xc[i] - 0.06f * h, top + 0.78f * h, 0.04f * h, 0.22f * h, 20, 20, 20, true);   // legs
+      draw(*image, xc[i] + 0.06f * h, top + 0.78f * h, 0.04f * h, 0.22f * h, 20, 20, 20, true);
+    }
+    return image;
+  }
+
+  PersonClassifier::Window
+  window(float height, float xc, float yc)
+  {
+    PersonClassifier::Window w;
+    w.height = height;
+    w.xc = xc;
+    w.yc = yc;
+    return w;
+  }
+} /* namespace */
+
+TEST(PersonClassifierTest, BatchScoresAgreeWithEvaluate)
+{
+  // The SVM of the detector (the test runs in the package directory):
+  PersonClassifier classifier;
+  ASSERT_TRUE(classifier.loadSVMFromFile("data/HogSvmPCL.yaml"));
+
+  // People of several sizes, one of them cut by the left border of the image:
+  std::vector<float> xc, yc, heights;
+  const float people[][3] = {{100, 200, 96}, {230, 260, 160}, {380, 300, 240}, {540, 180, 120}, {20, 250, 200}};
+  for(int i = 0; i < 5; i++)
+  {
+    xc.push_back(people[i][0]);
+    yc.push_back(people[i][1]);
+    heights.push_back(people[i][2]);
+  }
+  pcl::PointCloud<pcl::RGB>::Ptr image = createImage(xc, yc, heights);
+
+  // Windows on the people, slightly off them, and on the background:
+  std::vector<PersonClassifier::Window> windows;
+  for(size_t i = 0; i < xc.size(); i++)
+  {
+    windows.push_back(window(heights[i], xc[i], yc[i]));
+    windows.push_back(window(heights[i] * 1.1f, xc[i] + 5, yc[i] - 3));
+  }
+  for(int i = 0; i < 8; i++)
+    windows.push_back(window(80 + 30 * i, 60 + 70 * i, 120 + 30 * (i % 4)));
+
+  std::vector<double> confidences;
+  classifier.evaluateBatch(image, windows, confidences);
+  ASSERT_EQ(windows.size(), confidences.size());
+  int signed_scores = 0;
+  double difference = 0.0;
+  for(size_t i = 0; i < windows.size(); i++)
+  {
+    double expected = classifier.evaluate(windows[i].height, windows[i].xc, windows[i].yc, image);
+    ASSERT_TRUE(std::isfinite(expected)) << "window " << i;
+    EXPECT_NEAR(expected, confidences[i], TOLERANCE) << "window " << i;
+    difference += std::abs(expected - confidences[i]);
+
+    // Scores farther from 0 than the tolerance have the same sign:
+    if (std::abs(expected) > TOLERANCE)
+    {
+      EXPECT_EQ(expected > 0.0, confidences[i] > 0.0) << "window " << i << ": " << expected << ", " << confidences[i];
+      signed_scores++;
+    }
+  }
+  EXPECT_LT(difference / windows.size(), MEAN_TOLERANCE);
+  EXPECT_GT(signed_scores, int(windows.size()) / 2);
+}
+
+TEST(PersonClassifierTest, WindowsOutOfTheImageHaveNoScore)
+{
+  PersonClassifier classifier;
+  ASSERT_TRUE(classifier.loadSVMFromFile("data/HogSvmPCL.yaml"));
+  pcl::PointCloud<pcl::RGB>::Ptr image = createImage(std::vector<float>(1, 320), std::vector<float>(1, 240),
+      std::vector<float>(1, 160));
+
+  // Left, right, above and below the image, and without height (the last one is valid):
+  std::vector<PersonClassifier::Window> windows;
+  windows.push_back(window(120, -100, 240));
+  windows.push_back(window(120, 800, 240));
+  windows.push_back(window(120, 320, -200));
+  windows.push_back(window(120, 320, 700));
+  windows.push_back(window(0, 320, 240));
+  windows.push_back(window(-50, 320, 240));
+  windows.push_back(window(160, 320, 240));
+
+  std::vector<double> confidences;
+  classifier.evaluateBatch(image, windows, confidences);
+  ASSERT_EQ(windows.size(), confidences.size());
+  for(size_t i = 0; i + 1 < windows.size(); i++)
+  {
+    EXPECT_TRUE(std::isnan(confidences[i])) << "window " << i;
+    EXPECT_TRUE(std::isnan(classifier.evaluate(windows[i].height, windows[i].xc, windows[i].yc, image))) << "window " << i;
+  }
+  EXPECT_TRUE(std::isfinite(confidences.back()));
+}
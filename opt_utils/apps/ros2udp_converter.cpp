@@ -32,317 +32,28 @@
  * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
  * POSSIBILITY OF SUCH DAMAGE.
  *
- * Author: Matteo Munaro [matteo.munaro@dei.unipd.it]
- *
  */
 
 #include <ros/ros.h>
-#include <opt_msgs/TrackArray.h>
-#include <opt_msgs/IDArray.h>
-#include <opt_msgs/NameArray.h>
-#include <opt_msgs/SkeletonTrackArray.h>
-#include <opt_msgs/StandardSkeletonTrackArray.h>
-#include <opt_msgs/PoseRecognitionArray.h>
-#include <body_pose_estimation/skeleton_base.h>
-#include <message_filters/subscriber.h>
-#include <message_filters/time_synchronizer.h>
-#include <open_ptrack/opt_utils/udp_messaging.h>
-#include <open_ptrack/opt_utils/json.h>
-
-// Global variables:
-int facetracksflag;
-int udp_buffer_length;  // UDP message buffer length
-int udp_port;           // UDP port
-std::string hostip;     // UDP host
-int json_indent_size;   // indent size for JSON message
-bool json_newline;      // use newlines (true) or not (false) in JSON messages
-bool json_spacing;      // use spacing (true) or not (false) in JSON messages
-bool json_use_tabs;     // use tabs (true) or not (false) in JSON messages
-struct ComData udp_data;  // parameters for UDP messaging
-open_ptrack::opt_utils::UDPMessaging udp_messaging(udp_data);   // instance of class UDPMessaging
-ros::Time last_heartbeat_time;
-double heartbeat_interval;
-
-std::map<int, std::string> namePairs;
-
-using namespace open_ptrack::bpe;
-
-void
-trackingCallback(const opt_msgs::TrackArray::ConstPtr& tracking_msg)
-{
-  if (facetracksflag == 1)
-  {
-    return;
-  }
-  /// Create JSON-formatted message:
-  Jzon::Object root, header, stamp;
-
-  /// Add header (84 characters):
-  header.Add("seq", int(tracking_msg->header.seq));
-  stamp.Add("sec", int(tracking_msg->header.stamp.sec));
-  stamp.Add("nsec", int(tracking_msg->header.stamp.nsec));
-  header.Add("stamp", stamp);
-  std::string camera_name = tracking_msg->header.frame_id;
-    if (strcmp(camera_name.substr(0,1).c_str(), "/") == 0)  // Remove bar at the beginning
-    {
-      camera_name = camera_name.substr(1, camera_name.size() - 1);
-    }
-  header.Add("frame_id", camera_name);
-  root.Add("header", header);
-
-  /// Add tracks array:
-  // >50 characters for every track
-  Jzon::Array tracks;
-  for (unsigned int i = 0; i < tracking_msg->tracks.size(); i++)
-  {
-    Jzon::Object current_track;
-    current_track.Add("id", tracking_msg->tracks[i].id);
-    current_track.Add("x", tracking_msg->tracks[i].x);
-    current_track.Add("y", tracking_msg->tracks[i].y);
-    current_track.Add("height", tracking_msg->tracks[i].height);
-    current_track.Add("age", tracking_msg->tracks[i].age);
-    current_track.Add("confidence", tracking_msg->tracks[i].confidence);
-
-    tracks.Add(current_track);
-  }
-  root.Add("people_tracks", tracks);
-
-  /// Convert JSON object to string:
-  Jzon::Format message_format = Jzon::StandardFormat;
-  message_format.indentSize = json_indent_size;
-  message_format.newline = json_newline;
-  message_format.spacing = json_spacing;
-  message_format.useTabs = json_use_tabs;
-  Jzon::Writer writer(root, message_format);
-  writer.Write();
-  std::string json_string = writer.GetResult();
-  //  std::cout << "String sent: " << json_string << std::endl;
-
-  /// Copy string to message buffer:
-  udp_data.si_num_byte_ = json_string.length()+1;
-  char buf[udp_data.si_num_byte_];
-  for (unsigned int i = 0; i < udp_data.si_num_byte_; i++)
-  {
-    buf[i] = 0;
-  }
-  sprintf(buf, "%s", json_string.c_str());
-  udp_data.pc_pck_ = buf;         // buffer where the message is written
-
-  /// Send message:
-  udp_messaging.sendFromSocketUDP(&udp_data);
-}
-
-
-void peopleTracksCallback(const opt_msgs::TrackArray::ConstPtr& association_message)
-{
-  Jzon::Array tracks;
-  if (association_message->tracks.size() != 0){
-    facetracksflag = 1;
-  }
-
-  if (facetracksflag==0){
-    return;
-  }
-  
-  
-  Jzon::Object root, header, stamp;
-
-  /// Add header (84 characters):
-  header.Add("seq", int(association_message->header.seq));
-  stamp.Add("sec", int(association_message->header.stamp.sec));
-  stamp.Add("nsec", int(association_message->header.stamp.nsec));
-  header.Add("stamp", stamp);
-  std::string camera_name = association_message->header.frame_id;
-    if (strcmp(camera_name.substr(0,1).c_str(), "/") == 0)  // Remove bar at the beginning
-    {
-      camera_name = camera_name.substr(1, camera_name.size() - 1);
-    }
-  header.Add("frame_id", camera_name);
-  root.Add("header", header);
-
-  /// Add tracks array:
-  // >50 characters for every track
-  for (unsigned int i = 0; i < association_message->tracks.size(); i++)
-  {
-    Jzon::Object current_track;
-    current_track.Add("id", association_message->tracks[i].id);
-    current_track.Add("x", association_message->tracks[i].x);
-    current_track.Add("y", association_message->tracks[i].y);
-    current_track.Add("height", association_message->tracks[i].height);
-    current_track.Add("age", association_message->tracks[i].age);
-    current_track.Add("confidence", association_message->tracks[i].confidence);
-    current_track.Add("stable_id", association_message->tracks[i].stable_id);
-    
-    if (namePairs.count(association_message->tracks[i].stable_id)) {
-      current_track.Add("face_name", namePairs.at(association_message->tracks[i].stable_id));
-    }
-
-    tracks.Add(current_track);
-  }
-  root.Add("people_tracks", tracks);
-
-  /// Convert JSON object to string:
-  Jzon::Format message_format = Jzon::StandardFormat;
-  message_format.indentSize = json_indent_size;
-  message_format.newline = json_newline;
-  message_format.spacing = json_spacing;
-  message_format.useTabs = json_use_tabs;
-  Jzon::Writer writer(root, message_format);
-  writer.Write();
-  std::string json_string = writer.GetResult();
-  //  std::cout << "String sent: " << json_string << std::endl;
-
-  /// Copy string to message buffer:
-  udp_data.si_num_byte_ = json_string.length()+1;
-  char buf[udp_data.si_num_byte_];
-  for (unsigned int i = 0; i < udp_data.si_num_byte_; i++)
-  {
-    buf[i] = 0;
-  }
-  sprintf(buf, "%s", json_string.c_str());
-  udp_data.pc_pck_ = buf;         // buffer where the message is written
-
-  /// Send message:
-  udp_messaging.sendFromSocketUDP(&udp_data);
-}
-
-
-void 
-peoplenamesCallback(const opt_msgs::NameArray::ConstPtr& association_message)
-{
-  namePairs.clear();
-
-  Jzon::Array names;
-  Jzon::Array ids;
-  for (unsigned int i = 0; i < association_message->ids.size(); i++)
-  {
-    namePairs.insert(std::make_pair(association_message->ids[i], association_message->names[i]));
-  }
-}
-
-
-void
-aliveIDsCallback(const opt_msgs::IDArray::ConstPtr& alive_ids_msg)
-{
-  ros::Time msg_time = ros::Time(alive_ids_msg->header.stamp.sec, alive_ids_msg->header.stamp.nsec);
-  if ((msg_time - last_heartbeat_time).toSec() > heartbeat_interval)
-  {
-    /// Create JSON-formatted message:
-    Jzon::Object root, header, stamp;
-
-    /// Add header:
-    header.Add("seq", int(alive_ids_msg->header.seq));
-    stamp.Add("sec", int(alive_ids_msg->header.stamp.sec));
-    stamp.Add("nsec", int(alive_ids_msg->header.stamp.nsec));
-    header.Add("stamp", stamp);
-    header.Add("frame_id", "heartbeat");
-    root.Add("header", header);
-
-    Jzon::Array alive_IDs;
-    for (unsigned int i = 0; i < alive_ids_msg->ids.size(); i++)
-    {
-      alive_IDs.Add(alive_ids_msg->ids[i]);
-    }
-    root.Add("alive_IDs", alive_IDs);
-    root.Add("max_ID", alive_ids_msg->max_ID);
-
-    /// Convert JSON object to string:
-    Jzon::Format message_format = Jzon::StandardFormat;
-    message_format.indentSize = json_indent_size;
-    message_format.newline = json_newline;
-    message_format.spacing = json_spacing;
-    message_format.useTabs = json_use_tabs;
-    Jzon::Writer writer(root, message_format);
-    writer.Write();
-    std::string json_string = writer.GetResult();
-    //  std::cout << "String sent: " << json_string << std::endl;
-
-    /// Copy string to message buffer:
-    udp_data.si_num_byte_ = json_string.length()+1;
-    char buf[udp_data.si_num_byte_];
-    for (unsigned int i = 0; i < udp_data.si_num_byte_; i++)
-    {
-      buf[i] = 0;
-    }
-    sprintf(buf, "%s", json_string.c_str());
-    udp_data.pc_pck_ = buf;         // buffer where the message is written
-
-    /// Send message:
-    udp_messaging.sendFromSocketUDP(&udp_data);
-
-    last_heartbeat_time = msg_time;
-  }
-}
-
-typedef unsigned long uint32;
-// convert a string represenation of an IP address into its numeric equivalent
-static uint32 Inet_AtoN(const char * buf)
-{
-
-  uint32 ret = 0;
-  int shift = 24;  // fill out the MSB first
-  bool startQuad = true;
-  while((shift >= 0)&&(*buf))
-  {
-    if (startQuad)
-    {
-      unsigned char quad = (unsigned char) atoi(buf);
-      ret |= (((uint32)quad) << shift);
-      shift -= 8;
-    }
-    startQuad = (*buf == '.');
-    buf++;
-  }
-  return ret;
-}
+#include <nodelet/loader.h>
 
 int
 main(int argc, char **argv)
 {
   // Initialization:
   ros::init(argc, argv, "ros2udp_converter");
-  ros::NodeHandle nh("~");
-
-  // Read input parameters:
-  nh.param("udp/port", udp_port, 21234);
-  nh.param("udp/hostip", hostip, std::string("127.0.0.1"));
-  nh.param("udp/buffer_length", udp_buffer_length, 2048);
-  nh.param("json/indent_size", json_indent_size, 0);
-  nh.param("json/newline", json_newline, false);
-  nh.param("json/spacing", json_spacing, false);
-  nh.param("json/use_tabs", json_use_tabs, false);
-  nh.param("json/heartbeat_interval", heartbeat_interval, 0.25);
 
-  facetracksflag = 0;
-
-  // ROS subscriber:
-  ros::Subscriber tracking_sub = nh.subscribe<opt_msgs::TrackArray>
-      ("input_topic", 1, trackingCallback);
-  ros::Subscriber alive_ids_sub = nh.subscribe<opt_msgs::IDArray>
-      ("alive_ids_topic", 1, aliveIDsCallback);
-  ros::Subscriber people_tracks_sub = nh.subscribe<opt_msgs::TrackArray>("people_tracks_topic", 1, peopleTracksCallback);
-  ros::Subscriber people_names_sub = nh.subscribe<opt_msgs::NameArray>("people_names_topic", 1, peoplenamesCallback);
-
-  // Initialize UDP parameters:
-  char buf[0];
-  udp_data.si_port_ = udp_port;      // port
-  udp_data.si_retry_ = 1;
-  udp_data.si_num_byte_ = udp_buffer_length; // number of bytes to write (2048 -> about 30 tracks)
-  udp_data.pc_pck_ = buf;         // buffer where the message is written
-  udp_data.si_timeout_ = 4;
-  udp_data.sj_addr_ = Inet_AtoN(hostip.c_str());
-
-  /// Create object for UDP messaging:
-  udp_messaging = open_ptrack::opt_utils::UDPMessaging(udp_data);
-
-  /// Create client socket:
-  udp_messaging.createSocketClientUDP(&udp_data);
+  // Run the converter nodelet in this process, with the name, parameters and remappings of the node:
+  nodelet::Loader nodelet(false);
+  nodelet::M_string remappings(ros::names::getRemappings());
+  nodelet::V_string nodelet_argv(argv + 1, argv + argc);
+  if (not nodelet.load(ros::this_node::getName(), "opt_utils/ros2udp_converter", remappings, nodelet_argv))
+  {
+    ROS_FATAL("Cannot load the opt_utils/ros2udp_converter nodelet.");
+    return 1;
+  }
 
-  // Execute callbacks:
   ros::spin();
 
-  // Close socket:
-  udp_messaging.closeSocketUDP(&udp_data);
-
   return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,401 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Matteo Munaro [matteo.munaro@dei.unipd.it]
+ *
+ */
+
+#include <ros/ros.h>
+#include <opt_msgs/TrackArray.h>
+#include <opt_msgs/IDArray.h>
+#include <opt_msgs/NameArray.h>
+#include <opt_msgs/SkeletonTrackArray.h>
+#include <opt_msgs/StandardSkeletonTrackArray.h>
+#include <opt_msgs/PoseRecognitionArray.h>
+#include <body_pose_estimation/skeleton_base.h>
+#include <message_filters/subscriber.h>
+#include <message_filters/time_synchronizer.h>
+#include <open_ptrack/opt_utils/udp_messaging.h>
+#include <open_ptrack/opt_utils/json.h>
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+using namespace open_ptrack::bpe;
+
+namespace open_ptrack
+{
+namespace opt_utils
+{
+
+/**
+ * \brief ROS2UDPConverterNodelet sends tracks and alive IDs as JSON messages over UDP
+ *
+ * Loaded in the nodelet manager of the tracker, it receives the tracks as shared pointers, without serialization.
+ * The ros2udp_converter node (ros2udp_converter.cpp) loads it in its own process.
+ */
+class ROS2UDPConverterNodelet : public nodelet::Nodelet
+{
+public:
+
+  ROS2UDPConverterNodelet();
+
+  virtual ~ROS2UDPConverterNodelet();
+
+  virtual void
+  onInit();
+
+private:
+
+  void
+  trackingCallback(const opt_msgs::TrackArray::ConstPtr& tracking_msg);
+
+  void
+  peopleTracksCallback(const opt_msgs::TrackArray::ConstPtr& association_message);
+
+  void
+  peoplenamesCallback(const opt_msgs::NameArray::ConstPtr& association_message);
+
+  void
+  aliveIDsCallback(const opt_msgs::IDArray::ConstPtr& alive_ids_msg);
+
+  int facetracksflag;
+  int udp_buffer_length;  // UDP message buffer length
+  int udp_port;           // UDP port
+  std::string hostip;     // UDP host
+  int json_indent_size;   // indent size for JSON message
+  bool json_newline;      // use newlines (true) or not (false) in JSON messages
+  bool json_spacing;      // use spacing (true) or not (false) in JSON messages
+  bool json_use_tabs;     // use tabs (true) or not (false) in JSON messages
+  struct ComData udp_data;  // parameters for UDP messaging
+  open_ptrack::opt_utils::UDPMessaging udp_messaging;   // instance of class UDPMessaging
+  ros::Time last_heartbeat_time;
+  double heartbeat_interval;
+
+  std::map<int, std::string> namePairs;
+
+  ros::Subscriber tracking_sub;
+  ros::Subscriber alive_ids_sub;
+  ros::Subscriber people_tracks_sub;
+  ros::Subscriber people_names_sub;
+};
+
+void
+ROS2UDPConverterNodelet::trackingCallback(const opt_msgs::TrackArray::ConstPtr& tracking_msg)
+{
+  if (facetracksflag == 1)
+  {
+    return;
+  }
+  /// Create JSON-formatted message:
+  Jzon::Object root, header, stamp;
+
+  /// Add header (84 characters):
+  header.Add("seq", int(tracking_msg->header.seq));
+  stamp.Add("sec", int(tracking_msg->header.stamp.sec));
+  stamp.Add("nsec", int(tracking_msg->header.stamp.nsec));
+  header.Add("stamp", stamp);
+  std::string camera_name = tracking_msg->header.frame_id;
+    if (strcmp(camera_name.substr(0,1).c_str(), "/") == 0)  // Remove bar at the beginning
+    {
+      camera_name = camera_name.substr(1, camera_name.size() - 1);
+    }
+  header.Add("frame_id", camera_name);
+  root.Add("header", header);
+
+  /// Add tracks array:
+  // >50 characters for every track
+  Jzon::Array tracks;
+  for (unsigned int i = 0; i < tracking_msg->tracks.size(); i++)
+  {
+    Jzon::Object current_track;
+    current_track.Add("id", tracking_msg->tracks[i].id);
+    current_track.Add("x", tracking_msg->tracks[i].x);
+    current_track.Add("y", tracking_msg->tracks[i].y);
+    current_track.Add("height", tracking_msg->tracks[i].height);
+    current_track.Add("age", tracking_msg->tracks[i].age);
+    current_track.Add("confidence", tracking_msg->tracks[i].confidence);
+
+    tracks.Add(current_track);
+  }
+  root.Add("people_tracks", tracks);
+
+  /// Convert JSON object to string:
+  Jzon::Format message_format = Jzon::StandardFormat;
+  message_format.indentSize = json_indent_size;
+  message_format.newline = json_newline;
+  message_format.spacing = json_spacing;
+  message_format.useTabs = json_use_tabs;
+  Jzon::Writer writer(root, message_format);
+  writer.Write();
+  std::string json_string = writer.GetResult();
+  //  std::cout << "String sent: " << json_string << std::endl;
+
+  /// Copy string to message buffer:
+  udp_data.si_num_byte_ = json_string.length()+1;
+  char buf[udp_data.si_num_byte_];
+  for (unsigned int i = 0; i < udp_data.si_num_byte_; i++)
+  {
+    buf[i] = 0;
+  }
+  sprintf(buf, "%s", json_string.c_str());
+  udp_data.pc_pck_ = buf;         // buffer where the message is written
+
+  /// Send message:
+  udp_messaging.sendFromSocketUDP(&udp_data);
+}
+
+
+void
+ROS2UDPConverterNodelet::peopleTracksCallback(const opt_msgs::TrackArray::ConstPtr& association_message)
+{
+  Jzon::Array tracks;
+  if (association_message->tracks.size() != 0){
+    facetracksflag = 1;
+  }
+
+  if (facetracksflag==0){
+    return;
+  }
+  
+  
+  Jzon::Object root, header, stamp;
+
+  /// Add header (84 characters):
+  header.Add("seq", int(association_message->header.seq));
+  stamp.Add("sec", int(association_message->header.stamp.sec));
+  stamp.Add("nsec", int(association_message->header.stamp.nsec));
+  header.Add("stamp", stamp);
+  std::string camera_name = association_message->header.frame_id;
+    if (strcmp(camera_name.substr(0,1).c_str(), "/") == 0)  // Remove bar at the beginning
+    {
+      camera_name = camera_name.substr(1, camera_name.size() - 1);
+    }
+  header.Add("frame_id", camera_name);
+  root.Add("header", header);
+
+  /// Add tracks array:
+  // >50 characters for every track
+  for (unsigned int i = 0; i < association_message->tracks.size(); i++)
+  {
+    Jzon::Object current_track;
+    current_track.Add("id", association_message->tracks[i].id);
+    current_track.Add("x", association_message->tracks[i].x);
+    current_track.Add("y", association_message->tracks[i].y);
+    current_track.Add("height", association_message->tracks[i].height);
+    current_track.Add("age", association_message->tracks[i].age);
+    current_track.Add("confidence", association_message->tracks[i].confidence);
+    current_track.Add("stable_id", association_message->tracks[i].stable_id);
+    
+    if (namePairs.count(association_message->tracks[i].stable_id)) {
+      current_track.Add("face_name", namePairs.at(association_message->tracks[i].stable_id));
+    }
+
+    tracks.Add(current_track);
+  }
+  root.Add("people_tracks", tracks);
+
+  /// Convert JSON object to string:
+  Jzon::Format message_format = Jzon::StandardFormat;
+  message_format.indentSize = json_indent_size;
+  message_format.newline = json_newline;
+  message_format.spacing = json_spacing;
+  message_format.useTabs = json_use_tabs;
+  Jzon::Writer writer(root, message_format);
+  writer.Write();
+  std::string json_string = writer.GetResult();
+  //  std::cout << "String sent: " << json_string << std::endl;
+
+  /// Copy string to message buffer:
+  udp_data.si_num_byte_ = json_string.length()+1;
+  char buf[udp_data.si_num_byte_];
+  for (unsigned int i = 0; i < udp_data.si_num_byte_; i++)
+  {
+    buf[i] = 0;
+  }
+  sprintf(buf, "%s", json_string.c_str());
+  udp_data.pc_pck_ = buf;         // buffer where the message is written
+
+  /// Send message:
+  udp_messaging.sendFromSocketUDP(&udp_data);
+}
+
+
+void
+ROS2UDPConverterNodelet::peoplenamesCallback(const opt_msgs::NameArray::ConstPtr& association_message)
+{
+  namePairs.clear();
+
+  Jzon::Array names;
+  Jzon::Array ids;
+  for (unsigned int i = 0; i < association_message->ids.size(); i++)
+  {
+    namePairs.insert(std::make_pair(association_message->ids[i], association_message->names[i]));
+  }
+}
+
+
+void
+ROS2UDPConverterNodelet::aliveIDsCallback(const opt_msgs::IDArray::ConstPtr& alive_ids_msg)
+{
+  ros::Time msg_time = ros::Time(alive_ids_msg->header.stamp.sec, alive_ids_msg->header.stamp.nsec);
+  if ((msg_time - last_heartbeat_time).toSec() > heartbeat_interval)
+  {
+    /// Create JSON-formatted message:
+    Jzon::Object root, header, stamp;
+
+    /// Add header:
+    header.Add("seq", int(alive_ids_msg->header.seq));
+    stamp.Add("sec", int(alive_ids_msg->header.stamp.sec));
+    stamp.Add("nsec", int(alive_ids_msg->header.stamp.nsec));
+    header.Add("stamp", stamp);
+    header.Add("frame_id", "heartbeat");
+    root.Add("header", header);
+
+    Jzon::Array alive_IDs;
+    for (unsigned int i = 0; i < alive_ids_msg->ids.size(); i++)
+    {
+      alive_IDs.Add(alive_ids_msg->ids[i]);
+    }
+    root.Add("alive_IDs", alive_IDs);
+    root.Add("max_ID", alive_ids_msg->max_ID);
+
+    /// Convert JSON object to string:
+    Jzon::Format message_format = Jzon::StandardFormat;
+    message_format.indentSize = json_indent_size;
+    message_format.newline = json_newline;
+    message_format.spacing = json_spacing;
+    message_format.useTabs = json_use_tabs;
+    Jzon::Writer writer(root, message_format);
+    writer.Write();
+    std::string json_string = writer.GetResult();
+    //  std::cout << "String sent: " << json_string << std::endl;
+
+    /// Copy string to message buffer:
+    udp_data.si_num_byte_ = json_string.length()+1;
+    char buf[udp_data.si_num_byte_];
+    for (unsigned int i = 0; i < udp_data.si_num_byte_; i++)
+    {
+      buf[i] = 0;
+    }
+    sprintf(buf, "%s", json_string.c_str());
+    udp_data.pc_pck_ = buf;         // buffer where the message is written
+
+    /// Send message:
+    udp_messaging.sendFromSocketUDP(&udp_data);
+
+    last_heartbeat_time = msg_time;
+  }
+}
+
+typedef unsigned long uint32;
+// convert a string represenation of an IP address into its numeric equivalent
+static uint32 Inet_AtoN(const char * buf)
+{
+
+  uint32 ret = 0;
+  int shift = 24;  // fill out the MSB first
+  bool startQuad = true;
+  while((shift >= 0)&&(*buf))
+  {
+    if (startQuad)
+    {
+      unsigned char quad = (unsigned char) atoi(buf);
+      ret |= (((uint32)quad) << shift);
+      shift -= 8;
+    }
+    startQuad = (*buf == '.');
+    buf++;
+  }
+  return ret;
+}
+
+ROS2UDPConverterNodelet::ROS2UDPConverterNodelet() :
+  facetracksflag(0),
+  udp_messaging(udp_data)
+{
+  udp_data.si_socket_ = -1;
+}
+
+ROS2UDPConverterNodelet::~ROS2UDPConverterNodelet()
+{
+  // Close socket:
+  if (udp_data.si_socket_ >= 0)
+    udp_messaging.closeSocketUDP(&udp_data);
+}
+
+void
+ROS2UDPConverterNodelet::onInit()
+{
+  ros::NodeHandle& nh = getPrivateNodeHandle();
+
+  // Read input parameters:
+  nh.param("udp/port", udp_port, 21234);
+  nh.param("udp/hostip", hostip, std::string("127.0.0.1"));
+  nh.param("udp/buffer_length", udp_buffer_length, 2048);
+  nh.param("json/indent_size", json_indent_size, 0);
+  nh.param("json/newline", json_newline, false);
+  nh.param("json/spacing", json_spacing, false);
+  nh.param("json/use_tabs", json_use_tabs, false);
+  nh.param("json/heartbeat_interval", heartbeat_interval, 0.25);
+
+  // Initialize UDP parameters:
+  char buf[0];
+  udp_data.si_port_ = udp_port;      // port
+  udp_data.si_retry_ = 1;
+  udp_data.si_num_byte_ = udp_buffer_length; // number of bytes to write (2048 -> about 30 tracks)
+  udp_data.pc_pck_ = buf;         // buffer where the message is written
+  udp_data.si_timeout_ = 4;
+  udp_data.sj_addr_ = Inet_AtoN(hostip.c_str());
+
+  /// Create object for UDP messaging:
+  udp_messaging = open_ptrack::opt_utils::UDPMessaging(udp_data);
+
+  /// Create client socket:
+  udp_messaging.createSocketClientUDP(&udp_data);
+
+  // ROS subscriber (callbacks are executed by the nodelet manager):
+  tracking_sub = nh.subscribe<opt_msgs::TrackArray>
+      ("input_topic", 1, &ROS2UDPConverterNodelet::trackingCallback, this);
+  alive_ids_sub = nh.subscribe<opt_msgs::IDArray>
+      ("alive_ids_topic", 1, &ROS2UDPConverterNodelet::aliveIDsCallback, this);
+  people_tracks_sub = nh.subscribe<opt_msgs::TrackArray>("people_tracks_topic", 1,
+      &ROS2UDPConverterNodelet::peopleTracksCallback, this);
+  people_names_sub = nh.subscribe<opt_msgs::NameArray>("people_names_topic", 1,
+      &ROS2UDPConverterNodelet::peoplenamesCallback, this);
+}
+
+} // namespace opt_utils
+} // namespace open_ptrack
+
+PLUGINLIB_EXPORT_CLASS(open_ptrack::opt_utils::ROS2UDPConverterNodelet, nodelet::Nodelet)
\ No newline at end of file
@@ -0,0 +1,281 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_LATENCY_PROFILER_H_
+#define OPEN_PTRACK_OPT_UTILS_LATENCY_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief Latency statistics of a histogram over a reporting interval (times in microseconds) */
+    struct LatencyStatistics
+    {
+      std::string name;
+      uint64_t count;
+      double mean;
+      double p50;
+      double p90;
+      double p99;
+      double max;
+    };
+
+    /** \brief LatencyHistogram aggregates durations in logarithmic buckets without locks
+     *
+     *  Every power of two of nanoseconds is split in SUB_BUCKETS buckets, so that percentiles are exact
+     *  up to 1 / (2 * SUB_BUCKETS) of their value. record() is a few relaxed atomic increments and can be
+     *  called concurrently by any number of threads.
+     **/
+    class LatencyHistogram
+    {
+      public:
+
+        /** \brief Buckets per power of two (as a power of two). */
+        static const int SUB_BUCKET_BITS = 3;
+
+        /** \brief Buckets per power of two. */
+        static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+
+        /** \brief Number of buckets, enough for any 64 bit duration. */
+        static const int BUCKETS = SUB_BUCKETS * (64 - SUB_BUCKET_BITS + 1);
+
+        /** \brief Constructor. */
+        LatencyHistogram();
+
+        /**
+         * \brief Add a duration to the histogram.
+         *
+         * \param[in] nanoseconds Duration (in nanoseconds).
+         */
+        void
+        record(uint64_t nanoseconds)
+        {
+          counts_[getBucket(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+          sum_.fetch_add(nanoseconds, std::memory_order_relaxed);
+          uint64_t max = max_.load(std::memory_order_relaxed);
+          while ((nanoseconds > max) and not max_.compare_exchange_weak(max, nanoseconds, std::memory_order_relaxed))
+          {
+          }
+        }
+
+        /**
+         * \brief Read the histogram.
+         *
+         * \param[out] counts Number of durations of every bucket, since the construction.
+         * \param[out] sum Sum of the durations since the construction (in nanoseconds).
+         * \param[out] max Maximum duration since the previous read (in nanoseconds).
+         */
+        void
+        read(std::vector<uint64_t>& counts, uint64_t& sum, uint64_t& max);
+
+        /**
+         * \brief Get the bucket of a duration.
+         *
+         * \param[in] nanoseconds Duration (in nanoseconds).
+         *
+         * \return the bucket index.
+         */
+        static int
+        getBucket(uint64_t nanoseconds)
+        {
+          if (nanoseconds < SUB_BUCKETS)
+            return int(nanoseconds);
+          int exponent = 63 - __builtin_clzll(nanoseconds);
+          int sub_bucket = int(nanoseconds >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+          return SUB_BUCKETS * (exponent - SUB_BUCKET_BITS + 1) + sub_bucket;
+        }
+
+        /**
+         * \brief Get the smallest duration of a bucket.
+         *
+         * \param[in] bucket Bucket index.
+         *
+         * \return the duration (in nanoseconds).
+         */
+        static uint64_t
+        getBucketLowerBound(int bucket);
+
+        /**
+         * \brief Get the range of durations of a bucket.
+         *
+         * \param[in] bucket Bucket index.
+         *
+         * \return the width of the bucket (in nanoseconds).
+         */
+        static uint64_t
+        getBucketWidth(int bucket);
+
+      private:
+
+        LatencyHistogram(const LatencyHistogram&);
+        LatencyHistogram& operator=(const LatencyHistogram&);
+
+        /** \brief Number of durations of every bucket. */
+        std::atomic<uint64_t> counts_[BUCKETS];
+
+        /** \brief Sum of the durations (in nanoseconds). */
+        std::atomic<uint64_t> sum_;
+
+        /** \brief Maximum duration since the last read (in nanoseconds). */
+        std::atomic<uint64_t> max_;
+    };
+
+    /** \brief LatencyProfiler owns the named latency histograms of a process
+     *
+     *  Histograms are created once (usually at start-up) with getHistogram(), and then updated from the hot path
+     *  through ScopedLatencyTimer, without locks. When the profiler is disabled, getHistogram() returns NULL and
+     *  timers do not even read the clock.
+     **/
+    class LatencyProfiler
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] enabled If false, no histogram is created and nothing is measured.
+         */
+        explicit LatencyProfiler(bool enabled = true);
+
+        /** \brief Destructor. */
+        virtual ~LatencyProfiler();
+
+        /**
+         * \brief Check if the profiler is enabled.
+         *
+         * \return true if durations are measured.
+         */
+        bool
+        isEnabled() const;
+
+        /**
+         * \brief Get the histogram with a name, creating it the first time.
+         *
+         * \param[in] name Histogram name (e.g. "tracker/distance_matrix").
+         *
+         * \return a pointer valid for the whole life of the profiler, or NULL if the profiler is disabled.
+         */
+        LatencyHistogram*
+        getHistogram(const std::string& name);
+
+        /**
+         * \brief Compute the statistics of all histograms over the durations recorded since the previous call.
+         *
+         * \param[out] statistics Statistics of every histogram, in order of creation.
+         */
+        void
+        getStatistics(std::vector<LatencyStatistics>& statistics);
+
+      private:
+
+        LatencyProfiler(const LatencyProfiler&);
+        LatencyProfiler& operator=(const LatencyProfiler&);
+
+        struct Entry
+        {
+          std::string name;
+          LatencyHistogram histogram;
+          std::vector<uint64_t> previous_counts;
+          uint64_t previous_sum;
+        };
+
+        /** \brief If false, nothing is measured. */
+        bool enabled_;
+
+        /** \brief Histograms (entries are never moved, so that histogram pointers stay valid). */
+        std::vector<Entry*> entries_;
+
+        /** \brief Mutex protecting entries_ (not taken by record()). */
+        std::mutex mutex_;
+    };
+
+    /** \brief ScopedLatencyTimer records the time from its construction to its destruction (or to stop()) */
+    class ScopedLatencyTimer
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] histogram Histogram to update (if NULL, the timer does nothing).
+         */
+        explicit ScopedLatencyTimer(LatencyHistogram* histogram) :
+          histogram_(histogram)
+        {
+          if (histogram_ != NULL)
+            start_ = std::chrono::steady_clock::now();
+        }
+
+        /** \brief Destructor. */
+        ~ScopedLatencyTimer()
+        {
+          stop();
+        }
+
+        /** \brief Record the elapsed time now (only the first call has effect). */
+        void
+        stop()
+        {
+          if (histogram_ != NULL)
+          {
+            histogram_->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start_).count());
+            histogram_ = NULL;
+          }
+        }
+
+      private:
+
+        ScopedLatencyTimer(const ScopedLatencyTimer&);
+        ScopedLatencyTimer& operator=(const ScopedLatencyTimer&);
+
+        /** \brief Histogram to update (NULL if disabled or already stopped). */
+        LatencyHistogram* histogram_;
+
+        /** \brief Start time. */
+        std::chrono::steady_clock::time_point start_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_LATENCY_PROFILER_H_ */
@@ -0,0 +1,108 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_LATENCY_REPORTER_H_
+#define OPEN_PTRACK_OPT_UTILS_LATENCY_REPORTER_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include <open_ptrack/opt_utils/latency_profiler.h>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief LatencyReporter periodically publishes the statistics of a LatencyProfiler
+     *
+     *  Every histogram becomes a diagnostic_msgs/DiagnosticStatus of the /diagnostics topic, with the count, the mean
+     *  and the percentiles of the durations recorded in the last period. If a file name is given, the same
+     *  statistics are also appended to it as text lines.
+     **/
+    class LatencyReporter
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] nh Node handle used for the publisher and the timer.
+         * \param[in] profiler Profiler to report (it must outlive the reporter).
+         * \param[in] name Name of the reporting node, prepended to the histogram names.
+         * \param[in] period Reporting period (in seconds).
+         * \param[in] file_name File where statistics are appended (none if empty).
+         */
+        LatencyReporter(ros::NodeHandle& nh, LatencyProfiler& profiler, const std::string& name, double period,
+            const std::string& file_name = "");
+
+        /** \brief Destructor (reports the last period). */
+        virtual ~LatencyReporter();
+
+        /** \brief Publish (and write) the statistics of the durations recorded since the previous report. */
+        void
+        report();
+
+      private:
+
+        LatencyReporter(const LatencyReporter&);
+        LatencyReporter& operator=(const LatencyReporter&);
+
+        /** \brief Timer callback. */
+        void
+        timerCallback(const ros::WallTimerEvent& event);
+
+        /** \brief Profiler to report. */
+        LatencyProfiler& profiler_;
+
+        /** \brief Name of the reporting node. */
+        std::string name_;
+
+        /** \brief Diagnostics publisher. */
+        ros::Publisher diagnostics_pub_;
+
+        /** \brief Reporting timer. */
+        ros::WallTimer timer_;
+
+        /** \brief Statistics file (if open). */
+        std::ofstream file_;
+
+        /** \brief Statistics of the last report. */
+        std::vector<LatencyStatistics> statistics_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_LATENCY_REPORTER_H_ */
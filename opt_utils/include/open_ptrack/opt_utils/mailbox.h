@@ -0,0 +1,153 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * mailbox.h
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_MAILBOX_H_
+#define OPEN_PTRACK_OPT_UTILS_MAILBOX_H_
+
+#include <atomic>
+#include <cstddef>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief Mailbox is a lock-free single-slot hand-off of messages between threads, the latest message wins
+     *
+     *  put() replaces the message which has not been taken yet, and counts it as dropped. take() empties the slot.
+     *  Messages are meant to be shared pointers (e.g. the ConstPtr of a ROS callback), so that nothing is copied.
+     **/
+    template <class T>
+    class Mailbox
+    {
+      public:
+
+        /** \brief Constructor. */
+        Mailbox() :
+          slot_(NULL), dropped_(0)
+        {
+
+        }
+
+        /** \brief Destructor. */
+        ~Mailbox()
+        {
+          delete slot_.exchange(NULL);
+        }
+
+        /**
+         * \brief Put a message in the slot, replacing the one which has not been taken yet.
+         *
+         * \param[in] message The message.
+         */
+        void
+        put(const T& message)
+        {
+          Slot* previous = slot_.exchange(new Slot(message), std::memory_order_acq_rel);
+          if (previous != NULL)
+          {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            delete previous;
+          }
+        }
+
+        /**
+         * \brief Take the message in the slot, if any.
+         *
+         * \param[out] message The message.
+         *
+         * \return false if the slot is empty (and message is not changed).
+         */
+        bool
+        take(T& message)
+        {
+          Slot* slot = slot_.exchange(NULL, std::memory_order_acq_rel);
+          if (slot == NULL)
+            return false;
+
+          message = slot->message;
+          delete slot;
+          return true;
+        }
+
+        /**
+         * \brief Check if the slot is empty.
+         *
+         * \return true if there is no message to take (a message may be put right after).
+         */
+        bool
+        empty() const
+        {
+          return slot_.load(std::memory_order_acquire) == NULL;
+        }
+
+        /**
+         * \brief Get the number of messages dropped since the last call, and reset it.
+         *
+         * \return the number of messages replaced before being taken.
+         */
+        unsigned long
+        takeDropped()
+        {
+          return dropped_.exchange(0, std::memory_order_relaxed);
+        }
+
+      private:
+
+        Mailbox(const Mailbox&);
+        Mailbox& operator=(const Mailbox&);
+
+        /** \brief Message in the slot (allocated by put(), so that the slot is swapped with a single exchange). */
+        struct Slot
+        {
+          explicit Slot(const T& message) :
+            message(message)
+          {
+
+          }
+
+          T message;
+        };
+
+        /** \brief The slot (NULL if empty). */
+        std::atomic<Slot*> slot_;
+
+        /** \brief Messages dropped since the last takeDropped(). */
+        std::atomic<unsigned long> dropped_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_MAILBOX_H_ */
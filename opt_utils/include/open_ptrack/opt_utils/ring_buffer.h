@@ -0,0 +1,213 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_RING_BUFFER_H_
+#define OPEN_PTRACK_OPT_UTILS_RING_BUFFER_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief RingBuffer is a fixed-capacity sequence (it allocates memory only when its capacity is set)
+     *
+     *  Elements are indexed from the oldest (0) to the newest (size() - 1). When the buffer is full,
+     *  adding an element discards the oldest one.
+     **/
+    template <class T>
+    class RingBuffer
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] capacity Maximum number of elements (at least 1).
+         */
+        explicit RingBuffer(size_t capacity = 1) :
+          elements_(capacity > 0 ? capacity : 1), begin_(0), size_(0)
+        {
+
+        }
+
+        /**
+         * \brief Set the maximum number of elements (the elements are removed if the capacity changes).
+         *
+         * \param[in] capacity Maximum number of elements (at least 1).
+         */
+        void
+        setCapacity(size_t capacity)
+        {
+          if (capacity < 1)
+            capacity = 1;
+          if (capacity != elements_.size())
+            std::vector<T>(capacity).swap(elements_);
+          clear();
+        }
+
+        /** \brief Remove all elements. */
+        void
+        clear()
+        {
+          begin_ = size_ = 0;
+        }
+
+        /**
+         * \brief Get the number of elements.
+         *
+         * \return the number of elements.
+         */
+        size_t
+        size() const
+        {
+          return size_;
+        }
+
+        /**
+         * \brief Get the maximum number of elements.
+         *
+         * \return the capacity.
+         */
+        size_t
+        capacity() const
+        {
+          return elements_.size();
+        }
+
+        /** \brief Return true if there are no elements. */
+        bool
+        empty() const
+        {
+          return size_ == 0;
+        }
+
+        /** \brief Return true if adding an element would discard the oldest one. */
+        bool
+        full() const
+        {
+          return size_ == elements_.size();
+        }
+
+        /** \brief Access an element (0 is the oldest). */
+        T&
+        operator[](size_t index)
+        {
+          return elements_[(begin_ + index) % elements_.size()];
+        }
+
+        /** \brief Access an element (0 is the oldest). */
+        const T&
+        operator[](size_t index) const
+        {
+          return elements_[(begin_ + index) % elements_.size()];
+        }
+
+        /** \brief Access the oldest element. */
+        T&
+        front()
+        {
+          return (*this)[0];
+        }
+
+        /** \brief Access the newest element. */
+        T&
+        back()
+        {
+          return (*this)[size_ - 1];
+        }
+
+        /**
+         * \brief Add an element after the newest one (the oldest one is discarded if the buffer is full).
+         *
+         * \param[in] element The element.
+         */
+        void
+        push_back(const T& element)
+        {
+          if (full())
+            pop_front();
+          elements_[(begin_ + size_) % elements_.size()] = element;
+          size_++;
+        }
+
+        /** \brief Remove the oldest element. */
+        void
+        pop_front()
+        {
+          begin_ = (begin_ + 1) % elements_.size();
+          size_--;
+        }
+
+        /**
+         * \brief Insert an element before position index, shifting newer elements
+         * (the oldest element is discarded if the buffer is full).
+         *
+         * \param[in] index Position of the new element (between 1 and size() if the buffer is full).
+         * \param[in] element The element.
+         *
+         * \return the position of the new element.
+         */
+        size_t
+        insert(size_t index, const T& element)
+        {
+          if (full())
+          {
+            pop_front();
+            index--;
+          }
+          size_++;
+          for(size_t i = size_ - 1; i > index; i--)
+            (*this)[i] = (*this)[i - 1];
+          (*this)[index] = element;
+          return index;
+        }
+
+      private:
+
+        /** \brief Storage. */
+        std::vector<T> elements_;
+
+        /** \brief Position of the oldest element in the storage. */
+        size_t begin_;
+
+        /** \brief Number of elements. */
+        size_t size_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_RING_BUFFER_H_ */
@@ -0,0 +1,172 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_SPSC_QUEUE_H_
+#define OPEN_PTRACK_OPT_UTILS_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief SpscQueue is a bounded lock-free queue between one producer thread and one consumer thread
+     *
+     *  push() is called only by the producer, front() and pop() only by the consumer. Memory is allocated
+     *  once by the constructor, and push() fails instead of blocking when the queue is full.
+     **/
+    template <class T>
+    class SpscQueue
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] capacity Maximum number of queued elements.
+         */
+        explicit SpscQueue(size_t capacity) :
+          elements_(capacity + 1), head_(0), tail_(0)
+        {
+
+        }
+
+        /**
+         * \brief Add an element at the end of the queue (producer only).
+         *
+         * \param[in] element The element.
+         *
+         * \return false if the queue is full (and the element is not added).
+         */
+        bool
+        push(const T& element)
+        {
+          size_t tail = tail_.load(std::memory_order_relaxed);
+          size_t next = increment(tail);
+          if (next == head_.load(std::memory_order_acquire))
+            return false;
+
+          elements_[tail] = element;
+          tail_.store(next, std::memory_order_release);
+          return true;
+        }
+
+        /**
+         * \brief Get the first element of the queue without removing it (consumer only).
+         *
+         * \return a pointer to the element (NULL if the queue is empty).
+         */
+        T*
+        front()
+        {
+          size_t head = head_.load(std::memory_order_relaxed);
+          if (head == tail_.load(std::memory_order_acquire))
+            return NULL;
+          return &elements_[head];
+        }
+
+        /**
+         * \brief Remove the first element of the queue (consumer only).
+         *
+         * \param[out] element The element.
+         *
+         * \return false if the queue is empty.
+         */
+        bool
+        pop(T& element)
+        {
+          size_t head = head_.load(std::memory_order_relaxed);
+          if (head == tail_.load(std::memory_order_acquire))
+            return false;
+
+          element = elements_[head];
+          // Release the resources held by the slot (e.g. shared pointers) before the producer reuses it:
+          elements_[head] = T();
+          head_.store(increment(head), std::memory_order_release);
+          return true;
+        }
+
+        /**
+         * \brief Check if the queue is empty (exact only if called by the consumer).
+         *
+         * \return true if the queue is empty.
+         */
+        bool
+        empty() const
+        {
+          return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+        }
+
+        /**
+         * \brief Get the maximum number of queued elements.
+         *
+         * \return the capacity.
+         */
+        size_t
+        capacity() const
+        {
+          return elements_.size() - 1;
+        }
+
+      private:
+
+        SpscQueue(const SpscQueue&);
+        SpscQueue& operator=(const SpscQueue&);
+
+        /** \brief Index following i in the circular storage. */
+        size_t
+        increment(size_t i) const
+        {
+          return (i + 1 == elements_.size()) ? 0 : i + 1;
+        }
+
+        /** \brief Circular storage (one slot is always empty, for telling a full queue from an empty one). */
+        std::vector<T> elements_;
+
+        /** \brief Index of the first element (written by the consumer). */
+        std::atomic<size_t> head_;
+
+        /** \brief Padding, so that producer and consumer do not write to the same cache line. */
+        char padding_[64];
+
+        /** \brief Index following the last element (written by the producer). */
+        std::atomic<size_t> tail_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_SPSC_QUEUE_H_ */
@@ -0,0 +1,165 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_THREAD_POOL_H_
+#define OPEN_PTRACK_OPT_UTILS_THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief ThreadPool runs tasks on a fixed set of worker threads */
+    class ThreadPool
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] threads Number of worker threads (0 means one per hardware core).
+         */
+        explicit ThreadPool(unsigned int threads = 0) :
+          pending_(0), stop_(false)
+        {
+          if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+          for (unsigned int i = 0; i < threads; i++)
+            workers_.push_back(std::thread(&ThreadPool::workerLoop, this));
+        }
+
+        /** \brief Destructor (waits for queued tasks, then joins the workers). */
+        ~ThreadPool()
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+          }
+          task_available_.notify_all();
+          for (size_t i = 0; i < workers_.size(); i++)
+            workers_[i].join();
+        }
+
+        /**
+         * \brief Queue a task for execution.
+         *
+         * \param[in] task The task.
+         */
+        void
+        enqueue(const std::function<void()>& task)
+        {
+          {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks_.push_back(task);
+            pending_++;
+          }
+          task_available_.notify_one();
+        }
+
+        /** \brief Block until every queued task has been executed. */
+        void
+        wait()
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          all_done_.wait(lock, [this]{ return pending_ == 0; });
+        }
+
+        /**
+         * \brief Get the number of worker threads.
+         *
+         * \return the number of worker threads.
+         */
+        unsigned int
+        size() const
+        {
+          return workers_.size();
+        }
+
+      private:
+
+        ThreadPool(const ThreadPool&);
+        ThreadPool& operator=(const ThreadPool&);
+
+        /** \brief Main loop of every worker thread. */
+        void
+        workerLoop()
+        {
+          while (true)
+          {
+            std::function<void()> task;
+            {
+              std::unique_lock<std::mutex> lock(mutex_);
+              task_available_.wait(lock, [this]{ return stop_ || !tasks_.empty(); });
+              if (tasks_.empty())
+                return;
+              task = tasks_.front();
+              tasks_.pop_front();
+            }
+
+            task();
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+              all_done_.notify_all();
+          }
+        }
+
+        /** \brief Worker threads. */
+        std::vector<std::thread> workers_;
+
+        /** \brief Tasks waiting for a worker. */
+        std::deque<std::function<void()> > tasks_;
+
+        /** \brief Number of tasks queued or running. */
+        size_t pending_;
+
+        /** \brief If true, workers exit as soon as the queue is empty. */
+        bool stop_;
+
+        std::mutex mutex_;
+        std::condition_variable task_available_;
+        std::condition_variable all_done_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_THREAD_POOL_H_ */
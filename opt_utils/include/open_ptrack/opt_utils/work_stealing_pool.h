@@ -0,0 +1,212 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_OPT_UTILS_WORK_STEALING_POOL_H_
+#define OPEN_PTRACK_OPT_UTILS_WORK_STEALING_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    /** \brief WorkStealingPool runs tasks on a fixed set of worker threads, each with its own queue
+     *
+     *  A task is queued to a given worker, so that related tasks (e.g. the frames of a camera) tend to run on the same
+     *  core and find its caches warm. A worker runs its own tasks in order and, when it has none, steals the newest task
+     *  of another worker, so that no core stays idle while tasks are waiting.
+     **/
+    class WorkStealingPool
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] threads Number of worker threads (0 means one per hardware core).
+         */
+        explicit WorkStealingPool(unsigned int threads = 0) :
+          queued_(0), stop_(false)
+        {
+          if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+          for (unsigned int i = 0; i < threads; i++)
+            queues_.push_back(std::unique_ptr<Queue>(new Queue));
+          for (unsigned int i = 0; i < threads; i++)
+            workers_.push_back(std::thread(&WorkStealingPool::workerLoop, this, i));
+        }
+
+        /** \brief Destructor (waits for queued tasks, then joins the workers). */
+        ~WorkStealingPool()
+        {
+          {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stop_ = true;
+          }
+          task_available_.notify_all();
+          for (size_t i = 0; i < workers_.size(); i++)
+            workers_[i].join();
+        }
+
+        /**
+         * \brief Queue a task for execution.
+         *
+         * \param[in] task The task.
+         * \param[in] worker Index of the worker which should run it (modulo the number of workers).
+         */
+        void
+        enqueue(const std::function<void()>& task, unsigned int worker)
+        {
+          Queue& queue = *queues_[worker % queues_.size()];
+          queued_.fetch_add(1);
+          {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(task);
+          }
+
+          // Taking the lock orders the notification after the check of a worker going to sleep:
+          {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+          }
+          task_available_.notify_one();
+        }
+
+        /**
+         * \brief Get the number of worker threads.
+         *
+         * \return the number of worker threads.
+         */
+        unsigned int
+        size() const
+        {
+          return workers_.size();
+        }
+
+      private:
+
+        WorkStealingPool(const WorkStealingPool&);
+        WorkStealingPool& operator=(const WorkStealingPool&);
+
+        /** \brief Tasks queued to a worker */
+        struct Queue
+        {
+          std::mutex mutex;
+          std::deque<std::function<void()> > tasks;
+        };
+
+        /**
+         * \brief Take the oldest task of a worker, or else the newest task of another worker.
+         *
+         * \param[in] worker Index of the worker.
+         * \param[out] task The task.
+         *
+         * \return false if every queue is empty.
+         */
+        bool
+        pop(unsigned int worker, std::function<void()>& task)
+        {
+          for (unsigned int i = 0; i < queues_.size(); i++)
+          {
+            const bool own = (i == 0);
+            Queue& queue = *queues_[(worker + i) % queues_.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.tasks.empty())
+              continue;
+
+            if (own)
+            {
+              task = queue.tasks.front();
+              queue.tasks.pop_front();
+            }
+            else
+            {
+              task = queue.tasks.back();
+              queue.tasks.pop_back();
+            }
+            queued_.fetch_sub(1);
+            return true;
+          }
+          return false;
+        }
+
+        /** \brief Main loop of a worker thread. */
+        void
+        workerLoop(unsigned int worker)
+        {
+          while (true)
+          {
+            std::function<void()> task;
+            if (pop(worker, task))
+            {
+              task();
+              continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            if (queued_.load() > 0)
+              continue;
+            if (stop_)
+              return;
+            task_available_.wait(lock);
+          }
+        }
+
+        /** \brief Worker threads. */
+        std::vector<std::thread> workers_;
+
+        /** \brief Tasks of every worker. */
+        std::vector<std::unique_ptr<Queue> > queues_;
+
+        /** \brief Number of tasks queued (not running yet), counted before they are in a queue. */
+        std::atomic<size_t> queued_;
+
+        /** \brief If true, workers exit as soon as every queue is empty. */
+        bool stop_;
+
+        std::mutex sleep_mutex_;
+        std::condition_variable task_available_;
+    };
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_OPT_UTILS_WORK_STEALING_POOL_H_ */
@@ -0,0 +1,172 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <open_ptrack/opt_utils/latency_profiler.h>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    LatencyHistogram::LatencyHistogram() :
+      sum_(0), max_(0)
+    {
+      for (int i = 0; i < BUCKETS; i++)
+        counts_[i].store(0, std::memory_order_relaxed);
+    }
+
+    void
+    LatencyHistogram::read(std::vector<uint64_t>& counts, uint64_t& sum, uint64_t& max)
+    {
+      counts.resize(BUCKETS);
+      for (int i = 0; i < BUCKETS; i++)
+        counts[i] = counts_[i].load(std::memory_order_relaxed);
+      sum = sum_.load(std::memory_order_relaxed);
+      max = max_.exchange(0, std::memory_order_relaxed);
+    }
+
+    uint64_t
+    LatencyHistogram::getBucketLowerBound(int bucket)
+    {
+      if (bucket < SUB_BUCKETS)
+        return uint64_t(bucket);
+      int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+      uint64_t sub_bucket = uint64_t(bucket % SUB_BUCKETS);
+      return (uint64_t(SUB_BUCKETS) + sub_bucket) << (exponent - SUB_BUCKET_BITS);
+    }
+
+    uint64_t
+    LatencyHistogram::getBucketWidth(int bucket)
+    {
+      if (bucket < SUB_BUCKETS)
+        return 1;
+      int exponent = bucket / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+      return uint64_t(1) << (exponent - SUB_BUCKET_BITS);
+    }
+
+    LatencyProfiler::LatencyProfiler(bool enabled) :
+      enabled_(enabled)
+    {
+
+    }
+
+    LatencyProfiler::~LatencyProfiler()
+    {
+      for (size_t i = 0; i < entries_.size(); i++)
+        delete entries_[i];
+    }
+
+    bool
+    LatencyProfiler::isEnabled() const
+    {
+      return enabled_;
+    }
+
+    LatencyHistogram*
+    LatencyProfiler::getHistogram(const std::string& name)
+    {
+      if (not enabled_)
+        return NULL;
+
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (size_t i = 0; i < entries_.size(); i++)
+      {
+        if (entries_[i]->name == name)
+          return &entries_[i]->histogram;
+      }
+      Entry* entry = new Entry;
+      entry->name = name;
+      entry->previous_counts.assign(LatencyHistogram::BUCKETS, 0);
+      entry->previous_sum = 0;
+      entries_.push_back(entry);
+      return &entry->histogram;
+    }
+
+    void
+    LatencyProfiler::getStatistics(std::vector<LatencyStatistics>& statistics)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      statistics.resize(entries_.size());
+      std::vector<uint64_t> counts;
+      for (size_t i = 0; i < entries_.size(); i++)
+      {
+        Entry& entry = *entries_[i];
+        uint64_t sum, max;
+        entry.histogram.read(counts, sum, max);
+
+        // Durations recorded since the previous call:
+        uint64_t count = 0;
+        for (int b = 0; b < LatencyHistogram::BUCKETS; b++)
+        {
+          uint64_t total = counts[b];
+          counts[b] -= entry.previous_counts[b];
+          entry.previous_counts[b] = total;
+          count += counts[b];
+        }
+        double interval_sum = double(sum - entry.previous_sum);
+        entry.previous_sum = sum;
+
+        LatencyStatistics& s = statistics[i];
+        s.name = entry.name;
+        s.count = count;
+        s.mean = (count > 0) ? interval_sum / count / 1000.0 : 0.0;
+        s.max = max / 1000.0;
+
+        // Percentiles are the middle of the bucket of their rank (the maximum is exact):
+        const double percentiles[] = {0.5, 0.9, 0.99};
+        double* values[] = {&s.p50, &s.p90, &s.p99};
+        for (int p = 0; p < 3; p++)
+        {
+          *values[p] = 0.0;
+          if (count == 0)
+            continue;
+          uint64_t rank = std::max(uint64_t(1), uint64_t(percentiles[p] * count + 0.5));
+          uint64_t cumulative = 0;
+          for (int b = 0; b < LatencyHistogram::BUCKETS; b++)
+          {
+            cumulative += counts[b];
+            if (cumulative >= rank)
+            {
+              double middle = LatencyHistogram::getBucketLowerBound(b) + 0.5 * LatencyHistogram::getBucketWidth(b);
+              *values[p] = (s.max > 0.0) ? std::min(middle / 1000.0, s.max) : middle / 1000.0;
+              break;
+            }
+          }
+        }
+      }
+    }
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
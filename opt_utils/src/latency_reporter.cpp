@@ -0,0 +1,127 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <iomanip>
+#include <sstream>
+#include <diagnostic_msgs/DiagnosticArray.h>
+#include <open_ptrack/opt_utils/latency_reporter.h>
+
+namespace open_ptrack
+{
+  namespace opt_utils
+  {
+    namespace
+    {
+      diagnostic_msgs::KeyValue
+      createKeyValue(const std::string& key, double value, int precision = 1)
+      {
+        std::ostringstream stream;
+        stream << std::fixed << std::setprecision(precision) << value;
+        diagnostic_msgs::KeyValue key_value;
+        key_value.key = key;
+        key_value.value = stream.str();
+        return key_value;
+      }
+    }
+
+    LatencyReporter::LatencyReporter(ros::NodeHandle& nh, LatencyProfiler& profiler, const std::string& name,
+        double period, const std::string& file_name) :
+      profiler_(profiler), name_(name)
+    {
+      diagnostics_pub_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+      timer_ = nh.createWallTimer(ros::WallDuration(period), &LatencyReporter::timerCallback, this);
+
+      if (not file_name.empty())
+      {
+        file_.open(file_name.c_str(), std::ios::out | std::ios::app);
+        if (file_.is_open())
+          file_ << "# time name count mean_us p50_us p90_us p99_us max_us" << std::endl;
+        else
+          ROS_WARN_STREAM("Cannot open the latency log " << file_name);
+      }
+    }
+
+    LatencyReporter::~LatencyReporter()
+    {
+      timer_.stop();
+      report();
+    }
+
+    void
+    LatencyReporter::timerCallback(const ros::WallTimerEvent& event)
+    {
+      report();
+    }
+
+    void
+    LatencyReporter::report()
+    {
+      profiler_.getStatistics(statistics_);
+
+      diagnostic_msgs::DiagnosticArray::Ptr diagnostics_msg(new diagnostic_msgs::DiagnosticArray);
+      diagnostics_msg->header.stamp = ros::Time::now();
+      for (size_t i = 0; i < statistics_.size(); i++)
+      {
+        const LatencyStatistics& s = statistics_[i];
+
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = name_ + ": " + s.name;
+        std::ostringstream message;
+        message << std::fixed << std::setprecision(1) << "p50 " << s.p50 << " us, p99 " << s.p99 << " us";
+        status.message = message.str();
+        status.values.push_back(createKeyValue("count", double(s.count), 0));
+        status.values.push_back(createKeyValue("mean (us)", s.mean));
+        status.values.push_back(createKeyValue("p50 (us)", s.p50));
+        status.values.push_back(createKeyValue("p90 (us)", s.p90));
+        status.values.push_back(createKeyValue("p99 (us)", s.p99));
+        status.values.push_back(createKeyValue("max (us)", s.max));
+        diagnostics_msg->status.push_back(status);
+
+        if (file_.is_open() and (s.count > 0))
+        {
+          file_ << std::fixed << std::setprecision(3) << diagnostics_msg->header.stamp.toSec() << " " << name_ << "/"
+              << s.name << " " << s.count << std::setprecision(1) << " " << s.mean << " " << s.p50 << " " << s.p90
+              << " " << s.p99 << " " << s.max << "\n";
+        }
+      }
+      if (file_.is_open())
+        file_.flush();
+
+      diagnostics_pub_.publish(diagnostics_msg);
+    }
+  } /* namespace opt_utils */
+} /* namespace open_ptrack */
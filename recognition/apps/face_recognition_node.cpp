@@ -29,6 +29,7 @@
 #include <open_ptrack/recognition/face_recognizer.hpp>
 #include <open_ptrack/recognition/nn/face_recognizer_nn.hpp>
 #include <open_ptrack/recognition/bayes/face_recognizer_bayes.hpp>
+#include <open_ptrack/opt_utils/latency_reporter.h>
 
 /**
  * @brief The FaceRecognitionNode
@@ -52,7 +53,8 @@ public:
       detections_sub(nh, "/face_detector/detections", 10),
       feature_vector_sub(nh, "/face_feature_extractor/features", 10),
       sync(association_sub, detections_sub, feature_vector_sub, 1000),
-      seq(ros::Duration(0.1), ros::Duration(0.01), 24)
+      seq(ros::Duration(0.1), ros::Duration(0.01), 24),
+      latency_profiler(ros::NodeHandle("~").param("latency_profiling", false))
   {
 //    recognizer.reset(new FaceRecognizerNN(0.8, 5));
     recognizer.reset(new FaceRecognizerBayes());
@@ -63,6 +65,17 @@ public:
     seq.registerCallback(boost::bind(&FaceRecognitionNode::face_sequenced_callback, this, _1));
 
     names_seq_num = 0;
+
+    // latency profiling (statistics are published on /diagnostics)
+    track_latency = latency_profiler.getHistogram("face_recognition/tracks");
+    features_latency = latency_profiler.getHistogram("face_recognition/features");
+    update_latency = latency_profiler.getHistogram("face_recognition/recognizer_update");
+    if(latency_profiler.isEnabled()) {
+      ros::NodeHandle private_nh("~");
+      double latency_report_period = private_nh.param("latency_report_period", 5.0);
+      std::string latency_log = private_nh.param("latency_log", std::string(""));
+      latency_reporter.reset(new open_ptrack::opt_utils::LatencyReporter(nh, latency_profiler, ros::this_node::getName(), latency_report_period, latency_log));
+    }
   }
 
 private:
@@ -81,6 +94,7 @@ private:
    * @param track_msg   the input TrackArray
    */
   void track_callback(const opt_msgs::TrackArrayConstPtr& track_msg) {
+    open_ptrack::opt_utils::ScopedLatencyTimer timer(track_latency);
     opt_msgs::TrackArrayPtr recognized_msg(new opt_msgs::TrackArray());
     *recognized_msg = *track_msg;
 
@@ -125,6 +139,7 @@ private:
    * @param feature_vector_msg  the face feature vectors
    */
   void face_callback(const opt_msgs::AssociationConstPtr& association_msg, const opt_msgs::DetectionArrayConstPtr& detections_msg, const opt_msgs::FeatureVectorArrayConstPtr& feature_vector_msg) {
+    open_ptrack::opt_utils::ScopedLatencyTimer timer(features_latency);
     if(association_msg->track_ids.size() != feature_vector_msg->vectors.size() || association_msg->track_ids.size() != detections_msg->detections.size()){
       std::cerr << "warning : the numbers of the trackers and the feature vectors must be same!!" << std::endl;
       std::cerr << "        : skip this frame" << std::endl;
@@ -191,6 +206,7 @@ if (count > 0) { //jb
    * @brief updates the face recognizer with the data in the buffer and then clears the buffer
    */
   void flush_features_buffer() {
+    open_ptrack::opt_utils::ScopedLatencyTimer timer(update_latency);
     std::cout << "testupdate" << std::endl;
 
     std::unordered_map<int, std::vector<std::shared_ptr<Eigen::VectorXf>>> fmap;
@@ -332,6 +348,13 @@ private:
   std::vector<std::tuple<ros::Time, int, std::shared_ptr<Eigen::VectorXf>>> features_buffer;
 
   int names_seq_num;
+
+  // latency profiling
+  open_ptrack::opt_utils::LatencyProfiler latency_profiler;
+  open_ptrack::opt_utils::LatencyHistogram* track_latency;
+  open_ptrack::opt_utils::LatencyHistogram* features_latency;
+  open_ptrack::opt_utils::LatencyHistogram* update_latency;
+  std::unique_ptr<open_ptrack::opt_utils::LatencyReporter> latency_reporter;
 };
 
 
@@ -0,0 +1,606 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <opencv2/opencv.hpp>
+#include <open_ptrack/detection/detection.h>
+#include <open_ptrack/detection/detection_source.h>
+#include <open_ptrack/tracking/tracker.h>
+
+// Feed synthetic multi-camera detection streams of a crowd through Tracker::newFrame and Tracker::updateTracks,
+// and report the latency percentiles of every stage of an association round, the heap used by every track and
+// the throughput, while the number of people grows.
+//
+// People walk at constant speed between random points of the border of a square area, so that their
+// trajectories cross in the middle of it; the area grows with the number of people, to keep a constant density.
+// Every camera sees the whole area and publishes its frames at the tracker rate, shifted with respect to
+// the other cameras. A person can be occluded in a camera for a random number of frames, and false positives
+// with low confidence are scattered on the area.
+//
+// Usage: crowd_benchmark [cameras] [frames] [false_positives] [occlusion] [people,people,...] [--<parameter> <value> ...]
+//   false_positives: mean number of false positives per camera frame, for every 10 people
+//   occlusion: probability that a visible person becomes occluded in a camera frame
+// Parameters are association_solver (munkres|sparse_lap), filter_backend (unscented|closed_form),
+// track_storage (list|table) and association_threads.
+
+// Heap usage is measured by counting the bytes allocated with operator new:
+namespace
+{
+  const std::size_t HEAP_HEADER_SIZE = 16;    // keeps the alignment of malloc
+  std::atomic<long long> heap_bytes(0);    // association_threads can allocate concurrently
+}
+
+void*
+operator new(std::size_t size)
+{
+  void* block = std::malloc(size + HEAP_HEADER_SIZE);
+  if (block == NULL)
+    throw std::bad_alloc();
+  *static_cast<std::size_t*>(block) = size;
+  heap_bytes += size;
+  return static_cast<char*>(block) + HEAP_HEADER_SIZE;
+}
+
+void
+operator delete(void* pointer) noexcept
+{
+  if (pointer == NULL)
+    return;
+  void* block = static_cast<char*>(pointer) - HEAP_HEADER_SIZE;
+  heap_bytes -= *static_cast<std::size_t*>(block);
+  std::free(block);
+}
+
+void*
+operator new[](std::size_t size)
+{
+  return operator new(size);
+}
+
+void
+operator delete[](void* pointer) noexcept
+{
+  operator delete(pointer);
+}
+
+namespace
+{
+  const double RATE = 30.0;                 // frames per second of every camera
+  const double DENSITY = 0.25;              // people per square meter
+  const double WALKING_SPEED = 1.2;         // m/s
+  const double DETECTION_NOISE = 0.08;      // standard deviation of the detected positions (m)
+  const double HEIGHT = 1.7;
+  const double MIN_OCCLUSION_FRAMES = 5;
+  const double MAX_OCCLUSION_FRAMES = 30;
+
+  enum Stage
+  {
+    NEW_FRAME,
+    DISTANCE_MATRIX,
+    COST_MATRIX,
+    ASSIGNMENT,
+    UPDATE,
+    UNASSOCIATED_DETECTIONS,
+    LOST_TRACKS,
+    TRACK_CREATION,
+    STAGES
+  };
+
+  const char* STAGE_NAMES[STAGES] = {"new frame", "distance matrix", "cost matrix", "assignment", "update",
+      "unassociated", "lost tracks", "track creation"};
+
+  // Tracker which times every stage of an association round. Assignment (Munkres or the sparse solver,
+  // which are not virtual methods) is the time of updateTracks not spent in the other stages.
+  class ProfiledTracker : public open_ptrack::tracking::Tracker
+  {
+    public:
+
+      ProfiledTracker(double gate_distance, bool detector_likelihood, std::vector<double> likelihood_weights,
+          bool velocity_in_motion_term, double min_confidence, double min_confidence_detections,
+          double sec_before_old, double sec_before_fake, double sec_remain_new, int detections_to_validate,
+          double period, double position_variance, double acceleration_variance, std::string world_frame_id) :
+        Tracker(gate_distance, detector_likelihood, likelihood_weights, velocity_in_motion_term, min_confidence,
+            min_confidence_detections, sec_before_old, sec_before_fake, sec_remain_new, detections_to_validate,
+            period, position_variance, acceleration_variance, world_frame_id, false, false)
+      {
+      }
+
+      void
+      newFrame(const std::vector<open_ptrack::detection::Detection>& detections)
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::newFrame(detections);
+        samples_[NEW_FRAME].push_back(elapsed(start));
+      }
+
+      void
+      updateTracks()
+      {
+        std::fill(round_, round_ + STAGES, 0.0);
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::updateTracks();
+        double total = elapsed(start);
+
+        round_[ASSIGNMENT] = total;
+        for (int i = DISTANCE_MATRIX; i < STAGES; i++)
+        {
+          if (i != ASSIGNMENT)
+            round_[ASSIGNMENT] -= round_[i];
+        }
+        for (int i = DISTANCE_MATRIX; i < STAGES; i++)
+          samples_[i].push_back(round_[i]);
+        total_.push_back(samples_[NEW_FRAME].back() + total);
+      }
+
+      size_t
+      getTracksNumber() const
+      {
+        return tracks_.size();
+      }
+
+      int
+      getCreatedTracksNumber() const
+      {
+        return tracks_counter_;
+      }
+
+      const std::vector<double>&
+      getSamples(int stage) const
+      {
+        return samples_[stage];
+      }
+
+      const std::vector<double>&
+      getTotalSamples() const
+      {
+        return total_;
+      }
+
+    protected:
+
+      static double
+      elapsed(const std::chrono::steady_clock::time_point& start)
+      {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+      }
+
+      void
+      createDistanceMatrix()
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::createDistanceMatrix();
+        round_[DISTANCE_MATRIX] += elapsed(start);
+      }
+
+      void
+      createCostMatrix()
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::createCostMatrix();
+        round_[COST_MATRIX] += elapsed(start);
+      }
+
+      void
+      updateDetectedTracks()
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::updateDetectedTracks();
+        round_[UPDATE] += elapsed(start);
+      }
+
+      void
+      fillUnassociatedDetections()
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::fillUnassociatedDetections();
+        round_[UNASSOCIATED_DETECTIONS] += elapsed(start);
+      }
+
+      void
+      updateLostTracks()
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::updateLostTracks();
+        round_[LOST_TRACKS] += elapsed(start);
+      }
+
+      void
+      createNewTracks()
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        Tracker::createNewTracks();
+        round_[TRACK_CREATION] += elapsed(start);
+      }
+
+      /** \brief Stage times of the current round (in microseconds) */
+      double round_[STAGES];
+
+      /** \brief Stage times of all rounds (in microseconds) */
+      std::vector<double> samples_[STAGES];
+
+      /** \brief Times of newFrame plus updateTracks of all rounds (in microseconds) */
+      std::vector<double> total_;
+  };
+
+  struct Person
+  {
+    double x, y;
+    double target_x, target_y;
+  };
+
+  class Crowd
+  {
+    public:
+
+      Crowd(int people, int cameras, double false_positives, double occlusion, unsigned int seed) :
+        side_(std::sqrt(people / DENSITY)), false_positives_(false_positives * people / 10.0),
+        occlusion_(occlusion), random_(seed), people_(people),
+        occluded_frames_(cameras, std::vector<int>(people, 0))
+      {
+        for (int i = 0; i < people; i++)
+        {
+          getBorderPoint(people_[i].x, people_[i].y);
+          // Start somewhere along the first path:
+          getBorderPoint(people_[i].target_x, people_[i].target_y);
+          double fraction = uniform(0.0, 1.0);
+          people_[i].x += fraction * (people_[i].target_x - people_[i].x);
+          people_[i].y += fraction * (people_[i].target_y - people_[i].y);
+        }
+      }
+
+      // Move every person by a time interval:
+      void
+      walk(double interval)
+      {
+        for (size_t i = 0; i < people_.size(); i++)
+        {
+          Person& p = people_[i];
+          double dx = p.target_x - p.x;
+          double dy = p.target_y - p.y;
+          double distance = std::sqrt(dx * dx + dy * dy);
+          double step = WALKING_SPEED * interval;
+          if (distance <= step)
+          {
+            p.x = p.target_x;
+            p.y = p.target_y;
+            getBorderPoint(p.target_x, p.target_y);
+          }
+          else
+          {
+            p.x += step * dx / distance;
+            p.y += step * dy / distance;
+          }
+        }
+      }
+
+      // Detections of a camera frame, in world coordinates:
+      void
+      detect(int camera, std::vector<opt_msgs::Detection>& detections)
+      {
+        detections.clear();
+        std::vector<int>& occluded_frames = occluded_frames_[camera];
+        for (size_t i = 0; i < people_.size(); i++)
+        {
+          if (occluded_frames[i] > 0)
+          {
+            occluded_frames[i]--;
+            continue;
+          }
+          if (uniform(0.0, 1.0) < occlusion_)
+          {
+            occluded_frames[i] = int(uniform(MIN_OCCLUSION_FRAMES, MAX_OCCLUSION_FRAMES));
+            continue;
+          }
+          detections.push_back(createDetection(people_[i].x + noise_(random_) * DETECTION_NOISE,
+              people_[i].y + noise_(random_) * DETECTION_NOISE, uniform(0.0, 4.0)));
+        }
+
+        std::poisson_distribution<int> false_positives(false_positives_);
+        int false_positives_number = (false_positives_ > 0.0) ? false_positives(random_) : 0;
+        for (int i = 0; i < false_positives_number; i++)
+          detections.push_back(createDetection(uniform(0.0, side_), uniform(0.0, side_), uniform(-3.0, 0.0)));
+      }
+
+      double
+      getSide() const
+      {
+        return side_;
+      }
+
+    protected:
+
+      double
+      uniform(double min, double max)
+      {
+        return std::uniform_real_distribution<double>(min, max)(random_);
+      }
+
+      void
+      getBorderPoint(double& x, double& y)
+      {
+        double position = uniform(0.0, 4.0 * side_);
+        int border = std::min(int(position / side_), 3);
+        double offset = position - border * side_;
+        x = (border == 0) ? offset : (border == 1) ? side_ : (border == 2) ? side_ - offset : 0.0;
+        y = (border == 0) ? 0.0 : (border == 1) ? offset : (border == 2) ? side_ : side_ - offset;
+      }
+
+      opt_msgs::Detection
+      createDetection(double x, double y, double confidence)
+      {
+        // Cameras have identity transforms, so camera coordinates are world coordinates:
+        opt_msgs::Detection detection;
+        detection.centroid.x = x;
+        detection.centroid.y = y;
+        detection.centroid.z = HEIGHT / 2;
+        detection.top = detection.centroid;
+        detection.top.z = HEIGHT;
+        detection.bottom = detection.centroid;
+        detection.bottom.z = 0.0;
+        detection.height = HEIGHT;
+        detection.confidence = confidence;
+        detection.distance = uniform(1.0, 5.0);
+        detection.occluded = false;
+        return detection;
+      }
+
+      double side_;
+      double false_positives_;
+      double occlusion_;
+      std::mt19937 random_;
+      std::normal_distribution<double> noise_;
+      std::vector<Person> people_;
+
+      /** \brief Remaining occluded frames of every person in every camera */
+      std::vector<std::vector<int> > occluded_frames_;
+  };
+
+  double
+  getPercentile(std::vector<double> samples, double percentile)
+  {
+    if (samples.empty())
+      return 0.0;
+    size_t index = std::min(samples.size() - 1, size_t(percentile * samples.size()));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+  }
+
+  void
+  printLatencies(const std::string& name, const std::vector<double>& samples)
+  {
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << getPercentile(samples, 0.5) << std::setw(12) << getPercentile(samples, 0.9)
+        << std::setw(12) << getPercentile(samples, 0.99) << std::setw(12) << getPercentile(samples, 1.0)
+        << std::endl;
+  }
+
+  struct Options
+  {
+    std::string association_solver;
+    std::string filter_backend;
+    std::string track_storage;
+    int association_threads;
+  };
+
+  void
+  run(int people, int cameras, int frames, double false_positives, double occlusion, const Options& options)
+  {
+    // Tracking parameters (defaults of conf/tracker.yaml):
+    std::vector<double> likelihood_weights;
+    likelihood_weights.push_back(-0.25);
+    likelihood_weights.push_back(0.25);
+    double voxel_size = 0.06;
+    double position_variance = 30.0 * std::pow(2 * voxel_size, 2) / 12.0;
+    double gate_distance = 18.467;    // chi square, 4 degrees of freedom, 0.999
+
+    ProfiledTracker tracker(gate_distance, true, likelihood_weights, true, 0.0, -2.5, 8.0, 2.4, 1.2, 3,
+        1.0 / RATE, position_variance, 100.0, "/world");
+    if (options.association_solver == "sparse_lap")
+      tracker.setAssociationSolver(open_ptrack::tracking::SPARSE_LAP);
+    if (options.filter_backend == "closed_form")
+      tracker.setFilterBackend(open_ptrack::tracking::CLOSED_FORM);
+    if (options.track_storage == "table")
+      tracker.setTrackStorage(open_ptrack::tracking::TRACK_TABLE);
+    tracker.setAssociationThreads(options.association_threads);
+
+    Crowd crowd(people, cameras, false_positives, occlusion, 1234);
+    ros::Time time(1000.0);
+    std::vector<open_ptrack::detection::DetectionSource*> sources;
+    for (int c = 0; c < cameras; c++)
+    {
+      std::ostringstream frame_id;
+      frame_id << "/camera" << c;
+      tf::StampedTransform transform(tf::Transform::getIdentity(), time, "/world", frame_id.str());
+      tf::StampedTransform inverse_transform(tf::Transform::getIdentity(), time, frame_id.str(), "/world");
+      sources.push_back(new open_ptrack::detection::DetectionSource(cv::Mat(0, 0, CV_8UC3), transform,
+          inverse_transform, Eigen::Matrix3d::Identity(), time, frame_id.str()));
+    }
+
+    std::vector<opt_msgs::Detection> detection_msgs;
+    std::vector<open_ptrack::detection::Detection> detections;
+    detection_msgs.reserve(2 * people + 100);
+    detections.reserve(2 * people + 100);
+
+    // Heap allocated since here is held by the tracks (and by the buffers of the tracker, which grow with them):
+    long long heap_before = heap_bytes;
+
+    // Run half of the frames before measuring, so that all people are tracked:
+    int warm_up_frames = frames / 2;
+    int rounds = 0;
+    long long detections_number = 0;
+    double tracking_seconds = 0.0;
+    for (int f = 0; f < warm_up_frames + frames; f++)
+    {
+      if (f == warm_up_frames)
+      {
+        rounds = 0;
+        detections_number = 0;
+        tracking_seconds = 0.0;
+      }
+
+      for (int c = 0; c < cameras; c++)
+      {
+        // Cameras are not synchronized:
+        double interval = 1.0 / (RATE * cameras);
+        crowd.walk(interval);
+        time += ros::Duration(interval);
+
+        crowd.detect(c, detection_msgs);
+        if (detection_msgs.empty())
+          continue;
+        tf::StampedTransform transform(tf::Transform::getIdentity(), time, "/world", sources[c]->getFrameId());
+        tf::StampedTransform inverse_transform(tf::Transform::getIdentity(), time, sources[c]->getFrameId(), "/world");
+        sources[c]->update(cv::Mat(0, 0, CV_8UC3), transform, inverse_transform, Eigen::Matrix3d::Identity(),
+            time, sources[c]->getFrameId());
+
+        detections.clear();
+        for (size_t i = 0; i < detection_msgs.size(); i++)
+          detections.push_back(open_ptrack::detection::Detection(detection_msgs[i], sources[c]));
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        tracker.newFrame(detections);
+        tracker.updateTracks();
+        tracking_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        rounds++;
+        detections_number += detections.size();
+      }
+    }
+
+    size_t tracks = tracker.getTracksNumber();
+    long long heap_in_tracker = heap_bytes - heap_before;
+    for (size_t c = 0; c < sources.size(); c++)
+      delete sources[c];
+
+    std::cout << people << " people, " << cameras << " cameras, " << std::fixed << std::setprecision(1)
+        << crowd.getSide() << " m x " << crowd.getSide() << " m" << std::endl;
+    std::cout << "  " << rounds << " rounds, " << detections_number << " detections, " << tracks << " tracks ("
+        << tracker.getCreatedTracksNumber() << " created)" << std::endl;
+    std::cout << "  throughput: " << std::setprecision(0) << rounds / tracking_seconds << " rounds/s, "
+        << detections_number / tracking_seconds << " detections/s" << std::endl;
+    std::cout << "  heap: " << heap_in_tracker / 1024 << " KiB, "
+        << (tracks > 0 ? heap_in_tracker / double(tracks) : 0.0) << " bytes/track" << std::endl;
+    std::cout << "  " << std::left << std::setw(16) << "stage (us)" << std::right << std::setw(12) << "p50"
+        << std::setw(12) << "p90" << std::setw(12) << "p99" << std::setw(12) << "max" << std::endl;
+    for (int i = 0; i < STAGES; i++)
+    {
+      if (i == COST_MATRIX and options.association_solver == "sparse_lap")
+        continue;
+      const std::vector<double>& samples = tracker.getSamples(i);
+      // Only the measured rounds:
+      printLatencies(STAGE_NAMES[i], std::vector<double>(samples.end() - rounds, samples.end()));
+    }
+    const std::vector<double>& total = tracker.getTotalSamples();
+    printLatencies("total", std::vector<double>(total.end() - rounds, total.end()));
+    std::cout << std::endl;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  int positional = 1;
+  while (positional < argc and std::strncmp(argv[positional], "--", 2) != 0)
+    positional++;
+
+  int cameras = (positional > 1) ? std::atoi(argv[1]) : 4;
+  int frames = (positional > 2) ? std::atoi(argv[2]) : 100;
+  double false_positives = (positional > 3) ? std::atof(argv[3]) : 0.5;
+  double occlusion = (positional > 4) ? std::atof(argv[4]) : 0.02;
+  std::vector<int> people;
+  std::istringstream people_list((positional > 5) ? argv[5] : "10,30,100,300,1000");
+  std::string value;
+  while (std::getline(people_list, value, ','))
+    people.push_back(std::atoi(value.c_str()));
+
+  Options options;
+  options.association_solver = "munkres";
+  options.filter_backend = "unscented";
+  options.track_storage = "list";
+  options.association_threads = 1;
+  for (int i = positional; i < argc; i += 2)
+  {
+    if (i + 1 >= argc)
+    {
+      std::cerr << "Missing value of " << argv[i] << std::endl;
+      return 1;
+    }
+    std::string name(argv[i] + 2);
+    if (name == "association_solver")
+      options.association_solver = argv[i + 1];
+    else if (name == "filter_backend")
+      options.filter_backend = argv[i + 1];
+    else if (name == "track_storage")
+      options.track_storage = argv[i + 1];
+    else if (name == "association_threads")
+      options.association_threads = std::atoi(argv[i + 1]);
+    else
+    {
+      std::cerr << "Unknown parameter " << argv[i] << std::endl;
+      return 1;
+    }
+  }
+
+  if ((cameras < 1) or (frames < 1) or people.empty())
+  {
+    std::cerr << "Usage: " << argv[0] << " [cameras] [frames] [false_positives] [occlusion] [people,people,...]"
+        " [--<parameter> <value> ...]" << std::endl;
+    return 1;
+  }
+
+  // No ROS master: times are synthetic
+  ros::Time::init();
+
+  std::cout << "association_solver " << options.association_solver << ", filter_backend " << options.filter_backend
+      << ", track_storage " << options.track_storage << ", association_threads " << options.association_threads
+      << std::endl << std::endl;
+  for (size_t i = 0; i < people.size(); i++)
+    run(people[i], cameras, frames, false_positives, occlusion, options);
+  return 0;
+}
@@ -0,0 +1,204 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <open_ptrack/tracking/kalman_filter.h>
+#include <open_ptrack/tracking/kalman_filter3d.h>
+
+using open_ptrack::tracking::FilterBackend;
+using open_ptrack::tracking::KalmanFilter;
+using open_ptrack::tracking::KalmanFilter3D;
+
+// Compare the UNSCENTED and CLOSED_FORM filter backends on the operations done by a track at every frame:
+// prediction, extraction of the Mahalanobis parameters and update with a noisy detection of a walking person.
+//
+// Usage: kalman_filter_benchmark [tracks] [frames]
+
+namespace
+{
+  const double PERIOD = 1.0 / 30.0;
+  const double POSITION_VARIANCE = 0.0225;        // (0.15 m)^2
+  const double ACCELERATION_VARIANCE = 100.0;
+
+  struct Result
+  {
+    double seconds;
+    double state[6];
+  };
+
+  // Run the 2D filter (position or position and velocity in the output vector):
+  Result
+  run2d(FilterBackend backend, bool velocity_in_motion_term, int tracks, int frames)
+  {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> noise(0.0, 0.15);
+
+    std::vector<KalmanFilter*> filters;
+    for(int i = 0; i < tracks; i++)
+    {
+      filters.push_back(new KalmanFilter(PERIOD, POSITION_VARIANCE, ACCELERATION_VARIANCE,
+          velocity_in_motion_term ? 4 : 2, backend));
+      filters.back()->init(i, 0.0, 3.0, velocity_in_motion_term);
+    }
+    open_ptrack::tracking::MahalanobisParameters2d mp2d;
+    open_ptrack::tracking::MahalanobisParameters4d mp4d;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int frame = 1; frame <= frames; frame++)
+    {
+      for(int i = 0; i < tracks; i++)
+      {
+        double x = i + noise(generator);
+        double y = 1.2 * frame * PERIOD + noise(generator);
+        filters[i]->predict();
+        if (velocity_in_motion_term)
+        {
+          filters[i]->getMahalanobisParameters(mp4d);
+          filters[i]->update(x, y, 0.0, 1.2, 3.0);
+        }
+        else
+        {
+          filters[i]->getMahalanobisParameters(mp2d);
+          filters[i]->update(x, y, 3.0);
+        }
+      }
+    }
+    Result result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    filters.back()->getState(result.state[0], result.state[1], result.state[2], result.state[3]);
+    result.state[4] = result.state[5] = 0.0;
+    for(int i = 0; i < tracks; i++)
+      delete filters[i];
+    return result;
+  }
+
+  // Run the 3D filter (position or position and velocity in the output vector):
+  Result
+  run3d(FilterBackend backend, bool velocity_in_motion_term, int tracks, int frames)
+  {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> noise(0.0, 0.15);
+
+    std::vector<KalmanFilter3D*> filters;
+    for(int i = 0; i < tracks; i++)
+    {
+      filters.push_back(new KalmanFilter3D(PERIOD, POSITION_VARIANCE, ACCELERATION_VARIANCE,
+          velocity_in_motion_term ? 6 : 3, backend));
+      filters.back()->init(i, 0.0, 1.0, 3.0, velocity_in_motion_term);
+    }
+    open_ptrack::tracking::MahalanobisParameters3d mp3d;
+    open_ptrack::tracking::MahalanobisParameters6d mp6d;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int frame = 1; frame <= frames; frame++)
+    {
+      for(int i = 0; i < tracks; i++)
+      {
+        double x = i + noise(generator);
+        double y = 1.2 * frame * PERIOD + noise(generator);
+        double z = 1.0 + noise(generator);
+        filters[i]->predict();
+        if (velocity_in_motion_term)
+        {
+          filters[i]->getMahalanobisParameters(mp6d);
+          filters[i]->update(x, y, z, 0.0, 1.2, 0.0, 3.0);
+        }
+        else
+        {
+          filters[i]->getMahalanobisParameters(mp3d);
+          filters[i]->update(x, y, z, 3.0);
+        }
+      }
+    }
+    Result result;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    filters.back()->getState(result.state[0], result.state[1], result.state[2],
+        result.state[3], result.state[4], result.state[5]);
+    for(int i = 0; i < tracks; i++)
+      delete filters[i];
+    return result;
+  }
+
+  void
+  report(const std::string& name, const Result& unscented, const Result& closed_form, int tracks, int frames)
+  {
+    double steps = double(tracks) * frames;
+    double max_difference = 0.0;
+    for(int i = 0; i < 6; i++)
+      max_difference = std::max(max_difference, std::abs(unscented.state[i] - closed_form.state[i]));
+
+    std::cout << name << ": unscented " << 1e6 * unscented.seconds / steps << " us, closed form "
+              << 1e6 * closed_form.seconds / steps << " us per track and frame (speedup "
+              << unscented.seconds / closed_form.seconds << "x, max state difference " << max_difference << ")"
+              << std::endl;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  int tracks = (argc > 1) ? std::atoi(argv[1]) : 500;
+  int frames = (argc > 2) ? std::atoi(argv[2]) : 300;
+  std::cout << tracks << " tracks, " << frames << " frames" << std::endl;
+
+  for(int velocity = 0; velocity < 2; velocity++)
+  {
+    Result unscented = run2d(open_ptrack::tracking::UNSCENTED, velocity, tracks, frames);
+    Result closed_form = run2d(open_ptrack::tracking::CLOSED_FORM, velocity, tracks, frames);
+    report(velocity ? "KalmanFilter (position and velocity)" : "KalmanFilter (position)",
+        unscented, closed_form, tracks, frames);
+  }
+
+  for(int velocity = 0; velocity < 2; velocity++)
+  {
+    Result unscented = run3d(open_ptrack::tracking::UNSCENTED, velocity, tracks, frames);
+    Result closed_form = run3d(open_ptrack::tracking::CLOSED_FORM, velocity, tracks, frames);
+    report(velocity ? "KalmanFilter3D (position and velocity)" : "KalmanFilter3D (position)",
+        unscented, closed_form, tracks, frames);
+  }
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <open_ptrack/tracking/kalman_filter.h>
+#include <open_ptrack/tracking/track_table.h>
+
+using open_ptrack::tracking::ClosedFormKalmanFilter;
+using open_ptrack::tracking::KalmanFilter;
+using open_ptrack::tracking::TrackTable;
+
+// Compare the TRACK_LIST and TRACK_TABLE storage modes of the Tracker on the computation of the
+// track x detection distance matrix of a crowd: every track lost for a few frames is predicted to the
+// detection time and its Mahalanobis distance from every detection is computed.
+//
+// Usage: track_table_benchmark [tracks] [frames]
+
+namespace
+{
+  const double PERIOD = 1.0 / 30.0;
+  const double POSITION_VARIANCE = 0.0225;        // (0.15 m)^2
+  const double ACCELERATION_VARIANCE = 100.0;
+  const double DETECTOR_WEIGHT = -0.25;
+  const double MOTION_WEIGHT = 0.25;
+  const double INVALID_DISTANCE = 2 * 2.5;
+
+  struct Crowd
+  {
+    std::vector<KalmanFilter*> filters;
+    std::vector<double> intervals;          // from the last update of every track to the detections
+    std::vector<double> velocity_gains;
+    std::vector<double> velocity_offsets_x;
+    std::vector<double> velocity_offsets_y;
+    std::vector<double> x, y, detector_terms;
+  };
+
+  // People walking on a grid, detected with noise (the same number of tracks and detections):
+  void
+  createCrowd(int people, Crowd& crowd)
+  {
+    std::mt19937 generator(42);
+    std::normal_distribution<double> noise(0.0, 0.15);
+    std::uniform_real_distribution<double> confidence(-1.0, 3.0);
+
+    int side = int(std::ceil(std::sqrt(double(people))));
+    for(int i = 0; i < people; i++)
+    {
+      double x = 1.5 * (i % side);
+      double y = 1.5 * (i / side);
+      KalmanFilter* filter = new KalmanFilter(PERIOD, POSITION_VARIANCE, ACCELERATION_VARIANCE, 4,
+          open_ptrack::tracking::CLOSED_FORM);
+      filter->init(x, y, 3.0, true);
+      for(int frame = 1; frame <= 30; frame++)
+      {
+        filter->predict();
+        filter->update(x + noise(generator), y + 1.2 * frame * PERIOD + noise(generator), 0.0, 1.2, 3.0);
+      }
+      crowd.filters.push_back(filter);
+      crowd.intervals.push_back((1 + i % 4) * PERIOD);
+
+      // Velocity observed from the position one second before:
+      crowd.velocity_gains.push_back(1.0);
+      crowd.velocity_offsets_x.push_back(-x);
+      crowd.velocity_offsets_y.push_back(-(y + 0.2));
+
+      crowd.x.push_back(x + noise(generator));
+      crowd.y.push_back(y + 1.2 + crowd.intervals.back() * 1.2 + noise(generator));
+      crowd.detector_terms.push_back(DETECTOR_WEIGHT * confidence(generator));
+    }
+  }
+
+  // Every track predicts its Mahalanobis parameters and computes its distances (see Track::getMahalanobisDistance):
+  double
+  runList(const Crowd& crowd, bool velocity_in_motion_term, int frames, std::vector<double>& distances)
+  {
+    int tracks = crowd.filters.size();
+    int detections = crowd.x.size();
+    distances.resize(tracks * detections);
+    open_ptrack::tracking::MahalanobisParameters2d mp2d;
+    open_ptrack::tracking::MahalanobisParameters4d mp4d;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < frames; frame++)
+    {
+      for(int track = 0; track < tracks; track++)
+      {
+        KalmanFilter* filter = crowd.filters[track];
+        if (velocity_in_motion_term)
+          filter->getMahalanobisParameters(crowd.intervals[track], mp4d);
+        else
+          filter->getMahalanobisParameters(crowd.intervals[track], mp2d);
+
+        for(int measure = 0; measure < detections; measure++)
+        {
+          double x = crowd.x[measure];
+          double y = crowd.y[measure];
+          double motion_likelihood;
+          if (velocity_in_motion_term)
+          {
+            double vx = crowd.velocity_gains[track] * x + crowd.velocity_offsets_x[track];
+            double vy = crowd.velocity_gains[track] * y + crowd.velocity_offsets_y[track];
+            motion_likelihood = KalmanFilter::performMahalanobisDistance(x, y, vx, vy, mp4d);
+          }
+          else
+          {
+            motion_likelihood = KalmanFilter::performMahalanobisDistance(x, y, mp2d);
+          }
+          double distance = crowd.detector_terms[measure] + MOTION_WEIGHT * motion_likelihood;
+          distances[track * detections + measure] = std::isfinite(distance) ? distance : INVALID_DISTANCE;
+        }
+      }
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+
+  // Filters are copied to the table, predicted and compared with all detections in batch (see Tracker::createTableDistanceMatrix):
+  double
+  runTable(const Crowd& crowd, bool velocity_in_motion_term, int frames, std::vector<double>& distances)
+  {
+    int tracks = crowd.filters.size();
+    int detections = crowd.x.size();
+    distances.resize(tracks * detections);
+    TrackTable table;
+    ClosedFormKalmanFilter<2> buffer;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(int frame = 0; frame < frames; frame++)
+    {
+      table.setModel(PERIOD, ACCELERATION_VARIANCE, velocity_in_motion_term);
+      table.resize(tracks);
+      for(int track = 0; track < tracks; track++)
+      {
+        table.setTrack(track, crowd.filters[track]->getClosedFormFilter(buffer), - crowd.intervals[track],
+            crowd.velocity_gains[track], crowd.velocity_offsets_x[track], crowd.velocity_offsets_y[track]);
+      }
+      table.predict(0.0);
+      table.computeDistances(crowd.x, crowd.y, crowd.detector_terms, MOTION_WEIGHT, INVALID_DISTANCE, &distances[0]);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  int tracks = (argc > 1) ? std::atoi(argv[1]) : 500;
+  int frames = (argc > 2) ? std::atoi(argv[2]) : 100;
+  std::cout << tracks << " tracks and detections, " << frames << " frames, "
+            << TrackTable::getInstructionSet() << " kernels" << std::endl;
+
+  Crowd crowd;
+  createCrowd(tracks, crowd);
+
+  for(int velocity = 0; velocity < 2; velocity++)
+  {
+    std::vector<double> list_distances, table_distances;
+    double list_seconds = runList(crowd, velocity, frames, list_distances);
+    double table_seconds = runTable(crowd, velocity, frames, table_distances);
+
+    double max_difference = 0.0;
+    for(size_t i = 0; i < list_distances.size(); i++)
+      max_difference = std::max(max_difference, std::abs(list_distances[i] - table_distances[i]));
+
+    std::cout << (velocity ? "Position and velocity" : "Position") << ": list "
+              << 1e3 * list_seconds / frames << " ms, table " << 1e3 * table_seconds / frames
+              << " ms per distance matrix (speedup " << list_seconds / table_seconds
+              << "x, max distance difference " << max_difference << ")" << std::endl;
+  }
+
+  for(size_t i = 0; i < crowd.filters.size(); i++)
+    delete crowd.filters[i];
+  return 0;
+}
@@ -0,0 +1,1400 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2011-2012, Matteo Munaro [matteo.munaro@dei.unipd.it], Filippo Basso [filippo.basso@dei.unipd.it]
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Author: Matteo Munaro [matteo.munaro@dei.unipd.it], Filippo Basso [filippo.basso@dei.unipd.it]
+ *
+ */
+
+#include <ros/ros.h>
+#include <ros/package.h>
+#include <opencv2/opencv.hpp>
+#include <Eigen/Eigen>
+#include <visualization_msgs/MarkerArray.h>
+#include <std_msgs/Bool.h>
+#include <std_msgs/Header.h>
+#include <pcl_ros/point_cloud.h>
+#include <pcl/point_types.h>
+#include <tf/tf.h>
+#include <tf/transform_listener.h>
+#include <tf/transform_broadcaster.h>
+#include <list>
+#include <set>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <string.h>
+
+#include <message_filters/subscriber.h>
+#include <message_filters/time_sequencer.h>
+#include <open_ptrack/opt_utils/conversions.h>
+#include <open_ptrack/opt_utils/spsc_queue.h>
+#include <open_ptrack/opt_utils/latency_reporter.h>
+#include <open_ptrack/detection/detection.h>
+#include <open_ptrack/detection/detection_source.h>
+#include <open_ptrack/tracking/tracker.h>
+#include <open_ptrack/tracking/transform_cache.h>
+#include <open_ptrack/tracking/detection_log.h>
+#include <opt_msgs/Association.h>
+#include <opt_msgs/Detection.h>
+#include <opt_msgs/DetectionArray.h>
+#include <opt_msgs/TrackArray.h>
+#include <opt_msgs/IDArray.h>
+//#include <open_ptrack/opt_utils/ImageConverter.h>
+
+// Dynamic reconfigure:
+#include <dynamic_reconfigure/server.h>
+#include <tracking/TrackerConfig.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+namespace open_ptrack
+{
+namespace tracking
+{
+
+typedef ::tracking::TrackerConfig Config;
+typedef dynamic_reconfigure::Server<Config> ReconfigureServer;
+
+/** \brief Messages produced by an association round, published together (NULL messages are not published) */
+struct TrackingOutput
+{
+  opt_msgs::TrackArray::Ptr tracks;
+  opt_msgs::IDArray::Ptr alive_ids;
+  opt_msgs::Association::Ptr association;
+  visualization_msgs::MarkerArray::Ptr markers;
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr history;
+  visualization_msgs::MarkerArray::Ptr detection_markers;
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr detection_history;
+};
+
+/** \brief Detection messages of a camera waiting for the tracking thread */
+struct IngestQueue
+{
+  IngestQueue(size_t capacity) : messages(capacity), dropped(0) {}
+
+  std::string frame_id;
+  open_ptrack::opt_utils::SpscQueue<opt_msgs::DetectionArray::ConstPtr> messages;
+  std::atomic<unsigned long> dropped;     // messages dropped because the queue was full
+};
+
+/**
+ * \brief TrackerNodelet associates the detections of all the cameras in the network to people tracks
+ *
+ * Loaded in the nodelet manager of the detectors, it receives their DetectionArray messages as shared pointers,
+ * without serialization. The tracker node (tracker_node.cpp) loads it in its own process.
+ */
+class TrackerNodelet : public nodelet::Nodelet
+{
+public:
+
+  /** \brief Constructor. */
+  TrackerNodelet();
+
+  /** \brief Destructor (stops the threaded pipeline). */
+  virtual ~TrackerNodelet();
+
+  /** \brief Read the parameters, create the tracker and subscribe to the detection messages. */
+  virtual void
+  onInit();
+
+private:
+
+  visualization_msgs::Marker
+  createMarker (int id, std::string frame_id, ros::Time stamp, Eigen::Vector3d position, cv::Vec3f color);
+
+  void
+  plotCameraLegend (std::map<std::string, int> curr_color_map);
+
+  static Eigen::Matrix4d
+  readMatrixFromFile (std::string filename);
+
+  void
+  publishTrackingOutput(const TrackingOutput& output);
+
+  void
+  sendTrackingOutput(const TrackingOutput& output);
+
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr
+  getOutputCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr& cloud);
+
+  void
+  trackDetections(const std::vector<open_ptrack::detection::Detection>& detections_vector, const std_msgs::Header& header);
+
+  static bool
+  detectionTimeLess(const open_ptrack::detection::Detection& a, const open_ptrack::detection::Detection& b);
+
+  void
+  flushFusionWindow();
+
+
+  void
+  processDetections(const opt_msgs::DetectionArray::ConstPtr& msg);
+
+  void
+  queueDetections(const opt_msgs::DetectionArray::ConstPtr& msg);
+
+  void
+  detection_cb(const opt_msgs::DetectionArray::ConstPtr& msg);
+
+  void
+  checkFusionWindow(const ros::Time& now, const ros::Duration& sequencer_delay);
+
+  void
+  trackingLoop(ros::Duration sequencer_delay);
+
+  void
+  outputLoop();
+
+  void
+  updateCallback(const ros::TimerEvent& event);
+
+  static void
+  generateColors(int colors_number, std::vector<cv::Vec3f>& colors);
+
+  static void
+  fillChiMap(std::map<double, double>& chi_map, bool velocity_in_motion_term);
+
+  void
+  configCb(Config &config, uint32_t level);
+
+  std::map<std::string, open_ptrack::detection::DetectionSource*> detection_sources_map;
+  tf::TransformListener* tf_listener;
+  std::string world_frame_id;
+  bool output_history_pointcloud;
+  int output_history_size;
+  int detection_history_size;
+  bool output_markers;
+  bool output_image_rgb;
+  bool output_tracking_results;
+  bool output_detection_results;  // Enables/disables the publishing of detection positions to be visualized in RViz
+  bool vertical;
+  ros::Publisher results_pub;
+  ros::Publisher marker_pub_tmp;
+  ros::Publisher marker_pub;
+  ros::Publisher pointcloud_pub;
+  ros::Publisher detection_marker_pub;
+  ros::Publisher detection_trajectory_pub;
+  ros::Publisher alive_ids_pub;
+  ros::Publisher association_result_pub;
+  size_t starting_index;
+  size_t detection_insert_index;
+  tf::Transform camera_frame_to_world_transform;
+  tf::Transform world_to_camera_frame_transform;
+  bool extrinsic_calibration;
+  double period;
+  open_ptrack::tracking::Tracker* tracker;
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr history_pointcloud;
+  pcl::PointCloud<pcl::PointXYZRGB>::Ptr detection_history_pointcloud;
+  bool swissranger;
+  double min_confidence;
+  double min_confidence_sr;
+  double min_confidence_detections;
+  double min_confidence_detections_sr;
+  std::vector<cv::Vec3f> camera_colors;     // vector containing colors to use to identify cameras in the network
+  std::map<std::string, int> color_map;     // map between camera frame_id and color
+  // Chi square distribution
+  std::map<double, double> chi_map;
+  bool velocity_in_motion_term;
+  double acceleration_variance;
+  double position_variance_weight;
+  double voxel_size;
+  double gate_distance;
+  bool calibration_refinement;
+  open_ptrack::tracking::TransformCache* transform_cache;
+  open_ptrack::tracking::DetectionLogWriter detection_log;   // messages recorded for tracker_replay
+  open_ptrack::opt_utils::LatencyHistogram* detection_message_latency;   // whole processing of a message
+  double max_detection_delay;
+  int num_cameras;                          // sensors in the network (1 without extrinsic calibration)
+  ros::Time latest_time;
+
+  std::map<std::string, ros::Time> last_received_detection_;
+  ros::Duration max_time_between_detections_;
+
+  std::map<std::string, std::pair<double, int> > number_messages_delay_map_;
+
+  // Fusion window: detections of all cameras received within fusion_window seconds are associated together. A target
+  // seen by several cameras is assigned to a single track, which the other cameras update in sequence. Detections with
+  // different timestamps cannot use the gated or the table distance matrix, so the whole tracks x detections matrix is
+  // evaluated for every window:
+  double fusion_window;
+  std::vector<open_ptrack::detection::Detection> fusion_detections;
+  std::set<std::string> fusion_sources;     // frame_id of the cameras contributing to the current window
+  ros::Time fusion_window_start;
+  std_msgs::Header fusion_header;
+
+  // Threaded pipeline: the ROS callback thread only queues detection messages (one queue per camera), the tracking
+  // thread processes them and the output thread publishes the results. Every queue has a single producer and a
+  // single consumer, so the callbacks must run on a single thread (the single-threaded queue of the nodelet).
+  bool threaded_pipeline;
+  static const size_t MAX_INGEST_QUEUES = 64;
+  std::vector<boost::shared_ptr<IngestQueue> > ingest_queues;   // allocated at startup
+  std::map<std::string, IngestQueue*> ingest_queue_map;         // used by the ROS callback thread only
+  std::atomic<size_t> ingest_queue_count;                       // queues in use, read by the tracking thread
+  boost::shared_ptr<open_ptrack::opt_utils::SpscQueue<TrackingOutput> > output_queue;
+  std::atomic<unsigned long> output_dropped;                    // outputs dropped because the queue was full
+  std::atomic<bool> pipeline_running;
+  std::mutex tracker_mutex;                                     // tracker and parameters (dynamic reconfigure)
+  std::mutex ingest_mutex, output_mutex;                        // used only for waiting on the condition variables
+  std::condition_variable ingest_available, output_available;
+
+  // State of the main loop of the node (see updateCallback):
+  ros::Duration sequencer_delay;
+  message_filters::Subscriber<opt_msgs::DetectionArray> input_sub;
+  boost::shared_ptr<message_filters::TimeSequencer<opt_msgs::DetectionArray> > input_seq;
+  boost::recursive_mutex config_mutex_;
+  boost::shared_ptr<ReconfigureServer> reconfigure_server_;
+  boost::shared_ptr<open_ptrack::opt_utils::LatencyProfiler> latency_profiler;
+  boost::shared_ptr<open_ptrack::opt_utils::LatencyReporter> latency_reporter;
+  std::map<std::string, ros::Time> last_message;    // last warning about the detections of every camera
+  ros::Time last_camera_legend_update;              // last time when the camera legend has been updated
+  ros::Time last_drop_report;
+  std::thread tracking_thread, output_thread;
+  ros::Timer update_timer;
+
+};
+
+/**
+ * \brief Create marker to be visualized in RViz
+ *
+ * \param[in] id The marker ID.
+ * \param[in] frame_id The marker reference frame.
+ * \param[in] position The marker position.
+ * \param[in] color The marker color.
+ */
+visualization_msgs::Marker
+TrackerNodelet::createMarker (int id, std::string frame_id, ros::Time stamp, Eigen::Vector3d position, cv::Vec3f color)
+{
+  visualization_msgs::Marker marker;
+
+  marker.header.frame_id = world_frame_id;
+  marker.header.stamp = stamp;
+  marker.ns = frame_id;
+  marker.id = id;
+  marker.type = visualization_msgs::Marker::SPHERE;
+  marker.action = visualization_msgs::Marker::ADD;
+  marker.pose.position.x = position(0);
+  marker.pose.position.y = position(1);
+  marker.pose.position.z = position(2);
+  marker.scale.x = 0.1;
+  marker.scale.y = 0.1;
+  marker.scale.z = 0.1;
+  marker.color.r = color(0);
+  marker.color.g = color(1);
+  marker.color.b = color(2);
+  marker.color.a = 1.0;
+  marker.lifetime = ros::Duration(0.2);
+
+  return marker;
+}
+
+void
+TrackerNodelet::plotCameraLegend (std::map<std::string, int> curr_color_map)
+{
+  // Compose camera legend:
+  cv::Mat legend_image = cv::Mat::zeros(500, 500, CV_8UC3);
+  for(std::map<std::string, int>::iterator colormap_iterator = curr_color_map.begin(); colormap_iterator != curr_color_map.end(); colormap_iterator++)
+  {
+    int color_index = colormap_iterator->second;
+    cv::Vec3f color = camera_colors[color_index];
+    int y_coord = color_index * legend_image.rows / (curr_color_map.size()+1) + 0.5 * legend_image.rows / (curr_color_map.size()+1);
+    cv::line(legend_image, cv::Point(0,y_coord), cv::Point(100,y_coord), cv::Scalar(255*color(2), 255*color(1), 255*color(0)), 8);
+    cv::putText(legend_image, colormap_iterator->first, cv::Point(110,y_coord), 1, 1, cv::Scalar(255, 255, 255), 1);
+  }
+
+  // Display the cv image
+  cv::imshow("Camera legend", legend_image);
+  cv::waitKey(1);
+}
+
+Eigen::Matrix4d
+TrackerNodelet::readMatrixFromFile (std::string filename)
+{
+  Eigen::Matrix4d matrix;
+  std::string line;
+  std::ifstream myfile (filename.c_str());
+  if (myfile.is_open())
+  {
+    int k = 0;
+    std::string number;
+    while (myfile >> number)
+    {
+      matrix(int(k/4), int(k%4)) = std::atof(number.c_str());
+      k++;
+    }
+    myfile.close();
+  }
+
+  std::cout << matrix << std::endl;
+
+  return matrix;
+}
+
+/**
+ * \brief Associate detections to tracks and publish the results
+ *
+ * \param[in] detections_vector the detections (of a single message or of a fusion window).
+ * \param[in] header the header of the detection message (or of the fusion window).
+ */
+void
+TrackerNodelet::publishTrackingOutput(const TrackingOutput& output)
+{
+  if (output.tracks)
+    results_pub.publish(output.tracks);
+  if (output.alive_ids)
+    alive_ids_pub.publish(output.alive_ids);
+  if (output.association)
+    association_result_pub.publish(output.association);
+  if (output.markers)
+    marker_pub.publish(output.markers);
+  if (output.history)
+    pointcloud_pub.publish(output.history);
+  if (output.detection_markers)
+    detection_marker_pub.publish(output.detection_markers);
+  if (output.detection_history)
+    detection_trajectory_pub.publish(output.detection_history);
+}
+
+/**
+ * \brief Publish the messages of an association round, or queue them for the output thread
+ *
+ * \param[in] output the messages.
+ */
+void
+TrackerNodelet::sendTrackingOutput(const TrackingOutput& output)
+{
+  if (not threaded_pipeline)
+  {
+    publishTrackingOutput(output);
+    return;
+  }
+
+  // The tracking thread never waits for the output thread:
+  if (output_queue->push(output))
+    output_available.notify_one();
+  else
+    output_dropped++;
+}
+
+/**
+ * \brief Copy a point cloud that keeps changing after being sent (the output thread may publish it later,
+ * and nodelets in the same manager receive the published cloud itself)
+ *
+ * \param[in] cloud the point cloud.
+ *
+ * \return a copy of the cloud.
+ */
+pcl::PointCloud<pcl::PointXYZRGB>::Ptr
+TrackerNodelet::getOutputCloud(const pcl::PointCloud<pcl::PointXYZRGB>::Ptr& cloud)
+{
+  return pcl::PointCloud<pcl::PointXYZRGB>::Ptr(new pcl::PointCloud<pcl::PointXYZRGB>(*cloud));
+}
+
+void
+TrackerNodelet::trackDetections(const std::vector<open_ptrack::detection::Detection>& detections_vector, const std_msgs::Header& header)
+{
+  ros::Time frame_time = header.stamp;
+
+  // Perform detection-track association:
+//      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  tracker->newFrame(detections_vector);
+  tracker->updateTracks();
+//      std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+//      ROS_WARN_STREAM("Track time: " << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+
+  TrackingOutput output;
+
+  // Create a TrackingResult message with the output of the tracking process
+  opt_msgs::TrackArray::Ptr tracking_results_msg(new opt_msgs::TrackArray);
+
+  if(output_tracking_results)
+  {
+    opt_msgs::TrackArray::Ptr tracking_results_msg(new opt_msgs::TrackArray);
+    tracking_results_msg->header.stamp = ros::Time::now();//frame_time;
+    tracking_results_msg->header.frame_id = world_frame_id;
+    tracker->toMsg(tracking_results_msg);
+    // Publish tracking message:
+    output.tracks = tracking_results_msg;
+  }
+
+//      //Show the tracking process' results as an image
+//      if(output_image_rgb)
+//      {
+//        tracker->drawRgb();
+//        for(std::map<std::string, open_ptrack::detection::DetectionSource*>::iterator
+//            it = detection_sources_map.begin(); it != detection_sources_map.end(); it++)
+//        {
+//          cv::Mat image_to_show = it->second->getImage();
+//          if (not vertical)
+//          {
+//            //cv::imshow("TRACKER " + it->first, image_to_show);
+//            cv::imshow("TRACKER ", image_to_show);		// TODO: use the above row if using multiple cameras
+//          }
+//          else
+//          {
+//            cv::flip(image_to_show.t(), image_to_show, -1);
+//            cv::flip(image_to_show, image_to_show, 1);
+//            //cv::imshow("TRACKER " + it->first, image_to_show);
+//            cv::imshow("TRACKER ", image_to_show);		// TODO: use the above row if using multiple cameras
+//          }
+//          cv::waitKey(2);
+//        }
+//      }
+
+  // Publish IDs of active tracks:
+  opt_msgs::IDArray::Ptr alive_ids_msg(new opt_msgs::IDArray);
+  alive_ids_msg->header.stamp = ros::Time::now();
+  alive_ids_msg->header.frame_id = world_frame_id;
+  tracker->getAliveIDs (alive_ids_msg);
+  output.alive_ids = alive_ids_msg;
+
+  // Publish the data assocition result:
+  opt_msgs::Association::Ptr association_msg(new opt_msgs::Association());
+  association_msg->header = header;
+  tracker->getAssociationResult (association_msg);
+  association_msg->tracks = *tracking_results_msg;
+  output.association = association_msg;
+
+  // Show the pose of each tracked object with a 3D marker (to be visualized with ROS RViz)
+  if(output_markers)
+  {
+    visualization_msgs::MarkerArray::Ptr marker_msg(new visualization_msgs::MarkerArray);
+    tracker->toMarkerArray(marker_msg);
+    output.markers = marker_msg;
+  }
+
+  // Show the history of the movements in 3D (3D trajectory) of each tracked object as a PointCloud (which can be visualized in RViz)
+  if(output_history_pointcloud)
+  {
+    history_pointcloud->header.stamp = frame_time.toNSec() / 1e3;  // Convert from ns to us
+    history_pointcloud->header.frame_id = world_frame_id;
+    starting_index = tracker->appendToPointCloud(history_pointcloud, starting_index,
+        output_history_size);
+    output.history = getOutputCloud(history_pointcloud);
+  }
+
+  // Create message for showing detection positions in RViz:
+  if (output_detection_results)
+  {
+    visualization_msgs::MarkerArray::Ptr marker_msg(new visualization_msgs::MarkerArray);
+    detection_history_pointcloud->header.stamp = frame_time.toNSec() / 1e3;  // Convert from ns to us
+    detection_history_pointcloud->header.frame_id = world_frame_id;
+    for (unsigned int i = 0; i < detections_vector.size(); i++)
+    {
+      // Detections of a fusion window can come from different cameras:
+      std::string frame_id = detections_vector[i].getSource()->getFrameId();
+
+      // Define color:
+      int color_index;
+      std::map<std::string, int>::iterator colormap_iterator = color_map.find(frame_id);
+      if (colormap_iterator != color_map.end())
+      { // camera already present
+        color_index = colormap_iterator->second;
+      }
+      else
+      { // camera not present
+        color_index = color_map.size();
+        color_map.insert(std::pair<std::string, int> (frame_id, color_index));
+
+        // Plot legend with camera names and colors:
+        plotCameraLegend (color_map);
+      }
+
+      // Create marker and add it to message:
+      Eigen::Vector3d centroid = detections_vector[i].getWorldCentroid();
+      visualization_msgs::Marker marker = createMarker (i, frame_id, frame_time, centroid, camera_colors[color_index]);
+      marker_msg->markers.push_back(marker);
+
+      // Point cloud:
+      pcl::PointXYZRGB point;
+      point.x = marker.pose.position.x;
+      point.y = marker.pose.position.y;
+      point.z = marker.pose.position.z;
+      point.r = marker.color.r * 255.0f;
+      point.g = marker.color.g * 255.0f;
+      point.b = marker.color.b * 255.0f;
+      detection_insert_index = (detection_insert_index + 1) % detection_history_size;
+      detection_history_pointcloud->points[detection_insert_index] = point;
+    }
+    output.detection_markers = marker_msg; // publish marker message
+    output.detection_history = getOutputCloud(detection_history_pointcloud); // publish trajectory message
+  }
+
+  sendTrackingOutput(output);
+}
+
+/** \brief Order detections by the time of their source. */
+bool
+TrackerNodelet::detectionTimeLess(const open_ptrack::detection::Detection& a, const open_ptrack::detection::Detection& b)
+{
+  return a.getSource()->getTime() < b.getSource()->getTime();
+}
+
+/**
+ * \brief Run a single association round with the detections collected during the fusion window
+ */
+void
+TrackerNodelet::flushFusionWindow()
+{
+  if (fusion_detections.empty())
+    return;
+
+  // Detections are associated in time order:
+  std::vector<open_ptrack::detection::Detection> detections_vector;
+  detections_vector.swap(fusion_detections);
+  std::stable_sort(detections_vector.begin(), detections_vector.end(), detectionTimeLess);
+  fusion_sources.clear();
+
+  trackDetections(detections_vector, fusion_header);
+  fusion_header.stamp = ros::Time(0);
+}
+
+/**
+ * \brief Read the DetectionArray message and use the detections for creating/updating/deleting tracks
+ *
+ * \param[in] msg the DetectionArray message.
+ */
+void
+TrackerNodelet::processDetections(const opt_msgs::DetectionArray::ConstPtr& msg)
+{
+  open_ptrack::opt_utils::ScopedLatencyTimer latency_timer(detection_message_latency);
+
+  // Read message header information:
+  std::string frame_id = msg->header.frame_id;
+  ros::Time frame_time = msg->header.stamp;
+
+  // Compute delay of detection message, if any:
+  double time_delay = 0.0;
+  if (frame_time > latest_time)
+  {
+    latest_time = frame_time;
+    time_delay = 0.0;
+  }
+  else
+  {
+    time_delay = (latest_time - frame_time).toSec();
+  }
+
+  tf::StampedTransform transform;
+  tf::StampedTransform inverse_transform;
+  //	cv_bridge::CvImage::Ptr cvPtr;
+
+  try
+  {
+    // Read transforms between camera frame and world frame:
+    if (!extrinsic_calibration)
+    {
+      static tf::TransformBroadcaster world_to_camera_tf_publisher;
+//      world_to_camera_tf_publisher.sendTransform(tf::StampedTransform(camera_frame_to_world_transform, ros::Time::now(), world_frame_id, frame_id));
+      world_to_camera_tf_publisher.sendTransform(tf::StampedTransform(world_to_camera_frame_transform, ros::Time::now(), frame_id, world_frame_id));
+    }
+    //Calculate direct and inverse transforms between camera and world frame (looked up once per camera):
+    transform_cache->getTransforms(frame_id, transform, inverse_transform);
+    //		cvPtr = cv_bridge::toCvCopy(msg->image, sensor_msgs::image_encodings::BGR8);
+
+    // Read camera intrinsic parameters:
+    Eigen::Matrix3d intrinsic_matrix;
+    for(int i = 0; i < 3; i++)
+      for(int j = 0; j < 3; j++)
+        intrinsic_matrix(i, j) = msg->intrinsic_matrix[i * 3 + j];
+
+    // Close the fusion window when it is over or when this camera already contributed to it
+    // (its DetectionSource is updated below, but buffered detections still refer to the old frame):
+    if ((fusion_window > 0.0) and (not fusion_detections.empty()) and
+        (((frame_time - fusion_window_start).toSec() >= fusion_window) or (fusion_sources.count(frame_id) > 0)))
+      flushFusionWindow();
+    if (fusion_window > 0.0)
+      fusion_sources.insert(frame_id);
+
+    // Add a new DetectionSource or update an existing one:
+    if(detection_sources_map.find(frame_id) == detection_sources_map.end())
+    {
+      detection_sources_map[frame_id] = new open_ptrack::detection::DetectionSource(cv::Mat(0, 0, CV_8UC3),
+          transform, inverse_transform, intrinsic_matrix, frame_time, frame_id);
+    }
+    else
+    {
+      detection_sources_map[frame_id]->update(cv::Mat(0, 0, CV_8UC3), transform, inverse_transform,
+          intrinsic_matrix, frame_time, frame_id);
+      double d = detection_sources_map[frame_id]->getDuration().toSec() / period;
+      int lostFrames = int(round(d)) - 1;
+    }
+    open_ptrack::detection::DetectionSource* source = detection_sources_map[frame_id];
+
+    // Create a Detection object for every detection in the detection message:
+    std::vector<open_ptrack::detection::Detection> detections_vector;
+    for(std::vector<opt_msgs::Detection>::const_iterator it = msg->detections.begin();
+        it != msg->detections.end(); it++)
+    {
+      detections_vector.push_back(open_ptrack::detection::Detection(*it, source));
+    }
+
+    // Convert HOG+SVM confidences to HAAR+ADABOOST-like people detection confidences:
+    if (not std::strcmp(msg->confidence_type.c_str(), "hog+svm"))
+    {
+      for(unsigned int i = 0; i < detections_vector.size(); i++)
+      {
+//        double new_confidence = detections_vector[i].getConfidence();
+//        new_confidence = (new_confidence - min_confidence_detections_sr) / (min_confidence_sr - min_confidence_detections_sr) *
+//                         (min_confidence - min_confidence_detections) + min_confidence_detections;
+//        detections_vector[i].setConfidence(new_confidence+2);
+
+        double new_confidence = detections_vector[i].getConfidence();
+        new_confidence = (new_confidence - (-3)) / 3 * 4 + 2;
+        detections_vector[i].setConfidence(new_confidence);
+
+        //std::cout << detections_vector[i].getConfidence() << std::endl;
+      }
+    }
+
+    // Detection correction by means of calibration refinement:
+    Eigen::Matrix4d registration_matrix = Eigen::Matrix4d::Identity();
+    if (calibration_refinement)
+    {
+      if (strcmp(frame_id.substr(0,1).c_str(), "/") == 0)
+      {
+        frame_id = frame_id.substr(1, frame_id.size() - 1);
+      }
+
+      if (not transform_cache->getRegistrationMatrix(frame_id, registration_matrix))
+      { // camera not present
+        std::cout << "Reading refinement matrix of " << frame_id << " from file." << std::endl;
+        std::string refinement_filename = ros::package::getPath("opt_calibration") + "/conf/registration_" + frame_id + ".txt";
+        std::ifstream f(refinement_filename.c_str());
+        if (f.good()) // if the file exists
+        {
+          f.close();
+          registration_matrix = readMatrixFromFile (refinement_filename);
+          transform_cache->setRegistrationMatrix(frame_id, registration_matrix);
+        }
+        else  // if the file does not exist
+        {
+          // insert the identity matrix
+          std::cout << "Refinement file not found! Not doing refinement for this sensor." << std::endl;
+          registration_matrix = Eigen::Matrix4d::Identity();
+          transform_cache->setRegistrationMatrix(frame_id, registration_matrix);
+        }
+      }
+
+      if(detections_vector.size() > 0)
+      {
+        // Apply detection refinement:
+        for(unsigned int i = 0; i < detections_vector.size(); i++)
+        {
+          Eigen::Vector3d old_centroid = detections_vector[i].getWorldCentroid();
+
+          Eigen::Vector4d old_centroid_homogeneous(old_centroid(0),
+                                                   old_centroid(1),
+                                                   old_centroid(2), 1.0);
+          Eigen::Vector4d refined_centroid = registration_matrix
+              * old_centroid_homogeneous;
+          detections_vector[i].setWorldCentroid(
+                Eigen::Vector3d(refined_centroid(0), refined_centroid(1),
+                                refined_centroid(2)));
+
+          Eigen::Vector3d refined_centroid2 = detections_vector[i].getWorldCentroid();
+//          std::cout << "refined_centroid2: " << refined_centroid2.transpose() << std::endl;
+//          std::cout << "difference: " << (refined_centroid2 - old_centroid).transpose() << std::endl << std::endl;
+        }
+      }
+    }
+
+    // Record the message for tracker_replay:
+    if (detection_log.isOpen())
+    {
+      open_ptrack::tracking::DetectionLogRecord record;
+      record.msg = *msg;
+      record.transform = transform;
+      record.inverse_transform = inverse_transform;
+      record.registration_matrix = registration_matrix;
+      detection_log.write(record);
+    }
+
+    // If at least one detection has been received (detections older than the latest ones are applied by
+    // rolling back the tracks, up to max_detection_delay):
+    if((detections_vector.size() > 0) && (time_delay < max_detection_delay))
+    {
+      if (fusion_window > 0.0)
+      {
+        // Buffer the detections until the end of the fusion window:
+        if (fusion_detections.empty())
+          fusion_window_start = frame_time;
+        fusion_detections.insert(fusion_detections.end(), detections_vector.begin(), detections_vector.end());
+        fusion_header.stamp = std::max(fusion_header.stamp, frame_time);
+        fusion_header.frame_id = world_frame_id;
+      }
+      else
+      {
+        trackDetections(detections_vector, msg->header);
+      }
+    }
+    else // if no detections have been received or detection_delay is above max_detection_delay
+    {
+      if(output_tracking_results)
+      { // Publish an empty tracking message
+        TrackingOutput output;
+        output.tracks.reset(new opt_msgs::TrackArray);
+        output.tracks->header.stamp = frame_time;
+        output.tracks->header.frame_id = world_frame_id;
+        sendTrackingOutput(output);
+      }
+      if((detections_vector.size() > 0) && (time_delay >= max_detection_delay))
+      {
+        if (number_messages_delay_map_.find(msg->header.frame_id) == number_messages_delay_map_.end())
+          number_messages_delay_map_[msg->header.frame_id] = std::pair<double, int>(0.0, 0);
+
+        number_messages_delay_map_[msg->header.frame_id].first += time_delay;
+        number_messages_delay_map_[msg->header.frame_id].second++;
+
+        if (number_messages_delay_map_[msg->header.frame_id].second == 100)
+        {
+          double avg = number_messages_delay_map_[msg->header.frame_id].first / number_messages_delay_map_[msg->header.frame_id].second;
+          ROS_WARN_STREAM("[" << msg->header.frame_id << "] received 100 detections with average delay " << avg << " > " << max_detection_delay);
+          number_messages_delay_map_[msg->header.frame_id] = std::pair<double, int>(0.0, 0);
+        }
+      }
+    }
+  }
+  catch(tf::TransformException& ex)
+  {
+    ROS_ERROR("transform exception: %s If you are seeing just one error like this do not worry, I am probably working!", ex.what());
+  }
+}
+
+/**
+ * \brief Queue a DetectionArray message for the tracking thread (ROS callback thread only)
+ *
+ * \param[in] msg the DetectionArray message.
+ */
+void
+TrackerNodelet::queueDetections(const opt_msgs::DetectionArray::ConstPtr& msg)
+{
+  IngestQueue* queue;
+  std::map<std::string, IngestQueue*>::iterator it = ingest_queue_map.find(msg->header.frame_id);
+  if (it != ingest_queue_map.end())
+  {
+    queue = it->second;
+  }
+  else
+  {
+    size_t index = ingest_queue_count.load(std::memory_order_relaxed);
+    if (index == ingest_queues.size())
+    {
+      ROS_WARN_STREAM_THROTTLE(10.0, "[" << msg->header.frame_id << "] too many cameras, detections dropped");
+      return;
+    }
+    queue = ingest_queues[index].get();
+    queue->frame_id = msg->header.frame_id;
+    ingest_queue_map[queue->frame_id] = queue;
+    ingest_queue_count.store(index + 1, std::memory_order_release);
+  }
+
+  // The callback thread never waits for the tracking thread:
+  if (queue->messages.push(msg))
+    ingest_available.notify_one();
+  else
+    queue->dropped++;
+}
+
+/**
+ * \brief Callback of the DetectionArray messages
+ *
+ * \param[in] msg the DetectionArray message.
+ */
+void
+TrackerNodelet::detection_cb(const opt_msgs::DetectionArray::ConstPtr& msg)
+{
+  std::string frame_id_tmp = msg->header.frame_id;
+  int pos = frame_id_tmp.find("_rgb_optical_frame");
+  if (pos != std::string::npos)
+    frame_id_tmp.replace(pos, std::string("_rgb_optical_frame").size(), "");
+  pos = frame_id_tmp.find("_depth_optical_frame");
+  if (pos != std::string::npos)
+  frame_id_tmp.replace(pos, std::string("_depth_optical_frame").size(), "");
+  last_received_detection_[frame_id_tmp] = msg->header.stamp;
+
+  if (threaded_pipeline)
+    queueDetections(msg);
+  else
+    processDetections(msg);
+}
+
+/**
+ * \brief Close the fusion window if no camera sent detections for a while
+ *
+ * \param[in] now current time.
+ * \param[in] sequencer_delay delay of the input sequencer.
+ */
+void
+TrackerNodelet::checkFusionWindow(const ros::Time& now, const ros::Duration& sequencer_delay)
+{
+  // Do not wait for further messages if the fusion window is over and no camera is sending detections:
+  if ((fusion_window > 0.0) and (not fusion_detections.empty()) and
+      ((now - fusion_window_start) > (ros::Duration(fusion_window) + sequencer_delay)))
+    flushFusionWindow();
+}
+
+/**
+ * \brief Main loop of the tracking thread: process the queued messages, the oldest first
+ *
+ * \param[in] sequencer_delay delay of the input sequencer.
+ */
+void
+TrackerNodelet::trackingLoop(ros::Duration sequencer_delay)
+{
+  while (pipeline_running)
+  {
+    IngestQueue* oldest = NULL;
+    size_t queues = ingest_queue_count.load(std::memory_order_acquire);
+    for (size_t i = 0; i < queues; i++)
+    {
+      opt_msgs::DetectionArray::ConstPtr* msg = ingest_queues[i]->messages.front();
+      if (msg and ((oldest == NULL) or ((*msg)->header.stamp < (*oldest->messages.front())->header.stamp)))
+        oldest = ingest_queues[i].get();
+    }
+
+    if (oldest)
+    {
+      opt_msgs::DetectionArray::ConstPtr msg;
+      oldest->messages.pop(msg);
+      std::lock_guard<std::mutex> lock(tracker_mutex);
+      processDetections(msg);
+    }
+    else
+    {
+      {
+        std::lock_guard<std::mutex> lock(tracker_mutex);
+        checkFusionWindow(ros::Time::now(), sequencer_delay);
+      }
+
+      // Pushes do not take the mutex, so a notification can be missed: wait for a short time only
+      std::unique_lock<std::mutex> lock(ingest_mutex);
+      ingest_available.wait_for(lock, std::chrono::milliseconds(5));
+    }
+  }
+}
+
+/** \brief Main loop of the output thread: publish the queued results */
+void
+TrackerNodelet::outputLoop()
+{
+  while (pipeline_running)
+  {
+    TrackingOutput output;
+    if (output_queue->pop(output))
+    {
+      publishTrackingOutput(output);
+    }
+    else
+    {
+      std::unique_lock<std::mutex> lock(output_mutex);
+      output_available.wait_for(lock, std::chrono::milliseconds(5));
+    }
+  }
+}
+
+void
+TrackerNodelet::generateColors(int colors_number, std::vector<cv::Vec3f>& colors)
+{
+  for (unsigned int i = 0; i < colors_number; i++)
+  {
+    colors.push_back(cv::Vec3f(
+        float(rand() % 256) / 255,
+        float(rand() % 256) / 255,
+        float(rand() % 256) / 255));
+  }
+}
+
+void
+TrackerNodelet::fillChiMap(std::map<double, double>& chi_map, bool velocity_in_motion_term)
+{
+  if (velocity_in_motion_term)		// chi square values with state dimension = 4
+  {
+    chi_map[0.5] = 3.357;
+    chi_map[0.75] = 5.385;
+    chi_map[0.8] = 5.989;
+    chi_map[0.9] = 7.779;
+    chi_map[0.95] = 9.488;
+    chi_map[0.98] = 11.668;
+    chi_map[0.99] = 13.277;
+    chi_map[0.995] = 14.860;
+    chi_map[0.998] = 16.924;
+    chi_map[0.999] = 18.467;
+  }
+  else							              // chi square values with state dimension = 2
+  {
+    chi_map[0.5] = 1.386;
+    chi_map[0.75] = 2.773;
+    chi_map[0.8] = 3.219;
+    chi_map[0.9] = 4.605;
+    chi_map[0.95] = 5.991;
+    chi_map[0.98] = 7.824;
+    chi_map[0.99] = 9.210;
+    chi_map[0.995] = 10.597;
+    chi_map[0.998] = 12.429;
+    chi_map[0.999] = 13.816;
+  }
+}
+
+void
+TrackerNodelet::configCb(Config &config, uint32_t level)
+{
+  std::lock_guard<std::mutex> lock(tracker_mutex);
+  tracker->setMinConfidenceForTrackInitialization (config.min_confidence_initialization);
+  max_detection_delay = config.max_detection_delay;
+  tracker->setStateHistorySize (open_ptrack::tracking::Track::getStateHistorySize(max_detection_delay, period, num_cameras));
+  // Refinement files are read again when the refinement is enabled:
+  if (config.calibration_refinement and not calibration_refinement)
+    transform_cache->invalidateRegistrationMatrices();
+  calibration_refinement = config.calibration_refinement;
+  tracker->setSecBeforeOld (config.sec_before_old);
+  tracker->setSecBeforeFake (config.sec_before_fake);
+  tracker->setSecRemainNew (config.sec_remain_new);
+  tracker->setDetectionsToValidate (config.detections_to_validate);
+  tracker->setDetectorLikelihood (config.detector_likelihood);
+  tracker->setLikelihoodWeights (config.detector_weight*chi_map[0.999]/18.467, config.motion_weight);
+
+//  if (config.velocity_in_motion_term != velocity_in_motion_term)
+//  {
+//    // Take chi square values with regards to the state dimension:
+//    fillChiMap(chi_map, config.velocity_in_motion_term);
+//
+//    double position_variance = config.position_variance_weight*std::pow(2 * voxel_size, 2) / 12.0;
+//    tracker->setVelocityInMotionTerm (config.velocity_in_motion_term, config.acceleration_variance, position_variance);
+//  }
+//  else
+//  {
+    if (config.acceleration_variance != acceleration_variance)
+    {
+      tracker->setAccelerationVariance (config.acceleration_variance);
+    }
+
+    if (config.position_variance_weight != position_variance_weight)
+    {
+      double position_variance = config.position_variance_weight*std::pow(2 * voxel_size, 2) / 12.0;
+      tracker->setPositionVariance (position_variance);
+    }
+//  }
+
+  gate_distance = chi_map.find(config.gate_distance_probability) != chi_map.end() ? chi_map[config.gate_distance_probability] : chi_map[0.999];
+  tracker->setGateDistance (config.gate_distance_probability);
+}
+
+TrackerNodelet::TrackerNodelet() :
+  tf_listener(NULL),
+  tracker(NULL),
+  history_pointcloud(new pcl::PointCloud<pcl::PointXYZRGB>),
+  detection_history_pointcloud(new pcl::PointCloud<pcl::PointXYZRGB>),
+  transform_cache(NULL),
+  detection_message_latency(NULL),
+  threaded_pipeline(false),
+  ingest_queue_count(0),
+  output_dropped(0),
+  pipeline_running(false)
+{
+
+}
+
+TrackerNodelet::~TrackerNodelet()
+{
+  update_timer.stop();
+  if (threaded_pipeline)
+  {
+    pipeline_running = false;
+    if (tracking_thread.joinable())
+      tracking_thread.join();
+    if (output_thread.joinable())
+      output_thread.join();
+  }
+
+  for (std::map<std::string, open_ptrack::detection::DetectionSource*>::iterator it = detection_sources_map.begin();
+      it != detection_sources_map.end(); it++)
+    delete it->second;
+  delete tracker;
+  delete transform_cache;
+  delete tf_listener;
+}
+
+void
+TrackerNodelet::onInit()
+{
+  ros::NodeHandle& nh = getPrivateNodeHandle();
+
+  // Detection messages are sorted by time before processing them, but the sequencer drops the ones older
+  // than the last message it dispatched. With sequencer_delay = 0 messages are processed as soon as they arrive,
+  // and tracks are rolled back for applying late detections, up to the size of their state history (see
+  // Track::getStateHistorySize and Track::update):
+  double sequencer_delay_d;
+  nh.param("sequencer_delay", sequencer_delay_d, 0.5);
+  sequencer_delay = ros::Duration(sequencer_delay_d);
+
+  // Publishers (the subscriber is created at the end, when the tracker is ready):
+  //ros::Subscriber input_sub = nh.subscribe("input", 5, detection_cb);
+  marker_pub_tmp = nh.advertise<visualization_msgs::Marker>("/tracker/markers", 1);
+  marker_pub = nh.advertise<visualization_msgs::MarkerArray>("/tracker/markers_array", 1);
+  pointcloud_pub = nh.advertise<pcl::PointCloud<pcl::PointXYZRGBA> >("/tracker/history", 1);
+  results_pub = nh.advertise<opt_msgs::TrackArray>("/tracker/tracks", 100);
+  detection_marker_pub = nh.advertise<visualization_msgs::MarkerArray>("/detector/markers_array", 1);
+  detection_trajectory_pub = nh.advertise<pcl::PointCloud<pcl::PointXYZRGBA> >("/detector/history", 1);
+  alive_ids_pub = nh.advertise<opt_msgs::IDArray>("/tracker/alive_ids", 1);
+  association_result_pub = nh.advertise<opt_msgs::Association>("/tracker/association_result", 1);
+
+  tf_listener = new tf::TransformListener();
+
+  // Read tracking parameters:
+  nh.param("world_frame_id", world_frame_id, std::string("/odom"));
+
+  nh.param("orientation/vertical", vertical, false);
+  nh.param("extrinsic_calibration", extrinsic_calibration, false);
+
+  nh.param("voxel_size", voxel_size, 0.06);
+
+  double rate;
+  nh.param("rate", rate, 30.0);
+
+//  double min_confidence;
+  nh.param("min_confidence_initialization", min_confidence, -2.5); //0.0);
+
+  double chi_value;
+  nh.param("gate_distance_probability", chi_value, 0.9);
+
+  nh.param("acceleration_variance", acceleration_variance, 1.0);
+
+  nh.param("position_variance_weight", position_variance_weight, 1.0);
+
+  bool detector_likelihood;
+  nh.param("detector_likelihood", detector_likelihood, false);
+
+  nh.param("velocity_in_motion_term", velocity_in_motion_term, false);
+
+  double detector_weight;
+  nh.param("detector_weight", detector_weight, -1.0);
+
+  double motion_weight;
+  nh.param("motion_weight", motion_weight, 0.5);
+
+  double sec_before_old;
+  nh.param("sec_before_old", sec_before_old, 3.6);
+
+  double sec_before_fake;
+  nh.param("sec_before_fake", sec_before_fake, 2.4);
+
+  double sec_remain_new;
+  nh.param("sec_remain_new", sec_remain_new, 1.2);
+
+  int detections_to_validate;
+  nh.param("detections_to_validate", detections_to_validate, 5);
+
+  double haar_disp_ada_min_confidence, ground_based_people_detection_min_confidence;
+  nh.param("haar_disp_ada_min_confidence", haar_disp_ada_min_confidence, -2.5); //0.0);
+  nh.param("ground_based_people_detection_min_confidence", ground_based_people_detection_min_confidence, -2.5); //0.0);
+
+  nh.param("swissranger", swissranger, false);
+
+  nh.param("ground_based_people_detection_min_confidence_sr", min_confidence_detections_sr, -1.5);
+  nh.param("min_confidence_initialization_sr", min_confidence_sr, -1.1);
+
+  nh.param("history_pointcloud", output_history_pointcloud, false);
+  nh.param("history_size", output_history_size, 1000);
+  nh.param("markers", output_markers, true);
+  nh.param("image_rgb", output_image_rgb, true);
+  nh.param("tracking_results", output_tracking_results, true);
+
+  nh.param("detection_debug", output_detection_results, true);
+  nh.param("detection_history_size", detection_history_size, 1000);
+
+  bool debug_mode;
+  nh.param("debug_active", debug_mode, false);
+
+  nh.param("calibration_refinement", calibration_refinement, false);
+  double transform_cache_lifetime;
+  nh.param("transform_cache_lifetime", transform_cache_lifetime, 1.0);
+  std::string detection_log_file;
+  nh.param("detection_log", detection_log_file, std::string(""));
+  if ((not detection_log_file.empty()) and (not detection_log.open(detection_log_file)))
+    ROS_ERROR_STREAM("Cannot create the detection log " << detection_log_file);
+  nh.param("max_detection_delay", max_detection_delay, 3.0);
+  bool latency_profiling;
+  nh.param("latency_profiling", latency_profiling, false);
+  double latency_report_period;
+  nh.param("latency_report_period", latency_report_period, 5.0);
+  std::string latency_log;
+  nh.param("latency_log", latency_log, std::string(""));
+
+  double max_time_between_detections_d;
+  nh.param("max_time_between_detections", max_time_between_detections_d, 10.0);
+  max_time_between_detections_ = ros::Duration(max_time_between_detections_d);
+
+  std::string association_solver;
+  nh.param("association_solver", association_solver, std::string("munkres"));
+  int association_threads;
+  nh.param("association_threads", association_threads, 1);
+  std::string filter_backend;
+  nh.param("filter_backend", filter_backend, std::string("unscented"));
+  std::string track_storage;
+  nh.param("track_storage", track_storage, std::string("list"));
+  nh.param("fusion_window", fusion_window, 0.0);
+  nh.param("threaded_pipeline", threaded_pipeline, false);
+  int ingest_queue_size, output_queue_size;
+  nh.param("ingest_queue_size", ingest_queue_size, 8);
+  nh.param("output_queue_size", output_queue_size, 8);
+
+  // Read number of sensors in the network:
+  num_cameras = 1;
+  if (extrinsic_calibration)
+  {
+    num_cameras = 0;
+    XmlRpc::XmlRpcValue network;
+    nh.getParam("network", network);
+    for (unsigned i = 0; i < network.size(); i++)
+    {
+      num_cameras += network[i]["sensors"].size();
+      for (unsigned j = 0; j < network[i]["sensors"].size(); j++)
+      {
+        std::string frame_id = network[i]["sensors"][j]["id"];
+        last_received_detection_["/" + frame_id] = ros::Time(0);
+      }
+    }
+  }
+
+  // Set min_confidence_detections variable based on sensor type:
+  if (swissranger)
+    min_confidence_detections = ground_based_people_detection_min_confidence;
+  else
+    min_confidence_detections = haar_disp_ada_min_confidence;
+
+  // Take chi square values with regards to the state dimension:
+  fillChiMap(chi_map, velocity_in_motion_term);
+
+  // Compute additional parameters:
+  period = 1.0 / rate;
+  gate_distance = chi_map.find(chi_value) != chi_map.end() ? chi_map[chi_value] : chi_map[0.999];
+
+  double position_variance;
+//  position_variance = 3*std::pow(2 * voxel_size, 2) / 12.0; // DEFAULT
+  position_variance = position_variance_weight*std::pow(2 * voxel_size, 2) / 12.0;
+  std::vector<double> likelihood_weights;
+  likelihood_weights.push_back(detector_weight*chi_map[0.999]/18.467);
+  likelihood_weights.push_back(motion_weight);
+
+  // Generate colors used to identify different cameras:
+  generateColors(num_cameras, camera_colors);
+
+  // Initialize point cloud containing detections trajectory:
+  pcl::PointXYZRGB nan_point;
+  nan_point.x = std::numeric_limits<float>::quiet_NaN();
+  nan_point.y = std::numeric_limits<float>::quiet_NaN();
+  nan_point.z = std::numeric_limits<float>::quiet_NaN();
+  detection_history_pointcloud->points.resize(detection_history_size, nan_point);
+
+//  cv::namedWindow("TRACKER ", CV_WINDOW_NORMAL);
+
+  // Initialize an instance of the Tracker object:
+  tracker = new open_ptrack::tracking::Tracker(
+      gate_distance,
+      detector_likelihood,
+      likelihood_weights,
+      velocity_in_motion_term,
+      min_confidence,
+      min_confidence_detections,
+      sec_before_old,
+      sec_before_fake,
+      sec_remain_new,
+      detections_to_validate,
+      period,
+      position_variance,
+      acceleration_variance,
+      world_frame_id,
+      debug_mode,
+      vertical);
+
+  // Select the algorithm used to solve the Global Nearest Neighbor problem:
+  if (association_solver == "sparse_lap")
+    tracker->setAssociationSolver (open_ptrack::tracking::SPARSE_LAP);
+  else if (association_solver != "munkres")
+    ROS_WARN_STREAM("Unknown association_solver " << association_solver << ", using munkres.");
+  tracker->setAssociationThreads (association_threads);
+
+  // Select the algorithm used by the Kalman filters of the tracks:
+  if (filter_backend == "closed_form")
+    tracker->setFilterBackend (open_ptrack::tracking::CLOSED_FORM);
+  else if (filter_backend != "unscented")
+    ROS_WARN_STREAM("Unknown filter_backend " << filter_backend << ", using unscented.");
+
+  // Tracks keep the updates of the last max_detection_delay seconds of all cameras for applying late detections:
+  tracker->setStateHistorySize (open_ptrack::tracking::Track::getStateHistorySize(max_detection_delay, period, num_cameras));
+
+  // Select how tracks are stored while computing the distance matrix:
+  if (track_storage == "table")
+    tracker->setTrackStorage (open_ptrack::tracking::TRACK_TABLE);
+  else if (track_storage != "list")
+    ROS_WARN_STREAM("Unknown track_storage " << track_storage << ", using list.");
+
+  // Latency profiling of the tracking stages:
+  latency_profiler.reset(new open_ptrack::opt_utils::LatencyProfiler(latency_profiling));
+  if (latency_profiling)
+  {
+    tracker->setLatencyProfiler (latency_profiler.get());
+    detection_message_latency = latency_profiler->getHistogram("tracker/detection_message");
+    latency_reporter.reset(new open_ptrack::opt_utils::LatencyReporter(nh, *latency_profiler, getName(),
+        latency_report_period, latency_log));
+  }
+
+  starting_index = 0;
+
+  // Cache of the camera transforms:
+  transform_cache = new open_ptrack::tracking::TransformCache(tf_listener, world_frame_id, transform_cache_lifetime);
+  transform_cache->subscribe(nh);
+
+  // Set up dynamic reconfiguration
+  ReconfigureServer::CallbackType f = boost::bind(&TrackerNodelet::configCb, this, _1, _2);
+  reconfigure_server_.reset(new ReconfigureServer(config_mutex_, nh));
+  reconfigure_server_->setCallback(f);
+
+  // If extrinsic calibration is not available:
+  if (!extrinsic_calibration)
+  { // Set fixed transformation from rgb frame and base_link
+    tf::Vector3 fixed_translation(0, 0, 0);                  // camera_rgb_optical_frame -> world
+    tf::Quaternion fixed_rotation(-0.5, 0.5, -0.5, -0.5);	// camera_rgb_optical_frame -> world
+    tf::Vector3 inv_fixed_translation(0.0, 0.0, 0);			// world -> camera_rgb_optical_frame
+    tf::Quaternion inv_fixed_rotation(-0.5, 0.5, -0.5, 0.5);	// world -> camera_rgb_optical_frame
+    world_to_camera_frame_transform = tf::Transform(fixed_rotation, fixed_translation);
+    camera_frame_to_world_transform = tf::Transform(inv_fixed_rotation, inv_fixed_translation);
+  }
+
+  for (std::map<std::string, ros::Time>::const_iterator it = last_received_detection_.begin(); it != last_received_detection_.end(); ++it)
+    last_message[it->first] = ros::Time::now();
+
+  last_camera_legend_update = ros::Time::now();
+
+  // Start the threaded pipeline:
+  last_drop_report = ros::Time::now();
+  if (threaded_pipeline)
+  {
+    for (size_t i = 0; i < MAX_INGEST_QUEUES; i++)
+      ingest_queues.push_back(boost::shared_ptr<IngestQueue>(new IngestQueue(std::max(ingest_queue_size, 1))));
+    output_queue.reset(new open_ptrack::opt_utils::SpscQueue<TrackingOutput>(std::max(output_queue_size, 1)));
+    pipeline_running = true;
+    tracking_thread = std::thread(&TrackerNodelet::trackingLoop, this, sequencer_delay);
+    output_thread = std::thread(&TrackerNodelet::outputLoop, this);
+  }
+
+  // Subscriber:
+  boost::function<void(const opt_msgs::DetectionArrayConstPtr&)> input_cb(
+      boost::bind(&TrackerNodelet::detection_cb, this, _1));
+  input_sub.subscribe(nh, "input", 5);
+  if (sequencer_delay > ros::Duration(0.0))
+  {
+    input_seq.reset(new message_filters::TimeSequencer<opt_msgs::DetectionArray>(input_sub, sequencer_delay,
+        ros::Duration(0.01), 512));
+    input_seq->registerCallback(input_cb);
+  }
+  else
+  {
+    input_sub.registerCallback(input_cb);
+  }
+
+  // Periodic checks, once for every expected detection message:
+  update_timer = nh.createTimer(ros::Duration(1.0 / (std::max(num_cameras, 1) * rate)),
+      &TrackerNodelet::updateCallback, this);
+}
+
+/**
+ * \brief Check the input messages and update the camera legend (this was the main loop of the node)
+ *
+ * \param[in] event the timer event.
+ */
+void
+TrackerNodelet::updateCallback(const ros::TimerEvent& event)
+{
+  ros::Time now = ros::Time::now();
+
+  if (not threaded_pipeline)
+  {
+    checkFusionWindow(now, sequencer_delay);
+  }
+  else if ((now - last_drop_report) > ros::Duration(10.0))
+  {
+    // Report the messages dropped because the tracking or the output thread were too slow:
+    for (size_t i = 0; i < ingest_queue_count; i++)
+    {
+      unsigned long dropped = ingest_queues[i]->dropped.exchange(0);
+      if (dropped > 0)
+        ROS_WARN_STREAM("[" << ingest_queues[i]->frame_id << "] dropped " << dropped << " detection messages in the last "
+            << (now - last_drop_report).toSec() << " seconds (tracking is too slow)");
+    }
+    unsigned long dropped = output_dropped.exchange(0);
+    if (dropped > 0)
+      ROS_WARN_STREAM("Dropped " << dropped << " tracking outputs in the last " << (now - last_drop_report).toSec()
+          << " seconds (publishing is too slow)");
+    last_drop_report = now;
+  }
+
+  for (std::map<std::string, ros::Time>::const_iterator it = last_received_detection_.begin(); it != last_received_detection_.end(); ++it)
+  {
+    ros::Duration duration(now - it->second);
+    if (duration > max_time_between_detections_)
+    {
+      if (it->second > ros::Time(0) and now - last_message[it->first] > max_time_between_detections_)
+      {
+        ROS_WARN_STREAM("[" << it->first << "] last detection was " << duration.toSec() << " seconds ago");
+        last_message[it->first] = now;
+      }
+      else if (now - last_message[it->first] > max_time_between_detections_)
+      {
+        ROS_WARN_STREAM("[" << it->first << "] still waiting for detection messages...");
+        last_message[it->first] = now;
+      }
+    }
+
+    // Update camera legend every second:
+    if ((now - last_camera_legend_update) > ros::Duration(1.0))    // if more than one second passed since last update
+    { // update OpenCV image with a waitKey:
+      cv::waitKey(1);
+      last_camera_legend_update = now;
+    }
+  }
+}
+
+} // namespace tracking
+} // namespace open_ptrack
+
+PLUGINLIB_EXPORT_CLASS(open_ptrack::tracking::TrackerNodelet, nodelet::Nodelet)
@@ -57,6 +57,7 @@
 #include <open_ptrack/detection/detection.h>
 #include <open_ptrack/detection/detection_source.h>
 #include <open_ptrack/tracking/tracker_object.h>
+#include <open_ptrack/tracking/transform_cache.h>
 #include <opt_msgs/Detection.h>
 #include <opt_msgs/DetectionArray.h>
 #include <opt_msgs/TrackArray.h>
@@ -119,7 +120,7 @@ double position_variance_weight;
 double voxel_size;
 double gate_distance;
 bool calibration_refinement;
-std::map<std::string, Eigen::Matrix4d> registration_matrices;
+open_ptrack::tracking::TransformCache* transform_cache;
 double max_detection_delay;
 ros::Time latest_time;
 
@@ -255,9 +256,8 @@ detection_cb(const opt_msgs::DetectionArray::ConstPtr& msg)
                                 frame_id_tmp , world_frame_id));
     }
 
-    //Calculate direct and inverse transforms between camera and world frame:
-    tf_listener->lookupTransform(world_frame_id, frame_id, ros::Time(0), transform);
-    tf_listener->lookupTransform(frame_id, world_frame_id, ros::Time(0), inverse_transform);
+    //Calculate direct and inverse transforms between camera and world frame (looked up once per camera):
+    transform_cache->getTransforms(frame_id, transform, inverse_transform);
 
     //		cvPtr = cv_bridge::toCvCopy(msg->image, sensor_msgs::image_encodings::BGR8);
 
@@ -317,12 +317,7 @@ detection_cb(const opt_msgs::DetectionArray::ConstPtr& msg)
       }
 
       Eigen::Matrix4d registration_matrix;
-      std::map<std::string, Eigen::Matrix4d>::iterator registration_matrices_iterator = registration_matrices.find(frame_id);
-      if (registration_matrices_iterator != registration_matrices.end())
-      { // camera already present
-        registration_matrix = registration_matrices_iterator->second;
-      }
-      else
+      if (not transform_cache->getRegistrationMatrix(frame_id, registration_matrix))
       { // camera not present
         std::cout << "Reading refinement matrix of " << frame_id << " from file." << std::endl;
         std::string refinement_filename = ros::package::getPath("opt_calibration") + "/conf/registration_" + frame_id + ".txt";
@@ -331,13 +326,14 @@ detection_cb(const opt_msgs::DetectionArray::ConstPtr& msg)
         {
           f.close();
           registration_matrix = readMatrixFromFile (refinement_filename);
-          registration_matrices.insert(std::pair<std::string, Eigen::Matrix4d> (frame_id, registration_matrix));
+          transform_cache->setRegistrationMatrix(frame_id, registration_matrix);
         }
         else  // if the file does not exist
         {
           // insert the identity matrix
           std::cout << "Refinement file not found! Not doing refinement for this sensor." << std::endl;
-          registration_matrices.insert(std::pair<std::string, Eigen::Matrix4d> (frame_id, Eigen::Matrix4d::Identity()));
+          registration_matrix = Eigen::Matrix4d::Identity();
+          transform_cache->setRegistrationMatrix(frame_id, registration_matrix);
         }
       }
 
@@ -573,6 +569,9 @@ configCb(Config &config, uint32_t level)
 {
   tracker_object->setMinConfidenceForTrackInitialization (config.min_confidence_initialization);
   max_detection_delay = config.max_detection_delay;
+  // Refinement files are read again when the refinement is enabled:
+  if (config.calibration_refinement and not calibration_refinement)
+    transform_cache->invalidateRegistrationMatrices();
   calibration_refinement = config.calibration_refinement;
   tracker_object->setSecBeforeOld (config.sec_before_old);
   tracker_object->setSecBeforeFake (config.sec_before_fake);
@@ -697,12 +696,21 @@ main(int argc, char** argv)
   nh.param("debug_active", debug_mode, false);
 
   nh.param("calibration_refinement", calibration_refinement, false);
+  double transform_cache_lifetime;
+  nh.param("transform_cache_lifetime", transform_cache_lifetime, 1.0);
   nh.param("max_detection_delay", max_detection_delay, 3.0);
 
   double max_time_between_detections_d;
   nh.param("max_time_between_detections", max_time_between_detections_d, 10.0);
   max_time_between_detections_ = ros::Duration(max_time_between_detections_d);
 
+  std::string association_solver;
+  nh.param("association_solver", association_solver, std::string("munkres"));
+  int association_threads;
+  nh.param("association_threads", association_threads, 1);
+  std::string filter_backend;
+  nh.param("filter_backend", filter_backend, std::string("unscented"));
+
   // Read number of sensors in the network:
   int num_cameras = 1;
   if (extrinsic_calibration)
@@ -774,8 +782,25 @@ main(int argc, char** argv)
       debug_mode,
       vertical);
 
+  // Select the algorithm used to solve the Global Nearest Neighbor problem:
+  if (association_solver == "sparse_lap")
+    tracker_object->setAssociationSolver (open_ptrack::tracking::SPARSE_LAP);
+  else if (association_solver != "munkres")
+    ROS_WARN_STREAM("Unknown association_solver " << association_solver << ", using munkres.");
+  tracker_object->setAssociationThreads (association_threads);
+
+  // Select the algorithm used by the Kalman filters of the tracks:
+  if (filter_backend == "closed_form")
+    tracker_object->setFilterBackend (open_ptrack::tracking::CLOSED_FORM);
+  else if (filter_backend != "unscented")
+    ROS_WARN_STREAM("Unknown filter_backend " << filter_backend << ", using unscented.");
+
   starting_index = 0;
 
+  // Cache of the camera transforms:
+  transform_cache = new open_ptrack::tracking::TransformCache(tf_listener, world_frame_id, transform_cache_lifetime);
+  transform_cache->subscribe(nh);
+
   // Set up dynamic reconfiguration
   ReconfigureServer::CallbackType f = boost::bind(&configCb, _1, _2);
   reconfigure_server_.reset(new ReconfigureServer(config_mutex_, nh));
@@ -0,0 +1,337 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <opencv2/opencv.hpp>
+#include <open_ptrack/detection/detection.h>
+#include <open_ptrack/detection/detection_source.h>
+#include <open_ptrack/tracking/detection_log.h>
+#include <open_ptrack/tracking/tracker.h>
+#include <open_ptrack/tracking/tracker3d.h>
+#include <opt_msgs/TrackArray.h>
+#include <opt_msgs/Track3DArray.h>
+
+// Replay a detection log through Tracker or Tracker3D as fast as possible, without a ROS master.
+// Logs are recorded by the tracker and tracker3d nodes when their detection_log parameter is set.
+// Messages are processed as the nodes do (confidence conversion, calibration refinement, max_detection_delay),
+// and the tracks after every association round are written to a text file, so that the outputs of two builds
+// can be compared with diff. Throughput is printed at the end.
+//
+// Usage: tracker_replay <log> <output> [--tracker 2d|3d] [--<parameter> <value> ...]
+// Parameters have the names and the defaults of conf/tracker.yaml (e.g. --association_solver sparse_lap).
+// --cameras <number> sizes the state history of the tracks for the cameras of the log, as the node does.
+
+namespace
+{
+  typedef std::map<std::string, std::string> Parameters;
+
+  double
+  getParameter(const Parameters& parameters, const std::string& name, double default_value)
+  {
+    Parameters::const_iterator it = parameters.find(name);
+    return (it != parameters.end()) ? std::atof(it->second.c_str()) : default_value;
+  }
+
+  std::string
+  getParameter(const Parameters& parameters, const std::string& name, const std::string& default_value)
+  {
+    Parameters::const_iterator it = parameters.find(name);
+    return (it != parameters.end()) ? it->second : default_value;
+  }
+
+  // Chi square values (see fillChiMap in tracker_node.cpp):
+  double
+  getChiSquare(double probability, bool velocity_in_motion_term)
+  {
+    const double probabilities[] = {0.5, 0.75, 0.8, 0.9, 0.95, 0.98, 0.99, 0.995, 0.998, 0.999};
+    const double chi_square_2d[] = {1.386, 2.773, 3.219, 4.605, 5.991, 7.824, 9.210, 10.597, 12.429, 13.816};
+    const double chi_square_4d[] = {3.357, 5.385, 5.989, 7.779, 9.488, 11.668, 13.277, 14.860, 16.924, 18.467};
+    int index = 9;
+    for (int i = 0; i < 10; i++)
+      if (probabilities[i] == probability)
+        index = i;
+    return velocity_in_motion_term ? chi_square_4d[index] : chi_square_2d[index];
+  }
+
+  void
+  writeTracks(std::ofstream& output, const ros::Time& time, const opt_msgs::TrackArray& tracks)
+  {
+    for (size_t i = 0; i < tracks.tracks.size(); i++)
+    {
+      const opt_msgs::Track& t = tracks.tracks[i];
+      output << time.sec << "." << std::setw(9) << std::setfill('0') << time.nsec << std::setfill(' ') << " "
+          << t.id << " " << t.x << " " << t.y << " " << t.height << " " << t.distance << " " << t.age << " "
+          << t.confidence << " " << int(t.visibility) << "\n";
+    }
+  }
+
+  void
+  writeTracks(std::ofstream& output, const ros::Time& time, const opt_msgs::Track3DArray& tracks)
+  {
+    for (size_t i = 0; i < tracks.tracks.size(); i++)
+    {
+      const opt_msgs::Track3D& t = tracks.tracks[i];
+      output << time.sec << "." << std::setw(9) << std::setfill('0') << time.nsec << std::setfill(' ') << " "
+          << t.id << " " << t.x << " " << t.y << " " << t.z << " " << t.height << " " << t.distance << " "
+          << t.age << " " << t.confidence << " " << int(t.visibility) << "\n";
+    }
+  }
+
+  struct ReplayStatistics
+  {
+    ReplayStatistics() : messages(0), rounds(0), detections(0), tracking_seconds(0.0) {}
+
+    int messages;
+    int rounds;
+    int detections;
+    double tracking_seconds;    // spent in newFrame and updateTracks
+  };
+
+  template <class TrackerT, class TrackArrayT>
+  void
+  replay(open_ptrack::tracking::DetectionLogReader& reader, TrackerT& tracker, const std::string& world_frame_id,
+      double max_detection_delay, std::ofstream& output, ReplayStatistics& statistics)
+  {
+    std::map<std::string, open_ptrack::detection::DetectionSource*> detection_sources_map;
+    ros::Time latest_time;
+
+    open_ptrack::tracking::DetectionLogRecord record;
+    while (reader.read(record))
+    {
+      const opt_msgs::DetectionArray& msg = record.msg;
+      const std::string& frame_id = msg.header.frame_id;
+      ros::Time frame_time = msg.header.stamp;
+      statistics.messages++;
+
+      // Compute delay of detection message, if any:
+      double time_delay = 0.0;
+      if (frame_time > latest_time)
+        latest_time = frame_time;
+      else
+        time_delay = (latest_time - frame_time).toSec();
+
+      tf::StampedTransform transform(record.transform, frame_time, world_frame_id, frame_id);
+      tf::StampedTransform inverse_transform(record.inverse_transform, frame_time, frame_id, world_frame_id);
+      Eigen::Matrix3d intrinsic_matrix;
+      for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+          intrinsic_matrix(i, j) = msg.intrinsic_matrix[i * 3 + j];
+
+      // Add a new DetectionSource or update an existing one:
+      if(detection_sources_map.find(frame_id) == detection_sources_map.end())
+      {
+        detection_sources_map[frame_id] = new open_ptrack::detection::DetectionSource(cv::Mat(0, 0, CV_8UC3),
+            transform, inverse_transform, intrinsic_matrix, frame_time, frame_id);
+      }
+      else
+      {
+        detection_sources_map[frame_id]->update(cv::Mat(0, 0, CV_8UC3), transform, inverse_transform,
+            intrinsic_matrix, frame_time, frame_id);
+      }
+      open_ptrack::detection::DetectionSource* source = detection_sources_map[frame_id];
+
+      std::vector<open_ptrack::detection::Detection> detections_vector;
+      for(std::vector<opt_msgs::Detection>::const_iterator it = msg.detections.begin();
+          it != msg.detections.end(); it++)
+      {
+        detections_vector.push_back(open_ptrack::detection::Detection(*it, source));
+
+        // Convert HOG+SVM confidences to HAAR+ADABOOST-like people detection confidences:
+        if (not std::strcmp(msg.confidence_type.c_str(), "hog+svm"))
+          detections_vector.back().setConfidence((detections_vector.back().getConfidence() - (-3)) / 3 * 4 + 2);
+
+        // Detection correction by means of calibration refinement (identity if it was disabled):
+        Eigen::Vector3d centroid = detections_vector.back().getWorldCentroid();
+        Eigen::Vector4d refined_centroid = record.registration_matrix * Eigen::Vector4d(centroid(0), centroid(1),
+            centroid(2), 1.0);
+        detections_vector.back().setWorldCentroid(refined_centroid.head<3>());
+      }
+
+      if((detections_vector.size() > 0) && (time_delay < max_detection_delay))
+      {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        tracker.newFrame(detections_vector);
+        tracker.updateTracks();
+        statistics.tracking_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        statistics.rounds++;
+        statistics.detections += detections_vector.size();
+
+        typename TrackArrayT::Ptr tracks(new TrackArrayT);
+        tracker.toMsg(tracks);
+        writeTracks(output, frame_time, *tracks);
+      }
+    }
+
+    for (std::map<std::string, open_ptrack::detection::DetectionSource*>::iterator it = detection_sources_map.begin();
+        it != detection_sources_map.end(); it++)
+      delete it->second;
+  }
+
+  // Settings shared by Tracker and Tracker3D:
+  template <class TrackerT>
+  void
+  configureTracker(TrackerT& tracker, const Parameters& parameters)
+  {
+    std::string association_solver = getParameter(parameters, "association_solver", std::string("munkres"));
+    if (association_solver == "sparse_lap")
+      tracker.setAssociationSolver(open_ptrack::tracking::SPARSE_LAP);
+    else if (association_solver != "munkres")
+      std::cerr << "Unknown association_solver " << association_solver << ", using munkres." << std::endl;
+    tracker.setAssociationThreads(int(getParameter(parameters, "association_threads", 1.0)));
+
+    std::string filter_backend = getParameter(parameters, "filter_backend", std::string("unscented"));
+    if (filter_backend == "closed_form")
+      tracker.setFilterBackend(open_ptrack::tracking::CLOSED_FORM);
+    else if (filter_backend != "unscented")
+      std::cerr << "Unknown filter_backend " << filter_backend << ", using unscented." << std::endl;
+  }
+}
+
+int
+main(int argc, char** argv)
+{
+  if ((argc < 3) or (argc % 2 == 0))
+  {
+    std::cerr << "Usage: " << argv[0] << " <log> <output> [--tracker 2d|3d] [--<parameter> <value> ...]" << std::endl;
+    return 1;
+  }
+
+  Parameters parameters;
+  for (int i = 3; i + 1 < argc; i += 2)
+  {
+    if (std::strncmp(argv[i], "--", 2) != 0)
+    {
+      std::cerr << "Invalid option " << argv[i] << std::endl;
+      return 1;
+    }
+    parameters[argv[i] + 2] = argv[i + 1];
+  }
+
+  open_ptrack::tracking::DetectionLogReader reader;
+  if (not reader.open(argv[1]))
+  {
+    std::cerr << "Cannot read the detection log " << argv[1] << std::endl;
+    return 1;
+  }
+  std::ofstream output(argv[2]);
+  if (not output.is_open())
+  {
+    std::cerr << "Cannot create " << argv[2] << std::endl;
+    return 1;
+  }
+  output << std::setprecision(10);
+
+  // No ROS master: times come from the log only
+  ros::Time::init();
+
+  // Tracking parameters (as in tracker_node.cpp):
+  std::string world_frame_id = getParameter(parameters, "world_frame_id", std::string("/world"));
+  bool velocity_in_motion_term = getParameter(parameters, "velocity_in_motion_term", 1.0) != 0.0;
+  double voxel_size = getParameter(parameters, "voxel_size", 0.06);
+  double position_variance = getParameter(parameters, "position_variance_weight", 30.0) * std::pow(2 * voxel_size, 2) / 12.0;
+  std::vector<double> likelihood_weights;
+  likelihood_weights.push_back(getParameter(parameters, "detector_weight", -0.25) *
+      getChiSquare(0.999, velocity_in_motion_term) / 18.467);
+  likelihood_weights.push_back(getParameter(parameters, "motion_weight", 0.25));
+  double gate_distance = getChiSquare(getParameter(parameters, "gate_distance_probability", 0.999),
+      velocity_in_motion_term);
+  bool detector_likelihood = getParameter(parameters, "detector_likelihood", 1.0) != 0.0;
+  double min_confidence = getParameter(parameters, "min_confidence_initialization", 0.0);
+  double min_confidence_detections = getParameter(parameters, "haar_disp_ada_min_confidence", -2.5);
+  double sec_before_old = getParameter(parameters, "sec_before_old", 8.0);
+  double sec_before_fake = getParameter(parameters, "sec_before_fake", 2.4);
+  double sec_remain_new = getParameter(parameters, "sec_remain_new", 1.2);
+  int detections_to_validate = int(getParameter(parameters, "detections_to_validate", 3.0));
+  double period = 1.0 / getParameter(parameters, "rate", 10.0);
+  double acceleration_variance = getParameter(parameters, "acceleration_variance", 100.0);
+  bool vertical = getParameter(parameters, "vertical", 0.0) != 0.0;
+  double max_detection_delay = getParameter(parameters, "max_detection_delay", 3.0);
+
+  ReplayStatistics statistics;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::string tracker_type = getParameter(parameters, "tracker", std::string("2d"));
+  if (tracker_type == "3d")
+  {
+    open_ptrack::tracking::Tracker3D tracker(gate_distance, detector_likelihood, likelihood_weights,
+        velocity_in_motion_term, min_confidence, min_confidence_detections, sec_before_old, sec_before_fake,
+        sec_remain_new, detections_to_validate, period, position_variance, acceleration_variance, world_frame_id,
+        false, vertical);
+    configureTracker(tracker, parameters);
+    replay<open_ptrack::tracking::Tracker3D, opt_msgs::Track3DArray>(reader, tracker, world_frame_id,
+        max_detection_delay, output, statistics);
+  }
+  else if (tracker_type == "2d")
+  {
+    open_ptrack::tracking::Tracker tracker(gate_distance, detector_likelihood, likelihood_weights,
+        velocity_in_motion_term, min_confidence, min_confidence_detections, sec_before_old, sec_before_fake,
+        sec_remain_new, detections_to_validate, period, position_variance, acceleration_variance, world_frame_id,
+        false, vertical);
+    configureTracker(tracker, parameters);
+    if (getParameter(parameters, "track_storage", std::string("list")) == "table")
+      tracker.setTrackStorage(open_ptrack::tracking::TRACK_TABLE);
+    // The number of cameras is not in the log, the node reads it from the network of the calibration:
+    tracker.setStateHistorySize(open_ptrack::tracking::Track::getStateHistorySize(max_detection_delay, period,
+        int(getParameter(parameters, "cameras", 1.0))));
+    replay<open_ptrack::tracking::Tracker, opt_msgs::TrackArray>(reader, tracker, world_frame_id,
+        max_detection_delay, output, statistics);
+  }
+  else
+  {
+    std::cerr << "Unknown tracker " << tracker_type << std::endl;
+    return 1;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << statistics.messages << " messages, " << statistics.rounds << " association rounds, "
+      << statistics.detections << " detections" << std::endl;
+  std::cout << "total: " << seconds << " s (" << statistics.messages / seconds << " messages/s)" << std::endl;
+  std::cout << "tracking: " << statistics.tracking_seconds << " s ("
+      << statistics.rounds / statistics.tracking_seconds << " rounds/s, "
+      << 1e6 * statistics.tracking_seconds / std::max(statistics.rounds, 1) << " us/round)" << std::endl;
+  return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_CLOSED_FORM_KALMAN_FILTER_H_
+#define OPEN_PTRACK_TRACKING_CLOSED_FORM_KALMAN_FILTER_H_
+
+#include <Eigen/Eigen>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief Algorithms available for running the constant velocity Kalman filter of a track */
+    enum FilterBackend
+    {
+      UNSCENTED,    // Unscented_scheme of the bayes package (sigma points over dynamically sized matrices)
+      CLOSED_FORM   // Closed-form Kalman equations over fixed-size matrices (see ClosedFormKalmanFilter)
+    };
+
+    /**
+     * \brief Compute the process noise covariance of a constant velocity model along one axis over a time interval.
+     *
+     * As in the single step model, acceleration is white noise held constant for one period. Thus, for intervals which
+     * are multiples of the period, the result is the one of repeated single step predictions, in closed form:
+     * n steps of length h accumulate q*h*[T^3/3 - T*h^2/12, T^2/2; T^2/2, T] with T = n*h.
+     * Intervals shorter than the period are a single step of that length.
+     *
+     * \param[in] interval Prediction interval.
+     * \param[in] period Period of the single step model.
+     * \param[in] acceleration_variance Acceleration variance.
+     * \param[out] pp Position variance.
+     * \param[out] pv Position/velocity covariance.
+     * \param[out] vv Velocity variance.
+     */
+    inline void
+    getProcessNoise(double interval, double period, double acceleration_variance, double& pp, double& pv, double& vv)
+    {
+      double t = interval;
+      if (t <= period)
+      {
+        pp = acceleration_variance * t * t * t * t / 4.0;
+        pv = acceleration_variance * t * t * t / 2.0;
+        vv = acceleration_variance * t * t;
+      }
+      else
+      {
+        double h = period;
+        pp = acceleration_variance * h * (t * t * t / 3.0 - t * h * h / 12.0);
+        pv = acceleration_variance * h * t * t / 2.0;
+        vv = acceleration_variance * h * t;
+      }
+    }
+
+    /** \brief ClosedFormKalmanFilter implements the Kalman equations of a constant velocity model with fixed-size matrices
+     *
+     *  The state is made of D position components followed by D velocity components. Since prediction and observation
+     *  models are linear, the Kalman equations give the same result of the Unscented_scheme, but no sigma point is
+     *  generated and no memory is allocated on the heap.
+     *  Observations are the first N state components (N = D for position only, N = 2*D for position and velocity).
+     **/
+    template <int D>
+    class ClosedFormKalmanFilter
+    {
+      public:
+
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        typedef Eigen::Matrix<double, 2*D, 1> StateVector;
+        typedef Eigen::Matrix<double, 2*D, 2*D> StateMatrix;
+
+        /** \brief Constructor. */
+        ClosedFormKalmanFilter() :
+          x_(StateVector::Zero()), X_(StateMatrix::Zero()), dt_(0.0), acceleration_variance_(0.0),
+          F_(StateMatrix::Identity()), Q_(StateMatrix::Zero()),
+          Zv_(StateVector::Zero()), SI_(StateMatrix::Zero()), observation_size_(0)
+        {
+
+        }
+
+        /**
+         * \brief Set the constant velocity prediction model.
+         *
+         * \param[in] dt Time interval.
+         * \param[in] acceleration_variance Acceleration variance.
+         */
+        void
+        setPredictModel(double dt, double acceleration_variance)
+        {
+          dt_ = dt;
+          acceleration_variance_ = acceleration_variance;
+
+          // Transition matrix:
+          F_.setIdentity();
+          for(int i = 0; i < D; i++)
+            F_(i, D + i) = dt;
+
+          // Process noise Q = G q G', with acceleration as noise input:
+          Eigen::Matrix<double, 2*D, D> G = Eigen::Matrix<double, 2*D, D>::Zero();
+          for(int i = 0; i < D; i++)
+          {
+            G(i, i) = dt * dt / 2.0;
+            G(D + i, i) = dt;
+          }
+          Q_ = acceleration_variance * G * G.transpose();
+        }
+
+        /**
+         * \brief Set the variance of an observation component.
+         *
+         * \param[in] i Component index.
+         * \param[in] variance Observation noise variance.
+         */
+        void
+        setObservationVariance(int i, double variance)
+        {
+          Zv_(i) = variance;
+        }
+
+        /**
+         * \brief Filter initialization.
+         *
+         * \param[in] x Initial state.
+         * \param[in] X Initial state covariance.
+         */
+        void
+        init(const StateVector& x, const StateMatrix& X)
+        {
+          x_ = x;
+          X_ = X;
+        }
+
+        /** \brief Prediction step. */
+        void
+        predict()
+        {
+          x_ = F_ * x_;
+          X_ = F_ * X_ * F_.transpose() + Q_;
+        }
+
+        /**
+         * \brief Prediction step over an arbitrary time interval (see getProcessNoise()).
+         *
+         * \param[in] interval Prediction interval (nothing is done if it is not positive).
+         */
+        void
+        predict(double interval)
+        {
+          if (not (interval > 0.0))
+            return;
+
+          StateMatrix F, Q;
+          getTransition(interval, F, Q);
+          x_ = F * x_;
+          X_ = F * X_ * F.transpose() + Q;
+        }
+
+        /**
+         * \brief Predict state and innovation covariance at a later time, without changing the filter.
+         *
+         * The innovation covariance is built with the current observation variances.
+         *
+         * \param[in] interval Time elapsed since the last update (the current state is used if it is not positive).
+         * \param[out] x Predicted state.
+         * \param[out] SI Inverse innovation covariance of an observation of the first N state components.
+         */
+        template <int N> void
+        getPredictedInnovation(double interval, StateVector& x, Eigen::Matrix<double, N, N>& SI) const
+        {
+          StateMatrix F, Q;
+          getTransition(interval, F, Q);
+          x = F * x_;
+          Eigen::Matrix<double, N, N> S = (F * X_ * F.transpose() + Q).template topLeftCorner<N, N>();
+          S.diagonal() += Zv_.template head<N>();
+          SI = S.inverse();
+        }
+
+        /**
+         * \brief Observation step.
+         *
+         * \param[in] z Observation of the first N state components.
+         */
+        template <int N> void
+        observe(const Eigen::Matrix<double, N, 1>& z)
+        {
+          // Innovation covariance (observation model selects the first N state components):
+          Eigen::Matrix<double, N, N> S = X_.template topLeftCorner<N, N>();
+          S.diagonal() += Zv_.template head<N>();
+          Eigen::Matrix<double, N, N> SI = S.inverse();
+
+          // Kalman gain and filter update:
+          Eigen::Matrix<double, 2*D, N> W = X_.template leftCols<N>() * SI;
+          x_ += W * (z - x_.template head<N>());
+          X_ -= W * S * W.transpose();
+          X_ = (X_ + X_.transpose()) / 2.0;
+
+          SI_.template topLeftCorner<N, N>() = SI;
+          observation_size_ = N;
+        }
+
+        /** \brief Get the state. */
+        const StateVector&
+        getState() const
+        {
+          return x_;
+        }
+
+        /** \brief Get the state covariance. */
+        const StateMatrix&
+        getStateCovariance() const
+        {
+          return X_;
+        }
+
+        /** \brief Get the inverse innovation covariance of the last observation (top-left block of size getObservationSize()). */
+        const StateMatrix&
+        getInverseInnovationCovariance() const
+        {
+          return SI_;
+        }
+
+        /** \brief Get the observation noise variances. */
+        const StateVector&
+        getObservationVariances() const
+        {
+          return Zv_;
+        }
+
+        /** \brief Get the size of the last observation. */
+        int
+        getObservationSize() const
+        {
+          return observation_size_;
+        }
+
+      protected:
+
+        /**
+         * \brief Compute transition and process noise matrices over a time interval (see getProcessNoise()).
+         *
+         * \param[in] interval Prediction interval (identity and zero noise if it is not positive).
+         * \param[out] F Transition matrix.
+         * \param[out] Q Process noise covariance.
+         */
+        void
+        getTransition(double interval, StateMatrix& F, StateMatrix& Q) const
+        {
+          F.setIdentity();
+          Q.setZero();
+          if (not (interval > 0.0))
+            return;
+
+          double pp, pv, vv;
+          getProcessNoise(interval, dt_, acceleration_variance_, pp, pv, vv);
+          for(int i = 0; i < D; i++)
+          {
+            F(i, D + i) = interval;
+            Q(i, i) = pp;
+            Q(i, D + i) = Q(D + i, i) = pv;
+            Q(D + i, D + i) = vv;
+          }
+        }
+
+        /** \brief State. */
+        StateVector x_;
+
+        /** \brief State covariance. */
+        StateMatrix X_;
+
+        /** \brief Period of the single step model. */
+        double dt_;
+
+        /** \brief Acceleration variance. */
+        double acceleration_variance_;
+
+        /** \brief Transition matrix. */
+        StateMatrix F_;
+
+        /** \brief Process noise covariance. */
+        StateMatrix Q_;
+
+        /** \brief Observation noise variances. */
+        StateVector Zv_;
+
+        /** \brief Inverse innovation covariance of the last observation. */
+        StateMatrix SI_;
+
+        /** \brief Size of the last observation. */
+        int observation_size_;
+    };
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* !defined(OPEN_PTRACK_TRACKING_CLOSED_FORM_KALMAN_FILTER_H_) */
@@ -0,0 +1,184 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_DETECTION_LOG_H_
+#define OPEN_PTRACK_TRACKING_DETECTION_LOG_H_
+
+#include <ros/ros.h>
+#include <tf/tf.h>
+#include <Eigen/Eigen>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <opt_msgs/DetectionArray.h>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief A detection message as received by a tracker node, with the transforms used for its camera */
+    struct DetectionLogRecord
+    {
+      /** \brief The detection message. */
+      opt_msgs::DetectionArray msg;
+
+      /** \brief Transform from the camera frame to the world frame. */
+      tf::Transform transform;
+
+      /** \brief Transform from the world frame to the camera frame. */
+      tf::Transform inverse_transform;
+
+      /** \brief Registration matrix of the calibration refinement (identity if the refinement is disabled). */
+      Eigen::Matrix4d registration_matrix;
+
+      EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    };
+
+    /** \brief DetectionLogWriter writes detection messages to a binary log, for replaying them without ROS
+     *
+     *  A log is a header (DETECTION_LOG_MAGIC, the format version and DETECTION_LOG_BYTE_ORDER) followed by a
+     *  record per message: the two transforms (rotation matrix and translation), the registration matrix and the
+     *  serialized DetectionArray, preceded by its length. Numbers are stored with the byte order of the host,
+     *  which is recorded by DETECTION_LOG_BYTE_ORDER.
+     **/
+    class DetectionLogWriter
+    {
+      public:
+
+        /** \brief Constructor. */
+        DetectionLogWriter();
+
+        /** \brief Destructor. */
+        virtual ~DetectionLogWriter();
+
+        /**
+         * \brief Create a log file (overwriting an existing one).
+         *
+         * \param[in] filename Log file.
+         *
+         * \return false if the file cannot be created.
+         */
+        bool
+        open(const std::string& filename);
+
+        /** \brief Close the log file. */
+        void
+        close();
+
+        /**
+         * \brief Check if a log file is open.
+         *
+         * \return true if a log file is open.
+         */
+        bool
+        isOpen() const;
+
+        /**
+         * \brief Append a detection message to the log.
+         *
+         * \param[in] record The message and its transforms.
+         *
+         * \return false if the record cannot be written.
+         */
+        bool
+        write(const DetectionLogRecord& record);
+
+      protected:
+
+        /** \brief Log file. */
+        std::ofstream file_;
+
+        /** \brief Buffer for the serialized messages. */
+        std::vector<uint8_t> buffer_;
+    };
+
+    /** \brief DetectionLogReader reads the detection messages of a log written by DetectionLogWriter */
+    class DetectionLogReader
+    {
+      public:
+
+        /** \brief Constructor. */
+        DetectionLogReader();
+
+        /** \brief Destructor. */
+        virtual ~DetectionLogReader();
+
+        /**
+         * \brief Open a log file.
+         *
+         * \param[in] filename Log file.
+         *
+         * \return false if the file cannot be opened, it is not a detection log or it has been written with another byte order.
+         */
+        bool
+        open(const std::string& filename);
+
+        /**
+         * \brief Read the next detection message.
+         *
+         * \param[out] record The message and its transforms.
+         *
+         * \return false at the end of the log (or if the log is truncated or corrupted).
+         */
+        bool
+        read(DetectionLogRecord& record);
+
+      protected:
+
+        /** \brief Log file. */
+        std::ifstream file_;
+
+        /** \brief Buffer for the serialized messages. */
+        std::vector<uint8_t> buffer_;
+
+        /** \brief Size of the log file (message lengths are checked against it). */
+        std::streamoff file_size_;
+    };
+
+    /** \brief First bytes of a detection log. */
+    extern const char DETECTION_LOG_MAGIC[8];
+
+    /** \brief Version of the detection log format. */
+    extern const uint32_t DETECTION_LOG_VERSION;
+
+    /** \brief Written with the byte order of the host after the version (reads 0x04030201 with the other byte order). */
+    extern const uint32_t DETECTION_LOG_BYTE_ORDER;
+
+    /** \brief Longest serialized message accepted by DetectionLogReader. */
+    extern const uint32_t DETECTION_LOG_MAX_MESSAGE_LENGTH;
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_TRACKING_DETECTION_LOG_H_ */
@@ -0,0 +1,126 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_GATING_GRID_H_
+#define OPEN_PTRACK_TRACKING_GATING_GRID_H_
+
+#include <utility>
+#include <vector>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief GatingGrid indexes the gating regions of tracks on a uniform grid of the ground plane
+     *
+     *  Every track is represented by a disc centered on its predicted position: detections outside the disc
+     *  cannot be associated to the track. Discs are stored in the grid cells they overlap (hashed and sorted),
+     *  so that the tracks a detection can be associated to are found by looking at a single cell.
+     *  The cell size is the median disc radius, thus every disc overlaps a few cells. Discs which would overlap
+     *  too many cells (e.g. tracks lost for a long time) or whose radius is not finite are checked for every query.
+     **/
+    class GatingGrid
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] max_cells_per_region Discs overlapping more cells than this are checked for every query.
+         */
+        GatingGrid(int max_cells_per_region = 64);
+
+        /**
+         * \brief Build the grid from a set of discs.
+         *
+         * \param[in] x Discs center x coordinate.
+         * \param[in] y Discs center y coordinate.
+         * \param[in] radius Discs radius (infinite if the disc is not bounded).
+         */
+        void
+        build(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& radius);
+
+        /**
+         * \brief Find the discs containing a point.
+         *
+         * \param[in] x Point x coordinate.
+         * \param[in] y Point y coordinate.
+         * \param[out] regions Indices of the discs containing the point, in the order given to build().
+         */
+        void
+        query(double x, double y, std::vector<int>& regions) const;
+
+        /**
+         * \brief Get the size of the grid cells.
+         *
+         * \return the cell size (in meters).
+         */
+        double
+        getCellSize() const;
+
+      private:
+
+        /** \brief Compute the cell containing a point (false if the point is outside the representable grid). */
+        bool
+        getCell(double x, double y, int& cell_x, int& cell_y) const;
+
+        /** \brief Hash key of a cell. */
+        static long long
+        getKey(int cell_x, int cell_y);
+
+        /** \brief Smallest cell size (in meters). */
+        static const double MIN_CELL_SIZE;
+
+        /** \brief Discs overlapping more cells than this are checked for every query. */
+        int max_cells_per_region_;
+
+        /** \brief Cell size. */
+        double cell_size_;
+
+        /** \brief Discs given to build(). */
+        std::vector<double> x_;
+        std::vector<double> y_;
+        std::vector<double> radius_;
+
+        /** \brief (cell key, disc index) pairs, sorted by key. */
+        std::vector<std::pair<long long, int> > cells_;
+
+        /** \brief Discs not stored in cells. */
+        std::vector<int> unbounded_;
+    };
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* !defined(OPEN_PTRACK_TRACKING_GATING_GRID_H_) */
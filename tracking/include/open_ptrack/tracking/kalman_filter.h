@@ -45,6 +45,7 @@
 #include <Eigen/Eigen>
 #include <visualization_msgs/MarkerArray.h>
 #include <open_ptrack/bayes/allFilters.hpp>
+#include <open_ptrack/tracking/closed_form_kalman_filter.h>
 
 namespace open_ptrack
 {
@@ -61,6 +62,15 @@ public:
   /** \brief Constructor. */
   PredictModel(double dt, double acceleration_variance);
 
+  /**
+   * \brief Constructor of a model predicting over an arbitrary time interval.
+   *
+   * \param[in] dt Period of the single step model.
+   * \param[in] acceleration_variance Acceleration variance.
+   * \param[in] interval Prediction interval.
+   */
+  PredictModel(double dt, double acceleration_variance, double interval);
+
   /** \brief Destructor. */
   virtual ~PredictModel();
 };
@@ -126,6 +136,21 @@ public:
   double vy;
 };
 
+/** \brief KalmanFilterState is a copy of the state of a KalmanFilter, for restoring it later. */
+struct KalmanFilterState
+{
+  // Unaligned, so that states can be stored in plain arrays:
+
+  /** \brief State. */
+  Eigen::Matrix<double, 4, 1, Eigen::DontAlign> x;
+
+  /** \brief State covariance. */
+  Eigen::Matrix<double, 4, 4, Eigen::DontAlign> X;
+
+  /** \brief Observation noise variances of the last update. */
+  Eigen::Matrix<double, 4, 1, Eigen::DontAlign> observation_variances;
+};
+
 /** \brief KalmanFilter provides methods for bayesian estimation with Kalman Filter. */
 class KalmanFilter
 {
@@ -146,18 +171,36 @@ protected:
   /** \brief State/output dimension.*/
   int output_dimension_;
 
+  /** \brief Algorithm used for filtering. */
+  FilterBackend backend_;
+
+  /** \brief Unscented filter (NULL with the CLOSED_FORM backend). */
   Bayesian_filter::Unscented_scheme* filter_;
 
-  /** \brief Prediction model. */
+  /** \brief Prediction model (NULL with the CLOSED_FORM backend). */
   PredictModel* predict_model_;
 
-  /** \brief Observation model. */
+  /** \brief Observation model (NULL with the CLOSED_FORM backend). */
   ObserveModel* observe_model_;
 
+  /** \brief Fixed-size filter used with the CLOSED_FORM backend. */
+  ClosedFormKalmanFilter<2> closed_form_filter_;
+
 public:
 
-  /** \brief Constructor. */
-  KalmanFilter(double dt, double position_variance, double acceleration_variance, int output_dimension);
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /**
+         * \brief Constructor.
+         *
+         * \param[in] dt Time interval.
+         * \param[in] position_variance Position variance.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] output_dimension Observation dimension (2 for position, 4 for position and velocity).
+         * \param[in] backend Algorithm used for filtering.
+         */
+  KalmanFilter(double dt, double position_variance, double acceleration_variance, int output_dimension,
+      FilterBackend backend = UNSCENTED);
 
   /** \brief Constructor initializing a new KalmanFilter with another one. */
   KalmanFilter(const KalmanFilter& orig);
@@ -168,6 +211,22 @@ public:
   /** \brief Destructor. */
   virtual ~KalmanFilter();
 
+  /**
+         * \brief Reconfigure the filter for reusing it with another target (see TrackPool).
+         *
+         * Models and the unscented filter are kept if their parameters did not change, so that nothing is allocated.
+         * init() has to be called before using the filter again.
+         *
+         * \param[in] dt Time interval.
+         * \param[in] position_variance Position variance.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] output_dimension Observation dimension (2 for position, 4 for position and velocity).
+         * \param[in] backend Algorithm used for filtering.
+         */
+  void
+  reset(double dt, double position_variance, double acceleration_variance, int output_dimension,
+      FilterBackend backend = UNSCENTED);
+
   /**
          * \brief Filter initialization procedure.
          *
@@ -196,6 +255,16 @@ public:
   virtual void
   predict(double& x, double& y, double& vx, double& vy);
 
+  /**
+         * \brief Prediction step over an arbitrary time interval, in a single step.
+         *
+         * For multiples of the time interval dt, the result is the same of repeated predict() calls.
+         *
+         * \param[in] interval Prediction interval (nothing is done if it is not positive).
+         */
+  virtual void
+  predict(double interval);
+
   /**
          * \brief Update step.
          */
@@ -260,6 +329,84 @@ public:
   virtual void
   getMahalanobisParameters(MahalanobisParameters4d& mp);
 
+  /**
+         * \brief Obtain variables for bayesian estimation with output dimension = 2, at a later time.
+         *
+         * State and covariance are propagated over the interval without changing the filter,
+         * then the innovation covariance is built with the observation variances of the last update.
+         *
+         * \param[in] interval Time elapsed since the last update (the current state is used if it is not positive).
+         * \param[out] mp Object of class MahalanobisParameters2d.
+         */
+  virtual void
+  getMahalanobisParameters(double interval, MahalanobisParameters2d& mp);
+
+  /**
+         * \brief Obtain variables for bayesian estimation with output dimension = 4, at a later time.
+         *
+         * \param[in] interval Time elapsed since the last update (the current state is used if it is not positive).
+         * \param[out] mp Object of class MahalanobisParameters4d.
+         */
+  virtual void
+  getMahalanobisParameters(double interval, MahalanobisParameters4d& mp);
+
+  /**
+         * \brief Get a closed-form filter with the current state and models.
+         *
+         * \param[in] buffer Filter filled with the state of the Unscented_scheme (unused with the CLOSED_FORM backend).
+         *
+         * \return the closed-form filter.
+         */
+  const ClosedFormKalmanFilter<2>&
+  getClosedFormFilter(ClosedFormKalmanFilter<2>& buffer);
+
+  /**
+         * \brief Get a closed-form filter with a saved state and the models of this filter.
+         *
+         * \param[in] state Saved state.
+         * \param[in] buffer Filter filled with the saved state.
+         *
+         * \return the closed-form filter.
+         */
+  const ClosedFormKalmanFilter<2>&
+  getClosedFormFilter(const KalmanFilterState& state, ClosedFormKalmanFilter<2>& buffer);
+
+  /**
+         * \brief Save the filter state.
+         *
+         * \param[out] state Saved state.
+         */
+  void
+  getFilterState(KalmanFilterState& state);
+
+  /**
+         * \brief Restore a filter state saved with getFilterState().
+         *
+         * \param[in] state Saved state.
+         */
+  void
+  setFilterState(const KalmanFilterState& state);
+
+  /**
+         * \brief Obtain variables for bayesian estimation with output dimension = 2 from a closed-form filter, at a later time.
+         *
+         * \param[in] filter Filter (see getClosedFormFilter()).
+         * \param[in] interval Time elapsed since the last update of the filter.
+         * \param[out] mp Object of class MahalanobisParameters2d.
+         */
+  static void
+  getMahalanobisParameters(const ClosedFormKalmanFilter<2>& filter, double interval, MahalanobisParameters2d& mp);
+
+  /**
+         * \brief Obtain variables for bayesian estimation with output dimension = 4 from a closed-form filter, at a later time.
+         *
+         * \param[in] filter Filter (see getClosedFormFilter()).
+         * \param[in] interval Time elapsed since the last update of the filter.
+         * \param[out] mp Object of class MahalanobisParameters4d.
+         */
+  static void
+  getMahalanobisParameters(const ClosedFormKalmanFilter<2>& filter, double interval, MahalanobisParameters4d& mp);
+
   /**
          * \brief Compute Mahalanobis distance between measurement and target predicted state.
          *
@@ -286,6 +433,30 @@ public:
   static double
   performMahalanobisDistance(double x, double y, double vx, double vy, const MahalanobisParameters4d& mp);
 
+  /**
+         * \brief Compute a lower bound of the Mahalanobis distance per squared meter of position error.
+         *
+         * For every measurement, performMahalanobisDistance(x, y, ..., mp) >= bound * ((x - mp.x)^2 + (y - mp.y)^2).
+         *
+         * \param[in] mp Object of class MahalanobisParameters2d.
+         *
+         * \return the bound (0 if it cannot be computed).
+         */
+  static double
+  getMahalanobisLowerBound(const MahalanobisParameters2d& mp);
+
+  /**
+         * \brief Compute a lower bound of the Mahalanobis distance per squared meter of position error, whatever the velocity.
+         *
+         * For every measurement, performMahalanobisDistance(x, y, vx, vy, mp) >= bound * ((x - mp.x)^2 + (y - mp.y)^2).
+         *
+         * \param[in] mp Object of class MahalanobisParameters4d.
+         *
+         * \return the bound (0 if it cannot be computed).
+         */
+  static double
+  getMahalanobisLowerBound(const MahalanobisParameters4d& mp);
+
   /**
          * \brief Get filter innovation covariance.
          *
@@ -45,6 +45,7 @@
 #include <Eigen/Eigen>
 #include <visualization_msgs/MarkerArray.h>
 #include <open_ptrack/bayes/allFilters.hpp>
+#include <open_ptrack/tracking/closed_form_kalman_filter.h>
 
 namespace open_ptrack
 {
@@ -61,6 +62,15 @@ namespace open_ptrack
         /** \brief Constructor. */
         PredictModel3D(double dt, double acceleration_variance);
 
+        /**
+         * \brief Constructor of a model predicting over an arbitrary time interval.
+         *
+         * \param[in] dt Period of the single step model.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] interval Prediction interval.
+         */
+        PredictModel3D(double dt, double acceleration_variance, double interval);
+
         /** \brief Destructor. */
         virtual ~PredictModel3D();
     };
@@ -155,18 +165,36 @@ namespace open_ptrack
         /** \brief State/output dimension.*/
         int output_dimension_;
 
+        /** \brief Algorithm used for filtering. */
+        FilterBackend backend_;
+
+        /** \brief Unscented filter (NULL with the CLOSED_FORM backend). */
         Bayesian_filter::Unscented_scheme* filter_;
 
-        /** \brief Prediction model. */
+        /** \brief Prediction model (NULL with the CLOSED_FORM backend). */
         PredictModel3D* predict_model_;
 
-        /** \brief Observation model. */
+        /** \brief Observation model (NULL with the CLOSED_FORM backend). */
         ObserveModel3D* observe_model_;
 
+        /** \brief Fixed-size filter used with the CLOSED_FORM backend. */
+        ClosedFormKalmanFilter<3> closed_form_filter_;
+
       public:
 
-        /** \brief Constructor. */
-        KalmanFilter3D(double dt, double position_variance, double acceleration_variance, int output_dimension);
+        EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] dt Time interval.
+         * \param[in] position_variance Position variance.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] output_dimension Observation dimension (3 for position, 6 for position and velocity).
+         * \param[in] backend Algorithm used for filtering.
+         */
+        KalmanFilter3D(double dt, double position_variance, double acceleration_variance, int output_dimension,
+            FilterBackend backend = UNSCENTED);
 
         /** \brief Constructor initializing a new KalmanFilter with another one. */
         KalmanFilter3D(const KalmanFilter3D& orig);
@@ -205,6 +233,16 @@ namespace open_ptrack
         virtual void
         predict(double& x, double& y, double& z, double& vx, double& vy, double& vz);
 
+        /**
+         * \brief Prediction step over an arbitrary time interval, in a single step.
+         *
+         * For multiples of the time interval dt, the result is the same of repeated predict() calls.
+         *
+         * \param[in] interval Prediction interval (nothing is done if it is not positive).
+         */
+        virtual void
+        predict(double interval);
+
         /**
          * \brief Update step.
          */
@@ -269,6 +307,37 @@ namespace open_ptrack
         virtual void
         getMahalanobisParameters(MahalanobisParameters6d& mp);
 
+        /**
+         * \brief Obtain variables for bayesian estimation with output dimension = 3, at a later time.
+         *
+         * State and covariance are propagated over the interval without changing the filter,
+         * then the innovation covariance is built with the observation variances of the last update.
+         *
+         * \param[in] interval Time elapsed since the last update (the current state is used if it is not positive).
+         * \param[out] mp Object of class MahalanobisParameters3d.
+         */
+        virtual void
+        getMahalanobisParameters(double interval, MahalanobisParameters3d& mp);
+
+        /**
+         * \brief Obtain variables for bayesian estimation with output dimension = 6, at a later time.
+         *
+         * \param[in] interval Time elapsed since the last update (the current state is used if it is not positive).
+         * \param[out] mp Object of class MahalanobisParameters6d.
+         */
+        virtual void
+        getMahalanobisParameters(double interval, MahalanobisParameters6d& mp);
+
+        /**
+         * \brief Get a closed-form filter with the current state and models.
+         *
+         * \param[in] buffer Filter filled with the state of the Unscented_scheme (unused with the CLOSED_FORM backend).
+         *
+         * \return the closed-form filter.
+         */
+        const ClosedFormKalmanFilter<3>&
+        getClosedFormFilter(ClosedFormKalmanFilter<3>& buffer);
+
         /**
          * \brief Compute Mahalanobis distance between measurement and target predicted state.
          *
@@ -295,6 +364,26 @@ namespace open_ptrack
         static double
         performMahalanobisDistance(double x, double y, double z, double vx, double vy, double vz, const MahalanobisParameters6d& mp);
 
+        /**
+         * \brief Compute a lower bound of the Mahalanobis distance per squared meter of position error.
+         *
+         * \param[in] mp Object of class MahalanobisParameters3d.
+         *
+         * \return the bound (0 if it cannot be computed).
+         */
+        static double
+        getMahalanobisLowerBound(const MahalanobisParameters3d& mp);
+
+        /**
+         * \brief Compute a lower bound of the Mahalanobis distance per squared meter of position error, whatever the velocity.
+         *
+         * \param[in] mp Object of class MahalanobisParameters6d.
+         *
+         * \return the bound (0 if it cannot be computed).
+         */
+        static double
+        getMahalanobisLowerBound(const MahalanobisParameters6d& mp);
+
         /**
          * \brief Get filter innovation covariance.
          *
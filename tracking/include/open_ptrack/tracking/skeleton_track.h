@@ -86,7 +86,8 @@ public:
                 std::string frame_id, double position_variance,
                 double acceleration_variance, double period,
                 bool velocity_in_motion_term,
-                const std::vector<rtpose_wrapper::Joint3DMsg>& joints);
+                const std::vector<rtpose_wrapper::Joint3DMsg>& joints,
+                FilterBackend filter_backend = UNSCENTED);
 
   /** \brief Destructor. */
   virtual ~SkeletonTrack();
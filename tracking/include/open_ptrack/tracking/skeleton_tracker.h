@@ -85,6 +85,9 @@ protected:
   void
   createDistanceMatrix();
 
+  bool
+  createGatedDistanceMatrix();
+
   void
   updateDetectedTracks();
 
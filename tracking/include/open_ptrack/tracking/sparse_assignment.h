@@ -0,0 +1,213 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_SPARSE_ASSIGNMENT_H_
+#define OPEN_PTRACK_TRACKING_SPARSE_ASSIGNMENT_H_
+
+#include <vector>
+#include <boost/shared_ptr.hpp>
+#include <opencv2/opencv.hpp>
+#include <open_ptrack/opt_utils/thread_pool.h>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief Algorithms available for solving the detection<->track assignment problem */
+    enum AssociationSolver
+    {
+      MUNKRES,      // Dense Hungarian algorithm (see munkres.h)
+      SPARSE_LAP    // Shortest augmenting path on gated pairs only (see SparseAssignment)
+    };
+
+    /** \brief SparseAssignment solves the Global Nearest Neighbor problem on gated pairs only
+     *
+     *  Rows (tracks) and columns (detections) are connected only by the pairs added with addPair().
+     *  Every row can also stay unassigned at cost unassigned_cost (the padding value used by Munkres),
+     *  so the minimized objective is the same as the one of the dense Munkres solver.
+     *  The problem is solved with Jonker-Volgenant shortest augmenting paths (Dijkstra with dual
+     *  potentials), whose cost depends on the number of gated pairs and not on rows x cols.
+     *  The gated bipartite graph is first split into connected components, which are independent
+     *  problems: large components are solved in parallel on a thread pool.
+     **/
+    class SparseAssignment
+    {
+      public:
+
+        /** \brief Constructor. */
+        SparseAssignment(double unassigned_cost = 1000000.0);
+
+        /**
+         * \brief Clear the problem and set its size.
+         *
+         * \param[in] rows Number of rows (tracks).
+         * \param[in] cols Number of columns (detections).
+         */
+        void
+        reset(int rows, int cols);
+
+        /**
+         * \brief Add an admissible row<->column pair.
+         *
+         * \param[in] row Row index.
+         * \param[in] col Column index.
+         * \param[in] cost Assignment cost (lower is better).
+         */
+        void
+        addPair(int row, int col, double cost);
+
+        /**
+         * \brief Solve the problem built with reset() and addPair().
+         *
+         * \param[out] row_to_col Column assigned to every row (-1 if the row is unassigned).
+         */
+        void
+        solve(std::vector<int>& row_to_col);
+
+        /**
+         * \brief Solve the problem defined by a dense distance matrix, keeping only entries within the gate.
+         *
+         * \param[in] distance_matrix Distance matrix (rows are tracks, columns are detections).
+         * \param[in] gate_distance Entries greater than this value are not admissible.
+         *
+         * \return a matrix with the same layout of the Munkres::solve output: 0 for assigned pairs, -1 elsewhere.
+         */
+        cv::Mat
+        solve(const cv::Mat_<double>& distance_matrix, double gate_distance);
+
+        /**
+         * \brief Set the number of threads used for solving independent components.
+         *
+         * \param[in] threads Number of threads (0 or 1 solves everything in the calling thread).
+         */
+        void
+        setNumThreads(int threads);
+
+        /**
+         * \brief Set the minimum number of rows for a component to be solved on the thread pool.
+         *
+         * \param[in] rows Minimum number of rows (smaller components are solved in the calling thread).
+         */
+        void
+        setParallelComponentSize(int rows);
+
+        /**
+         * \brief Get the number of connected components found by the last call to solve().
+         *
+         * \return the number of connected components with at least one admissible pair.
+         */
+        int
+        getNumComponents();
+
+      private:
+
+        /** \brief Buffers used by a single shortest augmenting path search. */
+        struct Workspace
+        {
+          std::vector<int> touched_cols;
+          std::vector<int> done_cols;
+          std::vector<int> scanned_rows;
+          std::vector<std::pair<double, int> > heap;
+        };
+
+        /** \brief Split rows into connected components of the gated bipartite graph. */
+        void
+        computeComponents();
+
+        /** \brief Find the root of an element in the union-find forest. */
+        int
+        findRoot(int element);
+
+        /** \brief Solve the sub-problem made of the rows of a connected component. */
+        void
+        solveComponent(int component, Workspace& workspace);
+
+        /** \brief Find a shortest augmenting path from the free row and flip it. */
+        void
+        augment(int row, Workspace& workspace);
+
+        /** \brief Cost of leaving a row unassigned. */
+        double unassigned_cost_;
+
+        /** \brief Number of rows. */
+        int rows_;
+
+        /** \brief Number of real columns (a private dummy column per row follows them). */
+        int cols_;
+
+        /** \brief Admissible pairs, in insertion order. */
+        std::vector<int> pair_rows_;
+        std::vector<int> pair_cols_;
+        std::vector<double> pair_costs_;
+
+        /** \brief Compressed row storage of the admissible pairs (dummy columns included). */
+        std::vector<int> row_start_;
+        std::vector<int> edge_col_;
+        std::vector<double> edge_cost_;
+
+        /** \brief Dual potentials of rows and columns. */
+        std::vector<double> u_;
+        std::vector<double> v_;
+
+        /** \brief Current matching. */
+        std::vector<int> row_to_col_;
+        std::vector<int> col_to_row_;
+
+        /** \brief Dijkstra labels (components never share an entry, so they can be solved concurrently). */
+        std::vector<double> col_dist_;
+        std::vector<double> row_dist_;
+        std::vector<int> pred_;
+        std::vector<char> col_done_;
+
+        /** \brief Union-find forest over rows and real columns. */
+        std::vector<int> parent_;
+
+        /** \brief Rows grouped by connected component (compressed storage). */
+        std::vector<int> component_start_;
+        std::vector<int> component_rows_;
+
+        /** \brief One workspace per concurrent search (kept between calls to avoid reallocations). */
+        std::vector<Workspace> workspaces_;
+
+        /** \brief Thread pool for large components (NULL if solving serially). */
+        boost::shared_ptr<open_ptrack::opt_utils::ThreadPool> thread_pool_;
+
+        /** \brief Minimum number of rows for a component to be solved on the thread pool. */
+        int parallel_component_size_;
+    };
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* !defined(OPEN_PTRACK_TRACKING_SPARSE_ASSIGNMENT_H_) */
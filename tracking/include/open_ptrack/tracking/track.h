@@ -47,7 +47,9 @@
 #include <pcl_ros/point_cloud.h>
 #include <pcl/point_types.h>
 #include <open_ptrack/opt_utils/conversions.h>
+#include <open_ptrack/opt_utils/ring_buffer.h>
 #include <open_ptrack/tracking/kalman_filter.h>
+#include <open_ptrack/tracking/track_table.h>
 #include <open_ptrack/bayes/bayesFlt.hpp>
 #include <open_ptrack/detection/detection_source.h>
 #include <opt_msgs/Track.h>
@@ -76,19 +78,47 @@ namespace open_ptrack
           NOT_VISIBLE = 2   // Total occlusion
         };
 
+        /** \brief Default maximum number of updates in the state history (about 2 s of a single camera at 30 Hz) */
+        static const size_t DEFAULT_STATE_HISTORY_SIZE = 64;
+
+        /** \brief Bound on the size of the state history (a late detection applies again all the newer updates) */
+        static const size_t MAX_STATE_HISTORY_SIZE = 4096;
+
+        /**
+         * \brief Get the size of the state history which covers a detection delay.
+         *
+         * \param[in] max_delay Maximum delay of the detections (s).
+         * \param[in] period Detection period of a source (s).
+         * \param[in] sources Number of sources which can update a track (e.g. cameras).
+         *
+         * \return the number of updates, between DEFAULT_STATE_HISTORY_SIZE and MAX_STATE_HISTORY_SIZE.
+         */
+        static size_t
+        getStateHistorySize(double max_delay, double period, int sources);
+
       protected:
 
-        /** \brief Dimension of a circular buffer which keep tracks of filter parameters along time */
-        int MAX_SIZE;
+        /** \brief Update of the track filter, kept for predicting past positions and for applying late detections */
+        struct StateSample
+        {
+          /** \brief Detection time */
+          ros::Time time;
+
+          /** \brief Detection position, observed velocity and distance from the sensor */
+          double x, y, vx, vy, distance;
+
+          /** \brief Filter state after the update */
+          KalmanFilterState filter;
+        };
 
         /** \brief Track ID */
-        const int id_;
+        int id_;
 
         /** \brief Track frame id (frame id of the last detection associated to the track */
-        const std::string frame_id_;
+        std::string frame_id_;
 
         /** \brief Inverse of the frame rate */
-        const double period_;
+        double period_;
 
         /** \brief If true, the track is validated, meaning that it has been associated with a certain number of high confidence detections */
         bool validated_;
@@ -96,9 +126,6 @@ namespace open_ptrack
         /** \brief Kalman filter associated to the track */
         open_ptrack::tracking::KalmanFilter* filter_;
 
-        /** \brief Temporary copy of the Kalman filter associated to the track (used for recovery filter information when a track is re-found) */
-        open_ptrack::tracking::KalmanFilter* tmp_filter_;
-
         /** \brief First time a detection is associated to the track */
         ros::Time first_time_detected_;
 
@@ -108,17 +135,23 @@ namespace open_ptrack
         /** \brief Last time a detection with high detection confidence is associated to the track */
         ros::Time last_time_detected_with_high_confidence_;
 
-        /** \brief Last time a prediction has been performed for the track */
-        ros::Time last_time_predicted_;
+        /** \brief Time instant of the cached Mahalanobis parameters */
+        ros::Time mahalanobis_parameters_time_;
+
+        /** \brief If false, the cached Mahalanobis parameters have to be recomputed */
+        bool mahalanobis_parameters_valid_;
 
-        /** \brief Index in the circular buffer corresponding to the last time a prediction has been performed */
-        int last_time_predicted_index_;
+        /** \brief Incremented whenever the filter changes (never reset, not even when the track is recycled) */
+        unsigned int filter_revision_;
 
         /** Variables used for computing the detection/track Mahalanobis distance */
-        std::vector<MahalanobisParameters2d> mahalanobis_map2d_;
+        MahalanobisParameters2d mahalanobis_parameters2d_;
 
         /** Variables used for computing the detection/track Mahalanobis distance */
-        std::vector<MahalanobisParameters4d> mahalanobis_map4d_;
+        MahalanobisParameters4d mahalanobis_parameters4d_;
+
+        /** \brief Last updates of the filter, in time order (used for the velocity in the motion term and for late detections) */
+        open_ptrack::opt_utils::RingBuffer<StateSample> state_history_;
 
         /** \brief Track Status*/
         Status status_;
@@ -159,6 +192,79 @@ namespace open_ptrack
         /** \brief Count the number of consecutive updates with low confidence detections */
         int low_confidence_consecutive_frames_;
 
+        /**
+         * \brief Predict the Mahalanobis parameters at a time instant (cached until the next update).
+         *
+         * \param[in] when Time instant.
+         */
+        void
+        predictMahalanobisParameters(const ros::Time& when);
+
+        /**
+         * \brief Predict the filter from the previous update to the detection of a sample, then update it with the detection.
+         *
+         * \param[in] previous_time Time of the previous update.
+         * \param[in,out] sample Detection to apply (the filter state after the update is stored in it).
+         */
+        void
+        applyStateSample(const ros::Time& previous_time, StateSample& sample);
+
+        /**
+         * \brief Apply a detection older than the last update: the filter is rolled back to the last update before
+         * the detection, updated with it, and updated again with the newer detections.
+         *
+         * \param[in,out] sample Detection to apply.
+         *
+         * \return false if the detection is older than the state history (and the filter is not changed).
+         */
+        bool
+        updateOutOfSequence(StateSample& sample);
+
+        /**
+         * \brief Find the last update not after a time instant.
+         *
+         * \param[in] when Time instant.
+         *
+         * \return the index of the update in the state history (-1 if all updates are after when).
+         */
+        int
+        findStateSample(const ros::Time& when);
+
+        /**
+         * \brief Get the filter of the last update not after a time instant.
+         *
+         * \param[in] when Time instant.
+         * \param[in] buffer Filter filled with a past or an Unscented_scheme state.
+         * \param[out] update_time Time of the update (when, if it is older than the state history).
+         *
+         * \return the closed-form filter (the oldest one if when is older than the state history).
+         */
+        const ClosedFormKalmanFilter<2>&
+        getFilterBefore(const ros::Time& when, ClosedFormKalmanFilter<2>& buffer, ros::Time& update_time);
+
+        /**
+         * \brief Get the track position at a past time instant, predicted from the last update before it.
+         *
+         * \param[in] t Time instant (in seconds).
+         * \param[out] x Position x component.
+         * \param[out] y Position y component.
+         */
+        void
+        getPastPosition(double t, double& x, double& y);
+
+        /**
+         * \brief Get the linear model of the velocity observed with a detection at a time instant.
+         *
+         * The observed velocity is (gain * x + offset_x, gain * y + offset_y), where (x,y) is the detection position.
+         *
+         * \param[in] when Time instant.
+         * \param[out] gain Gain.
+         * \param[out] offset_x Offset of the x component.
+         * \param[out] offset_y Offset of the y component.
+         */
+        void
+        getVelocityObservationModel(const ros::Time& when, double& gain, double& offset_x, double& offset_y);
+
       public:
 
         /** \brief Constructor. */
@@ -168,11 +274,36 @@ namespace open_ptrack
             double position_variance,
             double acceleration_variance,
             double period,
-            bool velocity_in_motion_term);
+            bool velocity_in_motion_term,
+            FilterBackend filter_backend = UNSCENTED);
 
         /** \brief Destructor. */
         virtual ~Track();
 
+        /**
+         * \brief Prepare the track for a new target, as if it was just constructed (see TrackPool).
+         *
+         * The Kalman filter is reused, so that no memory is allocated if its parameters did not change.
+         * init() has to be called before using the track again.
+         *
+         * \param[in] id Track ID.
+         * \param[in] frame_id Track frame id.
+         * \param[in] position_variance Position variance.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] period Inverse of the frame rate.
+         * \param[in] velocity_in_motion_term If true, the velocity observed with a detection is part of the motion term.
+         * \param[in] filter_backend Algorithm used by the Kalman filter.
+         */
+        void
+        reset(
+            int id,
+            const std::string& frame_id,
+            double position_variance,
+            double acceleration_variance,
+            double period,
+            bool velocity_in_motion_term,
+            FilterBackend filter_backend = UNSCENTED);
+
         /** \brief Track initialization with an old track. */
         virtual void
         init(const Track& old_track);
@@ -196,6 +327,23 @@ namespace open_ptrack
             double distance,
             open_ptrack::detection::DetectionSource* detection_source);
 
+        /**
+         * \brief Move the detections of a new track to a later time instant (for tracks started by late detections).
+         *
+         * \param[in] time Time instant.
+         */
+        void
+        startAt(const ros::Time& time);
+
+        /**
+         * \brief Set the maximum number of updates in the state history, which limits how late a detection can be
+         * applied (the history is cleared if the size changes, so it is set before init).
+         *
+         * \param[in] size Maximum number of updates.
+         */
+        void
+        setStateHistorySize(size_t size);
+
         /**
          * \brief Update track with new detection information.
          *
@@ -208,8 +356,10 @@ namespace open_ptrack
          * \param[in] min_confidence Minimum confidence for track initialization
          * \param[in] min_confidence_detections Minimum confidence for detection
          * \param[in] detection_source DetectionSource which provided the detection
+         *
+         * \return false if the detection is older than the state history of the track and has been dropped.
          */
-        virtual void
+        virtual bool
         update(
             double x,
             double y,
@@ -235,6 +385,65 @@ namespace open_ptrack
         virtual double
         getMahalanobisDistance(double x, double y, const ros::Time& when);
 
+        /**
+         * \brief Compute the region where detections can have a Mahalanobis distance lower than a threshold.
+         *
+         * Detections at time when farther than the returned radius from (x,y) have a Mahalanobis distance
+         * from the track greater than max_mahalanobis_distance.
+         *
+         * \param[in] max_mahalanobis_distance Mahalanobis distance threshold.
+         * \param[in] when Time instant.
+         * \param[out] x Predicted track x coordinate.
+         * \param[out] y Predicted track y coordinate.
+         *
+         * \return the radius of the region (infinite if it cannot be bounded).
+         */
+        virtual double
+        getGatingRadius(double max_mahalanobis_distance, const ros::Time& when, double& x, double& y);
+
+        /**
+         * \brief Copy the filter of the track to a row of a TrackTable, for computing distances at a time instant.
+         *
+         * Times in the table are relative to epoch, so the table has to be predicted at when - epoch.
+         *
+         * \param[out] table Track table.
+         * \param[in] row Row index.
+         * \param[in] when Time instant.
+         * \param[in] epoch Time origin of the table.
+         *
+         * \return true if the row holds the last filter of the track, false if it holds a past one (late detections).
+         */
+        virtual bool
+        fillTrackTable(TrackTable& table, int row, const ros::Time& when, const ros::Time& epoch);
+
+        /**
+         * \brief Refresh only the model of the velocity observed at a time instant in a row of a TrackTable.
+         *
+         * \param[out] table Track table.
+         * \param[in] row Row index.
+         * \param[in] when Time instant.
+         */
+        virtual void
+        fillTrackTableVelocity(TrackTable& table, int row, const ros::Time& when);
+
+        /**
+         * \brief Get a counter which changes whenever the filter of the track changes.
+         *
+         * \return the filter revision.
+         */
+        unsigned int
+        getFilterRevision() const;
+
+        /**
+         * \brief Check if the last filter of the track is the one to predict at a time instant.
+         *
+         * \param[in] when Time instant.
+         *
+         * \return false if the track has been updated after when.
+         */
+        bool
+        hasFilterAt(const ros::Time& when) const;
+
         /* Validate a track */
         virtual void
         validate();
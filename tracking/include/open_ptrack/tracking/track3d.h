@@ -43,6 +43,7 @@
 #include <opencv2/opencv.hpp>
 #include <Eigen/Eigen>
 #include <cmath>
+#include <deque>
 #include <visualization_msgs/MarkerArray.h>
 #include <pcl_ros/point_cloud.h>
 #include <pcl/point_types.h>
@@ -78,8 +79,12 @@ namespace open_ptrack
 
       protected:
 
-        /** \brief Dimension of a circular buffer which keep tracks of filter parameters along time */
-        int MAX_SIZE;
+        /** \brief Filter state after an update */
+        struct StateSample
+        {
+          ros::Time time;
+          double x, y, z, vx, vy, vz;
+        };
 
         /** \brief Track ID */
         const int id_;
@@ -96,9 +101,6 @@ namespace open_ptrack
         /** \brief Kalman filter associated to the track */
         open_ptrack::tracking::KalmanFilter3D* filter_;
 
-        /** \brief Temporary copy of the Kalman filter associated to the track (used for recovery filter information when a track is re-found) */
-        open_ptrack::tracking::KalmanFilter3D* tmp_filter_;
-
         /** \brief First time a detection is associated to the track */
         ros::Time first_time_detected_;
 
@@ -108,17 +110,20 @@ namespace open_ptrack
         /** \brief Last time a detection with high detection confidence is associated to the track */
         ros::Time last_time_detected_with_high_confidence_;
 
-        /** \brief Last time a prediction has been performed for the track */
-        ros::Time last_time_predicted_;
+        /** \brief Time instant of the cached Mahalanobis parameters */
+        ros::Time mahalanobis_parameters_time_;
 
-        /** \brief Index in the circular buffer corresponding to the last time a prediction has been performed */
-        int last_time_predicted_index_;
+        /** \brief If false, the cached Mahalanobis parameters have to be recomputed */
+        bool mahalanobis_parameters_valid_;
 
         /** Variables used for computing the detection/track Mahalanobis distance */
-        std::vector<MahalanobisParameters3d> mahalanobis_map3d_;
+        MahalanobisParameters3d mahalanobis_parameters3d_;
 
         /** Variables used for computing the detection/track Mahalanobis distance */
-        std::vector<MahalanobisParameters6d> mahalanobis_map6d_;
+        MahalanobisParameters6d mahalanobis_parameters6d_;
+
+        /** \brief Filter states after the updates of the last seconds (used for the velocity in the motion term) */
+        std::deque<StateSample> state_history_;
 
         /** \brief Track Status*/
         Status status_;
@@ -159,6 +164,33 @@ namespace open_ptrack
         /** \brief Count the number of consecutive updates with low confidence detections */
         int low_confidence_consecutive_frames_;
 
+        /**
+         * \brief Predict the Mahalanobis parameters at a time instant (cached until the next update).
+         *
+         * \param[in] when Time instant.
+         */
+        void
+        predictMahalanobisParameters(const ros::Time& when);
+
+        /**
+         * \brief Add the current filter state to the state history, removing samples too old to be used.
+         *
+         * \param[in] when Time instant of the current filter state.
+         */
+        void
+        addStateSample(const ros::Time& when);
+
+        /**
+         * \brief Get the track position at a past time instant, predicted from the last update before it.
+         *
+         * \param[in] t Time instant (in seconds).
+         * \param[out] x Position x component.
+         * \param[out] y Position y component.
+         * \param[out] z Position z component.
+         */
+        void
+        getPastPosition(double t, double& x, double& y, double& z);
+
       public:
 
         /** \brief Constructor. */
@@ -168,7 +200,8 @@ namespace open_ptrack
             double position_variance,
             double acceleration_variance,
             double period,
-            bool velocity_in_motion_term);
+            bool velocity_in_motion_term,
+            FilterBackend filter_backend = UNSCENTED);
 
         /** \brief Destructor. */
         virtual ~Track3D();
@@ -235,6 +268,23 @@ namespace open_ptrack
         virtual double
         getMahalanobisDistance(double x, double y, double z, const ros::Time& when);
 
+        /**
+         * \brief Compute the region where detections can have a Mahalanobis distance lower than a threshold.
+         *
+         * Detections at time when farther than the returned radius from (x,y) have a Mahalanobis distance
+         * from the track greater than max_mahalanobis_distance.
+         * The region is a disc on the xy plane, since the z error can only increase the distance.
+         *
+         * \param[in] max_mahalanobis_distance Mahalanobis distance threshold.
+         * \param[in] when Time instant.
+         * \param[out] x Predicted track x coordinate.
+         * \param[out] y Predicted track y coordinate.
+         *
+         * \return the radius of the region (infinite if it cannot be bounded).
+         */
+        virtual double
+        getGatingRadius(double max_mahalanobis_distance, const ros::Time& when, double& x, double& y);
+
         /* Validate a track */
         virtual void
         validate();
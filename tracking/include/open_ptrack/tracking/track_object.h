@@ -43,6 +43,7 @@
 #include <opencv2/opencv.hpp>
 #include <Eigen/Eigen>
 #include <cmath>
+#include <deque>
 #include <visualization_msgs/MarkerArray.h>
 #include <pcl_ros/point_cloud.h>
 #include <pcl/point_types.h>
@@ -81,8 +82,12 @@ namespace open_ptrack
 
       protected:
 
-        /** \brief Dimension of a circular buffer which keep tracks of filter parameters along time */
-        int MAX_SIZE;
+        /** \brief Filter state after an update */
+        struct StateSample
+        {
+          ros::Time time;
+          double x, y, vx, vy;
+        };
 
         /** \brief Track ID */
         const int id_;
@@ -99,9 +104,6 @@ namespace open_ptrack
         /** \brief Kalman filter associated to the track */
         open_ptrack::tracking::KalmanFilter* filter_;
 
-        /** \brief Temporary copy of the Kalman filter associated to the track (used for recovery filter information when a track is re-found) */
-        open_ptrack::tracking::KalmanFilter* tmp_filter_;
-
         /** \brief First time a detection is associated to the track */
         ros::Time first_time_detected_;
 
@@ -111,17 +113,20 @@ namespace open_ptrack
         /** \brief Last time a detection with high detection confidence is associated to the track */
         ros::Time last_time_detected_with_high_confidence_;
 
-        /** \brief Last time a prediction has been performed for the track */
-        ros::Time last_time_predicted_;
+        /** \brief Time instant of the cached Mahalanobis parameters */
+        ros::Time mahalanobis_parameters_time_;
 
-        /** \brief Index in the circular buffer corresponding to the last time a prediction has been performed */
-        int last_time_predicted_index_;
+        /** \brief If false, the cached Mahalanobis parameters have to be recomputed */
+        bool mahalanobis_parameters_valid_;
 
         /** Variables used for computing the detection/track Mahalanobis distance */
-        std::vector<MahalanobisParameters2d> mahalanobis_map2d_;
+        MahalanobisParameters2d mahalanobis_parameters2d_;
 
         /** Variables used for computing the detection/track Mahalanobis distance */
-        std::vector<MahalanobisParameters4d> mahalanobis_map4d_;
+        MahalanobisParameters4d mahalanobis_parameters4d_;
+
+        /** \brief Filter states after the updates of the last seconds (used for the velocity in the motion term) */
+        std::deque<StateSample> state_history_;
 
         /** \brief Track Status*/
         Status status_;
@@ -162,6 +167,32 @@ namespace open_ptrack
         /** \brief Count the number of consecutive updates with low confidence detections */
         int low_confidence_consecutive_frames_;
 
+        /**
+         * \brief Predict the Mahalanobis parameters at a time instant (cached until the next update).
+         *
+         * \param[in] when Time instant.
+         */
+        void
+        predictMahalanobisParameters(const ros::Time& when);
+
+        /**
+         * \brief Add the current filter state to the state history, removing samples too old to be used.
+         *
+         * \param[in] when Time instant of the current filter state.
+         */
+        void
+        addStateSample(const ros::Time& when);
+
+        /**
+         * \brief Get the track position at a past time instant, predicted from the last update before it.
+         *
+         * \param[in] t Time instant (in seconds).
+         * \param[out] x Position x component.
+         * \param[out] y Position y component.
+         */
+        void
+        getPastPosition(double t, double& x, double& y);
+
 
 
       public:
@@ -173,7 +204,8 @@ namespace open_ptrack
             double position_variance,
             double acceleration_variance,
             double period,
-            bool velocity_in_motion_term);
+            bool velocity_in_motion_term,
+            FilterBackend filter_backend = UNSCENTED);
 
         /** \brief Destructor. */
         virtual ~TrackObject();
@@ -242,6 +274,22 @@ namespace open_ptrack
         double
         getMahalanobisDistance(double x, double y, const ros::Time& when);
 
+        /**
+         * \brief Compute the region where detections can have a Mahalanobis distance lower than a threshold.
+         *
+         * Detections at time when farther than the returned radius from (x,y) have a Mahalanobis distance
+         * from the track greater than max_mahalanobis_distance.
+         *
+         * \param[in] max_mahalanobis_distance Mahalanobis distance threshold.
+         * \param[in] when Time instant.
+         * \param[out] x Predicted track x coordinate.
+         * \param[out] y Predicted track y coordinate.
+         *
+         * \return the radius of the region (infinite if it cannot be bounded).
+         */
+        double
+        getGatingRadius(double max_mahalanobis_distance, const ros::Time& when, double& x, double& y);
+
         /* Validate a track */
         void
         validate();
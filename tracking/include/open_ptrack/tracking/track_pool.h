@@ -0,0 +1,120 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_TRACK_POOL_H_
+#define OPEN_PTRACK_TRACKING_TRACK_POOL_H_
+
+#include <list>
+#include <string>
+#include <open_ptrack/tracking/track.h>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief TrackPool recycles the tracks deleted by a Tracker
+     *
+     *  Released tracks are moved to a free list together with their list node and their Kalman filter, and
+     *  are reset when a new track is created. Once the pool holds as many tracks as the peak number of
+     *  deleted tracks, creating and deleting tracks does not allocate memory. Tracks are owned by the pool
+     *  while they are free and by the track list they are created in otherwise.
+     **/
+    class TrackPool
+    {
+      public:
+
+        /** \brief Constructor. */
+        TrackPool();
+
+        /** \brief Destructor (deletes the free tracks). */
+        virtual ~TrackPool();
+
+        /**
+         * \brief Create a track, reusing a free one if possible, and append it to a track list.
+         *
+         * \param[in,out] tracks Track list.
+         * \param[in] id Track ID.
+         * \param[in] frame_id Track frame id.
+         * \param[in] position_variance Position variance.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] period Inverse of the frame rate.
+         * \param[in] velocity_in_motion_term If true, the velocity observed with a detection is part of the motion term.
+         * \param[in] filter_backend Algorithm used by the Kalman filter.
+         *
+         * \return the new track, which has still to be initialized with Track::init().
+         */
+        Track*
+        create(
+            std::list<Track*>& tracks,
+            int id,
+            const std::string& frame_id,
+            double position_variance,
+            double acceleration_variance,
+            double period,
+            bool velocity_in_motion_term,
+            FilterBackend filter_backend = UNSCENTED);
+
+        /**
+         * \brief Move a track from a track list to the pool.
+         *
+         * \param[in,out] tracks Track list.
+         * \param[in] it Position of the track in the list.
+         *
+         * \return the position following the released track (as std::list::erase).
+         */
+        std::list<Track*>::iterator
+        release(std::list<Track*>& tracks, std::list<Track*>::iterator it);
+
+        /**
+         * \brief Get the number of free tracks.
+         *
+         * \return the number of tracks which can be created without allocating memory.
+         */
+        size_t
+        size() const;
+
+        /** \brief Delete the free tracks. */
+        void
+        clear();
+
+      protected:
+
+        /** \brief Tracks ready to be reused. */
+        std::list<Track*> free_tracks_;
+    };
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* !defined(OPEN_PTRACK_TRACKING_TRACK_POOL_H_) */
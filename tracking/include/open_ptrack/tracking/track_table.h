@@ -0,0 +1,225 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_TRACK_TABLE_H_
+#define OPEN_PTRACK_TRACKING_TRACK_TABLE_H_
+
+#include <vector>
+#include <Eigen/Eigen>
+#include <open_ptrack/tracking/closed_form_kalman_filter.h>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief Ways of storing the tracks of a Tracker while computing the distance matrix */
+    enum TrackStorage
+    {
+      TRACK_LIST,   // Every track computes its distances from the detections (see Track::getMahalanobisDistance)
+      TRACK_TABLE   // Filter states are kept in a structure of arrays and processed in batch (see TrackTable)
+    };
+
+    struct TrackTableColumns;
+
+    /** \brief TrackTable stores the filters of the tracks of a Tracker as a structure of arrays
+     *
+     *  Rows are tracks, and every state, covariance and time component is a contiguous array padded to a
+     *  multiple of the SIMD width. This allows predicting all tracks with one vectorized pass and computing
+     *  the whole track x detection Mahalanobis matrix with another one, without walking the track list.
+     *  The table persists across frames: the Tracker rewrites only the rows of tracks whose filter changed.
+     *  Kernels use AVX2 (if the CPU supports it) or NEON, with a scalar fallback: results are the same
+     *  of Track::getMahalanobisDistance, up to rounding.
+     **/
+    class TrackTable
+    {
+      public:
+
+        /** \brief Constructor. */
+        TrackTable();
+
+        /**
+         * \brief Set the prediction model shared by all tracks.
+         *
+         * \param[in] period Period of the single step model.
+         * \param[in] acceleration_variance Acceleration variance.
+         * \param[in] velocity_in_motion_term If true, the velocity observed with a detection is part of the motion term.
+         */
+        void
+        setModel(double period, double acceleration_variance, bool velocity_in_motion_term);
+
+        /**
+         * \brief Set the number of rows.
+         *
+         * Rows below the new size keep their content, so that the table can persist across frames.
+         *
+         * \param[in] tracks Number of tracks.
+         */
+        void
+        resize(int tracks);
+
+        /**
+         * \brief Get the number of rows.
+         *
+         * \return the number of tracks.
+         */
+        int
+        size() const;
+
+        /**
+         * \brief Copy the filter of a track to a row.
+         *
+         * \param[in] row Row index.
+         * \param[in] filter Filter state at the last update.
+         * \param[in] time Time of the last update (in seconds).
+         * \param[in] velocity_gain Gain of the velocity observed with a detection.
+         * \param[in] velocity_offset_x Offset of the x velocity observed with a detection.
+         * \param[in] velocity_offset_y Offset of the y velocity observed with a detection.
+         */
+        void
+        setTrack(int row, const ClosedFormKalmanFilter<2>& filter, double time,
+            double velocity_gain = 0.0, double velocity_offset_x = 0.0, double velocity_offset_y = 0.0);
+
+        /**
+         * \brief Set the model of the velocity observed with a detection, without touching the filter of a row.
+         *
+         * \param[in] row Row index.
+         * \param[in] velocity_gain Gain of the velocity observed with a detection.
+         * \param[in] velocity_offset_x Offset of the x velocity observed with a detection.
+         * \param[in] velocity_offset_y Offset of the y velocity observed with a detection.
+         */
+        void
+        setVelocityModel(int row, double velocity_gain, double velocity_offset_x, double velocity_offset_y);
+
+        /**
+         * \brief Copy a row to another one (e.g. for closing the gap left by a deleted track).
+         *
+         * \param[in] from Source row.
+         * \param[in] to Destination row.
+         */
+        void
+        moveRow(int from, int to);
+
+        /**
+         * \brief Predict state and inverse innovation covariance of all tracks at a time instant.
+         *
+         * \param[in] when Time instant (in seconds).
+         */
+        void
+        predict(double when);
+
+        /**
+         * \brief Compute the distances between all tracks and detections, after predict().
+         *
+         * distance = detector_term + motion_weight * Mahalanobis distance, or invalid_distance if it is not finite.
+         *
+         * \param[in] x Detection x coordinates.
+         * \param[in] y Detection y coordinates.
+         * \param[in] detector_term Weighted detector likelihood of every detection.
+         * \param[in] motion_weight Weight of the Mahalanobis distance.
+         * \param[in] invalid_distance Value for NaN and infinite distances.
+         * \param[out] distances Row-major tracks x detections matrix (one row per track, x.size() columns).
+         */
+        void
+        computeDistances(const std::vector<double>& x, const std::vector<double>& y,
+            const std::vector<double>& detector_term, double motion_weight, double invalid_distance, double* distances);
+
+        /**
+         * \brief Get the instruction set used by the kernels.
+         *
+         * \return "avx2", "neon" or "scalar".
+         */
+        static const char*
+        getInstructionSet();
+
+        /**
+         * \brief Use the scalar kernels even if the CPU supports SIMD ones (e.g. for checking them).
+         *
+         * \param[in] scalar_kernels If true, this table uses the scalar kernels.
+         */
+        void
+        setScalarKernels(bool scalar_kernels);
+
+      protected:
+
+        /** \brief Contiguous array aligned for SIMD loads. */
+        typedef std::vector<double, Eigen::aligned_allocator<double> > Column;
+
+        /** \brief Get pointers to the columns, for the kernels. */
+        TrackTableColumns
+        getColumns();
+
+        /** \brief Number of tracks. */
+        int size_;
+
+        /** \brief Number of rows allocated in every column (a multiple of the SIMD width). */
+        int padded_size_;
+
+        /** \brief Period of the single step model. */
+        double period_;
+
+        /** \brief Acceleration variance. */
+        double acceleration_variance_;
+
+        /** \brief If true, the velocity observed with a detection is part of the motion term. */
+        bool velocity_in_motion_term_;
+
+        /** \brief If true, the scalar kernels are used whatever the CPU supports. */
+        bool scalar_kernels_;
+
+        /** \brief Filter state at the last update. */
+        Column x_, y_, vx_, vy_;
+
+        /** \brief Upper triangle of the state covariance at the last update (row-major). */
+        Column p_[10];
+
+        /** \brief Observation noise variances. */
+        Column r_[4];
+
+        /** \brief Time of the last update. */
+        Column time_;
+
+        /** \brief Linear model of the velocity observed with a detection. */
+        Column velocity_gain_, velocity_offset_x_, velocity_offset_y_;
+
+        /** \brief Predicted state. */
+        Column predicted_x_, predicted_y_, predicted_vx_, predicted_vy_;
+
+        /** \brief Upper triangle of the predicted inverse innovation covariance. */
+        Column si_[10];
+    };
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* !defined(OPEN_PTRACK_TRACKING_TRACK_TABLE_H_) */
@@ -42,7 +42,12 @@
 
 #include <open_ptrack/detection/detection.h>
 #include <open_ptrack/tracking/track.h>
+#include <open_ptrack/tracking/track_pool.h>
 #include <open_ptrack/tracking/munkres.h>
+#include <open_ptrack/tracking/sparse_assignment.h>
+#include <open_ptrack/tracking/gating_grid.h>
+#include <open_ptrack/tracking/track_table.h>
+#include <open_ptrack/opt_utils/latency_profiler.h>
 #include <opt_msgs/TrackArray.h>
 #include <opt_msgs/IDArray.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -59,6 +64,9 @@ namespace open_ptrack
         /** \brief List of all active tracks */
         std::list<open_ptrack::tracking::Track*> tracks_;
 
+        /** \brief Deleted tracks, reused for creating new ones */
+        open_ptrack::tracking::TrackPool track_pool_;
+
         /** \brief List of lost tracks */
         std::list<open_ptrack::tracking::Track*> lost_tracks_;
 
@@ -132,10 +140,83 @@ namespace open_ptrack
         /** \brief if true, the sensor is considered to be vertically placed (portrait mode) */
         bool vertical_;
 
+        /** \brief Algorithm used to solve the Global Nearest Neighbor problem */
+        AssociationSolver association_solver_;
+
+        /** \brief Algorithm used by the Kalman filters of new tracks */
+        FilterBackend filter_backend_;
+
+        /** \brief Sparse solver (kept as a member for reusing its buffers between frames) */
+        SparseAssignment sparse_assignment_;
+
+        /** \brief Spatial index of the track gating regions (kept as a member for reusing its buffers between frames) */
+        GatingGrid gating_grid_;
+
+        /** \brief How tracks are stored while computing the distance matrix */
+        TrackStorage track_storage_;
+
+        /** \brief Maximum number of updates in the state history of the new tracks */
+        size_t state_history_size_;
+
+        /** \brief Time of the most recent batch of detections */
+        ros::Time latest_detections_time_;
+
+        /** \brief If true, the current batch of detections is older than a previous one (e.g. from a slower sensor) */
+        bool late_detections_;
+
+        /** \brief Structure of arrays of the track filters (used if track_storage_ is TRACK_TABLE), kept across frames */
+        TrackTable track_table_;
+
+        /** \brief Track held by a row of track_table_ */
+        struct TrackTableRow
+        {
+          /** \brief Track (rows follow the order of tracks_) */
+          Track* track;
+
+          /** \brief Filter revision copied to the row */
+          unsigned int filter_revision;
+
+          /** \brief If false, the row holds a past filter of the track (for late detections) */
+          bool current;
+        };
+
+        /** \brief Tracks held by the rows of track_table_ */
+        std::vector<TrackTableRow> track_table_rows_;
+
+        /** \brief Time origin of the times in track_table_ */
+        ros::Time track_table_epoch_;
+
+        /** \brief Latency histograms of the tracking stages (NULL if latency profiling is disabled) */
+        opt_utils::LatencyHistogram* new_frame_latency_;
+        opt_utils::LatencyHistogram* distance_matrix_latency_;
+        opt_utils::LatencyHistogram* cost_matrix_latency_;
+        opt_utils::LatencyHistogram* assignment_latency_;
+        opt_utils::LatencyHistogram* update_latency_;
+        opt_utils::LatencyHistogram* lost_tracks_latency_;
+        opt_utils::LatencyHistogram* track_creation_latency_;
+
         /** \brief Create detections<->tracks distance matrix for data association */
         virtual void
         createDistanceMatrix();
 
+        /**
+         * \brief Fill the distance matrix evaluating only detection<->track pairs which can be within the gate.
+         *
+         * \return false if pairs cannot be pruned (e.g. detections referred to different time instants).
+         */
+        virtual bool
+        createGatedDistanceMatrix();
+
+        /**
+         * \brief Fill the distance matrix with the batched kernels of the track table.
+         *
+         * Only the rows of tracks whose filter changed since the previous frame are copied to the table.
+         *
+         * \return false if the table cannot be used (e.g. detections referred to different time instants).
+         */
+        virtual bool
+        createTableDistanceMatrix();
+
         /** \brief Create detections<->tracks cost matrix to be used to solve the Global Nearest Neighbor problem */
         virtual void
         createCostMatrix();
@@ -148,7 +229,21 @@ namespace open_ptrack
         virtual void
         fillUnassociatedDetections();
 
-        /** \brief Create new tracks with high confidence unassociated detections */
+        /**
+         * \brief Update the track associated in this round to a detection of another source with an unassociated detection
+         * within its gate (sequential updates of a target seen by several cameras of a fusion window).
+         *
+         * \param[in] measure Index of the unassociated detection.
+         *
+         * \return true if the detection has updated a track, false if it has to be considered for a new track.
+         */
+        bool
+        fuseUnassociatedDetection(int measure);
+
+        /**
+         * \brief Create new tracks with high confidence unassociated detections (detections of other sources within the
+         * gate of a track created in this round update it instead)
+         */
         virtual void
         createNewTracks();
 
@@ -338,6 +433,55 @@ namespace open_ptrack
          */
         virtual void
         setGateDistance (double gate_distance);
+
+        /**
+         * \brief Set the algorithm used to solve the Global Nearest Neighbor problem
+         *
+         * \param[in] association_solver MUNKRES (dense) or SPARSE_LAP (gated pairs only).
+         */
+        virtual void
+        setAssociationSolver (AssociationSolver association_solver);
+
+        /**
+         * \brief Set the number of threads used for solving independent association sub-problems
+         *
+         * \param[in] threads Number of threads (1 solves everything in the tracking thread). Only used by SPARSE_LAP.
+         */
+        virtual void
+        setAssociationThreads (int threads);
+
+        /**
+         * \brief Set the algorithm used by the Kalman filters of new tracks
+         *
+         * \param[in] filter_backend UNSCENTED (bayes package) or CLOSED_FORM (fixed-size Kalman equations).
+         */
+        virtual void
+        setFilterBackend (FilterBackend filter_backend);
+
+        /**
+         * \brief Set how tracks are stored while computing the distance matrix
+         *
+         * \param[in] track_storage TRACK_LIST (every track computes its distances) or TRACK_TABLE (batched kernels).
+         */
+        virtual void
+        setTrackStorage (TrackStorage track_storage);
+
+        /**
+         * \brief Set the maximum number of updates kept by the tracks for applying late detections
+         *
+         * \param[in] state_history_size Maximum number of updates (for the tracks created from now on), e.g. the
+         * maximum detection delay times the detection rate of all cameras.
+         */
+        virtual void
+        setStateHistorySize (size_t state_history_size);
+
+        /**
+         * \brief Set the profiler measuring the latency of every tracking stage
+         *
+         * \param[in] profiler Latency profiler (it must outlive the tracker), or NULL for no profiling.
+         */
+        virtual void
+        setLatencyProfiler (opt_utils::LatencyProfiler* profiler);
     };
 
   } /* namespace tracking */
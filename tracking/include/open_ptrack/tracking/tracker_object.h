@@ -43,6 +43,8 @@
 #include <open_ptrack/detection/detection.h>
 #include <open_ptrack/tracking/track_object.h>
 #include <open_ptrack/tracking/munkres.h>
+#include <open_ptrack/tracking/sparse_assignment.h>
+#include <open_ptrack/tracking/gating_grid.h>
 #include <opt_msgs/TrackArray.h>
 #include <opt_msgs/IDArray.h>
 #include <opt_msgs/ObjectName.h>
@@ -129,10 +131,30 @@ protected:
     /** \brief if true, the sensor is considered to be vertically placed (portrait mode) */
     bool vertical_;
 
+    /** \brief Algorithm used to solve the Global Nearest Neighbor problem */
+    AssociationSolver association_solver_;
+
+    /** \brief Algorithm used by the Kalman filters of new tracks */
+    FilterBackend filter_backend_;
+
+    /** \brief Sparse solver (kept as a member for reusing its buffers between frames) */
+    SparseAssignment sparse_assignment_;
+
+    /** \brief Spatial index of the track gating regions (kept as a member for reusing its buffers between frames) */
+    GatingGrid gating_grid_;
+
     /** \brief Create detections<->tracks distance matrix for data association */
     void
     createDistanceMatrix();
 
+    /**
+     * \brief Fill the distance matrix evaluating only detection<->track pairs which can be within the gate.
+     *
+     * \return false if pairs cannot be pruned (e.g. detections referred to different time instants).
+     */
+    bool
+    createGatedDistanceMatrix();
+
     /** \brief Create detections<->tracks cost matrix to be used to solve the Global Nearest Neighbor problem */
     void
     createCostMatrix();
@@ -339,6 +361,30 @@ public:
          */
     void
     setGateDistance (double gate_distance);
+
+    /**
+         * \brief Set the algorithm used to solve the Global Nearest Neighbor problem
+         *
+         * \param[in] association_solver MUNKRES (dense) or SPARSE_LAP (gated pairs only).
+         */
+    void
+    setAssociationSolver (AssociationSolver association_solver);
+
+    /**
+         * \brief Set the number of threads used for solving independent association sub-problems
+         *
+         * \param[in] threads Number of threads (1 solves everything in the tracking thread). Only used by SPARSE_LAP.
+         */
+    void
+    setAssociationThreads (int threads);
+
+    /**
+     * \brief Set the algorithm used by the Kalman filters of new tracks
+     *
+     * \param[in] filter_backend UNSCENTED (bayes package) or CLOSED_FORM (fixed-size Kalman equations).
+     */
+    void
+    setFilterBackend (FilterBackend filter_backend);
 };
 
 } /* namespace tracking */
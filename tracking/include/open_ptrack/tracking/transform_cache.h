@@ -0,0 +1,163 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_TRANSFORM_CACHE_H_
+#define OPEN_PTRACK_TRACKING_TRANSFORM_CACHE_H_
+
+#include <ros/ros.h>
+#include <tf/transform_listener.h>
+#include <tf/tfMessage.h>
+#include <Eigen/Eigen>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief TransformCache stores the transforms between the cameras and the world frame used by the tracker nodes
+     *
+     *  Camera extrinsics do not change after calibration, so the transforms of a frame_id are looked up once
+     *  and reused for every detection message. They are looked up again when a static transform is published
+     *  on /tf_static or when they are older than the cache lifetime (calibration transforms published on /tf
+     *  by static_transform_publisher do not notify any change). The registration matrices of the calibration
+     *  refinement are stored too, until the refinement is reloaded.
+     *  All methods can be called from different threads.
+     **/
+    class TransformCache
+    {
+      public:
+
+        /**
+         * \brief Constructor.
+         *
+         * \param[in] tf_listener Listener used for looking up the transforms.
+         * \param[in] world_frame_id World reference frame.
+         * \param[in] lifetime Seconds after which transforms are looked up again (0 looks them up for every message).
+         */
+        TransformCache(tf::TransformListener* tf_listener, const std::string& world_frame_id, double lifetime);
+
+        /**
+         * \brief Invalidate the cached transforms whenever a static transform is published.
+         *
+         * \param[in] nh Node handle used for subscribing to /tf_static.
+         */
+        void
+        subscribe(ros::NodeHandle& nh);
+
+        /**
+         * \brief Get the transforms between a camera frame and the world frame.
+         *
+         * Throws tf::TransformException if the transforms are not cached and cannot be looked up.
+         *
+         * \param[in] frame_id Camera frame.
+         * \param[out] transform Transform from the camera frame to the world frame.
+         * \param[out] inverse_transform Transform from the world frame to the camera frame.
+         */
+        void
+        getTransforms(const std::string& frame_id, tf::StampedTransform& transform,
+            tf::StampedTransform& inverse_transform);
+
+        /**
+         * \brief Get the registration matrix of a camera stored with setRegistrationMatrix.
+         *
+         * \param[in] frame_id Camera frame.
+         * \param[out] matrix Registration matrix.
+         *
+         * \return false if the matrix is not stored (it has never been read, or the refinement has been reloaded).
+         */
+        bool
+        getRegistrationMatrix(const std::string& frame_id, Eigen::Matrix4d& matrix);
+
+        /**
+         * \brief Store the registration matrix of a camera.
+         *
+         * \param[in] frame_id Camera frame.
+         * \param[in] matrix Registration matrix.
+         */
+        void
+        setRegistrationMatrix(const std::string& frame_id, const Eigen::Matrix4d& matrix);
+
+        /** \brief Look up all transforms again at their next use. */
+        void
+        invalidateTransforms();
+
+        /** \brief Remove all registration matrices (e.g. for reading the refinement files again). */
+        void
+        invalidateRegistrationMatrices();
+
+      protected:
+
+        /** \brief Callback of /tf_static. */
+        void
+        staticTransformCallback(const tf::tfMessage::ConstPtr& msg);
+
+        /** \brief Transforms of a camera. */
+        struct CameraTransforms
+        {
+          tf::StampedTransform transform;
+          tf::StampedTransform inverse_transform;
+          ros::Time lookup_time;
+        };
+
+        typedef std::map<std::string, Eigen::Matrix4d, std::less<std::string>,
+            Eigen::aligned_allocator<std::pair<const std::string, Eigen::Matrix4d> > > RegistrationMap;
+
+        /** \brief Listener used for looking up the transforms. */
+        tf::TransformListener* tf_listener_;
+
+        /** \brief World reference frame. */
+        std::string world_frame_id_;
+
+        /** \brief Time after which transforms are looked up again. */
+        ros::Duration lifetime_;
+
+        /** \brief Transforms of every camera frame. */
+        std::map<std::string, CameraTransforms> transforms_;
+
+        /** \brief Registration matrix of every camera frame. */
+        RegistrationMap registration_matrices_;
+
+        /** \brief Subscriber to /tf_static. */
+        ros::Subscriber static_transform_sub_;
+
+        /** \brief Mutex protecting the cached transforms and matrices. */
+        std::mutex mutex_;
+    };
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* OPEN_PTRACK_TRACKING_TRANSFORM_CACHE_H_ */
@@ -0,0 +1,198 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <open_ptrack/tracking/detection_log.h>
+#include <ros/serialization.h>
+#include <cstring>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    const char DETECTION_LOG_MAGIC[8] = {'O', 'P', 'T', 'D', 'L', 'O', 'G', '\0'};
+    const uint32_t DETECTION_LOG_VERSION = 2;
+    const uint32_t DETECTION_LOG_BYTE_ORDER = 0x01020304;
+    const uint32_t DETECTION_LOG_MAX_MESSAGE_LENGTH = 64 * 1024 * 1024;
+
+    namespace
+    {
+      // Rotation matrix (row-major) and translation of a transform:
+      void
+      writeTransform(std::ofstream& file, const tf::Transform& transform)
+      {
+        double values[12];
+        for(int i = 0; i < 3; i++)
+        {
+          for(int j = 0; j < 3; j++)
+            values[i * 3 + j] = transform.getBasis()[i][j];
+          values[9 + i] = transform.getOrigin()[i];
+        }
+        file.write(reinterpret_cast<const char*>(values), sizeof(values));
+      }
+
+      bool
+      readTransform(std::ifstream& file, tf::Transform& transform)
+      {
+        double values[12];
+        if (not file.read(reinterpret_cast<char*>(values), sizeof(values)))
+          return false;
+
+        transform.setBasis(tf::Matrix3x3(values[0], values[1], values[2], values[3], values[4], values[5],
+            values[6], values[7], values[8]));
+        transform.setOrigin(tf::Vector3(values[9], values[10], values[11]));
+        return true;
+      }
+    }
+
+    DetectionLogWriter::DetectionLogWriter()
+    {
+
+    }
+
+    DetectionLogWriter::~DetectionLogWriter()
+    {
+      close();
+    }
+
+    bool
+    DetectionLogWriter::open(const std::string& filename)
+    {
+      close();
+      file_.open(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+      if (not file_.is_open())
+        return false;
+
+      file_.write(DETECTION_LOG_MAGIC, sizeof(DETECTION_LOG_MAGIC));
+      file_.write(reinterpret_cast<const char*>(&DETECTION_LOG_VERSION), sizeof(DETECTION_LOG_VERSION));
+      file_.write(reinterpret_cast<const char*>(&DETECTION_LOG_BYTE_ORDER), sizeof(DETECTION_LOG_BYTE_ORDER));
+      return bool(file_);
+    }
+
+    void
+    DetectionLogWriter::close()
+    {
+      if (file_.is_open())
+        file_.close();
+    }
+
+    bool
+    DetectionLogWriter::isOpen() const
+    {
+      return file_.is_open();
+    }
+
+    bool
+    DetectionLogWriter::write(const DetectionLogRecord& record)
+    {
+      uint32_t length = ros::serialization::serializationLength(record.msg);
+      buffer_.resize(length);
+      ros::serialization::OStream stream(buffer_.data(), length);
+      ros::serialization::serialize(stream, record.msg);
+
+      writeTransform(file_, record.transform);
+      writeTransform(file_, record.inverse_transform);
+      Eigen::Matrix<double, 4, 4, Eigen::RowMajor> registration_matrix = record.registration_matrix;
+      file_.write(reinterpret_cast<const char*>(registration_matrix.data()), 16 * sizeof(double));
+      file_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+      file_.write(reinterpret_cast<const char*>(buffer_.data()), length);
+      return bool(file_);
+    }
+
+    DetectionLogReader::DetectionLogReader() :
+        file_size_(0)
+    {
+
+    }
+
+    DetectionLogReader::~DetectionLogReader()
+    {
+
+    }
+
+    bool
+    DetectionLogReader::open(const std::string& filename)
+    {
+      if (file_.is_open())
+        file_.close();
+      file_.clear();
+      file_.open(filename.c_str(), std::ios::in | std::ios::binary);
+      if (not file_.seekg(0, std::ios::end))
+        return false;
+      file_size_ = file_.tellg();
+      file_.seekg(0, std::ios::beg);
+
+      // Numbers are in the byte order of the writer, so logs are read only on hosts with the same one:
+      char magic[sizeof(DETECTION_LOG_MAGIC)];
+      uint32_t version, byte_order;
+      if (not (file_.read(magic, sizeof(magic)) and file_.read(reinterpret_cast<char*>(&version), sizeof(version)) and
+          file_.read(reinterpret_cast<char*>(&byte_order), sizeof(byte_order))))
+        return false;
+      return (std::memcmp(magic, DETECTION_LOG_MAGIC, sizeof(magic)) == 0) and (version == DETECTION_LOG_VERSION) and
+          (byte_order == DETECTION_LOG_BYTE_ORDER);
+    }
+
+    bool
+    DetectionLogReader::read(DetectionLogRecord& record)
+    {
+      Eigen::Matrix<double, 4, 4, Eigen::RowMajor> registration_matrix;
+      uint32_t length;
+      if (not (readTransform(file_, record.transform) and readTransform(file_, record.inverse_transform) and
+          file_.read(reinterpret_cast<char*>(registration_matrix.data()), 16 * sizeof(double)) and
+          file_.read(reinterpret_cast<char*>(&length), sizeof(length))))
+        return false;
+      record.registration_matrix = registration_matrix;
+
+      // A corrupted length must not allocate more than the rest of the file:
+      std::streamoff remaining = file_size_ - file_.tellg();
+      if ((length > DETECTION_LOG_MAX_MESSAGE_LENGTH) or (std::streamoff(length) > remaining))
+        return false;
+
+      buffer_.resize(length);
+      if (not file_.read(reinterpret_cast<char*>(buffer_.data()), length))
+        return false;
+      try
+      {
+        ros::serialization::IStream stream(buffer_.data(), length);
+        ros::serialization::deserialize(stream, record.msg);
+      }
+      catch (ros::serialization::StreamOverrunException&)
+      {
+        return false;
+      }
+      return true;
+    }
+  } /* namespace tracking */
+} /* namespace open_ptrack */
@@ -0,0 +1,159 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "open_ptrack/tracking/gating_grid.h"
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+
+    const double GatingGrid::MIN_CELL_SIZE = 0.1;
+
+    GatingGrid::GatingGrid(int max_cells_per_region) :
+        max_cells_per_region_(max_cells_per_region), cell_size_(1.0)
+    {
+
+    }
+
+    long long
+    GatingGrid::getKey(int cell_x, int cell_y)
+    {
+      return (static_cast<long long>(cell_x) << 32) | static_cast<unsigned int>(cell_y);
+    }
+
+    bool
+    GatingGrid::getCell(double x, double y, int& cell_x, int& cell_y) const
+    {
+      double fx = std::floor(x / cell_size_);
+      double fy = std::floor(y / cell_size_);
+      // Also false for NaN:
+      if (!(std::abs(fx) < 1e9 && std::abs(fy) < 1e9))
+        return false;
+      cell_x = int(fx);
+      cell_y = int(fy);
+      return true;
+    }
+
+    void
+    GatingGrid::build(const std::vector<double>& x, const std::vector<double>& y, const std::vector<double>& radius)
+    {
+      x_ = x;
+      y_ = y;
+      radius_.resize(radius.size());
+      cells_.clear();
+      unbounded_.clear();
+
+      // Cell size: median radius of bounded discs
+      std::vector<double> finite_radius;
+      for(size_t i = 0; i < radius.size(); i++)
+      {
+        // Small tolerance for rounding errors in the bound:
+        radius_[i] = radius[i] * (1.0 + 1e-9);
+        if (std::isfinite(radius_[i]))
+          finite_radius.push_back(radius_[i]);
+      }
+      cell_size_ = 1.0;
+      if (finite_radius.size() > 0)
+      {
+        std::nth_element(finite_radius.begin(), finite_radius.begin() + finite_radius.size() / 2, finite_radius.end());
+        cell_size_ = std::max(finite_radius[finite_radius.size() / 2], MIN_CELL_SIZE);
+      }
+
+      // Store every disc in the cells overlapped by its bounding box:
+      for(size_t i = 0; i < radius_.size(); i++)
+      {
+        int min_x, min_y, max_x, max_y;
+        if (!std::isfinite(radius_[i]) ||
+            !getCell(x_[i] - radius_[i], y_[i] - radius_[i], min_x, min_y) ||
+            !getCell(x_[i] + radius_[i], y_[i] + radius_[i], max_x, max_y) ||
+            double(max_x - min_x + 1) * double(max_y - min_y + 1) > max_cells_per_region_)
+        {
+          unbounded_.push_back(i);
+          continue;
+        }
+
+        for(int cell_x = min_x; cell_x <= max_x; cell_x++)
+          for(int cell_y = min_y; cell_y <= max_y; cell_y++)
+            cells_.push_back(std::make_pair(getKey(cell_x, cell_y), int(i)));
+      }
+      std::sort(cells_.begin(), cells_.end());
+    }
+
+    void
+    GatingGrid::query(double x, double y, std::vector<int>& regions) const
+    {
+      regions.clear();
+
+      int cell_x, cell_y;
+      if (getCell(x, y, cell_x, cell_y))
+      {
+        long long key = getKey(cell_x, cell_y);
+        std::vector<std::pair<long long, int> >::const_iterator it =
+            std::lower_bound(cells_.begin(), cells_.end(), std::make_pair(key, std::numeric_limits<int>::min()));
+        for(; it != cells_.end() && it->first == key; it++)
+        {
+          int i = it->second;
+          double dx = x - x_[i];
+          double dy = y - y_[i];
+          if (dx * dx + dy * dy <= radius_[i] * radius_[i])
+            regions.push_back(i);
+        }
+      }
+
+      // Discs with NaN center or radius are kept, so that the caller evaluates them as before:
+      for(size_t k = 0; k < unbounded_.size(); k++)
+      {
+        int i = unbounded_[k];
+        double dx = x - x_[i];
+        double dy = y - y_[i];
+        if (!(dx * dx + dy * dy > radius_[i] * radius_[i]))
+          regions.push_back(i);
+      }
+    }
+
+    double
+    GatingGrid::getCellSize() const
+    {
+      return cell_size_;
+    }
+
+  } /* namespace tracking */
+} /* namespace open_ptrack */
@@ -37,6 +37,7 @@
  *
  */
 
+#include <algorithm>
 #include <ros/ros.h>
 
 #include <open_ptrack/tracking/kalman_filter.h>
@@ -45,6 +46,19 @@ namespace open_ptrack
 {
   namespace tracking
   {
+    namespace
+    {
+      /** \brief Copy the top-left size x size block of an Eigen matrix to a SymMatrix. */
+      template <typename MatrixType> void
+      toSymMatrix(const MatrixType& m, int size, Bayesian_filter::FM::SymMatrix& out)
+      {
+        if ((out.size1() != size_t(size)) or (out.size2() != size_t(size)))
+          out.resize(size, size, false);
+        for(int i = 0; i < size; i++)
+          for(int j = 0; j < size; j++)
+            out(i, j) = m(i, j);
+      }
+    }
 
     PredictModel::PredictModel(double dt, double acceleration_variance) :
 		    Bayesian_filter::Linear_predict_model(4, 2), dt_(dt)
@@ -73,6 +87,28 @@ namespace open_ptrack
       G(3, 1) = dt;
     }
 
+    PredictModel::PredictModel(double dt, double acceleration_variance, double interval) :
+        Bayesian_filter::Linear_predict_model(4, 4), dt_(dt)
+    {
+      for(size_t i = 0; i < 4; i++)
+        for(size_t j = 0; j < 4; j++)
+        {
+          Fx(i, j) = (i == j) ? 1.0 : 0.0;
+          G(i, j) = (i == j) ? 1.0 : 0.0;
+        }
+
+      // The closed-form process noise is factored as G*diag(q)*G' (LDL' decomposition of each axis block):
+      double pp, pv, vv;
+      getProcessNoise(interval, dt, acceleration_variance, pp, pv, vv);
+      for(size_t i = 0; i < 2; i++)
+      {
+        Fx(i, 2 + i) = interval;
+        G(2 + i, i) = pp > 0.0 ? pv / pp : 0.0;
+        q[i] = pp;
+        q[2 + i] = pp > 0.0 ? std::max(0.0, vv - pv * pv / pp) : vv;
+      }
+    }
+
     PredictModel::~PredictModel()
     {
 
@@ -107,16 +143,27 @@ namespace open_ptrack
 
     }
 
-    KalmanFilter::KalmanFilter(double dt, double position_variance, double acceleration_variance, int output_dimension) :
+    KalmanFilter::KalmanFilter(double dt, double position_variance, double acceleration_variance, int output_dimension,
+        FilterBackend backend) :
 		    dt_(dt), position_variance_(position_variance), depth_multiplier_(std::pow(0.005 / 1.96, 2)),
-		    acceleration_variance_(acceleration_variance), output_dimension_(output_dimension)
+		    acceleration_variance_(acceleration_variance), output_dimension_(output_dimension), backend_(backend),
+		    filter_(NULL), predict_model_(NULL), observe_model_(NULL)
     {
-      predict_model_ = new PredictModel(dt, acceleration_variance);
-      observe_model_ = new ObserveModel(position_variance, output_dimension);
-      filter_ = new Bayesian_filter::Unscented_scheme(4);
+      if (backend_ == CLOSED_FORM)
+      {
+        setPredictModel(acceleration_variance);
+        setObserveModel(position_variance);
+      }
+      else
+      {
+        predict_model_ = new PredictModel(dt, acceleration_variance);
+        observe_model_ = new ObserveModel(position_variance, output_dimension);
+        filter_ = new Bayesian_filter::Unscented_scheme(4);
+      }
     }
 
-    KalmanFilter::KalmanFilter(const KalmanFilter& orig)
+    KalmanFilter::KalmanFilter(const KalmanFilter& orig) :
+        filter_(NULL), predict_model_(NULL), observe_model_(NULL)
     {
       *this = orig;
     }
@@ -128,9 +175,18 @@ namespace open_ptrack
       this->position_variance_ = orig.position_variance_;
       this->depth_multiplier_ = orig.depth_multiplier_;
       this->acceleration_variance_ = orig.acceleration_variance_;
+      this->output_dimension_ = orig.output_dimension_;
+      this->backend_ = orig.backend_;
+      this->closed_form_filter_ = orig.closed_form_filter_;
       delete this->predict_model_;
       delete this->observe_model_;
       delete this->filter_;
+      this->predict_model_ = NULL;
+      this->observe_model_ = NULL;
+      this->filter_ = NULL;
+      if (backend_ == CLOSED_FORM)
+        return *this;
+
       this->predict_model_ = new PredictModel(dt_, acceleration_variance_);
       this->observe_model_ = new ObserveModel(position_variance_, output_dimension_);
       this->filter_ = new Bayesian_filter::Unscented_scheme(4, 2);
@@ -193,27 +249,63 @@ namespace open_ptrack
       delete filter_;
     }
 
+    void
+    KalmanFilter::reset(double dt, double position_variance, double acceleration_variance, int output_dimension,
+        FilterBackend backend)
+    {
+      if ((backend != backend_) or (output_dimension != output_dimension_) or (dt != dt_))
+      {
+        delete predict_model_;
+        delete observe_model_;
+        delete filter_;
+        predict_model_ = NULL;
+        observe_model_ = NULL;
+        filter_ = NULL;
+      }
+      dt_ = dt;
+      output_dimension_ = output_dimension;
+      backend_ = backend;
+
+      if ((backend_ == UNSCENTED) and (filter_ == NULL))
+        filter_ = new Bayesian_filter::Unscented_scheme(4);
+      if ((predict_model_ == NULL) or (acceleration_variance != acceleration_variance_))
+        setPredictModel(acceleration_variance);
+      if ((observe_model_ == NULL) or (position_variance != position_variance_))
+        setObserveModel(position_variance);
+    }
+
     void
     KalmanFilter::init(double x, double y, double distance, bool velocity_in_motion_term)
     {
+      const double velocity_variance = 100; //1000.0;
 
-      Bayesian_filter_matrix::Vec state(4);
-      Bayesian_filter_matrix::SymMatrix cov(4, 4);
+      // Filter initialization:
+      if (backend_ == CLOSED_FORM)
+      {
+        ClosedFormKalmanFilter<2>::StateMatrix X = ClosedFormKalmanFilter<2>::StateMatrix::Zero();
+        X(2, 2) = velocity_variance;
+        X(3, 3) = velocity_variance;
+        closed_form_filter_.init(ClosedFormKalmanFilter<2>::StateVector(x, y, 0.0, 0.0), X);
+      }
+      else
+      {
+        Bayesian_filter_matrix::Vec state(4);
+        Bayesian_filter_matrix::SymMatrix cov(4, 4);
 
-      state[0] = x;
-      state[1] = y;
-      state[2] = 0.0;
-      state[3] = 0.0;
+        state[0] = x;
+        state[1] = y;
+        state[2] = 0.0;
+        state[3] = 0.0;
 
-      for(size_t i = 0; i < 4; i++)
-        for(size_t j = 0; j < 4; j++)
-          cov(i, j) = 0.0;
+        for(size_t i = 0; i < 4; i++)
+          for(size_t j = 0; j < 4; j++)
+            cov(i, j) = 0.0;
 
-      cov(2, 2) = 100; //1000.0;
-      cov(3, 3) = 100; //1000.0;
+        cov(2, 2) = velocity_variance;
+        cov(3, 3) = velocity_variance;
 
-      // Filter initialization:
-      filter_->init_kalman(state, cov);
+        filter_->init_kalman(state, cov);
+      }
 
       // First update:
       if (velocity_in_motion_term)
@@ -226,23 +318,41 @@ namespace open_ptrack
     void
     KalmanFilter::predict()
     {
-      filter_->predict(*predict_model_);
+      if (backend_ == CLOSED_FORM)
+        closed_form_filter_.predict();
+      else
+        filter_->predict(*predict_model_);
     }
 
     void
     KalmanFilter::predict(double& x, double& y, double& vx, double& vy)
     {
       predict();
+      getState(x, y, vx, vy);
+    }
 
-      x = filter_->x[0];
-      y = filter_->x[1];
-      vx = filter_->x[2];
-      vy = filter_->x[3];
+    void
+    KalmanFilter::predict(double interval)
+    {
+      if (not (interval > 0.0))
+        return;
+
+      if (backend_ == CLOSED_FORM)
+        closed_form_filter_.predict(interval);
+      else
+      {
+        PredictModel predict_model(dt_, acceleration_variance_, interval);
+        filter_->predict(predict_model);
+      }
     }
 
     void
     KalmanFilter::update()
     {
+      // The closed-form filter updates the state when observing:
+      if (backend_ == CLOSED_FORM)
+        return;
+
       filter_->update();
       //filter_->update_XX(2.0);
     }
@@ -250,13 +360,20 @@ namespace open_ptrack
     void
     KalmanFilter::update(double x, double y, double distance)
     {
+      //printf("%d %f %f %f ", _id, x, y, height);
+
+      if (backend_ == CLOSED_FORM)
+      {
+        closed_form_filter_.setObservationVariance(0, position_variance_ + std::pow(distance, 4) * depth_multiplier_);
+        closed_form_filter_.setObservationVariance(1, position_variance_ + std::pow(distance, 4) * depth_multiplier_);
+        closed_form_filter_.observe(Eigen::Vector2d(x, y));
+        return;
+      }
 
       Bayesian_filter_matrix::Vec observation(2);
       observation[0] = x;
       observation[1] = y;
 
-      //printf("%d %f %f %f ", _id, x, y, height);
-
       observe_model_->Zv[0] = position_variance_ + std::pow(distance, 4) * depth_multiplier_;
       observe_model_->Zv[1] = position_variance_ + std::pow(distance, 4) * depth_multiplier_;
 
@@ -269,13 +386,6 @@ namespace open_ptrack
     void
     KalmanFilter::update(double x, double y, double vx, double vy, double distance)
     {
-
-      Bayesian_filter_matrix::Vec observation(4);
-      observation[0] = x;
-      observation[1] = y;
-      observation[2] = vx;
-      observation[3] = vy;
-
       //printf("%d %f %f %f ", _id, x, y, height);
 
       //	observe_model_->Zv[0] = position_variance_ + std::pow(distance, 4) * depth_multiplier_;
@@ -283,6 +393,18 @@ namespace open_ptrack
       //	observe_model_->Zv[2] = 16 * position_variance_ + std::pow(distance, 4) * depth_multiplier_;
       //	observe_model_->Zv[3] = 16 * position_variance_ + std::pow(distance, 4) * depth_multiplier_;
 
+      if (backend_ == CLOSED_FORM)
+      {
+        closed_form_filter_.observe(Eigen::Vector4d(x, y, vx, vy));
+        return;
+      }
+
+      Bayesian_filter_matrix::Vec observation(4);
+      observation[0] = x;
+      observation[1] = y;
+      observation[2] = vx;
+      observation[3] = vy;
+
       filter_->observe(*observe_model_, observation);
       filter_->update();
       //filter_->update_XX(2.0);
@@ -292,6 +414,13 @@ namespace open_ptrack
     void
     KalmanFilter::getMahalanobisParameters(MahalanobisParameters2d& mp)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        toSymMatrix(closed_form_filter_.getInverseInnovationCovariance(), closed_form_filter_.getObservationSize(), mp.SI);
+        getState(mp.x, mp.y);
+        return;
+      }
+
       mp.SI = filter_->SI;
       mp.x = filter_->x[0];
       mp.y = filter_->x[1];
@@ -300,6 +429,13 @@ namespace open_ptrack
     void
     KalmanFilter::getMahalanobisParameters(MahalanobisParameters4d& mp)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        toSymMatrix(closed_form_filter_.getInverseInnovationCovariance(), closed_form_filter_.getObservationSize(), mp.SI);
+        getState(mp.x, mp.y, mp.vx, mp.vy);
+        return;
+      }
+
       mp.SI = filter_->SI;
       mp.x = filter_->x[0];
       mp.y = filter_->x[1];
@@ -307,6 +443,113 @@ namespace open_ptrack
       mp.vy = filter_->x[3];
     }
 
+    const ClosedFormKalmanFilter<2>&
+    KalmanFilter::getClosedFormFilter(ClosedFormKalmanFilter<2>& buffer)
+    {
+      if (backend_ == CLOSED_FORM)
+        return closed_form_filter_;
+
+      ClosedFormKalmanFilter<2>::StateVector x;
+      ClosedFormKalmanFilter<2>::StateMatrix X;
+      for(int i = 0; i < 4; i++)
+      {
+        x(i) = filter_->x[i];
+        for(int j = 0; j < 4; j++)
+          X(i, j) = filter_->X(i, j);
+      }
+      buffer.setPredictModel(dt_, acceleration_variance_);
+      for(int i = 0; i < output_dimension_; i++)
+        buffer.setObservationVariance(i, observe_model_->Zv[i]);
+      buffer.init(x, X);
+      return buffer;
+    }
+
+    const ClosedFormKalmanFilter<2>&
+    KalmanFilter::getClosedFormFilter(const KalmanFilterState& state, ClosedFormKalmanFilter<2>& buffer)
+    {
+      buffer.setPredictModel(dt_, acceleration_variance_);
+      for(int i = 0; i < output_dimension_; i++)
+        buffer.setObservationVariance(i, state.observation_variances(i));
+      buffer.init(state.x, state.X);
+      return buffer;
+    }
+
+    void
+    KalmanFilter::getFilterState(KalmanFilterState& state)
+    {
+      ClosedFormKalmanFilter<2> buffer;
+      const ClosedFormKalmanFilter<2>& filter = getClosedFormFilter(buffer);
+      state.x = filter.getState();
+      state.X = filter.getStateCovariance();
+      state.observation_variances = filter.getObservationVariances();
+    }
+
+    void
+    KalmanFilter::setFilterState(const KalmanFilterState& state)
+    {
+      if (backend_ == CLOSED_FORM)
+      {
+        for(int i = 0; i < output_dimension_; i++)
+          closed_form_filter_.setObservationVariance(i, state.observation_variances(i));
+        closed_form_filter_.init(state.x, state.X);
+        return;
+      }
+
+      Bayesian_filter_matrix::Vec x(4);
+      Bayesian_filter_matrix::SymMatrix X(4, 4);
+      for(int i = 0; i < 4; i++)
+      {
+        x[i] = state.x(i);
+        for(int j = 0; j < 4; j++)
+          X(i, j) = state.X(i, j);
+      }
+      filter_->init_kalman(x, X);
+      for(int i = 0; i < output_dimension_; i++)
+        observe_model_->Zv[i] = state.observation_variances(i);
+    }
+
+    void
+    KalmanFilter::getMahalanobisParameters(double interval, MahalanobisParameters2d& mp)
+    {
+      ClosedFormKalmanFilter<2> buffer;
+      getMahalanobisParameters(getClosedFormFilter(buffer), interval, mp);
+    }
+
+    void
+    KalmanFilter::getMahalanobisParameters(double interval, MahalanobisParameters4d& mp)
+    {
+      ClosedFormKalmanFilter<2> buffer;
+      getMahalanobisParameters(getClosedFormFilter(buffer), interval, mp);
+    }
+
+    void
+    KalmanFilter::getMahalanobisParameters(const ClosedFormKalmanFilter<2>& filter, double interval,
+        MahalanobisParameters2d& mp)
+    {
+      ClosedFormKalmanFilter<2>::StateVector x;
+      Eigen::Matrix<double, 2, 2> SI;
+      filter.getPredictedInnovation<2>(interval, x, SI);
+
+      toSymMatrix(SI, 2, mp.SI);
+      mp.x = x(0);
+      mp.y = x(1);
+    }
+
+    void
+    KalmanFilter::getMahalanobisParameters(const ClosedFormKalmanFilter<2>& filter, double interval,
+        MahalanobisParameters4d& mp)
+    {
+      ClosedFormKalmanFilter<2>::StateVector x;
+      Eigen::Matrix<double, 4, 4> SI;
+      filter.getPredictedInnovation<4>(interval, x, SI);
+
+      toSymMatrix(SI, 4, mp.SI);
+      mp.x = x(0);
+      mp.y = x(1);
+      mp.vx = x(2);
+      mp.vy = x(3);
+    }
+
     double
     KalmanFilter::performMahalanobisDistance(double x, double y, const MahalanobisParameters2d& mp)
     {
@@ -329,15 +572,68 @@ namespace open_ptrack
       return Bayesian_filter_matrix::prod_SPDT(v, mp.SI);
     }
 
+    double
+    KalmanFilter::getMahalanobisLowerBound(const MahalanobisParameters2d& mp)
+    {
+      // Smallest eigenvalue of the (inverse) innovation covariance:
+      Eigen::Matrix2d m;
+      for(int i = 0; i < 2; i++)
+        for(int j = 0; j < 2; j++)
+          m(i, j) = mp.SI(i, j);
+
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver;
+      solver.computeDirect(m, Eigen::EigenvaluesOnly);
+      double bound = solver.eigenvalues()(0);
+      return (std::isfinite(bound) && bound > 0.0) ? bound : 0.0;
+    }
+
+    double
+    KalmanFilter::getMahalanobisLowerBound(const MahalanobisParameters4d& mp)
+    {
+      Eigen::Matrix4d m;
+      for(int i = 0; i < 4; i++)
+        for(int j = 0; j < 4; j++)
+          m(i, j) = mp.SI(i, j);
+
+      // Minimizing over the velocity error leaves the Schur complement of the velocity block:
+      Eigen::LLT<Eigen::Matrix2d> velocity_block(m.bottomRightCorner<2, 2>());
+      if (velocity_block.info() != Eigen::Success)
+        return 0.0;
+      Eigen::Matrix2d position_block = m.topLeftCorner<2, 2>() -
+          m.topRightCorner<2, 2>() * velocity_block.solve(m.bottomLeftCorner<2, 2>());
+
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver;
+      solver.computeDirect(position_block, Eigen::EigenvaluesOnly);
+      double bound = solver.eigenvalues()(0);
+      return (std::isfinite(bound) && bound > 0.0) ? bound : 0.0;
+    }
+
     Bayesian_filter::FM::SymMatrix
     KalmanFilter::getInnovationCovariance()
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        Bayesian_filter::FM::SymMatrix SI(Bayesian_filter_matrix::Empty);
+        toSymMatrix(closed_form_filter_.getInverseInnovationCovariance(), closed_form_filter_.getObservationSize(), SI);
+        return SI;
+      }
+
       return filter_->SI;
     }
 
     void
     KalmanFilter::getState(double& x, double& y, double& vx, double& vy)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        const ClosedFormKalmanFilter<2>::StateVector& state = closed_form_filter_.getState();
+        x = state(0);
+        y = state(1);
+        vx = state(2);
+        vy = state(3);
+        return;
+      }
+
       x = filter_->x[0];
       y = filter_->x[1];
       vx = filter_->x[2];
@@ -347,6 +643,13 @@ namespace open_ptrack
     void
     KalmanFilter::getState(double& x, double& y)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        x = closed_form_filter_.getState()(0);
+        y = closed_form_filter_.getState()(1);
+        return;
+      }
+
       x = filter_->x[0];
       y = filter_->x[1];
     }
@@ -355,14 +658,33 @@ namespace open_ptrack
     KalmanFilter::setPredictModel (double acceleration_variance)
     {
       acceleration_variance_ = acceleration_variance;
-      predict_model_ = new PredictModel(dt_, acceleration_variance_);
+      if (backend_ == CLOSED_FORM)
+        closed_form_filter_.setPredictModel(dt_, acceleration_variance_);
+      else
+      {
+        delete predict_model_;
+        predict_model_ = new PredictModel(dt_, acceleration_variance_);
+      }
     }
 
     void
     KalmanFilter::setObserveModel (double position_variance)
     {
       position_variance_ = position_variance;
-      observe_model_ = new ObserveModel(position_variance_, output_dimension_);
+      if (backend_ == CLOSED_FORM)
+      {
+        // Same variances of ObserveModel:
+        for(int i = 0; i < 2; i++)
+        {
+          closed_form_filter_.setObservationVariance(i, position_variance_);
+          closed_form_filter_.setObservationVariance(2 + i, 16 * position_variance_);
+        }
+      }
+      else
+      {
+        delete observe_model_;
+        observe_model_ = new ObserveModel(position_variance_, output_dimension_);
+      }
     }
 
   } /* namespace tracking */
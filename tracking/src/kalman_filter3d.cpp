@@ -37,6 +37,7 @@
  *
  */
 
+#include <algorithm>
 #include <ros/ros.h>
 
 #include <open_ptrack/tracking/kalman_filter3d.h>
@@ -45,6 +46,19 @@ namespace open_ptrack
 {
   namespace tracking
   {
+    namespace
+    {
+      /** \brief Copy the top-left size x size block of an Eigen matrix to a SymMatrix. */
+      template <typename MatrixType> void
+      toSymMatrix(const MatrixType& m, int size, Bayesian_filter::FM::SymMatrix& out)
+      {
+        if ((out.size1() != size_t(size)) or (out.size2() != size_t(size)))
+          out.resize(size, size, false);
+        for(int i = 0; i < size; i++)
+          for(int j = 0; j < size; j++)
+            out(i, j) = m(i, j);
+      }
+    }
 
     PredictModel3D::PredictModel3D(double dt, double acceleration_variance) :
         Bayesian_filter::Linear_predict_model(6, 3), dt_(dt)
@@ -81,6 +95,28 @@ namespace open_ptrack
       G(5, 2) = dt;
     }
 
+    PredictModel3D::PredictModel3D(double dt, double acceleration_variance, double interval) :
+        Bayesian_filter::Linear_predict_model(6, 6), dt_(dt)
+    {
+      for(size_t i = 0; i < 6; i++)
+        for(size_t j = 0; j < 6; j++)
+        {
+          Fx(i, j) = (i == j) ? 1.0 : 0.0;
+          G(i, j) = (i == j) ? 1.0 : 0.0;
+        }
+
+      // The closed-form process noise is factored as G*diag(q)*G' (LDL' decomposition of each axis block):
+      double pp, pv, vv;
+      getProcessNoise(interval, dt, acceleration_variance, pp, pv, vv);
+      for(size_t i = 0; i < 3; i++)
+      {
+        Fx(i, 3 + i) = interval;
+        G(3 + i, i) = pp > 0.0 ? pv / pp : 0.0;
+        q[i] = pp;
+        q[3 + i] = pp > 0.0 ? std::max(0.0, vv - pv * pv / pp) : vv;
+      }
+    }
+
     PredictModel3D::~PredictModel3D()
     {
 
@@ -118,16 +154,27 @@ namespace open_ptrack
 
     }
 
-    KalmanFilter3D::KalmanFilter3D(double dt, double position_variance, double acceleration_variance, int output_dimension) :
+    KalmanFilter3D::KalmanFilter3D(double dt, double position_variance, double acceleration_variance, int output_dimension,
+        FilterBackend backend) :
         dt_(dt), position_variance_(position_variance), depth_multiplier_(std::pow(0.005 / 1.96, 2)),
-        acceleration_variance_(acceleration_variance), output_dimension_(output_dimension)
+        acceleration_variance_(acceleration_variance), output_dimension_(output_dimension), backend_(backend),
+        filter_(NULL), predict_model_(NULL), observe_model_(NULL)
     {
-      predict_model_ = new PredictModel3D(dt, acceleration_variance);
-      observe_model_ = new ObserveModel3D(position_variance, output_dimension);
-      filter_ = new Bayesian_filter::Unscented_scheme(6);
+      if (backend_ == CLOSED_FORM)
+      {
+        setPredictModel(acceleration_variance);
+        setObserveModel(position_variance);
+      }
+      else
+      {
+        predict_model_ = new PredictModel3D(dt, acceleration_variance);
+        observe_model_ = new ObserveModel3D(position_variance, output_dimension);
+        filter_ = new Bayesian_filter::Unscented_scheme(6);
+      }
     }
 
-    KalmanFilter3D::KalmanFilter3D(const KalmanFilter3D& orig)
+    KalmanFilter3D::KalmanFilter3D(const KalmanFilter3D& orig) :
+        filter_(NULL), predict_model_(NULL), observe_model_(NULL)
     {
       *this = orig;
     }
@@ -139,9 +186,18 @@ namespace open_ptrack
       this->position_variance_ = orig.position_variance_;
       this->depth_multiplier_ = orig.depth_multiplier_;
       this->acceleration_variance_ = orig.acceleration_variance_;
+      this->output_dimension_ = orig.output_dimension_;
+      this->backend_ = orig.backend_;
+      this->closed_form_filter_ = orig.closed_form_filter_;
       delete this->predict_model_;
       delete this->observe_model_;
       delete this->filter_;
+      this->predict_model_ = NULL;
+      this->observe_model_ = NULL;
+      this->filter_ = NULL;
+      if (backend_ == CLOSED_FORM)
+        return *this;
+
       this->predict_model_ = new PredictModel3D(dt_, acceleration_variance_);
       this->observe_model_ = new ObserveModel3D(position_variance_, output_dimension_);
       this->filter_ = new Bayesian_filter::Unscented_scheme(6, 3);
@@ -227,7 +283,18 @@ namespace open_ptrack
       cov(5, 5) = 100;
 
       // Filter initialization:
-      filter_->init_kalman(state, cov);
+      if (backend_ == CLOSED_FORM)
+      {
+        ClosedFormKalmanFilter<3>::StateVector x0;
+        x0 << x, y, z, 0.0, 0.0, 0.0;
+        ClosedFormKalmanFilter<3>::StateMatrix X = ClosedFormKalmanFilter<3>::StateMatrix::Zero();
+        X(3, 3) = cov(3, 3);
+        X(4, 4) = cov(4, 4);
+        X(5, 5) = cov(5, 5);
+        closed_form_filter_.init(x0, X);
+      }
+      else
+        filter_->init_kalman(state, cov);
 
       // First update:
       if (velocity_in_motion_term)
@@ -240,7 +307,10 @@ namespace open_ptrack
     void
     KalmanFilter3D::predict()
     {
-      filter_->predict(*predict_model_);
+      if (backend_ == CLOSED_FORM)
+        closed_form_filter_.predict();
+      else
+        filter_->predict(*predict_model_);
     }
 
     void
@@ -248,18 +318,31 @@ namespace open_ptrack
                             double& vz)
     {
       predict();
+      getState(x, y, z, vx, vy, vz);
+    }
 
-      x = filter_->x[0];
-      y = filter_->x[1];
-      z = filter_->x[2];
-      vx = filter_->x[3];
-      vy = filter_->x[4];
-      vz = filter_->x[5];
+    void
+    KalmanFilter3D::predict(double interval)
+    {
+      if (not (interval > 0.0))
+        return;
+
+      if (backend_ == CLOSED_FORM)
+        closed_form_filter_.predict(interval);
+      else
+      {
+        PredictModel3D predict_model(dt_, acceleration_variance_, interval);
+        filter_->predict(predict_model);
+      }
     }
 
     void
     KalmanFilter3D::update()
     {
+      // The closed-form filter updates the state when observing:
+      if (backend_ == CLOSED_FORM)
+        return;
+
       filter_->update();
       //filter_->update_XX(2.0);
     }
@@ -275,6 +358,14 @@ namespace open_ptrack
 
       //printf("%d %f %f %f ", _id, x, y, height);
 
+      if (backend_ == CLOSED_FORM)
+      {
+        for(int i = 0; i < 3; i++)
+          closed_form_filter_.setObservationVariance(i, position_variance_ + std::pow(distance, 4) * depth_multiplier_);
+        closed_form_filter_.observe(Eigen::Vector3d(x, y, z));
+        return;
+      }
+
       observe_model_->Zv[0] = position_variance_ + std::pow(distance, 4) * depth_multiplier_;
       observe_model_->Zv[1] = position_variance_ + std::pow(distance, 4) * depth_multiplier_;
       observe_model_->Zv[2] = position_variance_ + std::pow(distance, 4) * depth_multiplier_;
@@ -305,6 +396,14 @@ namespace open_ptrack
       //	observe_model_->Zv[2] = 16 * position_variance_ + std::pow(distance, 4) * depth_multiplier_;
       //	observe_model_->Zv[3] = 16 * position_variance_ + std::pow(distance, 4) * depth_multiplier_;
 
+      if (backend_ == CLOSED_FORM)
+      {
+        Eigen::Matrix<double, 6, 1> z6;
+        z6 << x, y, z, vx, vy, vz;
+        closed_form_filter_.observe(z6);
+        return;
+      }
+
       filter_->observe(*observe_model_, observation);
       filter_->update();
       //filter_->update_XX(2.0);
@@ -314,6 +413,13 @@ namespace open_ptrack
     void
     KalmanFilter3D::getMahalanobisParameters(MahalanobisParameters3d& mp)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        toSymMatrix(closed_form_filter_.getInverseInnovationCovariance(), closed_form_filter_.getObservationSize(), mp.SI);
+        getState(mp.x, mp.y, mp.z);
+        return;
+      }
+
       mp.SI = filter_->SI;
       mp.x = filter_->x[0];
       mp.y = filter_->x[1];
@@ -323,6 +429,13 @@ namespace open_ptrack
     void
     KalmanFilter3D::getMahalanobisParameters(MahalanobisParameters6d& mp)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        toSymMatrix(closed_form_filter_.getInverseInnovationCovariance(), closed_form_filter_.getObservationSize(), mp.SI);
+        getState(mp.x, mp.y, mp.z, mp.vx, mp.vy, mp.vz);
+        return;
+      }
+
       mp.SI = filter_->SI;
       mp.x = filter_->x[0];
       mp.y = filter_->x[1];
@@ -332,6 +445,58 @@ namespace open_ptrack
       mp.vz = filter_->x[5];
     }
 
+    const ClosedFormKalmanFilter<3>&
+    KalmanFilter3D::getClosedFormFilter(ClosedFormKalmanFilter<3>& buffer)
+    {
+      if (backend_ == CLOSED_FORM)
+        return closed_form_filter_;
+
+      ClosedFormKalmanFilter<3>::StateVector x;
+      ClosedFormKalmanFilter<3>::StateMatrix X;
+      for(int i = 0; i < 6; i++)
+      {
+        x(i) = filter_->x[i];
+        for(int j = 0; j < 6; j++)
+          X(i, j) = filter_->X(i, j);
+      }
+      buffer.setPredictModel(dt_, acceleration_variance_);
+      for(int i = 0; i < output_dimension_; i++)
+        buffer.setObservationVariance(i, observe_model_->Zv[i]);
+      buffer.init(x, X);
+      return buffer;
+    }
+
+    void
+    KalmanFilter3D::getMahalanobisParameters(double interval, MahalanobisParameters3d& mp)
+    {
+      ClosedFormKalmanFilter<3> buffer;
+      ClosedFormKalmanFilter<3>::StateVector x;
+      Eigen::Matrix<double, 3, 3> SI;
+      getClosedFormFilter(buffer).getPredictedInnovation<3>(interval, x, SI);
+
+      toSymMatrix(SI, 3, mp.SI);
+      mp.x = x(0);
+      mp.y = x(1);
+      mp.z = x(2);
+    }
+
+    void
+    KalmanFilter3D::getMahalanobisParameters(double interval, MahalanobisParameters6d& mp)
+    {
+      ClosedFormKalmanFilter<3> buffer;
+      ClosedFormKalmanFilter<3>::StateVector x;
+      Eigen::Matrix<double, 6, 6> SI;
+      getClosedFormFilter(buffer).getPredictedInnovation<6>(interval, x, SI);
+
+      toSymMatrix(SI, 6, mp.SI);
+      mp.x = x(0);
+      mp.y = x(1);
+      mp.z = x(2);
+      mp.vx = x(3);
+      mp.vy = x(4);
+      mp.vz = x(5);
+    }
+
     double
     KalmanFilter3D::performMahalanobisDistance(double x, double y, double z,
                                                const MahalanobisParameters3d& mp)
@@ -360,9 +525,52 @@ namespace open_ptrack
       return Bayesian_filter_matrix::prod_SPDT(v, mp.SI);
     }
 
+    double
+    KalmanFilter3D::getMahalanobisLowerBound(const MahalanobisParameters3d& mp)
+    {
+      // Smallest eigenvalue of the (inverse) innovation covariance:
+      Eigen::Matrix3d m;
+      for(int i = 0; i < 3; i++)
+        for(int j = 0; j < 3; j++)
+          m(i, j) = mp.SI(i, j);
+
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+      solver.computeDirect(m, Eigen::EigenvaluesOnly);
+      double bound = solver.eigenvalues()(0);
+      return (std::isfinite(bound) && bound > 0.0) ? bound : 0.0;
+    }
+
+    double
+    KalmanFilter3D::getMahalanobisLowerBound(const MahalanobisParameters6d& mp)
+    {
+      Eigen::Matrix<double, 6, 6> m;
+      for(int i = 0; i < 6; i++)
+        for(int j = 0; j < 6; j++)
+          m(i, j) = mp.SI(i, j);
+
+      // Minimizing over the velocity error leaves the Schur complement of the velocity block:
+      Eigen::LLT<Eigen::Matrix3d> velocity_block(m.bottomRightCorner<3, 3>());
+      if (velocity_block.info() != Eigen::Success)
+        return 0.0;
+      Eigen::Matrix3d position_block = m.topLeftCorner<3, 3>() -
+          m.topRightCorner<3, 3>() * velocity_block.solve(m.bottomLeftCorner<3, 3>());
+
+      Eigen::SelfAdjointEigenSolver<Eigen::Matrix3d> solver;
+      solver.computeDirect(position_block, Eigen::EigenvaluesOnly);
+      double bound = solver.eigenvalues()(0);
+      return (std::isfinite(bound) && bound > 0.0) ? bound : 0.0;
+    }
+
     Bayesian_filter::FM::SymMatrix
     KalmanFilter3D::getInnovationCovariance()
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        Bayesian_filter::FM::SymMatrix SI(Bayesian_filter_matrix::Empty);
+        toSymMatrix(closed_form_filter_.getInverseInnovationCovariance(), closed_form_filter_.getObservationSize(), SI);
+        return SI;
+      }
+
       return filter_->SI;
     }
 
@@ -370,6 +578,18 @@ namespace open_ptrack
     KalmanFilter3D::getState(double& x, double& y, double& z,
                              double& vx, double& vy, double& vz)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        const ClosedFormKalmanFilter<3>::StateVector& state = closed_form_filter_.getState();
+        x = state(0);
+        y = state(1);
+        z = state(2);
+        vx = state(3);
+        vy = state(4);
+        vz = state(5);
+        return;
+      }
+
       x = filter_->x[0];
       y = filter_->x[1];
       z = filter_->x[2];
@@ -381,6 +601,15 @@ namespace open_ptrack
     void
     KalmanFilter3D::getState(double& x, double& y, double& z)
     {
+      if (backend_ == CLOSED_FORM)
+      {
+        const ClosedFormKalmanFilter<3>::StateVector& state = closed_form_filter_.getState();
+        x = state(0);
+        y = state(1);
+        z = state(2);
+        return;
+      }
+
       x = filter_->x[0];
       y = filter_->x[1];
       z = filter_->x[2];
@@ -390,14 +619,27 @@ namespace open_ptrack
     KalmanFilter3D::setPredictModel (double acceleration_variance)
     {
       acceleration_variance_ = acceleration_variance;
-      predict_model_ = new PredictModel3D(dt_, acceleration_variance_);
+      if (backend_ == CLOSED_FORM)
+        closed_form_filter_.setPredictModel(dt_, acceleration_variance_);
+      else
+        predict_model_ = new PredictModel3D(dt_, acceleration_variance_);
     }
 
     void
     KalmanFilter3D::setObserveModel (double position_variance)
     {
       position_variance_ = position_variance;
-      observe_model_ = new ObserveModel3D(position_variance_, output_dimension_);
+      if (backend_ == CLOSED_FORM)
+      {
+        // Same variances of ObserveModel3D:
+        for(int i = 0; i < 3; i++)
+        {
+          closed_form_filter_.setObservationVariance(i, position_variance_);
+          closed_form_filter_.setObservationVariance(3 + i, 16 * position_variance_);
+        }
+      }
+      else
+        observe_model_ = new ObserveModel3D(position_variance_, output_dimension_);
     }
   } /* namespace tracking */
 } /* namespace open_ptrack */
@@ -64,9 +64,10 @@ SkeletonTrack::SkeletonTrack(int id,
                              std::string frame_id, double position_variance,
                              double acceleration_variance, double period,
                              bool velocity_in_motion_term,
-                             const std::vector<rtpose_wrapper::Joint3DMsg>& joints):
+                             const std::vector<rtpose_wrapper::Joint3DMsg>& joints,
+                             FilterBackend filter_backend):
   Track(id, frame_id, position_variance, acceleration_variance, period,
-        velocity_in_motion_term), all_joint_tracks_initialized_(false)
+        velocity_in_motion_term, filter_backend), all_joint_tracks_initialized_(false)
 {
   joint_tracks_.resize(SkeletonJoints::SIZE);
   for(size_t i = 0; i < SkeletonJoints::SIZE; ++i)
@@ -77,7 +78,8 @@ SkeletonTrack::SkeletonTrack(int id,
           position_variance,
           acceleration_variance,
           period,
-          velocity_in_motion_term
+          velocity_in_motion_term,
+          filter_backend
           );
   }
   debug_count_ = -1;
@@ -144,9 +146,10 @@ SkeletonTrack::update(
     const std::vector<rtpose_wrapper::Joint3DMsg>& joints,
     bool first_update)
 {
-  Track::update(x,y,z,height,distance,data_assocation_score,
-                confidence,min_confidence,min_confidence_detections,
-                detection_source,first_update);
+  if (not Track::update(x,y,z,height,distance,data_assocation_score,
+                        confidence,min_confidence,min_confidence_detections,
+                        detection_source,first_update))
+    return;
   if(all_joint_tracks_initialized_)
   {
     for(int i = 0, end = SkeletonJoints::SIZE; i != end; ++i)
@@ -0,0 +1,401 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+#include "open_ptrack/tracking/sparse_assignment.h"
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+
+    SparseAssignment::SparseAssignment(double unassigned_cost) :
+        unassigned_cost_(unassigned_cost), rows_(0), cols_(0), parallel_component_size_(16)
+    {
+      workspaces_.resize(1);
+    }
+
+    void
+    SparseAssignment::reset(int rows, int cols)
+    {
+      rows_ = rows;
+      cols_ = cols;
+      pair_rows_.clear();
+      pair_cols_.clear();
+      pair_costs_.clear();
+    }
+
+    void
+    SparseAssignment::addPair(int row, int col, double cost)
+    {
+      pair_rows_.push_back(row);
+      pair_cols_.push_back(col);
+      pair_costs_.push_back(cost);
+    }
+
+    void
+    SparseAssignment::setNumThreads(int threads)
+    {
+      if (threads > 1)
+        thread_pool_.reset(new open_ptrack::opt_utils::ThreadPool(threads));
+      else
+        thread_pool_.reset();
+    }
+
+    void
+    SparseAssignment::setParallelComponentSize(int rows)
+    {
+      parallel_component_size_ = rows;
+    }
+
+    int
+    SparseAssignment::getNumComponents()
+    {
+      return int(component_start_.size()) - 1;
+    }
+
+    void
+    SparseAssignment::solve(std::vector<int>& row_to_col)
+    {
+      int total_cols = cols_ + rows_;   // real columns followed by one dummy column per row
+
+      // Build compressed row storage (counting sort on rows), appending the dummy column of every row:
+      row_start_.assign(rows_ + 1, 0);
+      for (size_t k = 0; k < pair_rows_.size(); k++)
+        row_start_[pair_rows_[k] + 1]++;
+      for (int r = 0; r < rows_; r++)
+        row_start_[r + 1] += row_start_[r] + 1;
+      edge_col_.resize(row_start_[rows_]);
+      edge_cost_.resize(row_start_[rows_]);
+      std::vector<int> fill(row_start_.begin(), row_start_.end() - 1);
+      for (size_t k = 0; k < pair_rows_.size(); k++)
+      {
+        int e = fill[pair_rows_[k]]++;
+        edge_col_[e] = pair_cols_[k];
+        edge_cost_[e] = pair_costs_[k];
+      }
+      for (int r = 0; r < rows_; r++)
+      {
+        edge_col_[fill[r]] = cols_ + r;
+        edge_cost_[fill[r]] = unassigned_cost_;
+      }
+
+      // Initial dual solution: reduced costs c(i,j) - u(i) - v(j) must be non-negative:
+      u_.assign(rows_, 0.0);
+      v_.assign(total_cols, 0.0);
+      for (int r = 0; r < rows_; r++)
+      {
+        double min_cost = unassigned_cost_;
+        for (int e = row_start_[r]; e < row_start_[r + 1]; e++)
+          min_cost = std::min(min_cost, edge_cost_[e]);
+        u_[r] = min_cost;
+      }
+
+      row_to_col_.assign(rows_, -1);
+      col_to_row_.assign(total_cols, -1);
+      col_dist_.assign(total_cols, std::numeric_limits<double>::infinity());
+      row_dist_.assign(rows_, 0.0);
+      pred_.assign(total_cols, -1);
+      col_done_.assign(total_cols, 0);
+
+      // Rows without admissible pairs can only stay unassigned:
+      for (int r = 0; r < rows_; r++)
+      {
+        if (row_start_[r + 1] - row_start_[r] == 1)
+        {
+          row_to_col_[r] = cols_ + r;
+          col_to_row_[cols_ + r] = r;
+        }
+      }
+
+      // Independent sub-problems: large ones go to the thread pool, the others are solved here.
+      computeComponents();
+      int num_components = getNumComponents();
+      if (thread_pool_)
+      {
+        int parallel_tasks = 0;
+        for (int k = 0; k < num_components; k++)
+        {
+          if (component_start_[k + 1] - component_start_[k] >= parallel_component_size_)
+            parallel_tasks++;
+        }
+        if (int(workspaces_.size()) < parallel_tasks + 1)
+          workspaces_.resize(parallel_tasks + 1);
+
+        int task = 0;
+        for (int k = 0; k < num_components; k++)
+        {
+          if (component_start_[k + 1] - component_start_[k] >= parallel_component_size_)
+          {
+            Workspace* workspace = &workspaces_[++task];
+            thread_pool_->enqueue([this, k, workspace]{ solveComponent(k, *workspace); });
+          }
+        }
+        for (int k = 0; k < num_components; k++)
+        {
+          if (component_start_[k + 1] - component_start_[k] < parallel_component_size_)
+            solveComponent(k, workspaces_[0]);
+        }
+        thread_pool_->wait();
+      }
+      else
+      {
+        for (int k = 0; k < num_components; k++)
+          solveComponent(k, workspaces_[0]);
+      }
+
+      // Dummy columns mean "unassigned":
+      row_to_col.assign(rows_, -1);
+      for (int r = 0; r < rows_; r++)
+      {
+        if (row_to_col_[r] < cols_)
+          row_to_col[r] = row_to_col_[r];
+      }
+    }
+
+    int
+    SparseAssignment::findRoot(int element)
+    {
+      while (parent_[element] != element)
+      {
+        parent_[element] = parent_[parent_[element]];   // path halving
+        element = parent_[element];
+      }
+      return element;
+    }
+
+    void
+    SparseAssignment::computeComponents()
+    {
+      // Union-find over rows (0..rows-1) and real columns (rows..rows+cols-1):
+      parent_.resize(rows_ + cols_);
+      for (int i = 0; i < rows_ + cols_; i++)
+        parent_[i] = i;
+      for (size_t k = 0; k < pair_rows_.size(); k++)
+      {
+        int a = findRoot(pair_rows_[k]);
+        int b = findRoot(rows_ + pair_cols_[k]);
+        if (a != b)
+          parent_[a] = b;
+      }
+
+      // Number the components containing at least one admissible pair and group their rows:
+      std::vector<int> component_id(rows_ + cols_, -1);
+      std::vector<int> row_component(rows_, -1);
+      int num_components = 0;
+      for (int r = 0; r < rows_; r++)
+      {
+        if (row_start_[r + 1] - row_start_[r] == 1)
+          continue;
+        int root = findRoot(r);
+        if (component_id[root] == -1)
+          component_id[root] = num_components++;
+        row_component[r] = component_id[root];
+      }
+
+      component_start_.assign(num_components + 1, 0);
+      for (int r = 0; r < rows_; r++)
+      {
+        if (row_component[r] >= 0)
+          component_start_[row_component[r] + 1]++;
+      }
+      for (int k = 0; k < num_components; k++)
+        component_start_[k + 1] += component_start_[k];
+      component_rows_.resize(component_start_[num_components]);
+      std::vector<int> fill(component_start_.begin(), component_start_.end() - 1);
+      for (int r = 0; r < rows_; r++)
+      {
+        if (row_component[r] >= 0)
+          component_rows_[fill[row_component[r]]++] = r;
+      }
+    }
+
+    void
+    SparseAssignment::solveComponent(int component, Workspace& workspace)
+    {
+      // Try first the zero reduced cost column of every row (cheap initial matching):
+      for (int k = component_start_[component]; k < component_start_[component + 1]; k++)
+      {
+        int r = component_rows_[k];
+        for (int e = row_start_[r]; e < row_start_[r + 1]; e++)
+        {
+          int c = edge_col_[e];
+          if (col_to_row_[c] == -1 && edge_cost_[e] - u_[r] - v_[c] == 0.0)
+          {
+            row_to_col_[r] = c;
+            col_to_row_[c] = r;
+            break;
+          }
+        }
+      }
+
+      // Augment every row left free:
+      for (int k = component_start_[component]; k < component_start_[component + 1]; k++)
+      {
+        int r = component_rows_[k];
+        if (row_to_col_[r] == -1)
+          augment(r, workspace);
+      }
+    }
+
+    void
+    SparseAssignment::augment(int row, Workspace& workspace)
+    {
+      std::vector<int>& touched_cols = workspace.touched_cols;
+      std::vector<int>& done_cols = workspace.done_cols;
+      std::vector<int>& scanned_rows = workspace.scanned_rows;
+      std::vector<std::pair<double, int> >& heap = workspace.heap;
+      touched_cols.clear();
+      done_cols.clear();
+      scanned_rows.clear();
+      heap.clear();
+
+      std::greater<std::pair<double, int> > heap_order;
+      int current_row = row;
+      double current_dist = 0.0;
+      int sink = -1;
+      double sink_dist = 0.0;
+      while (true)
+      {
+        // Relax all pairs of the row just reached:
+        row_dist_[current_row] = current_dist;
+        scanned_rows.push_back(current_row);
+        for (int e = row_start_[current_row]; e < row_start_[current_row + 1]; e++)
+        {
+          int c = edge_col_[e];
+          if (col_done_[c])
+            continue;
+          double d = current_dist + edge_cost_[e] - u_[current_row] - v_[c];
+          if (d < col_dist_[c])
+          {
+            if (col_dist_[c] == std::numeric_limits<double>::infinity())
+              touched_cols.push_back(c);
+            col_dist_[c] = d;
+            pred_[c] = current_row;
+            heap.push_back(std::make_pair(d, c));
+            std::push_heap(heap.begin(), heap.end(), heap_order);
+          }
+        }
+
+        // Pick the closest column not yet reached (the dummy column of the starting row is always free,
+        // so the heap cannot become empty before a free column is found):
+        int c;
+        double d;
+        do
+        {
+          std::pop_heap(heap.begin(), heap.end(), heap_order);
+          d = heap.back().first;
+          c = heap.back().second;
+          heap.pop_back();
+        } while (col_done_[c] || d > col_dist_[c]);
+        col_done_[c] = 1;
+        done_cols.push_back(c);
+
+        if (col_to_row_[c] == -1)
+        {
+          sink = c;
+          sink_dist = d;
+          break;
+        }
+        current_row = col_to_row_[c];
+        current_dist = d;
+      }
+
+      // Update dual potentials so that reduced costs stay non-negative and the path has zero reduced cost:
+      for (size_t k = 0; k < scanned_rows.size(); k++)
+      {
+        int r = scanned_rows[k];
+        u_[r] += sink_dist - row_dist_[r];
+      }
+      for (size_t k = 0; k < done_cols.size(); k++)
+      {
+        int c = done_cols[k];
+        v_[c] -= sink_dist - col_dist_[c];
+      }
+
+      // Flip the augmenting path:
+      int c = sink;
+      while (true)
+      {
+        int r = pred_[c];
+        int next = row_to_col_[r];
+        row_to_col_[r] = c;
+        col_to_row_[c] = r;
+        if (r == row)
+          break;
+        c = next;
+      }
+
+      // Reset work buffers only where they have been used:
+      for (size_t k = 0; k < touched_cols.size(); k++)
+      {
+        int c = touched_cols[k];
+        col_dist_[c] = std::numeric_limits<double>::infinity();
+        col_done_[c] = 0;
+        pred_[c] = -1;
+      }
+    }
+
+    cv::Mat
+    SparseAssignment::solve(const cv::Mat_<double>& distance_matrix, double gate_distance)
+    {
+      reset(distance_matrix.rows, distance_matrix.cols);
+      for (int i = 0; i < distance_matrix.rows; i++)
+      {
+        for (int j = 0; j < distance_matrix.cols; j++)
+        {
+          if (distance_matrix(i, j) <= gate_distance)
+            addPair(i, j, distance_matrix(i, j));
+        }
+      }
+
+      std::vector<int> row_to_col;
+      solve(row_to_col);
+
+      cv::Mat matrix_out(distance_matrix.rows, distance_matrix.cols, CV_64F, -1.0);
+      for (int i = 0; i < distance_matrix.rows; i++)
+      {
+        if (row_to_col[i] >= 0)
+          matrix_out.at<double>(i, row_to_col[i]) = 0.0;
+      }
+      return matrix_out;
+    }
+
+  } /* namespace tracking */
+} /* namespace open_ptrack */
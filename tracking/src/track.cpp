@@ -39,6 +39,10 @@
 
 #include <ros/ros.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 #include <open_ptrack/tracking/track.h>
 
 namespace open_ptrack
@@ -52,37 +56,47 @@ namespace open_ptrack
         double position_variance,
         double acceleration_variance,
         double period,
-        bool velocity_in_motion_term) :
-		    id_(id),
-		    frame_id_(frame_id),
-		    period_(period),
-		    velocity_in_motion_term_(velocity_in_motion_term)
+        bool velocity_in_motion_term,
+        FilterBackend filter_backend) :
+		    filter_(NULL),
+		    filter_revision_(0),
+		    state_history_(DEFAULT_STATE_HISTORY_SIZE)
+    {
+      reset(id, frame_id, position_variance, acceleration_variance, period, velocity_in_motion_term, filter_backend);
+    }
+
+    Track::~Track()
     {
+      delete filter_;
+    }
+
+    void
+    Track::reset(
+        int id,
+        const std::string& frame_id,
+        double position_variance,
+        double acceleration_variance,
+        double period,
+        bool velocity_in_motion_term,
+        FilterBackend filter_backend)
+    {
+      id_ = id;
+      frame_id_ = frame_id;
+      period_ = period;
+      velocity_in_motion_term_ = velocity_in_motion_term;
+
       color_ = Eigen::Vector3f(
           float(rand() % 256) / 255,
           float(rand() % 256) / 255,
           float(rand() % 256) / 255);
 
-      MAX_SIZE = 90; //XXX create a parameter!!!
-      if (velocity_in_motion_term_)
-      {
-        filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 4);
-        tmp_filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 4);
-        mahalanobis_map4d_.resize(MAX_SIZE, MahalanobisParameters4d());
-      }
+      int output_dimension = velocity_in_motion_term_ ? 4 : 2;
+      if (filter_ == NULL)
+        filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, output_dimension, filter_backend);
       else
-      {
-        filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 2);
-        tmp_filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 2);
-        mahalanobis_map2d_.resize(MAX_SIZE, MahalanobisParameters2d());
-      }
-
-    }
-
-    Track::~Track()
-    {
-      delete filter_;
-      delete tmp_filter_;
+        filter_->reset(period, position_variance, acceleration_variance, output_dimension, filter_backend);
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
     }
 
     void
@@ -93,7 +107,6 @@ namespace open_ptrack
 
       filter_->init(x, y, 10, old_track.velocity_in_motion_term_);
 
-      *tmp_filter_ = *filter_;
       visibility_ = old_track.visibility_;
 
       ROS_INFO("%d -> %d", old_track.id_, id_);
@@ -111,8 +124,9 @@ namespace open_ptrack
       first_time_detected_ = old_track.first_time_detected_;
       last_time_detected_ = old_track.last_time_detected_;
       last_time_detected_with_high_confidence_ = old_track.last_time_detected_with_high_confidence_;
-      last_time_predicted_ = old_track.last_time_predicted_;
-      last_time_predicted_index_ = old_track.last_time_predicted_index_;
+      state_history_ = old_track.state_history_;
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
 
       data_association_score_ = old_track.data_association_score_;
     }
@@ -132,14 +146,51 @@ namespace open_ptrack
       updates_with_enough_confidence_ = low_confidence_consecutive_frames_ = 0;
       detection_source_ = detection_source;
       first_time_detected_ = detection_source->getTime();
-      last_time_predicted_ = last_time_detected_ = last_time_detected_with_high_confidence_ = detection_source->getTime();
-      last_time_predicted_index_ = 0;
+      last_time_detected_ = last_time_detected_with_high_confidence_ = detection_source->getTime();
       age_ = 0.0;
 
+      StateSample sample;
+      sample.time = last_time_detected_;
+      sample.x = x;
+      sample.y = y;
+      sample.vx = sample.vy = 0.0;
+      sample.distance = distance;
+      filter_->getFilterState(sample.filter);
+      state_history_.clear();
+      state_history_.push_back(sample);
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
+
 
     }
 
     void
+    Track::startAt(const ros::Time& time)
+    {
+      first_time_detected_ = last_time_detected_ = last_time_detected_with_high_confidence_ = time;
+      for(size_t i = 0; i < state_history_.size(); i++)
+        state_history_[i].time = time;
+      age_ = 0.0;
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
+    }
+
+    size_t
+    Track::getStateHistorySize(double max_delay, double period, int sources)
+    {
+      double size = std::ceil(max_delay / period) * std::max(sources, 1) + 1;
+      size = std::max(size, double(DEFAULT_STATE_HISTORY_SIZE));
+      return size_t(std::min(size, double(MAX_STATE_HISTORY_SIZE)));
+    }
+
+    void
+    Track::setStateHistorySize(size_t size)
+    {
+      if (size != state_history_.capacity())
+        state_history_.setCapacity(size);
+    }
+
+    bool
     Track::update(
         double x,
         double y,
@@ -154,8 +205,7 @@ namespace open_ptrack
         bool first_update)
     {
       //Update Kalman filter
-      int difference;
-      double vx, vy;
+      double vx = 0.0, vy = 0.0;
       if (velocity_in_motion_term_)
       {
         ros::Duration d(1.0);
@@ -167,57 +217,51 @@ namespace open_ptrack
 //        std::cout << "t2: " << t << std::endl;
         t = std::max(t, (detection_source->getTime() - d2).toSec());
 //        std::cout << "t3: " << t << std::endl;
-        double dt = t - last_time_predicted_.toSec();
+        double dt = t - detection_source->getTime().toSec();
 //        std::cout << "dt: " << dt << std::endl;
-        difference = int(round(dt / period_));
+        int difference = int(round(dt / period_));
 //        std::cout << "period: " << period_ << std::endl;
 //        std::cout << "difference: " << difference << std::endl;
-        int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
-//        std::cout << vIndex << std::endl;
 
-//        difference = int(round(dt / period_));
-//        int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+        double past_x, past_y;
+        getPastPosition(t, past_x, past_y);
 
         if(difference != 0)
         {
-          vx = - (x - mahalanobis_map4d_[vIndex].x) / dt;
-          vy = - (y - mahalanobis_map4d_[vIndex].y) / dt;
+          vx = - (x - past_x) / dt;
+          vy = - (y - past_y) / dt;
         }
         else
         {
-          vx = mahalanobis_map4d_[vIndex].x;
-          vy = mahalanobis_map4d_[vIndex].x;
+          vx = past_x;
+          vy = past_y;
         }
-//        std::cout << "Mahalanobis: " << mahalanobis_map4d_[vIndex].x << "," << mahalanobis_map4d_[vIndex].y << std::endl;
+//        std::cout << "Past position: " << past_x << "," << past_y << std::endl;
       }
 
-      // Update Kalman filter from the last time the track was visible:
-      int framesLost = int(round((detection_source->getTime() - last_time_detected_).toSec() / period_)) - 1;
-
-      for(int i = 0; i < framesLost; i++)
-      {
-        filter_->predict();
-        filter_->update();
-      }
+      StateSample sample;
+      sample.time = detection_source->getTime();
+      sample.x = x;
+      sample.y = y;
+      sample.vx = vx;
+      sample.vy = vy;
+      sample.distance = distance;
 
-      filter_->predict();
-      if (velocity_in_motion_term_)
+      bool in_sequence = (sample.time >= last_time_detected_);
+      if (in_sequence)
       {
-        filter_->update(x, y, vx, vy, distance);
+        // Update Kalman filter from the last time the track was visible:
+        applyStateSample(last_time_detected_, sample);
+        state_history_.push_back(sample);
+        last_time_detected_ = sample.time;
       }
-      else
+      else if (not updateOutOfSequence(sample))
       {
-        filter_->update(x, y, distance);
+        // Late detection older than the whole state history: the track is left untouched
+        return false;
       }
-
-      *tmp_filter_ = *filter_;
-      difference = int(round((detection_source->getTime() - last_time_predicted_).toSec() / period_));
-      last_time_predicted_index_ = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
-      last_time_predicted_ = last_time_detected_ = detection_source->getTime();
-      if (velocity_in_motion_term_)
-        filter_->getMahalanobisParameters(mahalanobis_map4d_[last_time_predicted_index_]);
-      else
-        filter_->getMahalanobisParameters(mahalanobis_map2d_[last_time_predicted_index_]);
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
 
       // Update z_ and height_ with a weighted combination of current and new values:
       z_ = z_ * 0.9 + z * 0.1;
@@ -227,7 +271,7 @@ namespace open_ptrack
       if(confidence > min_confidence)
       {
         updates_with_enough_confidence_++;
-        last_time_detected_with_high_confidence_ = last_time_detected_;
+        last_time_detected_with_high_confidence_ = std::max(last_time_detected_with_high_confidence_, sample.time);
       }
 
 //      if (((confidence - 0.5) < min_confidence_detections) && ((last_detector_confidence_ - 0.5) < min_confidence_detections))
@@ -244,9 +288,13 @@ namespace open_ptrack
       data_association_score_ = data_assocation_score;
 
       // Compute track age:
-      age_ = (detection_source->getTime() - first_time_detected_).toSec();
+      age_ = (last_time_detected_ - first_time_detected_).toSec();
 
-      detection_source_ = detection_source;
+      // The source of the most recent detection is kept:
+      if (in_sequence)
+        detection_source_ = detection_source;
+
+      return true;
     }
 
     void
@@ -321,67 +369,219 @@ namespace open_ptrack
       return updates_with_enough_confidence_;
     }
 
-    double
-    Track::getMahalanobisDistance(double x, double y, const ros::Time& when)
+    void
+    Track::predictMahalanobisParameters(const ros::Time& when)
+    {
+      if (mahalanobis_parameters_valid_ and (when == mahalanobis_parameters_time_))
+        return;
+
+      // The filter state refers to the last update (before when, for late detections):
+      ClosedFormKalmanFilter<2> buffer;
+      ros::Time update_time;
+      const ClosedFormKalmanFilter<2>& filter = getFilterBefore(when, buffer, update_time);
+      double interval = (when - update_time).toSec();
+      if (velocity_in_motion_term_)
+        KalmanFilter::getMahalanobisParameters(filter, interval, mahalanobis_parameters4d_);
+      else
+        KalmanFilter::getMahalanobisParameters(filter, interval, mahalanobis_parameters2d_);
+
+      mahalanobis_parameters_time_ = when;
+      mahalanobis_parameters_valid_ = true;
+    }
+
+    void
+    Track::applyStateSample(const ros::Time& previous_time, StateSample& sample)
     {
-      int difference = int(round((when - last_time_predicted_).toSec() / period_));
-//      std::cout << "time difference from last detection: " << difference << std::endl;
-      int index;
-      if(difference <= 0)
+      int framesLost = int(round((sample.time - previous_time).toSec() / period_)) - 1;
+
+      // Lost frames are predicted in a single step:
+      if (framesLost > 0)
+        filter_->predict(framesLost * period_);
+
+      filter_->predict();
+      if (velocity_in_motion_term_)
       {
-        index = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+        filter_->update(sample.x, sample.y, sample.vx, sample.vy, sample.distance);
       }
       else
       {
-        for(int i = 0; i < difference; i++)
-        {
-          tmp_filter_->predict();
-          last_time_predicted_index_ = (last_time_predicted_index_ + 1) % MAX_SIZE;
-          if (velocity_in_motion_term_)
-            tmp_filter_->getMahalanobisParameters(mahalanobis_map4d_[last_time_predicted_index_]);
-          else
-            tmp_filter_->getMahalanobisParameters(mahalanobis_map2d_[last_time_predicted_index_]);
-          tmp_filter_->update();
-        }
-        last_time_predicted_ = when;
-        index = last_time_predicted_index_;
+        filter_->update(sample.x, sample.y, sample.distance);
       }
+      filter_->getFilterState(sample.filter);
+    }
+
+    bool
+    Track::updateOutOfSequence(StateSample& sample)
+    {
+      int previous = findStateSample(sample.time);
+      if (previous < 0)
+        return false;
 
+      // Roll the filter back to the last update before the detection and apply it:
+      filter_->setFilterState(state_history_[previous].filter);
+      applyStateSample(state_history_[previous].time, sample);
+      size_t index = state_history_.insert(previous + 1, sample);
+
+      // Apply again the newer detections:
+      for(size_t i = index + 1; i < state_history_.size(); i++)
+        applyStateSample(state_history_[i - 1].time, state_history_[i]);
+
+      return true;
+    }
+
+    int
+    Track::findStateSample(const ros::Time& when)
+    {
+      int i = int(state_history_.size()) - 1;
+      while ((i >= 0) and (state_history_[i].time > when))
+        i--;
+      return i;
+    }
+
+    const ClosedFormKalmanFilter<2>&
+    Track::getFilterBefore(const ros::Time& when, ClosedFormKalmanFilter<2>& buffer, ros::Time& update_time)
+    {
+      if (when >= last_time_detected_)
+      {
+        update_time = last_time_detected_;
+        return filter_->getClosedFormFilter(buffer);
+      }
+
+      // Detections older than the state history are compared with its oldest state:
+      int sample = std::max(findStateSample(when), 0);
+      update_time = std::min(state_history_[sample].time, when);
+      return filter_->getClosedFormFilter(state_history_[sample].filter, buffer);
+    }
+
+    void
+    Track::getPastPosition(double t, double& x, double& y)
+    {
+      x = y = 0.0;
+      if (state_history_.empty())
+        return;
+
+      // Last sample not after t (or the first sample):
+      int i = int(state_history_.size()) - 1;
+      while ((i > 0) and (state_history_[i].time.toSec() > t))
+        i--;
+
+      const KalmanFilterState& state = state_history_[i].filter;
+      double dt = std::max(t - state_history_[i].time.toSec(), 0.0);
+      x = state.x(0) + state.x(2) * dt;
+      y = state.x(1) + state.x(3) * dt;
+    }
+
+    double
+    Track::getGatingRadius(double max_mahalanobis_distance, const ros::Time& when, double& x, double& y)
+    {
+      predictMahalanobisParameters(when);
+
+      double bound;
       if (velocity_in_motion_term_)
       {
-        ros::Duration d(1.0);
-        ros::Duration d2(2.0);
+        x = mahalanobis_parameters4d_.x;
+        y = mahalanobis_parameters4d_.y;
+        bound = open_ptrack::tracking::KalmanFilter::getMahalanobisLowerBound(mahalanobis_parameters4d_);
+      }
+      else
+      {
+        x = mahalanobis_parameters2d_.x;
+        y = mahalanobis_parameters2d_.y;
+        bound = open_ptrack::tracking::KalmanFilter::getMahalanobisLowerBound(mahalanobis_parameters2d_);
+      }
 
-        double t = std::max(first_time_detected_.toSec(), (when - d).toSec());
-        t = std::min(t, last_time_detected_.toSec());
-        t = std::max(t, (last_time_predicted_ - d2).toSec());
-        double dt = t - last_time_predicted_.toSec();
+      // Detections farther than this have a Mahalanobis distance greater than the threshold:
+      if (bound <= 0.0)
+        return std::numeric_limits<double>::infinity();
+      return sqrt(std::max(max_mahalanobis_distance, 0.0) / bound);
+    }
 
-        difference = int(round(dt / period_));
-        int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+    bool
+    Track::fillTrackTable(TrackTable& table, int row, const ros::Time& when, const ros::Time& epoch)
+    {
+      // The filter state refers to the last update (see predictMahalanobisParameters).
+      // Times are relative to epoch, for not losing precision on the intervals:
+      ClosedFormKalmanFilter<2> buffer;
+      ros::Time update_time;
+      const ClosedFormKalmanFilter<2>& filter = getFilterBefore(when, buffer, update_time);
+      table.setTrack(row, filter, (update_time - epoch).toSec());
+      fillTrackTableVelocity(table, row, when);
+      return hasFilterAt(when);
+    }
 
-//        std::cout << "dt: " << dt << std::endl;
-//        std::cout << "vIndex: " << vIndex << std::endl;
+    void
+    Track::fillTrackTableVelocity(TrackTable& table, int row, const ros::Time& when)
+    {
+      double gain = 0.0, offset_x = 0.0, offset_y = 0.0;
+      if (velocity_in_motion_term_)
+        getVelocityObservationModel(when, gain, offset_x, offset_y);
+      table.setVelocityModel(row, gain, offset_x, offset_y);
+    }
 
-        double vx, vy;
-        if(difference != 0)
-        {
-          vx = - (x - mahalanobis_map4d_[vIndex].x) / dt;
-          vy = - (y - mahalanobis_map4d_[vIndex].y) / dt;
-        }
-        else
-        {
-          vx = mahalanobis_map4d_[vIndex].x;
-          vy = mahalanobis_map4d_[vIndex].y;
-        }
+    unsigned int
+    Track::getFilterRevision() const
+    {
+      return filter_revision_;
+    }
+
+    bool
+    Track::hasFilterAt(const ros::Time& when) const
+    {
+      return when >= last_time_detected_;
+    }
+
+    void
+    Track::getVelocityObservationModel(const ros::Time& when, double& gain, double& offset_x, double& offset_y)
+    {
+      ros::Duration d(1.0);
+      ros::Duration d2(2.0);
+
+      double t = std::max(first_time_detected_.toSec(), (when - d).toSec());
+      t = std::min(t, last_time_detected_.toSec());
+      t = std::max(t, (when - d2).toSec());
+      double dt = t - when.toSec();
+
+      int difference = int(round(dt / period_));
+
+//      std::cout << "dt: " << dt << std::endl;
+
+      double past_x, past_y;
+      getPastPosition(t, past_x, past_y);
+
+      // Observed velocity: -(detection - past_position) / dt
+      if(difference != 0)
+      {
+        gain = - 1.0 / dt;
+        offset_x = past_x / dt;
+        offset_y = past_y / dt;
+      }
+      else
+      {
+        gain = 0.0;
+        offset_x = past_x;
+        offset_y = past_y;
+      }
+    }
+
+    double
+    Track::getMahalanobisDistance(double x, double y, const ros::Time& when)
+    {
+      predictMahalanobisParameters(when);
+
+      if (velocity_in_motion_term_)
+      {
+        double gain, offset_x, offset_y;
+        getVelocityObservationModel(when, gain, offset_x, offset_y);
+        double vx = gain * x + offset_x;
+        double vy = gain * y + offset_y;
 
 //        std::cout << "vx: " << vx << ", vy: " << vy<< std::endl;
 
-        return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, vx, vy, mahalanobis_map4d_[index]);
+        return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, vx, vy, mahalanobis_parameters4d_);
       }
       else
       {
-        return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, mahalanobis_map2d_[index]);
+        return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, mahalanobis_parameters2d_);
       }
 
     }
@@ -391,11 +591,6 @@ namespace open_ptrack
     {
       cv::Scalar color(int(255.0 * color_(0)), int(255.0 * color_(1)), int(255.0 * color_(2)));
 
-      double _x2, _y2;
-      tmp_filter_->getState(_x2, _y2);
-      Eigen::Vector3d centroid2(_x2, _y2, z_);
-      centroid2 = detection_source_->transformToCam(centroid2);
-
       if(visibility_ == Track::NOT_VISIBLE)
         return;
 
@@ -629,21 +824,24 @@ namespace open_ptrack
       filter_->getState(x, y);
       filter_->init(x, y, distance_, velocity_in_motion_term_);
 
-      *tmp_filter_ = *filter_;
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
     }
 
     void
     Track::setAccelerationVariance (double acceleration_variance)
     {
       filter_->setPredictModel (acceleration_variance);
-      tmp_filter_->setPredictModel (acceleration_variance);
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
     }
 
     void
     Track::setPositionVariance (double position_variance)
     {
       filter_->setObserveModel (position_variance);
-      tmp_filter_->setObserveModel (position_variance);
+      mahalanobis_parameters_valid_ = false;
+      filter_revision_++;
     }
   } /* namespace tracking */
 } /* namespace open_ptrack */
@@ -39,6 +39,8 @@
 
 #include <ros/ros.h>
 
+#include <limits>
+
 #include <open_ptrack/tracking/track3d.h>
 
 namespace open_ptrack
@@ -52,7 +54,8 @@ Track3D::Track3D(
     double position_variance,
     double acceleration_variance,
     double period,
-    bool velocity_in_motion_term) :
+    bool velocity_in_motion_term,
+    FilterBackend filter_backend) :
   id_(id),
   frame_id_(frame_id),
   period_(period),
@@ -63,26 +66,21 @@ Track3D::Track3D(
         float(rand() % 256) / 255,
         float(rand() % 256) / 255);
 
-  MAX_SIZE = 90; //XXX create a parameter!!!
   if (velocity_in_motion_term_)
   {
-    filter_ = new open_ptrack::tracking::KalmanFilter3D(period, position_variance, acceleration_variance, 6);
-    tmp_filter_ = new open_ptrack::tracking::KalmanFilter3D(period, position_variance, acceleration_variance, 6);
-    mahalanobis_map6d_.resize(MAX_SIZE, MahalanobisParameters6d());
+    filter_ = new open_ptrack::tracking::KalmanFilter3D(period, position_variance, acceleration_variance, 6, filter_backend);
   }
   else
   {
-    filter_ = new open_ptrack::tracking::KalmanFilter3D(period, position_variance, acceleration_variance, 3);
-    tmp_filter_ = new open_ptrack::tracking::KalmanFilter3D(period, position_variance, acceleration_variance, 3);
-    mahalanobis_map3d_.resize(MAX_SIZE, MahalanobisParameters3d());
+    filter_ = new open_ptrack::tracking::KalmanFilter3D(period, position_variance, acceleration_variance, 3, filter_backend);
   }
+  mahalanobis_parameters_valid_ = false;
 
 }
 
 Track3D::~Track3D()
 {
   delete filter_;
-  delete tmp_filter_;
 }
 
 void
@@ -93,7 +91,6 @@ Track3D::init(const Track3D& old_track)
 
   filter_->init(x, y, z, 10, old_track.velocity_in_motion_term_);
 
-  *tmp_filter_ = *filter_;
   visibility_ = old_track.visibility_;
 
   ROS_INFO("%d -> %d", old_track.id_, id_);
@@ -109,8 +106,8 @@ Track3D::init(const Track3D& old_track)
   first_time_detected_ = old_track.first_time_detected_;
   last_time_detected_ = old_track.last_time_detected_;
   last_time_detected_with_high_confidence_ = old_track.last_time_detected_with_high_confidence_;
-  last_time_predicted_ = old_track.last_time_predicted_;
-  last_time_predicted_index_ = old_track.last_time_predicted_index_;
+  state_history_ = old_track.state_history_;
+  mahalanobis_parameters_valid_ = false;
 
   data_association_score_ = old_track.data_association_score_;
 }
@@ -129,10 +126,13 @@ Track3D::init(double x, double y, double z, double height, double distance,
   updates_with_enough_confidence_ = low_confidence_consecutive_frames_ = 0;
   detection_source_ = detection_source;
   first_time_detected_ = detection_source->getTime();
-  last_time_predicted_ = last_time_detected_ = last_time_detected_with_high_confidence_ = detection_source->getTime();
-  last_time_predicted_index_ = 0;
+  last_time_detected_ = last_time_detected_with_high_confidence_ = detection_source->getTime();
   age_ = 0.0;
 
+  state_history_.clear();
+  addStateSample(last_time_detected_);
+  mahalanobis_parameters_valid_ = false;
+
 
 }
 
@@ -153,7 +153,6 @@ Track3D::update(
   if(std::isnan(x) or std::isnan(y) or std::isnan(z)) return;
 
   //Update Kalman filter
-  int difference;
   double vx, vy, vz;
   if (velocity_in_motion_term_)
   {
@@ -166,39 +165,38 @@ Track3D::update(
 //    std::cout << "t2: " << t << std::endl;
     t = std::max(t, (detection_source->getTime() - d2).toSec());
 //    std::cout << "t3: " << t << std::endl;
-    double dt = t - last_time_predicted_.toSec();
+    double dt = t - detection_source->getTime().toSec();
 //    std::cout << "dt: " << dt << std::endl;
-    difference = int(round(dt / period_));
+    int difference = int(round(dt / period_));
 //    std::cout << "period: " << period_ << std::endl;
 //    std::cout << "difference: " << difference << std::endl;
-    int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
-//    std::cout << vIndex << std::endl;
+
+    double past_x, past_y, past_z;
+    getPastPosition(t, past_x, past_y, past_z);
 
     if(difference != 0
-       and not mahalanobis_map6d_[vIndex].x == 0
-       and not mahalanobis_map6d_[vIndex].y == 0
-       and not mahalanobis_map6d_[vIndex].z == 0) // prevent initial drift
+       and not past_x == 0
+       and not past_y == 0
+       and not past_z == 0) // prevent initial drift
     {
-      vx = - (x - mahalanobis_map6d_[vIndex].x) / dt;
-      vy = - (y - mahalanobis_map6d_[vIndex].y) / dt;
-      vz = - (z - mahalanobis_map6d_[vIndex].z) / dt;
+      vx = - (x - past_x) / dt;
+      vy = - (y - past_y) / dt;
+      vz = - (z - past_z) / dt;
     }
     else
     {
-      vx = mahalanobis_map6d_[vIndex].x;
-      vy = mahalanobis_map6d_[vIndex].y;
-      vz = mahalanobis_map6d_[vIndex].z;
+      vx = past_x;
+      vy = past_y;
+      vz = past_z;
     }
-//    std::cout << "Mahalanobis: " << mahalanobis_map6d_[vIndex].x << "," << mahalanobis_map6d_[vIndex].y << "," << mahalanobis_map6d_[vIndex].z << std::endl;
+//    std::cout << "Past position: " << past_x << "," << past_y << "," << past_z << std::endl;
   }
   // Update Kalman filter from the last time the track was visible:
   int framesLost = int(round((detection_source->getTime() - last_time_detected_).toSec() / period_)) - 1;
 
-  for(int i = 0; i < framesLost; i++)
-  {
-    filter_->predict();
-    filter_->update();
-  }
+  // Lost frames are predicted in a single step:
+  if (framesLost > 0)
+    filter_->predict(framesLost * period_);
 
   filter_->predict();
   if (velocity_in_motion_term_)
@@ -214,14 +212,9 @@ Track3D::update(
           filter_->update(x, y, z, distance);
   }
 
-  *tmp_filter_ = *filter_;
-  difference = int(round((detection_source->getTime() - last_time_predicted_).toSec() / period_));
-  last_time_predicted_index_ = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
-  last_time_predicted_ = last_time_detected_ = detection_source->getTime();
-  if (velocity_in_motion_term_)
-    filter_->getMahalanobisParameters(mahalanobis_map6d_[last_time_predicted_index_]);
-  else
-    filter_->getMahalanobisParameters(mahalanobis_map3d_[last_time_predicted_index_]);
+  last_time_detected_ = detection_source->getTime();
+  addStateSample(last_time_detected_);
+  mahalanobis_parameters_valid_ = false;
 
   // Update z_ and height_ with a weighted combination of current and new values:
   //      z_ = z_ * 0.9 + z * 0.1;
@@ -325,32 +318,86 @@ Track3D::getUpdatesWithEnoughConfidence()
   return updates_with_enough_confidence_;
 }
 
+void
+Track3D::predictMahalanobisParameters(const ros::Time& when)
+{
+  if (mahalanobis_parameters_valid_ and (when == mahalanobis_parameters_time_))
+    return;
+
+  // The filter state refers to the last update:
+  double interval = (when - last_time_detected_).toSec();
+  if (velocity_in_motion_term_)
+    filter_->getMahalanobisParameters(interval, mahalanobis_parameters6d_);
+  else
+    filter_->getMahalanobisParameters(interval, mahalanobis_parameters3d_);
+
+  mahalanobis_parameters_time_ = when;
+  mahalanobis_parameters_valid_ = true;
+}
+
+void
+Track3D::addStateSample(const ros::Time& when)
+{
+  StateSample sample;
+  sample.time = when;
+  filter_->getState(sample.x, sample.y, sample.z, sample.vx, sample.vy, sample.vz);
+  state_history_.push_back(sample);
+
+  // Positions older than three seconds are never used for the velocity in the motion term,
+  // but the last sample before that time is needed for predicting them:
+  ros::Time oldest_time = when - ros::Duration(3.0);
+  while ((state_history_.size() > 1) and (state_history_[1].time <= oldest_time))
+    state_history_.pop_front();
+}
+
+void
+Track3D::getPastPosition(double t, double& x, double& y, double& z)
+{
+  x = y = z = 0.0;
+  if (state_history_.empty())
+    return;
+
+  // Last sample not after t (or the first sample):
+  std::deque<StateSample>::const_reverse_iterator it = state_history_.rbegin();
+  while ((it + 1 != state_history_.rend()) and (it->time.toSec() > t))
+    it++;
+
+  double dt = std::max(t - it->time.toSec(), 0.0);
+  x = it->x + it->vx * dt;
+  y = it->y + it->vy * dt;
+  z = it->z + it->vz * dt;
+}
+
 double
-Track3D::getMahalanobisDistance(double x, double y, double z, const ros::Time& when)
+Track3D::getGatingRadius(double max_mahalanobis_distance, const ros::Time& when, double& x, double& y)
 {
-  int difference = int(round((when - last_time_predicted_).toSec() / period_));
-  //      std::cout << "time difference from last detection: " << difference << std::endl;
-  int index;
-  if(difference <= 0)
+  predictMahalanobisParameters(when);
+
+  double bound;
+  if (velocity_in_motion_term_)
   {
-    index = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+    x = mahalanobis_parameters6d_.x;
+    y = mahalanobis_parameters6d_.y;
+    bound = open_ptrack::tracking::KalmanFilter3D::getMahalanobisLowerBound(mahalanobis_parameters6d_);
   }
   else
   {
-    for(int i = 0; i < difference; i++)
-    {
-      tmp_filter_->predict();
-      last_time_predicted_index_ = (last_time_predicted_index_ + 1) % MAX_SIZE;
-      if (velocity_in_motion_term_)
-        tmp_filter_->getMahalanobisParameters(mahalanobis_map6d_[last_time_predicted_index_]);
-      else
-        tmp_filter_->getMahalanobisParameters(mahalanobis_map3d_[last_time_predicted_index_]);
-      tmp_filter_->update();
-    }
-    last_time_predicted_ = when;
-    index = last_time_predicted_index_;
+    x = mahalanobis_parameters3d_.x;
+    y = mahalanobis_parameters3d_.y;
+    bound = open_ptrack::tracking::KalmanFilter3D::getMahalanobisLowerBound(mahalanobis_parameters3d_);
   }
 
+  // Detections farther than this have a Mahalanobis distance greater than the threshold:
+  if (bound <= 0.0)
+    return std::numeric_limits<double>::infinity();
+  return sqrt(std::max(max_mahalanobis_distance, 0.0) / bound);
+}
+
+double
+Track3D::getMahalanobisDistance(double x, double y, double z, const ros::Time& when)
+{
+  predictMahalanobisParameters(when);
+
   if (velocity_in_motion_term_)
   {
     ros::Duration d(1.0);
@@ -358,38 +405,39 @@ Track3D::getMahalanobisDistance(double x, double y, double z, const ros::Time& w
 
     double t = std::max(first_time_detected_.toSec(), (when - d).toSec());
     t = std::min(t, last_time_detected_.toSec());
-    t = std::max(t, (last_time_predicted_ - d2).toSec());
-    double dt = t - last_time_predicted_.toSec();
+    t = std::max(t, (when - d2).toSec());
+    double dt = t - when.toSec();
 
-    difference = int(round(dt / period_));
-    int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+    int difference = int(round(dt / period_));
 
     //        std::cout << "dt: " << dt << std::endl;
-    //        std::cout << "vIndex: " << vIndex << std::endl;
+
+    double past_x, past_y, past_z;
+    getPastPosition(t, past_x, past_y, past_z);
 
     double vx, vy, vz;
     if(difference != 0)
     {
-      vx = - (x - mahalanobis_map6d_[vIndex].x) / dt;
-      vy = - (y - mahalanobis_map6d_[vIndex].y) / dt;
-      vz = - (z - mahalanobis_map6d_[vIndex].z) / dt;
+      vx = - (x - past_x) / dt;
+      vy = - (y - past_y) / dt;
+      vz = - (z - past_z) / dt;
     }
     else
     {
-      vx = mahalanobis_map6d_[vIndex].x;
-      vy = mahalanobis_map6d_[vIndex].y;
-      vz = mahalanobis_map6d_[vIndex].z;
+      vx = past_x;
+      vy = past_y;
+      vz = past_z;
     }
 
     //        std::cout << "vx: " << vx << ", vy: " << vy<< std::endl;
 
     return open_ptrack::tracking::KalmanFilter3D::performMahalanobisDistance
-        (x, y, z, vx, vy, vz, mahalanobis_map6d_[index]);
+        (x, y, z, vx, vy, vz, mahalanobis_parameters6d_);
   }
   else
   {
     return open_ptrack::tracking::KalmanFilter3D::performMahalanobisDistance
-        (x, y, z, mahalanobis_map3d_[index]);
+        (x, y, z, mahalanobis_parameters3d_);
   }
 
 }
@@ -399,11 +447,6 @@ Track3D::draw(bool vertical)
 {
   cv::Scalar color(int(255.0 * color_(0)), int(255.0 * color_(1)), int(255.0 * color_(2)));
 
-  double _x2, _y2, _z2;
-  tmp_filter_->getState(_x2, _y2, _z2);
-  Eigen::Vector3d centroid2(_x2, _y2, _z2);
-  centroid2 = detection_source_->transformToCam(centroid2);
-
   if(visibility_ == Track3D::NOT_VISIBLE)
     return;
 
@@ -638,21 +681,21 @@ Track3D::setVelocityInMotionTerm (bool velocity_in_motion_term, double accelerat
   filter_->getState(x, y, z);
   filter_->init(x, y, z, distance_, velocity_in_motion_term_);
 
-  *tmp_filter_ = *filter_;
+  mahalanobis_parameters_valid_ = false;
 }
 
 void
 Track3D::setAccelerationVariance (double acceleration_variance)
 {
   filter_->setPredictModel (acceleration_variance);
-  tmp_filter_->setPredictModel (acceleration_variance);
+  mahalanobis_parameters_valid_ = false;
 }
 
 void
 Track3D::setPositionVariance (double position_variance)
 {
   filter_->setObserveModel (position_variance);
-  tmp_filter_->setObserveModel (position_variance);
+  mahalanobis_parameters_valid_ = false;
 }
 
 void
@@ -39,6 +39,8 @@
 
 #include <ros/ros.h>
 
+#include <limits>
+
 #include <open_ptrack/tracking/track_object.h>
 
 namespace open_ptrack
@@ -52,7 +54,8 @@ TrackObject::TrackObject(
     double position_variance,
     double acceleration_variance,
     double period,
-    bool velocity_in_motion_term) :
+    bool velocity_in_motion_term,
+    FilterBackend filter_backend) :
   id_(id),
   frame_id_(frame_id),
   period_(period),
@@ -63,26 +66,21 @@ TrackObject::TrackObject(
         float(rand() % 256) / 255,
         float(rand() % 256) / 255);
 
-  MAX_SIZE = 90; //XXX create a parameter!!!
   if (velocity_in_motion_term_)
   {
-    filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 4);
-    tmp_filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 4);
-    mahalanobis_map4d_.resize(MAX_SIZE, MahalanobisParameters4d());
+    filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 4, filter_backend);
   }
   else
   {
-    filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 2);
-    tmp_filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 2);
-    mahalanobis_map2d_.resize(MAX_SIZE, MahalanobisParameters2d());
+    filter_ = new open_ptrack::tracking::KalmanFilter(period, position_variance, acceleration_variance, 2, filter_backend);
   }
+  mahalanobis_parameters_valid_ = false;
 
 }
 
 TrackObject::~TrackObject()
 {
   delete filter_;
-  delete tmp_filter_;
 }
 
 void
@@ -93,7 +91,6 @@ TrackObject::init(const TrackObject& old_track)
 
   filter_->init(x, y, 10, old_track.velocity_in_motion_term_);
 
-  *tmp_filter_ = *filter_;
   visibility_ = old_track.visibility_;
 
   ROS_INFO("%d -> %d", old_track.id_, id_);
@@ -113,8 +110,8 @@ TrackObject::init(const TrackObject& old_track)
   first_time_detected_ = old_track.first_time_detected_;
   last_time_detected_ = old_track.last_time_detected_;
   last_time_detected_with_high_confidence_ = old_track.last_time_detected_with_high_confidence_;
-  last_time_predicted_ = old_track.last_time_predicted_;
-  last_time_predicted_index_ = old_track.last_time_predicted_index_;
+  state_history_ = old_track.state_history_;
+  mahalanobis_parameters_valid_ = false;
 
   data_association_score_ = old_track.data_association_score_;
 }
@@ -138,9 +135,12 @@ TrackObject::init(double x, double y, double z, double height, double distance,s
   updates_with_enough_confidence_ = low_confidence_consecutive_frames_ = 0;
   detection_source_ = detection_source;
   first_time_detected_ = detection_source->getTime();
-  last_time_predicted_ = last_time_detected_ = last_time_detected_with_high_confidence_ = detection_source->getTime();
-  last_time_predicted_index_ = 0;
+  last_time_detected_ = last_time_detected_with_high_confidence_ = detection_source->getTime();
   age_ = 0.0;
+
+  state_history_.clear();
+  addStateSample(last_time_detected_);
+  mahalanobis_parameters_valid_ = false;
 }
 
 void
@@ -159,7 +159,6 @@ TrackObject::update(
     bool first_update)
 {
   //Update Kalman filter
-  int difference;
   double vx, vy;
   if (velocity_in_motion_term_)
   {
@@ -169,31 +168,31 @@ TrackObject::update(
     double t = std::max(first_time_detected_.toSec(), (detection_source->getTime() - d).toSec());
     t = std::min(t, last_time_detected_.toSec());
     t = std::max(t, (detection_source->getTime() - d2).toSec());
-    double dt = t - last_time_predicted_.toSec();
+    double dt = t - detection_source->getTime().toSec();
+
+    int difference = int(round(dt / period_));
 
-    difference = int(round(dt / period_));
-    int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+    double past_x, past_y;
+    getPastPosition(t, past_x, past_y);
 
     if(difference != 0)
     {
-      vx = - (x - mahalanobis_map4d_[vIndex].x) / dt;
-      vy = - (y - mahalanobis_map4d_[vIndex].y) / dt;
+      vx = - (x - past_x) / dt;
+      vy = - (y - past_y) / dt;
     }
     else
     {
-      vx = mahalanobis_map4d_[vIndex].x;
-      vy = mahalanobis_map4d_[vIndex].x;
+      vx = past_x;
+      vy = past_x;
     }
   }
 
   // Update Kalman filter from the last time the track was visible:
   int framesLost = int(round((detection_source->getTime() - last_time_detected_).toSec() / period_)) - 1;
 
-  for(int i = 0; i < framesLost; i++)
-  {
-    filter_->predict();
-    filter_->update();
-  }
+  // Lost frames are predicted in a single step:
+  if (framesLost > 0)
+    filter_->predict(framesLost * period_);
 
   filter_->predict();
   if (velocity_in_motion_term_)
@@ -205,14 +204,9 @@ TrackObject::update(
     filter_->update(x, y, distance);
   }
 
-  *tmp_filter_ = *filter_;
-  difference = int(round((detection_source->getTime() - last_time_predicted_).toSec() / period_));
-  last_time_predicted_index_ = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
-  last_time_predicted_ = last_time_detected_ = detection_source->getTime();
-  if (velocity_in_motion_term_)
-    filter_->getMahalanobisParameters(mahalanobis_map4d_[last_time_predicted_index_]);
-  else
-    filter_->getMahalanobisParameters(mahalanobis_map2d_[last_time_predicted_index_]);
+  last_time_detected_ = detection_source->getTime();
+  addStateSample(last_time_detected_);
+  mahalanobis_parameters_valid_ = false;
 
   // Update z_ and height_ with a weighted combination of current and new values:
   z_ = z_ * 0.9 + z * 0.1;
@@ -317,32 +311,85 @@ TrackObject::getUpdatesWithEnoughConfidence()
   return updates_with_enough_confidence_;
 }
 
+void
+TrackObject::predictMahalanobisParameters(const ros::Time& when)
+{
+  if (mahalanobis_parameters_valid_ and (when == mahalanobis_parameters_time_))
+    return;
+
+  // The filter state refers to the last update:
+  double interval = (when - last_time_detected_).toSec();
+  if (velocity_in_motion_term_)
+    filter_->getMahalanobisParameters(interval, mahalanobis_parameters4d_);
+  else
+    filter_->getMahalanobisParameters(interval, mahalanobis_parameters2d_);
+
+  mahalanobis_parameters_time_ = when;
+  mahalanobis_parameters_valid_ = true;
+}
+
+void
+TrackObject::addStateSample(const ros::Time& when)
+{
+  StateSample sample;
+  sample.time = when;
+  filter_->getState(sample.x, sample.y, sample.vx, sample.vy);
+  state_history_.push_back(sample);
+
+  // Positions older than two seconds are never used for the velocity in the motion term,
+  // but the last sample before that time is needed for predicting them:
+  ros::Time oldest_time = when - ros::Duration(2.0);
+  while ((state_history_.size() > 1) and (state_history_[1].time <= oldest_time))
+    state_history_.pop_front();
+}
+
+void
+TrackObject::getPastPosition(double t, double& x, double& y)
+{
+  x = y = 0.0;
+  if (state_history_.empty())
+    return;
+
+  // Last sample not after t (or the first sample):
+  std::deque<StateSample>::const_reverse_iterator it = state_history_.rbegin();
+  while ((it + 1 != state_history_.rend()) and (it->time.toSec() > t))
+    it++;
+
+  double dt = std::max(t - it->time.toSec(), 0.0);
+  x = it->x + it->vx * dt;
+  y = it->y + it->vy * dt;
+}
+
 double
-TrackObject::getMahalanobisDistance(double x, double y, const ros::Time& when)
+TrackObject::getGatingRadius(double max_mahalanobis_distance, const ros::Time& when, double& x, double& y)
 {
-  int difference = int(round((when - last_time_predicted_).toSec() / period_));
-  //      std::cout << "time difference from last detection: " << difference << std::endl;
-  int index;
-  if(difference <= 0)
+  predictMahalanobisParameters(when);
+
+  double bound;
+  if (velocity_in_motion_term_)
   {
-    index = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+    x = mahalanobis_parameters4d_.x;
+    y = mahalanobis_parameters4d_.y;
+    bound = open_ptrack::tracking::KalmanFilter::getMahalanobisLowerBound(mahalanobis_parameters4d_);
   }
   else
   {
-    for(int i = 0; i < difference; i++)
-    {
-      tmp_filter_->predict();
-      last_time_predicted_index_ = (last_time_predicted_index_ + 1) % MAX_SIZE;
-      if (velocity_in_motion_term_)
-        tmp_filter_->getMahalanobisParameters(mahalanobis_map4d_[last_time_predicted_index_]);
-      else
-        tmp_filter_->getMahalanobisParameters(mahalanobis_map2d_[last_time_predicted_index_]);
-      tmp_filter_->update();
-    }
-    last_time_predicted_ = when;
-    index = last_time_predicted_index_;
+    x = mahalanobis_parameters2d_.x;
+    y = mahalanobis_parameters2d_.y;
+    bound = open_ptrack::tracking::KalmanFilter::getMahalanobisLowerBound(mahalanobis_parameters2d_);
   }
 
+  // Detections farther than this have a Mahalanobis distance greater than the threshold:
+  if (bound <= 0.0)
+    return std::numeric_limits<double>::infinity();
+  return sqrt(std::max(max_mahalanobis_distance, 0.0) / bound);
+}
+
+double
+TrackObject::getMahalanobisDistance(double x, double y, const ros::Time& when)
+{
+  predictMahalanobisParameters(when);
+
   if (velocity_in_motion_term_)
   {
     ros::Duration d(1.0);
@@ -350,34 +397,35 @@ TrackObject::getMahalanobisDistance(double x, double y, const ros::Time& when)
 
     double t = std::max(first_time_detected_.toSec(), (when - d).toSec());
     t = std::min(t, last_time_detected_.toSec());
-    t = std::max(t, (last_time_predicted_ - d2).toSec());
-    double dt = t - last_time_predicted_.toSec();
+    t = std::max(t, (when - d2).toSec());
+    double dt = t - when.toSec();
 
-    difference = int(round(dt / period_));
-    int vIndex = (MAX_SIZE + last_time_predicted_index_ + difference) % MAX_SIZE;
+    int difference = int(round(dt / period_));
 
     //        std::cout << "dt: " << dt << std::endl;
-    //        std::cout << "vIndex: " << vIndex << std::endl;
+
+    double past_x, past_y;
+    getPastPosition(t, past_x, past_y);
 
     double vx, vy;
     if(difference != 0)
     {
-      vx = - (x - mahalanobis_map4d_[vIndex].x) / dt;
-      vy = - (y - mahalanobis_map4d_[vIndex].y) / dt;
+      vx = - (x - past_x) / dt;
+      vy = - (y - past_y) / dt;
     }
     else
     {
-      vx = mahalanobis_map4d_[vIndex].x;
-      vy = mahalanobis_map4d_[vIndex].y;
+      vx = past_x;
+      vy = past_y;
     }
 
     //        std::cout << "vx: " << vx << ", vy: " << vy<< std::endl;
 
-    return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, vx, vy, mahalanobis_map4d_[index]);
+    return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, vx, vy, mahalanobis_parameters4d_);
   }
   else
   {
-    return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, mahalanobis_map2d_[index]);
+    return open_ptrack::tracking::KalmanFilter::performMahalanobisDistance(x, y, mahalanobis_parameters2d_);
   }
 
 }
@@ -387,11 +435,6 @@ TrackObject::draw(bool vertical)
 {
   cv::Scalar color(int(255.0 * color_(0)), int(255.0 * color_(1)), int(255.0 * color_(2)));
 
-  double _x2, _y2;
-  tmp_filter_->getState(_x2, _y2);
-  Eigen::Vector3d centroid2(_x2, _y2, z_);
-  centroid2 = detection_source_->transformToCam(centroid2);
-
   if(visibility_ == TrackObject::NOT_VISIBLE)
     return;
 
@@ -629,21 +672,21 @@ TrackObject::setVelocityInMotionTerm (bool velocity_in_motion_term, double accel
   filter_->getState(x, y);
   filter_->init(x, y, distance_, velocity_in_motion_term_);
 
-  *tmp_filter_ = *filter_;
+  mahalanobis_parameters_valid_ = false;
 }
 
 void
 TrackObject::setAccelerationVariance (double acceleration_variance)
 {
   filter_->setPredictModel (acceleration_variance);
-  tmp_filter_->setPredictModel (acceleration_variance);
+  mahalanobis_parameters_valid_ = false;
 }
 
 void
 TrackObject::setPositionVariance (double position_variance)
 {
   filter_->setObserveModel (position_variance);
-  tmp_filter_->setObserveModel (position_variance);
+  mahalanobis_parameters_valid_ = false;
 }
 } /* namespace tracking */
 } /* namespace open_ptrack */
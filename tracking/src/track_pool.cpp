@@ -0,0 +1,101 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <open_ptrack/tracking/track_pool.h>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    TrackPool::TrackPool()
+    {
+
+    }
+
+    TrackPool::~TrackPool()
+    {
+      clear();
+    }
+
+    Track*
+    TrackPool::create(
+        std::list<Track*>& tracks,
+        int id,
+        const std::string& frame_id,
+        double position_variance,
+        double acceleration_variance,
+        double period,
+        bool velocity_in_motion_term,
+        FilterBackend filter_backend)
+    {
+      if (free_tracks_.empty())
+      {
+        tracks.push_back(new Track(id, frame_id, position_variance, acceleration_variance, period,
+            velocity_in_motion_term, filter_backend));
+        return tracks.back();
+      }
+
+      // Move the node of the free track to the end of the track list:
+      tracks.splice(tracks.end(), free_tracks_, free_tracks_.begin());
+      Track* t = tracks.back();
+      t->reset(id, frame_id, position_variance, acceleration_variance, period, velocity_in_motion_term, filter_backend);
+      return t;
+    }
+
+    std::list<Track*>::iterator
+    TrackPool::release(std::list<Track*>& tracks, std::list<Track*>::iterator it)
+    {
+      std::list<Track*>::iterator next = it;
+      ++next;
+      free_tracks_.splice(free_tracks_.begin(), tracks, it);
+      return next;
+    }
+
+    size_t
+    TrackPool::size() const
+    {
+      return free_tracks_.size();
+    }
+
+    void
+    TrackPool::clear()
+    {
+      for(std::list<Track*>::iterator it = free_tracks_.begin(); it != free_tracks_.end(); it++)
+        delete *it;
+      free_tracks_.clear();
+    }
+  } /* namespace tracking */
+} /* namespace open_ptrack */
@@ -0,0 +1,325 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <open_ptrack/tracking/track_table.h>
+#include <algorithm>
+#include "track_table_kernels.h"
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+#if defined(OPEN_PTRACK_TRACKING_AVX2)
+    // Defined in track_table_avx2.cpp, which is compiled with AVX2 and FMA enabled:
+    void
+    predictTracksAvx2(const TrackTableColumns& columns, int rows, double when, double period,
+        double acceleration_variance, bool velocity_in_motion_term);
+
+    void
+    computeTrackDistancesAvx2(const TrackTableColumns& columns, int rows, const double* x, const double* y,
+        const double* detector_term, int detections, double motion_weight, double invalid_distance,
+        bool velocity_in_motion_term, double* distances);
+#endif
+
+    namespace
+    {
+#if defined(__aarch64__) && defined(__ARM_NEON)
+      /** \brief Two doubles at a time with NEON. */
+      struct NeonVector
+      {
+        float64x2_t v;
+        NeonVector() {}
+        NeonVector(float64x2_t value) : v(value) {}
+      };
+
+      inline NeonVector operator+(NeonVector a, NeonVector b) { return vaddq_f64(a.v, b.v); }
+      inline NeonVector operator-(NeonVector a, NeonVector b) { return vsubq_f64(a.v, b.v); }
+      inline NeonVector operator*(NeonVector a, NeonVector b) { return vmulq_f64(a.v, b.v); }
+      inline NeonVector operator/(NeonVector a, NeonVector b) { return vdivq_f64(a.v, b.v); }
+
+      struct NeonPack
+      {
+        typedef NeonVector Type;
+        static const int SIZE = 2;
+
+        static inline Type load(const double* p) { return vld1q_f64(p); }
+        static inline void store(double* p, Type v) { vst1q_f64(p, v.v); }
+        static inline Type set1(double v) { return vdupq_n_f64(v); }
+        static inline Type max(Type a, Type b) { return vmaxq_f64(a.v, b.v); }
+        static inline Type selectLessEqual(Type a, Type b, Type x, Type y)
+        {
+          return vbslq_f64(vcleq_f64(a.v, b.v), x.v, y.v);
+        }
+        static inline Type finiteOr(Type v, Type fallback)
+        {
+          // v - v is 0 for finite values and NaN otherwise:
+          return vbslq_f64(vceqq_f64(vsubq_f64(v.v, v.v), vdupq_n_f64(0.0)), v.v, fallback.v);
+        }
+      };
+
+      typedef NeonPack NativePack;
+#else
+      typedef ScalarPack NativePack;
+#endif
+
+      /** \brief Rows are padded to a multiple of the widest SIMD vector (4 doubles with AVX2). */
+      const int ROW_ALIGNMENT = 4;
+
+      bool
+      useAvx2()
+      {
+#if defined(OPEN_PTRACK_TRACKING_AVX2)
+        static const bool avx2 = __builtin_cpu_supports("avx2") and __builtin_cpu_supports("fma");
+        return avx2;
+#else
+        return false;
+#endif
+      }
+    } /* namespace */
+
+    TrackTable::TrackTable() :
+        size_(0), padded_size_(0), period_(1.0 / 30.0), acceleration_variance_(0.0), velocity_in_motion_term_(false),
+        scalar_kernels_(false)
+    {
+
+    }
+
+    void
+    TrackTable::setModel(double period, double acceleration_variance, bool velocity_in_motion_term)
+    {
+      period_ = period;
+      acceleration_variance_ = acceleration_variance;
+      velocity_in_motion_term_ = velocity_in_motion_term;
+    }
+
+    void
+    TrackTable::resize(int tracks)
+    {
+      int kept = std::min(size_, tracks);
+      size_ = tracks;
+      padded_size_ = (tracks + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT * ROW_ALIGNMENT;
+
+      x_.resize(padded_size_);
+      y_.resize(padded_size_);
+      vx_.resize(padded_size_);
+      vy_.resize(padded_size_);
+      for(int i = 0; i < 10; i++)
+        p_[i].resize(padded_size_);
+      for(int i = 0; i < 4; i++)
+        r_[i].resize(padded_size_);
+      time_.resize(padded_size_);
+      velocity_gain_.resize(padded_size_);
+      velocity_offset_x_.resize(padded_size_);
+      velocity_offset_y_.resize(padded_size_);
+
+      // Padding rows hold a harmless state (identity covariance, observed now):
+      for(int row = kept; row < padded_size_; row++)
+      {
+        x_[row] = y_[row] = vx_[row] = vy_[row] = 0.0;
+        for(int i = 0; i < 10; i++)
+          p_[i][row] = (i == 0 or i == 4 or i == 7 or i == 9) ? 1.0 : 0.0;
+        for(int i = 0; i < 4; i++)
+          r_[i][row] = 1.0;
+        time_[row] = 0.0;
+        velocity_gain_[row] = velocity_offset_x_[row] = velocity_offset_y_[row] = 0.0;
+      }
+
+      predicted_x_.resize(padded_size_);
+      predicted_y_.resize(padded_size_);
+      predicted_vx_.resize(padded_size_);
+      predicted_vy_.resize(padded_size_);
+      for(int i = 0; i < 10; i++)
+        si_[i].resize(padded_size_);
+    }
+
+    int
+    TrackTable::size() const
+    {
+      return size_;
+    }
+
+    void
+    TrackTable::setTrack(int row, const ClosedFormKalmanFilter<2>& filter, double time,
+        double velocity_gain, double velocity_offset_x, double velocity_offset_y)
+    {
+      const ClosedFormKalmanFilter<2>::StateVector& x = filter.getState();
+      const ClosedFormKalmanFilter<2>::StateMatrix& X = filter.getStateCovariance();
+      const ClosedFormKalmanFilter<2>::StateVector& r = filter.getObservationVariances();
+
+      x_[row] = x(0);
+      y_[row] = x(1);
+      vx_[row] = x(2);
+      vy_[row] = x(3);
+      int k = 0;
+      for(int i = 0; i < 4; i++)
+      {
+        for(int j = i; j < 4; j++)
+          p_[k++][row] = X(i, j);
+        r_[i][row] = r(i);
+      }
+      time_[row] = time;
+      setVelocityModel(row, velocity_gain, velocity_offset_x, velocity_offset_y);
+    }
+
+    void
+    TrackTable::setVelocityModel(int row, double velocity_gain, double velocity_offset_x, double velocity_offset_y)
+    {
+      velocity_gain_[row] = velocity_gain;
+      velocity_offset_x_[row] = velocity_offset_x;
+      velocity_offset_y_[row] = velocity_offset_y;
+    }
+
+    void
+    TrackTable::moveRow(int from, int to)
+    {
+      x_[to] = x_[from];
+      y_[to] = y_[from];
+      vx_[to] = vx_[from];
+      vy_[to] = vy_[from];
+      for(int i = 0; i < 10; i++)
+        p_[i][to] = p_[i][from];
+      for(int i = 0; i < 4; i++)
+        r_[i][to] = r_[i][from];
+      time_[to] = time_[from];
+      setVelocityModel(to, velocity_gain_[from], velocity_offset_x_[from], velocity_offset_y_[from]);
+    }
+
+    void
+    TrackTable::predict(double when)
+    {
+      if (padded_size_ == 0)
+        return;
+
+      // Padding rows are predicted too, so that no scalar tail is needed:
+      for(int i = size_; i < padded_size_; i++)
+        time_[i] = when;
+
+      TrackTableColumns columns = getColumns();
+      if (scalar_kernels_)
+      {
+        predictTracks<ScalarPack>(columns, 0, padded_size_, when, period_, acceleration_variance_,
+            velocity_in_motion_term_);
+      }
+      else if (useAvx2())
+      {
+#if defined(OPEN_PTRACK_TRACKING_AVX2)
+        predictTracksAvx2(columns, padded_size_, when, period_, acceleration_variance_, velocity_in_motion_term_);
+#endif
+      }
+      else
+      {
+        predictTracks<NativePack>(columns, 0, padded_size_, when, period_, acceleration_variance_,
+            velocity_in_motion_term_);
+      }
+    }
+
+    void
+    TrackTable::computeDistances(const std::vector<double>& x, const std::vector<double>& y,
+        const std::vector<double>& detector_term, double motion_weight, double invalid_distance, double* distances)
+    {
+      int detections = x.size();
+      if (detections == 0 or size_ == 0)
+        return;
+
+      TrackTableColumns columns = getColumns();
+      if (scalar_kernels_)
+      {
+        computeTrackDistances<ScalarPack>(columns, size_, &x[0], &y[0], &detector_term[0], detections,
+            motion_weight, invalid_distance, velocity_in_motion_term_, distances);
+      }
+      else if (useAvx2())
+      {
+#if defined(OPEN_PTRACK_TRACKING_AVX2)
+        computeTrackDistancesAvx2(columns, size_, &x[0], &y[0], &detector_term[0], detections, motion_weight,
+            invalid_distance, velocity_in_motion_term_, distances);
+#endif
+      }
+      else
+      {
+        computeTrackDistances<NativePack>(columns, size_, &x[0], &y[0], &detector_term[0], detections,
+            motion_weight, invalid_distance, velocity_in_motion_term_, distances);
+      }
+    }
+
+    const char*
+    TrackTable::getInstructionSet()
+    {
+      if (useAvx2())
+        return "avx2";
+#if defined(__aarch64__) && defined(__ARM_NEON)
+      return "neon";
+#else
+      return "scalar";
+#endif
+    }
+
+    void
+    TrackTable::setScalarKernels(bool scalar_kernels)
+    {
+      scalar_kernels_ = scalar_kernels;
+    }
+
+    TrackTableColumns
+    TrackTable::getColumns()
+    {
+      TrackTableColumns columns;
+      columns.x = &x_[0];
+      columns.y = &y_[0];
+      columns.vx = &vx_[0];
+      columns.vy = &vy_[0];
+      for(int i = 0; i < 10; i++)
+      {
+        columns.p[i] = &p_[i][0];
+        columns.si[i] = &si_[i][0];
+      }
+      for(int i = 0; i < 4; i++)
+        columns.r[i] = &r_[i][0];
+      columns.time = &time_[0];
+      columns.velocity_gain = &velocity_gain_[0];
+      columns.velocity_offset_x = &velocity_offset_x_[0];
+      columns.velocity_offset_y = &velocity_offset_y_[0];
+      columns.predicted_x = &predicted_x_[0];
+      columns.predicted_y = &predicted_y_[0];
+      columns.predicted_vx = &predicted_vx_[0];
+      columns.predicted_vy = &predicted_vy_[0];
+      return columns;
+    }
+  } /* namespace tracking */
+} /* namespace open_ptrack */
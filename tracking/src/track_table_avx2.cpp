@@ -0,0 +1,101 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+// Compiled with AVX2 and FMA enabled (see CMakeLists.txt): only call these functions
+// after checking that the CPU supports them (see TrackTable::predict()).
+
+#include <immintrin.h>
+#include "track_table_kernels.h"
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    namespace
+    {
+      /** \brief Four doubles at a time with AVX2. */
+      struct Avx2Vector
+      {
+        __m256d v;
+        Avx2Vector() {}
+        Avx2Vector(__m256d value) : v(value) {}
+      };
+
+      inline Avx2Vector operator+(Avx2Vector a, Avx2Vector b) { return _mm256_add_pd(a.v, b.v); }
+      inline Avx2Vector operator-(Avx2Vector a, Avx2Vector b) { return _mm256_sub_pd(a.v, b.v); }
+      inline Avx2Vector operator*(Avx2Vector a, Avx2Vector b) { return _mm256_mul_pd(a.v, b.v); }
+      inline Avx2Vector operator/(Avx2Vector a, Avx2Vector b) { return _mm256_div_pd(a.v, b.v); }
+
+      struct Avx2Pack
+      {
+        typedef Avx2Vector Type;
+        static const int SIZE = 4;
+
+        // Columns are 32 byte aligned, but detections come from a std::vector:
+        static inline Type load(const double* p) { return _mm256_loadu_pd(p); }
+        static inline void store(double* p, Type v) { _mm256_storeu_pd(p, v.v); }
+        static inline Type set1(double v) { return _mm256_set1_pd(v); }
+        static inline Type max(Type a, Type b) { return _mm256_max_pd(a.v, b.v); }
+        static inline Type selectLessEqual(Type a, Type b, Type x, Type y)
+        {
+          return _mm256_blendv_pd(y.v, x.v, _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ));
+        }
+        static inline Type finiteOr(Type v, Type fallback)
+        {
+          // v - v is 0 for finite values and NaN otherwise:
+          __m256d finite = _mm256_cmp_pd(_mm256_sub_pd(v.v, v.v), _mm256_setzero_pd(), _CMP_EQ_OQ);
+          return _mm256_blendv_pd(fallback.v, v.v, finite);
+        }
+      };
+    } /* namespace */
+
+    void
+    predictTracksAvx2(const TrackTableColumns& columns, int rows, double when, double period,
+        double acceleration_variance, bool velocity_in_motion_term)
+    {
+      predictTracks<Avx2Pack>(columns, 0, rows, when, period, acceleration_variance, velocity_in_motion_term);
+    }
+
+    void
+    computeTrackDistancesAvx2(const TrackTableColumns& columns, int rows, const double* x, const double* y,
+        const double* detector_term, int detections, double motion_weight, double invalid_distance,
+        bool velocity_in_motion_term, double* distances)
+    {
+      computeTrackDistances<Avx2Pack>(columns, rows, x, y, detector_term, detections, motion_weight,
+          invalid_distance, velocity_in_motion_term, distances);
+    }
+  } /* namespace tracking */
+} /* namespace open_ptrack */
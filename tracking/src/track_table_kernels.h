@@ -0,0 +1,272 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#ifndef OPEN_PTRACK_TRACKING_TRACK_TABLE_KERNELS_H_
+#define OPEN_PTRACK_TRACKING_TRACK_TABLE_KERNELS_H_
+
+// Private header of track_table.cpp and track_table_avx2.cpp.
+// Everything here has internal linkage, so that every source file compiles its own copy of the kernels
+// with its own instruction set and the linker never mixes them up.
+
+#include <cmath>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    /** \brief Columns of a TrackTable, as seen by the kernels (see TrackTable for their meaning). */
+    struct TrackTableColumns
+    {
+      const double* x;
+      const double* y;
+      const double* vx;
+      const double* vy;
+      const double* p[10];
+      const double* r[4];
+      const double* time;
+      const double* velocity_gain;
+      const double* velocity_offset_x;
+      const double* velocity_offset_y;
+      double* predicted_x;
+      double* predicted_y;
+      double* predicted_vx;
+      double* predicted_vy;
+      double* si[10];
+    };
+
+    namespace
+    {
+      /** \brief One double at a time. */
+      struct ScalarPack
+      {
+        typedef double Type;
+        static const int SIZE = 1;
+
+        static inline Type load(const double* p) { return *p; }
+        static inline void store(double* p, Type v) { *p = v; }
+        static inline Type set1(double v) { return v; }
+        static inline Type max(Type a, Type b) { return a > b ? a : b; }
+        static inline Type selectLessEqual(Type a, Type b, Type x, Type y) { return a <= b ? x : y; }
+        static inline Type finiteOr(Type v, Type fallback) { return std::isfinite(v) ? v : fallback; }
+      };
+
+      /**
+       * \brief Predict state and inverse innovation covariance of the rows in [begin, end).
+       *
+       * The covariance at the last update is propagated with the closed-form constant velocity model
+       * (see getProcessNoise()) and the innovation covariance is inverted blockwise, like
+       * ClosedFormKalmanFilter::getPredictedInnovation() does for a single track.
+       */
+      template <class Pack> inline void
+      predictTracks(const TrackTableColumns& c, int begin, int end, double when, double period,
+          double acceleration_variance, bool velocity_in_motion_term)
+      {
+        typedef typename Pack::Type V;
+        const V zero = Pack::set1(0.0);
+        const V one = Pack::set1(1.0);
+        const V half = Pack::set1(0.5);
+        const V t_now = Pack::set1(when);
+        const V h = Pack::set1(period);
+        const V q = Pack::set1(acceleration_variance);
+        const V qh = Pack::set1(acceleration_variance * period);
+        const V h2_12 = Pack::set1(period * period / 12.0);
+        const V third = Pack::set1(1.0 / 3.0);
+
+        for(int i = begin; i < end; i += Pack::SIZE)
+        {
+          V t = Pack::max(t_now - Pack::load(c.time + i), zero);
+          V t2 = t * t;
+
+          // Process noise:
+          V pp = Pack::selectLessEqual(t, h, q * t2 * t2 * half * half, qh * t * (t2 * third - h2_12));
+          V pv = Pack::selectLessEqual(t, h, q * t2 * t, qh * t2) * half;
+          V vv = Pack::selectLessEqual(t, h, q * t2, qh * t);
+
+          // State:
+          V vx = Pack::load(c.vx + i);
+          V vy = Pack::load(c.vy + i);
+          Pack::store(c.predicted_x + i, Pack::load(c.x + i) + t * vx);
+          Pack::store(c.predicted_y + i, Pack::load(c.y + i) + t * vy);
+          Pack::store(c.predicted_vx + i, vx);
+          Pack::store(c.predicted_vy + i, vy);
+
+          // Position block of F * P * F' + Q + R:
+          V p2 = Pack::load(c.p[2] + i);
+          V p3 = Pack::load(c.p[3] + i);
+          V p5 = Pack::load(c.p[5] + i);
+          V p6 = Pack::load(c.p[6] + i);
+          V p7 = Pack::load(c.p[7] + i);
+          V p8 = Pack::load(c.p[8] + i);
+          V p9 = Pack::load(c.p[9] + i);
+          V a00 = Pack::load(c.p[0] + i) + t * (p2 + p2 + t * p7) + pp + Pack::load(c.r[0] + i);
+          V a01 = Pack::load(c.p[1] + i) + t * (p3 + p5 + t * p8);
+          V a11 = Pack::load(c.p[4] + i) + t * (p6 + p6 + t * p9) + pp + Pack::load(c.r[1] + i);
+
+          V inverse_det = one / (a00 * a11 - a01 * a01);
+          V ai00 = a11 * inverse_det;
+          V ai01 = (zero - a01) * inverse_det;
+          V ai11 = a00 * inverse_det;
+
+          if (not velocity_in_motion_term)
+          {
+            Pack::store(c.si[0] + i, ai00);
+            Pack::store(c.si[1] + i, ai01);
+            Pack::store(c.si[2] + i, ai11);
+            continue;
+          }
+
+          // Position/velocity and velocity blocks:
+          V b00 = p2 + t * p7 + pv;
+          V b01 = p3 + t * p8;
+          V b10 = p5 + t * p8;
+          V b11 = p6 + t * p9 + pv;
+          V c00 = p7 + vv + Pack::load(c.r[2] + i);
+          V c01 = p8;
+          V c11 = p9 + vv + Pack::load(c.r[3] + i);
+
+          // M = inv(A) * B
+          V m00 = ai00 * b00 + ai01 * b10;
+          V m01 = ai00 * b01 + ai01 * b11;
+          V m10 = ai01 * b00 + ai11 * b10;
+          V m11 = ai01 * b01 + ai11 * b11;
+
+          // Schur complement C - B' * M and its inverse E:
+          V s00 = c00 - (b00 * m00 + b10 * m10);
+          V s01 = c01 - (b00 * m01 + b10 * m11);
+          V s11 = c11 - (b01 * m01 + b11 * m11);
+          V inverse_schur_det = one / (s00 * s11 - s01 * s01);
+          V e00 = s11 * inverse_schur_det;
+          V e01 = (zero - s01) * inverse_schur_det;
+          V e11 = s00 * inverse_schur_det;
+
+          // K = - M * E
+          V k00 = zero - (m00 * e00 + m01 * e01);
+          V k01 = zero - (m00 * e01 + m01 * e11);
+          V k10 = zero - (m10 * e00 + m11 * e01);
+          V k11 = zero - (m10 * e01 + m11 * e11);
+
+          // inv(S) = [inv(A) - K * M', K; K', E]
+          Pack::store(c.si[0] + i, ai00 - (k00 * m00 + k01 * m01));
+          Pack::store(c.si[1] + i, ai01 - (k00 * m10 + k01 * m11));
+          Pack::store(c.si[2] + i, k00);
+          Pack::store(c.si[3] + i, k01);
+          Pack::store(c.si[4] + i, ai11 - (k10 * m10 + k11 * m11));
+          Pack::store(c.si[5] + i, k10);
+          Pack::store(c.si[6] + i, k11);
+          Pack::store(c.si[7] + i, e00);
+          Pack::store(c.si[8] + i, e01);
+          Pack::store(c.si[9] + i, e11);
+        }
+      }
+
+      /** \brief Compute the distances of a track (row) from the detections in [begin, end). */
+      template <class Pack> inline void
+      computeRowDistances(const TrackTableColumns& c, int row, const double* x, const double* y,
+          const double* detector_term, int begin, int end, double motion_weight, double invalid_distance,
+          bool velocity_in_motion_term, double* distances)
+      {
+        typedef typename Pack::Type V;
+        const V px = Pack::set1(c.predicted_x[row]);
+        const V py = Pack::set1(c.predicted_y[row]);
+        const V w = Pack::set1(motion_weight);
+        const V invalid = Pack::set1(invalid_distance);
+
+        // Off-diagonal terms are doubled once for all detections:
+        const V si0 = Pack::set1(c.si[0][row]);
+        const V si1 = Pack::set1(2.0 * c.si[1][row]);
+
+        if (not velocity_in_motion_term)
+        {
+          const V si2 = Pack::set1(c.si[2][row]);
+          for(int j = begin; j < end; j += Pack::SIZE)
+          {
+            V e0 = Pack::load(x + j) - px;
+            V e1 = Pack::load(y + j) - py;
+            V m = e0 * (si0 * e0 + si1 * e1) + si2 * e1 * e1;
+            Pack::store(distances + j, Pack::finiteOr(Pack::load(detector_term + j) + w * m, invalid));
+          }
+          return;
+        }
+
+        const V pvx = Pack::set1(c.predicted_vx[row]);
+        const V pvy = Pack::set1(c.predicted_vy[row]);
+        const V gain = Pack::set1(c.velocity_gain[row]);
+        const V offset_x = Pack::set1(c.velocity_offset_x[row]);
+        const V offset_y = Pack::set1(c.velocity_offset_y[row]);
+        const V si2 = Pack::set1(2.0 * c.si[2][row]);
+        const V si3 = Pack::set1(2.0 * c.si[3][row]);
+        const V si4 = Pack::set1(c.si[4][row]);
+        const V si5 = Pack::set1(2.0 * c.si[5][row]);
+        const V si6 = Pack::set1(2.0 * c.si[6][row]);
+        const V si7 = Pack::set1(c.si[7][row]);
+        const V si8 = Pack::set1(2.0 * c.si[8][row]);
+        const V si9 = Pack::set1(c.si[9][row]);
+        for(int j = begin; j < end; j += Pack::SIZE)
+        {
+          V dx = Pack::load(x + j);
+          V dy = Pack::load(y + j);
+          V e0 = dx - px;
+          V e1 = dy - py;
+          V e2 = gain * dx + offset_x - pvx;
+          V e3 = gain * dy + offset_y - pvy;
+          V m = e0 * (si0 * e0 + si1 * e1 + si2 * e2 + si3 * e3) +
+                e1 * (si4 * e1 + si5 * e2 + si6 * e3) +
+                e2 * (si7 * e2 + si8 * e3) +
+                si9 * e3 * e3;
+          Pack::store(distances + j, Pack::finiteOr(Pack::load(detector_term + j) + w * m, invalid));
+        }
+      }
+
+      /** \brief Compute the distances of the first rows tracks from all detections (row-major output). */
+      template <class Pack> inline void
+      computeTrackDistances(const TrackTableColumns& c, int rows, const double* x, const double* y,
+          const double* detector_term, int detections, double motion_weight, double invalid_distance,
+          bool velocity_in_motion_term, double* distances)
+      {
+        int vectorized = detections - detections % Pack::SIZE;
+        for(int row = 0; row < rows; row++)
+        {
+          double* row_distances = distances + static_cast<long>(row) * detections;
+          computeRowDistances<Pack>(c, row, x, y, detector_term, 0, vectorized, motion_weight,
+              invalid_distance, velocity_in_motion_term, row_distances);
+          computeRowDistances<ScalarPack>(c, row, x, y, detector_term, vectorized, detections, motion_weight,
+              invalid_distance, velocity_in_motion_term, row_distances);
+        }
+      }
+    } /* namespace */
+  } /* namespace tracking */
+} /* namespace open_ptrack */
+#endif /* !defined(OPEN_PTRACK_TRACKING_TRACK_TABLE_KERNELS_H_) */
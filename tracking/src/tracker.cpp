@@ -37,6 +37,8 @@
  *
  */
 
+#include <algorithm>
+#include <limits>
 #include <opencv2/opencv.hpp>
 
 #include <open_ptrack/tracking/tracker.h>
@@ -78,7 +80,19 @@ Tracker::Tracker(
   acceleration_variance_(acceleration_variance),
   world_frame_id_(world_frame_id),
   debug_mode_(debug_mode),
-  vertical_(vertical)
+  vertical_(vertical),
+  association_solver_(MUNKRES),
+  filter_backend_(UNSCENTED),
+  track_storage_(TRACK_LIST),
+  state_history_size_(Track::DEFAULT_STATE_HISTORY_SIZE),
+  late_detections_(false),
+  new_frame_latency_(NULL),
+  distance_matrix_latency_(NULL),
+  cost_matrix_latency_(NULL),
+  assignment_latency_(NULL),
+  update_latency_(NULL),
+  lost_tracks_latency_(NULL),
+  track_creation_latency_(NULL)
 {
   tracks_counter_ = 0;
 }
@@ -91,6 +105,8 @@ Tracker::~Tracker()
 void
 Tracker::newFrame(const std::vector<open_ptrack::detection::Detection>& detections)
 {
+  opt_utils::ScopedLatencyTimer timer(new_frame_latency_);
+
   detections_.clear();
   unassociated_detections_.clear();
   lost_tracks_.clear();
@@ -98,7 +114,13 @@ Tracker::newFrame(const std::vector<open_ptrack::detection::Detection>& detectio
   associations_.assign(detections.size(), NULL);
   detections_ = detections;
 
+  // Late batches are associated to the tracks, but the tracks are managed at the latest time:
   ros::Time current_detections_time = detections_[0].getSource()->getTime();
+  late_detections_ = (current_detections_time < latest_detections_time_);
+  if (late_detections_)
+    current_detections_time = latest_detections_time_;
+  else
+    latest_detections_time_ = current_detections_time;
 
   for(std::list<open_ptrack::tracking::Track*>::iterator it = tracks_.begin(); it != tracks_.end();)
   {
@@ -112,8 +134,7 @@ Tracker::newFrame(const std::vector<open_ptrack::detection::Detection>& detectio
       {
         std::cout << "Track " << t->getId() << " DELETED" << std::endl;
       }
-      delete t;
-      it = tracks_.erase(it);
+      it = track_pool_.release(tracks_, it);
       deleted = true;
     }
     else if(!t->isValidated() && t->getUpdatesWithEnoughConfidence() == detections_to_validate_)
@@ -148,16 +169,38 @@ Tracker::newFrame(const std::vector<open_ptrack::detection::Detection>& detectio
 void
 Tracker::updateTracks()
 {
+  opt_utils::ScopedLatencyTimer distance_matrix_timer(distance_matrix_latency_);
   createDistanceMatrix();
-  createCostMatrix();
+  distance_matrix_timer.stop();
 
   // Solve Global Nearest Neighbor problem:
-  Munkres munkres;
-  cost_matrix_ = munkres.solve(cost_matrix_, false);	// rows: targets (tracks), cols: detections
+  if (association_solver_ == SPARSE_LAP)
+  {
+    // Only detection<->track pairs within the gate are given to the solver:
+    opt_utils::ScopedLatencyTimer assignment_timer(assignment_latency_);
+    cost_matrix_ = sparse_assignment_.solve(distance_matrix_, gate_distance_);	// rows: targets (tracks), cols: detections
+  }
+  else
+  {
+    opt_utils::ScopedLatencyTimer cost_matrix_timer(cost_matrix_latency_);
+    createCostMatrix();
+    cost_matrix_timer.stop();
 
+    opt_utils::ScopedLatencyTimer assignment_timer(assignment_latency_);
+    Munkres munkres;
+    cost_matrix_ = munkres.solve(cost_matrix_, false);	// rows: targets (tracks), cols: detections
+  }
+
+  opt_utils::ScopedLatencyTimer update_timer(update_latency_);
   updateDetectedTracks();
   fillUnassociatedDetections();
+  update_timer.stop();
+
+  opt_utils::ScopedLatencyTimer lost_tracks_timer(lost_tracks_latency_);
   updateLostTracks();
+  lost_tracks_timer.stop();
+
+  opt_utils::ScopedLatencyTimer track_creation_timer(track_creation_latency_);
   createNewTracks();
 }
 
@@ -265,13 +308,16 @@ Tracker::createNewTrack(open_ptrack::detection::Detection& detection)
   }
 
   open_ptrack::tracking::Track* t;
-  t = new open_ptrack::tracking::Track(
+  t = track_pool_.create(
+        tracks_,
         ++tracks_counter_,
         world_frame_id_,
         position_variance_,
         acceleration_variance_,
         period_,
-        velocity_in_motion_term_  );
+        velocity_in_motion_term_,
+        filter_backend_);
+  t->setStateHistorySize(state_history_size_);
 
   t->init(detection.getWorldCentroid()(0), detection.getWorldCentroid()(1),detection.getWorldCentroid()(2),
           detection.getHeight(), detection.getDistance(), detection.getSource());
@@ -282,16 +328,157 @@ Tracker::createNewTrack(open_ptrack::detection::Detection& detection)
             detection.getHeight(), detection.getDistance(), 0.0,
             detection.getConfidence(), min_confidence_, min_confidence_detections_, detection.getSource(), first_update);
 
+  // Tracks started by late detections begin at the latest time, like the tracks they have not been associated to:
+  if (late_detections_)
+    t->startAt(latest_detections_time_);
+
   ROS_INFO("Created %d", t->getId());
 
-  tracks_.push_back(t);
   return tracks_counter_;
 }
 
+bool
+Tracker::createGatedDistanceMatrix()
+{
+  // The bound on the motion term holds only for detections referred to the same time instant:
+  if (tracks_.empty() or detections_.empty() or likelihood_weights_[1] <= 0.0)
+    return false;
+  ros::Time when = detections_[0].getSource()->getTime();
+  for(size_t measure = 1; measure < detections_.size(); measure++)
+  {
+    if (detections_[measure].getSource()->getTime() != when)
+      return false;
+  }
+
+  // Compute detector likelihood:
+  std::vector<double> detector_likelihoods(detections_.size(), 0.0);
+  double min_detector_term = std::numeric_limits<double>::infinity();
+  for(size_t measure = 0; measure < detections_.size(); measure++)
+  {
+    if (detector_likelihood_)
+      detector_likelihoods[measure] = detections_[measure].getConfidence();
+    min_detector_term = std::min(min_detector_term, likelihood_weights_[0] * detector_likelihoods[measure]);
+  }
+
+  // Pairs with a Mahalanobis distance greater than this cannot be within the gate:
+  double max_mahalanobis_distance = (gate_distance_ - min_detector_term) / likelihood_weights_[1];
+  if (not std::isfinite(max_mahalanobis_distance))
+    return false;
+
+  // Index the gating regions of the tracks:
+  std::vector<Track*> tracks(tracks_.begin(), tracks_.end());
+  std::vector<double> x(tracks.size()), y(tracks.size()), radius(tracks.size());
+  for(size_t track = 0; track < tracks.size(); track++)
+    radius[track] = tracks[track]->getGatingRadius(max_mahalanobis_distance, when, x[track], y[track]);
+  gating_grid_.build(x, y, radius);
+
+  // Pairs which are not evaluated are out of the gate:
+  distance_matrix_ = 2*gate_distance_;
+  std::vector<int> candidates;
+  for(size_t measure = 0; measure < detections_.size(); measure++)
+  {
+    open_ptrack::detection::Detection& d = detections_[measure];
+    gating_grid_.query(d.getWorldCentroid()(0), d.getWorldCentroid()(1), candidates);
+    for(size_t k = 0; k < candidates.size(); k++)
+    {
+      // Compute motion likelihood:
+      double motion_likelihood = tracks[candidates[k]]->getMahalanobisDistance(
+            d.getWorldCentroid()(0),
+            d.getWorldCentroid()(1),
+            when);
+
+      // Compute joint likelihood and put it in the distance matrix (NaN and inf are left out of the gate):
+      double distance = likelihood_weights_[0] * detector_likelihoods[measure] + likelihood_weights_[1] * motion_likelihood;
+      if (std::isfinite(distance))
+        distance_matrix_(candidates[k], measure) = distance;
+    }
+  }
+
+  return true;
+}
+
+bool
+Tracker::createTableDistanceMatrix()
+{
+  // Tracks are predicted once for all detections, so they have to be referred to the same time instant:
+  if (tracks_.empty() or detections_.empty())
+    return false;
+  ros::Time when = detections_[0].getSource()->getTime();
+  for(size_t measure = 1; measure < detections_.size(); measure++)
+  {
+    if (detections_[measure].getSource()->getTime() != when)
+      return false;
+  }
+
+  // Rows follow the track list, where tracks are only removed or appended, so the rows of the tracks still
+  // alive are found in order and moved over the rows of deleted tracks. Only the rows of tracks whose filter
+  // changed since the previous frame are copied again (times are relative to track_table_epoch_):
+  track_table_.setModel(period_, acceleration_variance_, velocity_in_motion_term_);
+  if (track_table_rows_.empty())
+    track_table_epoch_ = when;
+  track_table_.resize(std::max(track_table_rows_.size(), tracks_.size()));
+  std::vector<TrackTableRow> rows;
+  rows.reserve(tracks_.size());
+  size_t old_row = 0;
+  for(std::list<Track*>::const_iterator it = tracks_.begin(), end = tracks_.end(); it != end; it++)
+  {
+    Track* t = *it;
+    int row = rows.size();
+    while ((old_row < track_table_rows_.size()) and (track_table_rows_[old_row].track != t))
+      old_row++;
+
+    TrackTableRow table_row;
+    table_row.track = t;
+    table_row.filter_revision = t->getFilterRevision();
+    if ((old_row < track_table_rows_.size()) and track_table_rows_[old_row].current and
+        (track_table_rows_[old_row].filter_revision == table_row.filter_revision) and t->hasFilterAt(when))
+    {
+      // Unchanged filter, only the velocity observed with the detections depends on when:
+      if (int(old_row) != row)
+        track_table_.moveRow(old_row, row);
+      if (velocity_in_motion_term_)
+        t->fillTrackTableVelocity(track_table_, row, when);
+      table_row.current = true;
+    }
+    else
+    {
+      table_row.current = t->fillTrackTable(track_table_, row, when, track_table_epoch_);
+    }
+    if (old_row < track_table_rows_.size())
+      old_row++;
+    rows.push_back(table_row);
+  }
+  track_table_rows_.swap(rows);
+  track_table_.resize(tracks_.size());
+  track_table_.predict((when - track_table_epoch_).toSec());
+
+  // Detections as columns:
+  std::vector<double> x(detections_.size()), y(detections_.size()), detector_terms(detections_.size());
+  for(size_t measure = 0; measure < detections_.size(); measure++)
+  {
+    x[measure] = detections_[measure].getWorldCentroid()(0);
+    y[measure] = detections_[measure].getWorldCentroid()(1);
+    detector_terms[measure] = detector_likelihood_ ? likelihood_weights_[0] * detections_[measure].getConfidence() : 0.0;
+  }
+
+  // NaN and inf are replaced by 2*gate_distance_, like in the track list:
+  track_table_.computeDistances(x, y, detector_terms, likelihood_weights_[1], 2*gate_distance_, distance_matrix_[0]);
+  return true;
+}
+
 void
 Tracker::createDistanceMatrix()
 {
   distance_matrix_ = cv::Mat_<double>(tracks_.size(), detections_.size());
+
+  // Compute all distances in batch, if tracks are stored in a table:
+  if ((track_storage_ == TRACK_TABLE) and createTableDistanceMatrix())
+    return;
+
+  // Evaluate only track<->detection pairs which can be within the gate, if possible:
+  if (createGatedDistanceMatrix())
+    return;
+
   int track = 0;
   for(std::list<Track*>::const_iterator it = tracks_.begin(),
       end = tracks_.end(); it != end; it++)
@@ -416,12 +603,18 @@ Tracker::updateDetectedTracks()
           // Update track with the associated detection:
           bool first_update = false;
           associations_[measure] = t;
-          t->update(d.getWorldCentroid()(0), d.getWorldCentroid()(1), d.getWorldCentroid()(2),d.getHeight(),
+          if (not t->update(d.getWorldCentroid()(0), d.getWorldCentroid()(1), d.getWorldCentroid()(2),d.getHeight(),
                     d.getDistance(), distance_matrix_(track, measure),
                     d.getConfidence(), min_confidence_, min_confidence_detections_,
-                    d.getSource(), first_update);
-
-          t->setVisibility(d.isOccluded() ? Track::OCCLUDED : Track::VISIBLE);
+                    d.getSource(), first_update))
+          {
+            ROS_WARN_STREAM_THROTTLE(5.0, "Track " << t->getId() << ": dropped a detection older than its state history ("
+                << (latest_detections_time_ - d.getSource()->getTime()).toSec() << " s late).");
+          }
+
+          // Visibility refers to the latest batch:
+          if (not late_detections_)
+            t->setVisibility(d.isOccluded() ? Track::OCCLUDED : Track::VISIBLE);
           updated = true;
           break;
         }
@@ -431,7 +624,8 @@ Tracker::updateDetectedTracks()
         }
       }
     }
-    if(!updated)
+    // A late batch misses the tracks seen by newer ones, so it cannot tell that a track is not visible:
+    if(!updated and !late_detections_)
     {
       if(t->getVisibility() != Track::NOT_VISIBLE)
       {
@@ -467,7 +661,7 @@ Tracker::fillUnassociatedDetections()
           associated = true;
         }
       }
-      if(!associated/* && detections_[measure].getConfidence() > min_confidence_*/)
+      if(!associated/* && detections_[measure].getConfidence() > min_confidence_*/ && !fuseUnassociatedDetection(measure))
       {
         unassociated_detections_.push_back(detections_[measure]);
       }
@@ -475,6 +669,53 @@ Tracker::fillUnassociatedDetections()
   }
 }
 
+bool
+Tracker::fuseUnassociatedDetection(int measure)
+{
+  // Every detection source sees a target at most once, so only the tracks associated to detections of other sources
+  // can be seen again (the GNN assignment gives a single detection to every track):
+  open_ptrack::detection::Detection& d = detections_[measure];
+  Track* best_track = NULL;
+  int best_row = -1;
+  int track = 0;
+  for(std::list<open_ptrack::tracking::Track*>::iterator it = tracks_.begin(); it != tracks_.end(); it++, track++)
+  {
+    if (distance_matrix_(track, measure) > gate_distance_ or
+        (best_track != NULL and distance_matrix_(track, measure) >= distance_matrix_(best_row, measure)))
+      continue;
+
+    bool associated = false;
+    bool same_source = false;
+    for(size_t other = 0; other < associations_.size(); other++)
+    {
+      if (associations_[other] == *it)
+      {
+        associated = true;
+        same_source = same_source or (detections_[other].getSource() == d.getSource());
+      }
+    }
+    if (associated and not same_source)
+    {
+      best_track = *it;
+      best_row = track;
+    }
+  }
+  if (best_track == NULL)
+    return false;
+
+  // Applied after the detection of the assignment (rolling back the track if the detection is older):
+  associations_[measure] = best_track;
+  bool first_update = false;
+  if (not best_track->update(d.getWorldCentroid()(0), d.getWorldCentroid()(1), d.getWorldCentroid()(2), d.getHeight(),
+      d.getDistance(), distance_matrix_(best_row, measure), d.getConfidence(), min_confidence_,
+      min_confidence_detections_, d.getSource(), first_update))
+  {
+    ROS_WARN_STREAM_THROTTLE(5.0, "Track " << best_track->getId() << ": dropped a detection older than its state history ("
+        << (latest_detections_time_ - d.getSource()->getTime()).toSec() << " s late).");
+  }
+  return true;
+}
+
 void
 Tracker::updateLostTracks()
 {
@@ -485,10 +726,42 @@ Tracker::updateLostTracks()
 void
 Tracker::createNewTracks()
 {
+  // Tracks created in this round, with the sources of their detections:
+  std::vector<Track*> created_tracks;
+  std::vector<std::vector<open_ptrack::detection::DetectionSource*> > created_sources;
+
   for(std::list<open_ptrack::detection::Detection>::iterator dit = unassociated_detections_.begin();
       dit != unassociated_detections_.end(); dit++)
   {
-    createNewTrack(*dit);
+    // A target seen by several sources of a fusion window starts a single track, updated by the other sources:
+    int best = -1;
+    double best_distance = gate_distance_;
+    for(size_t i = 0; i < created_tracks.size(); i++)
+    {
+      if (std::find(created_sources[i].begin(), created_sources[i].end(), dit->getSource()) != created_sources[i].end())
+        continue;
+      double distance = likelihood_weights_[0] * (detector_likelihood_ ? dit->getConfidence() : 0.0) +
+          likelihood_weights_[1] * created_tracks[i]->getMahalanobisDistance(dit->getWorldCentroid()(0),
+          dit->getWorldCentroid()(1), dit->getSource()->getTime());
+      if (distance <= best_distance)
+      {
+        best = i;
+        best_distance = distance;
+      }
+    }
+    if (best >= 0)
+    {
+      bool first_update = false;
+      created_tracks[best]->update(dit->getWorldCentroid()(0), dit->getWorldCentroid()(1), dit->getWorldCentroid()(2),
+          dit->getHeight(), dit->getDistance(), best_distance, dit->getConfidence(), min_confidence_,
+          min_confidence_detections_, dit->getSource(), first_update);
+      created_sources[best].push_back(dit->getSource());
+    }
+    else if (createNewTrack(*dit) >= 0)
+    {
+      created_tracks.push_back(tracks_.back());
+      created_sources.push_back(std::vector<open_ptrack::detection::DetectionSource*>(1, dit->getSource()));
+    }
   }
 }
 
@@ -581,5 +854,48 @@ Tracker::setGateDistance (double gate_distance)
 {
   gate_distance_ = gate_distance;
 }
+
+void
+Tracker::setAssociationSolver (AssociationSolver association_solver)
+{
+  association_solver_ = association_solver;
+}
+
+void
+Tracker::setAssociationThreads (int threads)
+{
+  sparse_assignment_.setNumThreads(threads);
+}
+
+void
+Tracker::setFilterBackend (FilterBackend filter_backend)
+{
+  filter_backend_ = filter_backend;
+}
+
+void
+Tracker::setTrackStorage (TrackStorage track_storage)
+{
+  track_storage_ = track_storage;
+}
+
+void
+Tracker::setStateHistorySize (size_t state_history_size)
+{
+  state_history_size_ = state_history_size;
+}
+
+void
+Tracker::setLatencyProfiler (opt_utils::LatencyProfiler* profiler)
+{
+  bool enabled = (profiler != NULL);
+  new_frame_latency_ = enabled ? profiler->getHistogram("tracker/new_frame") : NULL;
+  distance_matrix_latency_ = enabled ? profiler->getHistogram("tracker/distance_matrix") : NULL;
+  cost_matrix_latency_ = enabled ? profiler->getHistogram("tracker/cost_matrix") : NULL;
+  assignment_latency_ = enabled ? profiler->getHistogram("tracker/assignment") : NULL;
+  update_latency_ = enabled ? profiler->getHistogram("tracker/update") : NULL;
+  lost_tracks_latency_ = enabled ? profiler->getHistogram("tracker/lost_tracks") : NULL;
+  track_creation_latency_ = enabled ? profiler->getHistogram("tracker/track_creation") : NULL;
+}
 } /* namespace tracking */
 } /* namespace open_ptrack */
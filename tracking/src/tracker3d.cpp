@@ -37,6 +37,7 @@
  *
  */
 
+#include <limits>
 #include <opencv2/opencv.hpp>
 
 #include <open_ptrack/tracking/tracker3d.h>
@@ -78,7 +79,9 @@ Tracker3D::Tracker3D(
   acceleration_variance_(acceleration_variance),
   world_frame_id_(world_frame_id),
   debug_mode_(debug_mode),
-  vertical_(vertical)
+  vertical_(vertical),
+  association_solver_(MUNKRES),
+  filter_backend_(UNSCENTED)
 {
   tracks_counter_ = 0;
 }
@@ -148,11 +151,19 @@ void
 Tracker3D::updateTracks()
 {
   createDistanceMatrix();
-  createCostMatrix();
 
   // Solve Global Nearest Neighbor problem:
-  Munkres munkres;
-  cost_matrix_ = munkres.solve(cost_matrix_, false);	// rows: targets (tracks), cols: detections
+  if (association_solver_ == SPARSE_LAP)
+  {
+    // Only detection<->track pairs within the gate are given to the solver:
+    cost_matrix_ = sparse_assignment_.solve(distance_matrix_, gate_distance_);	// rows: targets (tracks), cols: detections
+  }
+  else
+  {
+    createCostMatrix();
+    Munkres munkres;
+    cost_matrix_ = munkres.solve(cost_matrix_, false);	// rows: targets (tracks), cols: detections
+  }
 
   updateDetectedTracks();
   fillUnassociatedDetections();
@@ -255,7 +266,8 @@ Tracker3D::createNewTrack(open_ptrack::detection::Detection& detection)
         position_variance_,
         acceleration_variance_,
         period_,
-        velocity_in_motion_term_  );
+        velocity_in_motion_term_,
+        filter_backend_);
 
   t->init(detection.getWorldCentroid()(0), detection.getWorldCentroid()(1),detection.getWorldCentroid()(2),
           detection.getHeight(), detection.getDistance(), detection.getSource());
@@ -271,10 +283,76 @@ Tracker3D::createNewTrack(open_ptrack::detection::Detection& detection)
   return tracks_counter_;
 }
 
+bool
+Tracker3D::createGatedDistanceMatrix()
+{
+  // The bound on the motion term holds only for detections referred to the same time instant:
+  if (tracks_.empty() or detections_.empty() or likelihood_weights_[1] <= 0.0)
+    return false;
+  ros::Time when = detections_[0].getSource()->getTime();
+  for(size_t measure = 1; measure < detections_.size(); measure++)
+  {
+    if (detections_[measure].getSource()->getTime() != when)
+      return false;
+  }
+
+  // Compute detector likelihood:
+  std::vector<double> detector_likelihoods(detections_.size(), 0.0);
+  double min_detector_term = std::numeric_limits<double>::infinity();
+  for(size_t measure = 0; measure < detections_.size(); measure++)
+  {
+    if (detector_likelihood_)
+      detector_likelihoods[measure] = detections_[measure].getConfidence();
+    min_detector_term = std::min(min_detector_term, likelihood_weights_[0] * detector_likelihoods[measure]);
+  }
+
+  // Pairs with a Mahalanobis distance greater than this cannot be within the gate:
+  double max_mahalanobis_distance = (gate_distance_ - min_detector_term) / likelihood_weights_[1];
+  if (not std::isfinite(max_mahalanobis_distance))
+    return false;
+
+  // Index the gating regions of the tracks:
+  std::vector<Track3D*> tracks(tracks_.begin(), tracks_.end());
+  std::vector<double> x(tracks.size()), y(tracks.size()), radius(tracks.size());
+  for(size_t track = 0; track < tracks.size(); track++)
+    radius[track] = tracks[track]->getGatingRadius(max_mahalanobis_distance, when, x[track], y[track]);
+  gating_grid_.build(x, y, radius);
+
+  // Pairs which are not evaluated are out of the gate:
+  distance_matrix_ = 2*gate_distance_;
+  std::vector<int> candidates;
+  for(size_t measure = 0; measure < detections_.size(); measure++)
+  {
+    open_ptrack::detection::Detection& d = detections_[measure];
+    gating_grid_.query(d.getWorldCentroid()(0), d.getWorldCentroid()(1), candidates);
+    for(size_t k = 0; k < candidates.size(); k++)
+    {
+      // Compute motion likelihood:
+      double motion_likelihood = tracks[candidates[k]]->getMahalanobisDistance(
+            d.getWorldCentroid()(0),
+            d.getWorldCentroid()(1),
+            d.getWorldCentroid()(2),
+            when);
+
+      // Compute joint likelihood and put it in the distance matrix (NaN and inf are left out of the gate):
+      double distance = likelihood_weights_[0] * detector_likelihoods[measure] + likelihood_weights_[1] * motion_likelihood;
+      if (std::isfinite(distance))
+        distance_matrix_(candidates[k], measure) = distance;
+    }
+  }
+
+  return true;
+}
+
 void
 Tracker3D::createDistanceMatrix()
 {
   distance_matrix_ = cv::Mat_<double>(tracks_.size(), detections_.size());
+
+  // Evaluate only track<->detection pairs which can be within the gate, if possible:
+  if (createGatedDistanceMatrix())
+    return;
+
   int track = 0;
   for(std::list<Track3D*>::const_iterator it = tracks_.begin(),
       end = tracks_.end(); it != end; it++)
@@ -564,5 +642,23 @@ Tracker3D::setGateDistance (double gate_distance)
 {
   gate_distance_ = gate_distance;
 }
+
+void
+Tracker3D::setAssociationSolver (AssociationSolver association_solver)
+{
+  association_solver_ = association_solver;
+}
+
+void
+Tracker3D::setAssociationThreads (int threads)
+{
+  sparse_assignment_.setNumThreads(threads);
+}
+
+void
+Tracker3D::setFilterBackend (FilterBackend filter_backend)
+{
+  filter_backend_ = filter_backend;
+}
 } /* namespace tracking */
 } /* namespace open_ptrack */
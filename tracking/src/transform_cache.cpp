@@ -0,0 +1,129 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <open_ptrack/tracking/transform_cache.h>
+
+namespace open_ptrack
+{
+  namespace tracking
+  {
+    TransformCache::TransformCache(tf::TransformListener* tf_listener, const std::string& world_frame_id,
+        double lifetime) :
+        tf_listener_(tf_listener), world_frame_id_(world_frame_id), lifetime_(lifetime)
+    {
+
+    }
+
+    void
+    TransformCache::subscribe(ros::NodeHandle& nh)
+    {
+      static_transform_sub_ = nh.subscribe("/tf_static", 10, &TransformCache::staticTransformCallback, this);
+    }
+
+    void
+    TransformCache::getTransforms(const std::string& frame_id, tf::StampedTransform& transform,
+        tf::StampedTransform& inverse_transform)
+    {
+      ros::Time now = ros::Time::now();
+      std::lock_guard<std::mutex> lock(mutex_);
+
+      std::map<std::string, CameraTransforms>::iterator it = transforms_.find(frame_id);
+      if ((it != transforms_.end()) and ((now - it->second.lookup_time) < lifetime_))
+      {
+        transform = it->second.transform;
+        inverse_transform = it->second.inverse_transform;
+        return;
+      }
+
+      // Calculate direct and inverse transforms between camera and world frame:
+      CameraTransforms& cached = transforms_[frame_id];
+      try
+      {
+        tf_listener_->lookupTransform(world_frame_id_, frame_id, ros::Time(0), cached.transform);
+        tf_listener_->lookupTransform(frame_id, world_frame_id_, ros::Time(0), cached.inverse_transform);
+      }
+      catch(tf::TransformException& ex)
+      {
+        transforms_.erase(frame_id);
+        throw;
+      }
+      cached.lookup_time = now;
+
+      transform = cached.transform;
+      inverse_transform = cached.inverse_transform;
+    }
+
+    bool
+    TransformCache::getRegistrationMatrix(const std::string& frame_id, Eigen::Matrix4d& matrix)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      RegistrationMap::const_iterator it = registration_matrices_.find(frame_id);
+      if (it == registration_matrices_.end())
+        return false;
+
+      matrix = it->second;
+      return true;
+    }
+
+    void
+    TransformCache::setRegistrationMatrix(const std::string& frame_id, const Eigen::Matrix4d& matrix)
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      registration_matrices_[frame_id] = matrix;
+    }
+
+    void
+    TransformCache::invalidateTransforms()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      transforms_.clear();
+    }
+
+    void
+    TransformCache::invalidateRegistrationMatrices()
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      registration_matrices_.clear();
+    }
+
+    void
+    TransformCache::staticTransformCallback(const tf::tfMessage::ConstPtr& msg)
+    {
+      // Any transform of the chain between a camera and the world frame may have changed:
+      invalidateTransforms();
+    }
+  } /* namespace tracking */
+} /* namespace open_ptrack */
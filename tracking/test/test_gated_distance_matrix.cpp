@@ -0,0 +1,269 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <list>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <open_ptrack/tracking/tracker.h>
+
+using open_ptrack::detection::Detection;
+using open_ptrack::detection::DetectionSource;
+using open_ptrack::tracking::Tracker;
+
+namespace
+{
+  const double PERIOD = 1.0 / 30.0;
+  const double GATE_DISTANCE = 18.467;
+
+  std::vector<double>
+  coordinates(double a, double b)
+  {
+    std::vector<double> c;
+    c.push_back(a);
+    c.push_back(b);
+    return c;
+  }
+
+  /** \brief Tracker with the parameters of conf/tracker.yaml, whose distance matrix is computed with or without gating. */
+  class GatingTracker : public Tracker
+  {
+    public:
+      GatingTracker(bool gating) :
+        Tracker(GATE_DISTANCE, true, coordinates(-0.25, 0.25), true, 0.0, -2.5, 8.0, 2.4, 1.2, 3, PERIOD, 0.05, 100.0,
+            "/world", false, false),
+        gating_(gating),
+        gated_(false)
+      {
+
+      }
+
+      /** \brief Distance matrix of the last frame. */
+      const cv::Mat_<double>&
+      getDistanceMatrix() const
+      {
+        return distances_;
+      }
+
+      /** \brief True if the distance matrix of the last frame has been computed with gating. */
+      bool
+      isGated() const
+      {
+        return gated_;
+      }
+
+      double
+      getCellSize() const
+      {
+        return gating_grid_.getCellSize();
+      }
+
+    protected:
+      virtual void
+      createDistanceMatrix()
+      {
+        gated_ = false;
+        Tracker::createDistanceMatrix();
+        distances_ = distance_matrix_.clone();
+      }
+
+      virtual bool
+      createGatedDistanceMatrix()
+      {
+        gated_ = gating_ and Tracker::createGatedDistanceMatrix();
+        return gated_;
+      }
+
+      bool gating_;
+      bool gated_;
+      cv::Mat_<double> distances_;
+  };
+
+  /** \brief Feeds the same batches of detections to a tracker with gating and to one without. */
+  class GatedDistanceMatrixTest : public ::testing::Test
+  {
+    protected:
+      GatedDistanceMatrixTest() :
+        gated_(true),
+        full_(false)
+      {
+
+      }
+
+      /** \brief Process a batch of detections at (x[i], y[i]) with confidence[i] observed at a time instant. */
+      void
+      track(GatingTracker& tracker, double time, const std::vector<double>& x, const std::vector<double>& y,
+          const std::vector<double>& confidence)
+      {
+        ros::Time stamp(time);
+        tf::StampedTransform transform(tf::Transform::getIdentity(), stamp, "/world", "/camera");
+        tf::StampedTransform inverse_transform(tf::Transform::getIdentity(), stamp, "/camera", "/world");
+        sources_.push_back(new DetectionSource(cv::Mat(0, 0, CV_8UC3), transform, inverse_transform,
+            Eigen::Matrix3d::Identity(), stamp, "/camera"));
+
+        std::vector<Detection> detections;
+        for(size_t i = 0; i < x.size(); i++)
+        {
+          opt_msgs::Detection detection;
+          detection.centroid.x = x[i];
+          detection.centroid.y = y[i];
+          detection.centroid.z = 0.9;
+          detection.top = detection.centroid;
+          detection.top.z = 1.8;
+          detection.bottom = detection.centroid;
+          detection.bottom.z = 0.0;
+          detection.height = 1.8;
+          detection.confidence = confidence[i];
+          detection.distance = 3.0;
+          detection.occluded = false;
+          detections.push_back(Detection(detection, sources_.back()));
+        }
+        tracker.newFrame(detections);
+        tracker.updateTracks();
+      }
+
+      virtual void
+      TearDown()
+      {
+        for(std::list<DetectionSource*>::iterator it = sources_.begin(); it != sources_.end(); it++)
+          delete *it;
+      }
+
+      GatingTracker gated_;
+      GatingTracker full_;
+      std::list<DetectionSource*> sources_;
+  };
+} /* namespace */
+
+TEST_F(GatedDistanceMatrixTest, SameDistancesAndAssociationsOfTheFullMatrix)
+{
+  // Cell size of the grid for tracks detected in most frames (the median gating radius):
+  GatingTracker calibration(true);
+  for(int frame = 0; frame < 10; frame++)
+    track(calibration, 10.0 + frame * PERIOD, coordinates(0.0, 5.0), coordinates(0.0, 5.0), coordinates(1.0, 1.0));
+  const double cell = calibration.getCellSize();
+
+  // People at the corners of the cells, some still and some walking, so that tracks and detections fall on both sides
+  // of the cell borders:
+  std::mt19937 random(42);
+  std::uniform_real_distribution<double> jitter(-0.01 * cell, 0.01 * cell);
+  std::uniform_real_distribution<double> speed(-0.5, 0.5);
+  std::uniform_real_distribution<double> noise(-0.05, 0.05);
+  std::uniform_real_distribution<double> confidence(0.5, 2.0);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<double> people_x, people_y, people_vx, people_vy;
+  for(int i = 0; i < 6; i++)
+  {
+    for(int j = 0; j < 6; j++)
+    {
+      people_x.push_back(i * cell + jitter(random));
+      people_y.push_back(j * cell + jitter(random));
+      bool walking = uniform(random) < 0.5;
+      people_vx.push_back(walking ? speed(random) : 0.0);
+      people_vy.push_back(walking ? speed(random) : 0.0);
+    }
+  }
+
+  int gated_frames = 0;
+  for(int frame = 0; frame < 90; frame++)
+  {
+    // People are missed in some frames (their gating regions grow), and there are false detections on the borders:
+    double t = frame * PERIOD;
+    std::vector<double> x, y, c;
+    for(size_t k = 0; k < people_x.size(); k++)
+    {
+      if (uniform(random) < 0.2)
+        continue;
+      x.push_back(people_x[k] + people_vx[k] * t + noise(random));
+      y.push_back(people_y[k] + people_vy[k] * t + noise(random));
+      c.push_back(confidence(random));
+    }
+    for(int k = 0; k < 4; k++)
+    {
+      x.push_back(int(uniform(random) * 6) * cell + jitter(random));
+      y.push_back(uniform(random) * 5 * cell);
+      c.push_back(confidence(random) - 1.5);
+    }
+
+    track(gated_, 10.0 + t, x, y, c);
+    track(full_, 10.0 + t, x, y, c);
+    if (gated_.isGated())
+      gated_frames++;
+    ASSERT_FALSE(full_.isGated());
+
+    // Pairs within the gate have the same distance, the others are out of the gate in both matrices:
+    const cv::Mat_<double>& gated = gated_.getDistanceMatrix();
+    const cv::Mat_<double>& full = full_.getDistanceMatrix();
+    ASSERT_EQ(full.rows, gated.rows) << "frame " << frame;
+    ASSERT_EQ(full.cols, gated.cols) << "frame " << frame;
+    for(int i = 0; i < full.rows; i++)
+    {
+      for(int j = 0; j < full.cols; j++)
+      {
+        if (full(i, j) <= GATE_DISTANCE)
+          EXPECT_EQ(full(i, j), gated(i, j)) << "frame " << frame << ", track " << i << ", detection " << j;
+        else
+          EXPECT_GT(gated(i, j), GATE_DISTANCE) << "frame " << frame << ", track " << i << ", detection " << j;
+      }
+    }
+
+    // Same associations and tracks:
+    opt_msgs::Association::Ptr gated_associations(new opt_msgs::Association);
+    opt_msgs::Association::Ptr full_associations(new opt_msgs::Association);
+    gated_.getAssociationResult(gated_associations);
+    full_.getAssociationResult(full_associations);
+    ASSERT_EQ(full_associations->track_ids, gated_associations->track_ids) << "frame " << frame;
+
+    opt_msgs::IDArray::Ptr gated_ids(new opt_msgs::IDArray);
+    opt_msgs::IDArray::Ptr full_ids(new opt_msgs::IDArray);
+    gated_.getAliveIDs(gated_ids);
+    full_.getAliveIDs(full_ids);
+    ASSERT_EQ(full_ids->ids, gated_ids->ids) << "frame " << frame;
+  }
+
+  // Every frame after the first one has tracks to gate:
+  EXPECT_EQ(89, gated_frames);
+}
+
+int
+main(int argc, char** argv)
+{
+  // Time is needed by the throttled log messages of the tracker:
+  ros::Time::init();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,172 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <opencv2/opencv.hpp>
+#include <open_ptrack/tracking/munkres.h>
+#include <open_ptrack/tracking/sparse_assignment.h>
+
+using open_ptrack::tracking::Munkres;
+using open_ptrack::tracking::SparseAssignment;
+
+namespace
+{
+  const double GATE_DISTANCE = 18.467;
+
+  /** \brief Associations of the Tracker with the Munkres solver: assigned pairs within the gate. */
+  std::vector<int>
+  solveWithMunkres(const cv::Mat_<double>& distance_matrix)
+  {
+    cv::Mat_<double> cost_matrix = distance_matrix.clone();
+    for(int i = 0; i < cost_matrix.rows; i++)
+    {
+      for(int j = 0; j < cost_matrix.cols; j++)
+      {
+        if (cost_matrix(i, j) > GATE_DISTANCE)
+          cost_matrix(i, j) = 1000000.0;
+      }
+    }
+
+    Munkres munkres;
+    cv::Mat_<double> assignment = munkres.solve(cost_matrix, false);
+    std::vector<int> row_to_col(distance_matrix.rows, -1);
+    for(int i = 0; i < distance_matrix.rows; i++)
+    {
+      for(int j = 0; j < distance_matrix.cols; j++)
+      {
+        if ((assignment(i, j) == 0.0) and (distance_matrix(i, j) <= GATE_DISTANCE))
+          row_to_col[i] = j;
+      }
+    }
+    return row_to_col;
+  }
+
+  /** \brief Associations of the Tracker with the sparse solver. */
+  std::vector<int>
+  solveWithSparseAssignment(SparseAssignment& solver, const cv::Mat_<double>& distance_matrix)
+  {
+    cv::Mat_<double> assignment = solver.solve(distance_matrix, GATE_DISTANCE);
+    std::vector<int> row_to_col(distance_matrix.rows, -1);
+    for(int i = 0; i < distance_matrix.rows; i++)
+    {
+      for(int j = 0; j < distance_matrix.cols; j++)
+      {
+        if (assignment(i, j) == 0.0)
+        {
+          EXPECT_EQ(-1, row_to_col[i]) << "row " << i << " assigned twice";
+          EXPECT_LE(distance_matrix(i, j), GATE_DISTANCE);
+          row_to_col[i] = j;
+        }
+      }
+    }
+    return row_to_col;
+  }
+
+  /** \brief Distances of tracks and detections on a line: most pairs are out of the gate, as in a crowd. */
+  cv::Mat_<double>
+  createDistanceMatrix(int rows, int cols, std::mt19937& random)
+  {
+    std::uniform_real_distribution<double> position(0.0, 4.0 * std::max(rows, cols));
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    std::vector<double> tracks(rows);
+    for(int i = 0; i < rows; i++)
+      tracks[i] = position(random);
+
+    cv::Mat_<double> distance_matrix(rows, cols);
+    for(int j = 0; j < cols; j++)
+    {
+      double detection = (j < rows) ? tracks[j] + noise(random) : position(random);
+      for(int i = 0; i < rows; i++)
+        distance_matrix(i, j) = -2.0 + 5.0 * (tracks[i] - detection) * (tracks[i] - detection) + noise(random);
+    }
+    return distance_matrix;
+  }
+} /* namespace */
+
+TEST(SparseAssignmentTest, SameAssociationsOfMunkresOnAFixedMatrix)
+{
+  // Rows 0 and 1 compete for column 0, row 2 has no admissible column:
+  double values[3][4] = {
+    {  1.0,  3.0, 50.0, 50.0},
+    {  2.0, 50.0, 50.0, 10.0},
+    { 30.0, 40.0, 19.0, 50.0}};
+  cv::Mat_<double> distance_matrix(3, 4);
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 4; j++)
+      distance_matrix(i, j) = values[i][j];
+
+  SparseAssignment solver;
+  std::vector<int> row_to_col = solveWithSparseAssignment(solver, distance_matrix);
+  EXPECT_EQ(solveWithMunkres(distance_matrix), row_to_col);
+  EXPECT_EQ(1, row_to_col[0]);
+  EXPECT_EQ(0, row_to_col[1]);
+  EXPECT_EQ(-1, row_to_col[2]);
+}
+
+TEST(SparseAssignmentTest, SameAssociationsOfMunkres)
+{
+  std::mt19937 random(42);
+  SparseAssignment solver;
+  for(int rows = 0; rows <= 12; rows++)
+  {
+    for(int cols = 0; cols <= 12; cols++)
+    {
+      for(int trial = 0; trial < 5; trial++)
+      {
+        cv::Mat_<double> distance_matrix = createDistanceMatrix(rows, cols, random);
+        EXPECT_EQ(solveWithMunkres(distance_matrix), solveWithSparseAssignment(solver, distance_matrix))
+            << rows << "x" << cols << " matrix, trial " << trial;
+      }
+    }
+  }
+}
+
+TEST(SparseAssignmentTest, SameAssociationsOfMunkresWithParallelComponents)
+{
+  std::mt19937 random(7);
+  SparseAssignment solver;
+  solver.setNumThreads(4);
+  solver.setParallelComponentSize(1);
+  for(int trial = 0; trial < 50; trial++)
+  {
+    cv::Mat_<double> distance_matrix = createDistanceMatrix(40, 45, random);
+    EXPECT_EQ(solveWithMunkres(distance_matrix), solveWithSparseAssignment(solver, distance_matrix))
+        << "trial " << trial;
+  }
+  EXPECT_GT(solver.getNumComponents(), 1);
+}
@@ -0,0 +1,167 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+#include <gtest/gtest.h>
+#include <open_ptrack/tracking/track_table.h>
+
+using open_ptrack::tracking::ClosedFormKalmanFilter;
+using open_ptrack::tracking::TrackTable;
+
+namespace
+{
+  const double PERIOD = 1.0 / 30.0;
+  const double ACCELERATION_VARIANCE = 100.0;
+  const double INVALID_DISTANCE = 1000.0;
+
+  /** \brief Filter of a track updated a random number of times, with position or position and velocity. */
+  ClosedFormKalmanFilter<2>
+  createFilter(std::mt19937& random)
+  {
+    std::uniform_real_distribution<double> position(-10.0, 10.0);
+    std::uniform_real_distribution<double> velocity(-1.5, 1.5);
+    std::uniform_real_distribution<double> noise(-0.1, 0.1);
+    std::uniform_int_distribution<int> updates(0, 20);
+
+    ClosedFormKalmanFilter<2> filter;
+    filter.setPredictModel(PERIOD, ACCELERATION_VARIANCE);
+    for(int i = 0; i < 4; i++)
+      filter.setObservationVariance(i, i < 2 ? 0.05 : 0.2);
+    ClosedFormKalmanFilter<2>::StateVector x;
+    x << position(random), position(random), velocity(random), velocity(random);
+    filter.init(x, ClosedFormKalmanFilter<2>::StateMatrix::Identity());
+
+    for(int k = updates(random); k > 0; k--)
+    {
+      filter.predict();
+      x(0) += x(2) * PERIOD;
+      x(1) += x(3) * PERIOD;
+      if (k % 3 == 0)
+      {
+        Eigen::Vector2d z(x(0) + noise(random), x(1) + noise(random));
+        filter.observe(z);
+      }
+      else
+      {
+        Eigen::Vector4d z(x(0) + noise(random), x(1) + noise(random), x(2) + noise(random), x(3) + noise(random));
+        filter.observe(z);
+      }
+    }
+    return filter;
+  }
+
+  /** \brief Fill a table with the same random tracks as another one, updated at different times before when. */
+  void
+  fillTable(TrackTable& table, int tracks, double when, bool velocity_in_motion_term, unsigned int seed)
+  {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> age(0.0, 0.5);
+    std::uniform_real_distribution<double> gain(0.5, 1.5);
+    std::uniform_real_distribution<double> offset(-5.0, 5.0);
+    table.setModel(PERIOD, ACCELERATION_VARIANCE, velocity_in_motion_term);
+    table.resize(tracks);
+    for(int row = 0; row < tracks; row++)
+    {
+      // Some tracks are updated now, one of them after when:
+      double time = (row % 4 == 0) ? when : when - age(random);
+      if (row == 1)
+        time = when + PERIOD;
+      table.setTrack(row, createFilter(random), time, gain(random), offset(random), offset(random));
+    }
+  }
+} /* namespace */
+
+TEST(TrackTableTest, SimdKernelsMatchScalarKernels)
+{
+  // Track and detection counts which are not multiples of the vector width, so that padding rows and the scalar
+  // tail of the detections are used (with a CPU without SIMD kernels, scalar kernels are compared to themselves):
+  const int track_counts[] = {1, 2, 3, 5, 6, 7, 9, 13};
+  const int detection_counts[] = {1, 3, 4, 5, 7, 11};
+  const double when = 3.0;
+  std::mt19937 random(7);
+  std::uniform_real_distribution<double> position(-10.0, 10.0);
+  std::uniform_real_distribution<double> confidence(-0.5, 0.5);
+
+  for(int velocity = 0; velocity < 2; velocity++)
+  {
+    for(int t = 0; t < 8; t++)
+    {
+      for(int d = 0; d < 6; d++)
+      {
+        const int tracks = track_counts[t], detections = detection_counts[d];
+        std::vector<double> x(detections), y(detections), detector_term(detections);
+        for(int j = 0; j < detections; j++)
+        {
+          x[j] = position(random);
+          y[j] = position(random);
+          detector_term[j] = confidence(random);
+        }
+        // An invalid detection, in the scalar tail if there is one:
+        if (detections > 4)
+          x[detections - 1] = std::numeric_limits<double>::quiet_NaN();
+
+        TrackTable simd_table, scalar_table;
+        scalar_table.setScalarKernels(true);
+        fillTable(simd_table, tracks, when, velocity, 100 * t + d);
+        fillTable(scalar_table, tracks, when, velocity, 100 * t + d);
+        simd_table.predict(when);
+        scalar_table.predict(when);
+        std::vector<double> simd_distances(tracks * detections), scalar_distances(tracks * detections);
+        simd_table.computeDistances(x, y, detector_term, 0.25, INVALID_DISTANCE, &simd_distances[0]);
+        scalar_table.computeDistances(x, y, detector_term, 0.25, INVALID_DISTANCE, &scalar_distances[0]);
+
+        // Same distances, up to the rounding of fused multiply-adds:
+        for(int i = 0; i < tracks * detections; i++)
+        {
+          ASSERT_TRUE(std::isfinite(scalar_distances[i]));
+          EXPECT_NEAR(scalar_distances[i], simd_distances[i], 1e-9 * std::max(1.0, std::abs(scalar_distances[i])))
+              << TrackTable::getInstructionSet() << " kernels, " << tracks << " tracks, " << detections
+              << " detections, velocity " << velocity << ", track " << i / detections << ", detection "
+              << i % detections;
+        }
+        if (detections > 4)
+        {
+          for(int row = 0; row < tracks; row++)
+            EXPECT_EQ(INVALID_DISTANCE, simd_distances[row * detections + detections - 1]);
+        }
+      }
+    }
+  }
+}
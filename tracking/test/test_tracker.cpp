@@ -0,0 +1,313 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ * Copyright (c) 2013-, Open Perception, Inc.
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following
+ * disclaimer in the documentation and/or other materials provided
+ * with the distribution.
+ * * Neither the name of the copyright holder(s) nor the names of its
+ * contributors may be used to endorse or promote products derived
+ * from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ * ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ */
+
+#include <list>
+#include <vector>
+#include <gtest/gtest.h>
+#include <open_ptrack/tracking/tracker.h>
+
+using open_ptrack::detection::Detection;
+using open_ptrack::detection::DetectionSource;
+using open_ptrack::tracking::Track;
+using open_ptrack::tracking::Tracker;
+
+namespace
+{
+  const double PERIOD = 1.0 / 30.0;
+
+  std::vector<double>
+  coordinates(double a, double b)
+  {
+    std::vector<double> c;
+    c.push_back(a);
+    c.push_back(b);
+    return c;
+  }
+
+  /** \brief Tracker with the parameters of conf/tracker.yaml and access to its tracks. */
+  class TestTracker : public Tracker
+  {
+    public:
+      TestTracker() :
+        Tracker(18.467, true, coordinates(-0.25, 0.25), true, 0.0, -2.5, 8.0, 2.4, 1.2, 3, PERIOD, 0.05, 100.0,
+            "/world", false, false)
+      {
+
+      }
+
+      const std::list<Track*>&
+      getTracks() const
+      {
+        return tracks_;
+      }
+  };
+
+  /** \brief Feeds batches of detections of people standing still to a tracker. */
+  class TrackerTest : public ::testing::Test
+  {
+    protected:
+      /** \brief Create the source of a batch of detections of a camera, observed at a time instant. */
+      DetectionSource*
+      createSource(double time, const std::string& frame_id = "/camera")
+      {
+        // Tracks keep a pointer to the source of their last detection, so every batch has its own:
+        ros::Time stamp(time);
+        tf::StampedTransform transform(tf::Transform::getIdentity(), stamp, "/world", frame_id);
+        tf::StampedTransform inverse_transform(tf::Transform::getIdentity(), stamp, frame_id, "/world");
+        sources_.push_back(new DetectionSource(cv::Mat(0, 0, CV_8UC3), transform, inverse_transform,
+            Eigen::Matrix3d::Identity(), stamp, frame_id));
+        return sources_.back();
+      }
+
+      /** \brief Append the detections at (x[i], y[i]) of a source to a batch. */
+      void
+      addDetections(DetectionSource* source, const std::vector<double>& x, const std::vector<double>& y,
+          std::vector<Detection>& detections)
+      {
+        for(size_t i = 0; i < x.size(); i++)
+        {
+          opt_msgs::Detection detection;
+          detection.centroid.x = x[i];
+          detection.centroid.y = y[i];
+          detection.centroid.z = 0.9;
+          detection.top = detection.centroid;
+          detection.top.z = 1.8;
+          detection.bottom = detection.centroid;
+          detection.bottom.z = 0.0;
+          detection.height = 1.8;
+          detection.confidence = 1.0;
+          detection.distance = 3.0;
+          detection.occluded = false;
+          detections.push_back(Detection(detection, source));
+        }
+      }
+
+      /** \brief Process a batch of detections at (x[i], y[i]) observed at a time instant. */
+      void
+      track(double time, const std::vector<double>& x, const std::vector<double>& y)
+      {
+        track(tracker_, time, x, y);
+      }
+
+      /** \brief Process a batch of detections at (x[i], y[i]) observed at a time instant with another tracker. */
+      void
+      track(TestTracker& tracker, double time, const std::vector<double>& x, const std::vector<double>& y)
+      {
+        std::vector<Detection> detections;
+        addDetections(createSource(time), x, y, detections);
+        tracker.newFrame(detections);
+        tracker.updateTracks();
+      }
+
+      /** \brief Process the batch of a frame of two people walking across each other. */
+      void
+      walk(TestTracker& tracker, int frame)
+      {
+        double t = frame * PERIOD;
+        track(tracker, 10.0 + t, coordinates(-2.0 + 0.8 * t, 1.0 - 0.2 * t), coordinates(1.0 + 0.3 * t, 3.0 - 0.6 * t));
+      }
+
+      /** \brief Check that the tracks of two trackers have the same position and uncertainty at a time instant. */
+      void
+      expectSameTracks(TestTracker& expected, TestTracker& actual, const ros::Time& when, double tolerance)
+      {
+        ASSERT_EQ(expected.getTracks().size(), actual.getTracks().size());
+        std::list<Track*>::const_iterator e = expected.getTracks().begin();
+        std::list<Track*>::const_iterator a = actual.getTracks().begin();
+        for(; e != expected.getTracks().end(); e++, a++)
+        {
+          opt_msgs::Track expected_msg, actual_msg;
+          (*e)->toMsg(expected_msg, false);
+          (*a)->toMsg(actual_msg, false);
+          EXPECT_NEAR(expected_msg.x, actual_msg.x, tolerance);
+          EXPECT_NEAR(expected_msg.y, actual_msg.y, tolerance);
+          EXPECT_NEAR((*e)->getSecFromLastDetection(when), (*a)->getSecFromLastDetection(when), 1e-6);
+          EXPECT_EQ((*e)->getUpdatesWithEnoughConfidence(), (*a)->getUpdatesWithEnoughConfidence());
+
+          // The filter covariance, seen through the distance of points around the predicted position:
+          for(int i = 0; i < 4; i++)
+          {
+            double x = expected_msg.x + 0.2 * (i % 2), y = expected_msg.y + 0.2 * (i / 2);
+            EXPECT_NEAR((*e)->getMahalanobisDistance(x, y, when), (*a)->getMahalanobisDistance(x, y, when),
+                tolerance * 100.0);
+          }
+        }
+      }
+
+      virtual void
+      TearDown()
+      {
+        for(std::list<DetectionSource*>::iterator it = sources_.begin(); it != sources_.end(); it++)
+          delete *it;
+      }
+
+      TestTracker tracker_;
+      std::list<DetectionSource*> sources_;
+  };
+} /* namespace */
+
+TEST_F(TrackerTest, LateBatchKeepsUnmatchedTracksVisible)
+{
+  for(int frame = 0; frame <= 6; frame++)
+    track(10.0 + frame * PERIOD, coordinates(0.0, 5.0), coordinates(0.0, 5.0));
+  ASSERT_EQ(2u, tracker_.getTracks().size());
+
+  // A slower sensor, which sees only the first person, delivers a batch older than the last one:
+  track(10.0 + 5.5 * PERIOD, std::vector<double>(1, 0.0), std::vector<double>(1, 0.0));
+
+  ASSERT_EQ(2u, tracker_.getTracks().size());
+  for(std::list<Track*>::const_iterator it = tracker_.getTracks().begin(); it != tracker_.getTracks().end(); it++)
+    EXPECT_EQ(Track::VISIBLE, (*it)->getVisibility());
+}
+
+TEST_F(TrackerTest, LateBatchStartsTracksAtTheLatestTime)
+{
+  for(int frame = 0; frame <= 6; frame++)
+    track(10.0 + frame * PERIOD, std::vector<double>(1, 0.0), std::vector<double>(1, 0.0));
+  ASSERT_EQ(1u, tracker_.getTracks().size());
+
+  // A person seen only by a slower sensor:
+  track(10.0 + 5.5 * PERIOD, coordinates(0.0, 5.0), coordinates(0.0, 5.0));
+  ASSERT_EQ(2u, tracker_.getTracks().size());
+  Track* late_track = tracker_.getTracks().back();
+  ros::Time latest(10.0 + 6 * PERIOD);
+  EXPECT_NEAR(0.0, late_track->getSecFromFirstDetection(latest), 1e-6);
+  EXPECT_NEAR(0.0, late_track->getSecFromLastDetection(latest), 1e-6);
+
+  // The next batch in sequence updates the new track instead of starting another one:
+  track(10.0 + 7 * PERIOD, coordinates(0.0, 5.0), coordinates(0.0, 5.0));
+  EXPECT_EQ(2u, tracker_.getTracks().size());
+  EXPECT_NEAR(PERIOD, late_track->getSecFromFirstDetection(ros::Time(10.0 + 7 * PERIOD)), 1e-6);
+  EXPECT_NEAR(0.0, late_track->getSecFromLastDetection(ros::Time(10.0 + 7 * PERIOD)), 1e-6);
+}
+
+TEST_F(TrackerTest, DetectionOlderThanTheStateHistoryIsDropped)
+{
+  for(int frame = 0; frame <= 3; frame++)
+    track(10.0 + frame * PERIOD, std::vector<double>(1, 0.0), std::vector<double>(1, 0.0));
+  ASSERT_EQ(1u, tracker_.getTracks().size());
+  Track* t = tracker_.getTracks().front();
+  int updates = t->getUpdatesWithEnoughConfidence();
+  int low_confidence_frames = t->getLowConfidenceConsecutiveFrames();
+
+  // Older than the first detection of the track:
+  ros::Time stamp(9.0);
+  tf::StampedTransform transform(tf::Transform::getIdentity(), stamp, "/world", "/camera");
+  DetectionSource source(cv::Mat(0, 0, CV_8UC3), transform, transform, Eigen::Matrix3d::Identity(), stamp, "/camera");
+  EXPECT_FALSE(t->update(0.0, 0.0, 0.9, 1.8, 3.0, 0.0, -5.0, 0.0, -2.5, &source));
+  EXPECT_EQ(updates, t->getUpdatesWithEnoughConfidence());
+  EXPECT_EQ(low_confidence_frames, t->getLowConfidenceConsecutiveFrames());
+  EXPECT_NEAR(3 * PERIOD, t->getSecFromFirstDetection(ros::Time(10.0 + 3 * PERIOD)), 1e-6);
+}
+
+TEST_F(TrackerTest, PersonSeenByTwoCamerasInAFusionWindowHasOneTrack)
+{
+  for(int frame = 0; frame <= 30; frame++)
+  {
+    // Detections of a fusion window, sorted by time, where the cameras see the same person a few cm apart:
+    std::vector<Detection> detections;
+    addDetections(createSource(10.0 + frame * PERIOD, "/camera_a"), coordinates(0.0, 5.0), coordinates(0.0, 5.0),
+        detections);
+    addDetections(createSource(10.0 + frame * PERIOD + 0.005, "/camera_b"), std::vector<double>(1, 0.05),
+        std::vector<double>(1, 0.03), detections);
+    tracker_.newFrame(detections);
+    tracker_.updateTracks();
+    ASSERT_EQ(2u, tracker_.getTracks().size()) << "frame " << frame;
+  }
+
+  // Both tracks are updated by the latest detection:
+  for(std::list<Track*>::const_iterator it = tracker_.getTracks().begin(); it != tracker_.getTracks().end(); it++)
+    EXPECT_EQ(Track::VISIBLE, (*it)->getVisibility());
+  EXPECT_NEAR(0.0, tracker_.getTracks().front()->getSecFromLastDetection(ros::Time(10.0 + 30 * PERIOD + 0.005)), 1e-6);
+}
+
+TEST_F(TrackerTest, PeopleSeenByOneCameraKeepTheirTracks)
+{
+  // Two people close to each other in the gate of both tracks, seen by the same camera:
+  for(int frame = 0; frame <= 30; frame++)
+    track(10.0 + frame * PERIOD, coordinates(0.0, 0.3), coordinates(0.0, 0.0));
+  EXPECT_EQ(2u, tracker_.getTracks().size());
+}
+
+TEST_F(TrackerTest, RollbackMatchesInOrderProcessing)
+{
+  TestTracker in_order;
+  for(int frame = 0; frame <= 40; frame++)
+    walk(in_order, frame);
+
+  // The batch of frame 30 comes from a slower sensor and arrives after frame 33:
+  for(int frame = 0; frame <= 40; frame++)
+  {
+    if(frame != 30)
+      walk(tracker_, frame);
+    if(frame == 33)
+      walk(tracker_, 30);
+  }
+
+  ASSERT_EQ(2u, in_order.getTracks().size());
+  expectSameTracks(in_order, tracker_, ros::Time(10.0 + 41 * PERIOD), 1e-6);
+}
+
+TEST_F(TrackerTest, StateHistorySizedFromTheDetectionDelayKeepsLateDetections)
+{
+  // A batch more than DEFAULT_STATE_HISTORY_SIZE frames late:
+  const int late_frame = 20, arrival_frame = late_frame + 3 * Track::DEFAULT_STATE_HISTORY_SIZE / 2;
+  size_t size = Track::getStateHistorySize(2.0 * Track::DEFAULT_STATE_HISTORY_SIZE * PERIOD, PERIOD, 1);
+  ASSERT_GT(size, size_t(arrival_frame - late_frame));
+  tracker_.setStateHistorySize(size);
+  TestTracker in_order;
+  in_order.setStateHistorySize(size);
+
+  for(int frame = 0; frame <= arrival_frame; frame++)
+  {
+    walk(in_order, frame);
+    if(frame != late_frame)
+      walk(tracker_, frame);
+  }
+  walk(tracker_, late_frame);
+
+  // The past position used for the velocity observations is extrapolated while the batch is missing:
+  expectSameTracks(in_order, tracker_, ros::Time(10.0 + (arrival_frame + 1) * PERIOD), 1e-3);
+}
+
+int
+main(int argc, char** argv)
+{
+  // Time is needed by the throttled log messages of the tracker:
+  ros::Time::init();
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
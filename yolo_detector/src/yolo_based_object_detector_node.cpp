@@ -44,6 +44,7 @@ extern  "C"{
 #include <Eigen/Eigen>
 
 #include <open_ptrack/opt_utils/conversions.h>
+#include <open_ptrack/opt_utils/latency_reporter.h>
 
 
 using namespace sensor_msgs;
@@ -81,6 +82,12 @@ double _constant_y;
 std::string encoding;
 float mm_factor;
 
+// Latency histograms (NULL if latency profiling is disabled):
+open_ptrack::opt_utils::LatencyHistogram* frame_latency = NULL;
+open_ptrack::opt_utils::LatencyHistogram* conversion_latency = NULL;
+open_ptrack::opt_utils::LatencyHistogram* inference_latency = NULL;
+open_ptrack::opt_utils::LatencyHistogram* localization_latency = NULL;
+
 void camera_info_cb (const CameraInfo::ConstPtr & msg)
 {
 	intrinsics_matrix << msg->K[0], 0, msg->K[2], 0, msg->K[4], msg->K[5], 0, 0, 1;
@@ -173,8 +180,11 @@ void callback(const Image::ConstPtr& rgb_image,
     if((pub.getNumSubscribers() > 0 || detection_pub.getNumSubscribers()) && camera_info_available_flag)
     {
 	//	std::cout<<"Run Yolo"<<std::endl;
+		open_ptrack::opt_utils::ScopedLatencyTimer frame_timer(frame_latency);
 		ros::Time begin = ros::Time::now();
+		open_ptrack::opt_utils::ScopedLatencyTimer conversion_timer(conversion_latency);
 		image im = convert_image(cv_ptr_rgb,0,0);
+		conversion_timer.stop();
 		
 		//std::cout << "START CREATE BOX INFO" << std::endl;
 		boxInfo* boxes = (boxInfo*)calloc(1, sizeof(boxInfo));
@@ -182,7 +192,9 @@ void callback(const Image::ConstPtr& rgb_image,
 		boxes->boxes = (adjBox*)calloc(200, sizeof(adjBox));
 		
 		//std::cout << "ENTER C CODE" << std::endl;
+		open_ptrack::opt_utils::ScopedLatencyTimer inference_timer(inference_latency);
 		run_yolo_detection_obj(im, net, boxes_y, probs, thresh,  hier_thresh, names, boxes);
+		inference_timer.stop();
 		
 		printf( "Yolo object count = %d\n", boxes->num);
 		double duration = ros::Time::now().toSec() - begin.toSec();
@@ -191,6 +203,7 @@ void callback(const Image::ConstPtr& rgb_image,
 		
     	
     	//Get Depth Image
+		open_ptrack::opt_utils::ScopedLatencyTimer localization_timer(localization_latency);
 		cv::Mat _depth_image;
 		cv_bridge::CvImage::Ptr cv_ptr_depth;
 		try
@@ -308,6 +321,7 @@ void callback(const Image::ConstPtr& rgb_image,
 				
 			}
 		}
+		localization_timer.stop();
 		
 		if(pub.getNumSubscribers() > 0)
 		{
@@ -397,6 +411,26 @@ std::string datacfg;
 	std::string root_str;
 	nh.param("root", root_str, std::string("home"));
 	
+	// Latency profiling of the detection stages (statistics are published on /diagnostics):
+	bool latency_profiling;
+	nh.param("latency_profiling", latency_profiling, false);
+	double latency_report_period;
+	nh.param("latency_report_period", latency_report_period, 5.0);
+	std::string latency_log;
+	nh.param("latency_log", latency_log, std::string(""));
+	
+	open_ptrack::opt_utils::LatencyProfiler latency_profiler(latency_profiling);
+	frame_latency = latency_profiler.getHistogram("yolo/frame");
+	conversion_latency = latency_profiler.getHistogram("yolo/conversion");
+	inference_latency = latency_profiler.getHistogram("yolo/inference");
+	localization_latency = latency_profiler.getHistogram("yolo/localization");
+	boost::shared_ptr<open_ptrack::opt_utils::LatencyReporter> latency_reporter;
+	if (latency_profiling)
+	{
+		latency_reporter.reset(new open_ptrack::opt_utils::LatencyReporter(nh, latency_profiler, ros::this_node::getName(),
+		    latency_report_period, latency_log));
+	}
+	
 	// revise to new API 
     net = parse_network_cfg( (char*)cfgfile.c_str() );
 	char *arr = (char*)((void*) &(net->layers[0]));